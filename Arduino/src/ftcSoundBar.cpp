@@ -31,6 +31,33 @@ void FtcSoundBar::i2cSend( i2c_cmd_t cmd, uint8_t data ) {
   Wire.endTransmission();  
 }
 
+void FtcSoundBar::i2cSend( i2c_cmd_t cmd, uint8_t data1, uint8_t data2 ) {
+  Wire.beginTransmission( I2CAddress );
+  Wire.write( cmd );
+  Wire.write( data1 );
+  Wire.write( data2 );
+  Wire.endTransmission();
+}
+
+void FtcSoundBar::i2cSend( i2c_cmd_t cmd, uint8_t data1, uint8_t data2, uint8_t data3 ) {
+  Wire.beginTransmission( I2CAddress );
+  Wire.write( cmd );
+  Wire.write( data1 );
+  Wire.write( data2 );
+  Wire.write( data3 );
+  Wire.endTransmission();
+}
+
+void FtcSoundBar::i2cSend( i2c_cmd_t cmd, uint8_t data1, uint8_t data2, uint8_t data3, uint8_t data4 ) {
+  Wire.beginTransmission( I2CAddress );
+  Wire.write( cmd );
+  Wire.write( data1 );
+  Wire.write( data2 );
+  Wire.write( data3 );
+  Wire.write( data4 );
+  Wire.endTransmission();
+}
+
 uint8_t FtcSoundBar::i2cReceive( i2c_cmd_t cmd ) {
 
   i2cSend( (uint8_t) cmd, 1 );
@@ -46,6 +73,11 @@ void FtcSoundBar::play( uint8_t track ) {
   i2cSend( I2C_CMD_PLAY, track );
 }
 
+void FtcSoundBar::play( uint8_t track, uint8_t priority ) {
+  // play Track with priority
+  i2cSend( I2C_CMD_PLAY_PRIORITY, track, priority );
+}
+
 void FtcSoundBar::setVolume( uint8_t volume ) {
   // set volume
   i2cSend( I2C_CMD_SET_VOLUME, volume );
@@ -105,3 +137,80 @@ void FtcSoundBar::previous( void ) {
   // play previous track
   i2cSend( I2C_CMD_PREVIOUS );
 }
+
+void FtcSoundBar::enqueue( uint8_t track ) {
+  // play track after the queued tracks
+  i2cSend( I2C_CMD_ENQUEUE, track );
+}
+
+void FtcSoundBar::clearQueue( void ) {
+  // remove all queued tracks
+  i2cSend( I2C_CMD_CLEAR_QUEUE );
+}
+
+void FtcSoundBar::playTone( uint16_t frequency, uint16_t duration, tone_waveform_t waveform ) {
+  // play a tone
+  if ( duration > 2550 ) duration = 2550;
+  i2cSend( I2C_CMD_TONE, frequency & 0xFF, frequency >> 8, duration / 10, (uint8_t) waveform );
+}
+
+void FtcSoundBar::playPhrase( uint8_t track1, uint8_t track2, uint8_t track3, uint8_t track4 ) {
+  // play up to 4 tracks without gaps
+  i2cSend( I2C_CMD_PHRASE, track1, track2, track3, track4 );
+}
+
+void FtcSoundBar::playNumber( uint32_t number ) {
+  // say a number
+  i2cSend( I2C_CMD_NUMBER, number & 0xFF, ( number >> 8 ) & 0xFF, ( number >> 16 ) & 0xFF );
+}
+
+void FtcSoundBar::setRate( uint16_t rate ) {
+  // set pitch and tempo
+  i2cSend( I2C_CMD_SET_RATE, rate & 0xFF, rate >> 8 );
+}
+
+void FtcSoundBar::playForeground( uint8_t track ) {
+  // play an effect over the music
+  i2cSend( I2C_CMD_PLAY_FOREGROUND, track );
+}
+
+void FtcSoundBar::setFolder( uint8_t folder ) {
+  // switch the playlist to another folder
+  i2cSend( I2C_CMD_SET_FOLDER, folder );
+}
+
+void FtcSoundBar::setPlaylist( uint8_t playlist ) {
+  // play the tracks in the order of a m3u file
+  i2cSend( I2C_CMD_SET_PLAYLIST, playlist );
+}
+
+uint32_t FtcSoundBar::hashName( const char *name ) {
+  // FNV-1a, the same as the sound bar uses
+  uint32_t hash = 2166136261UL;
+  for ( ; *name != '\0'; name++ ) {
+    char c = *name;
+    if ( ( c >= 'A' ) && ( c <= 'Z' ) ) c += 'a' - 'A';
+    hash = ( hash ^ (uint8_t) c ) * 16777619UL;
+  }
+  return hash;
+}
+
+void FtcSoundBar::playName( const char *name ) {
+  // play a track by its file name
+  playHash( hashName( name ) );
+}
+
+void FtcSoundBar::playHash( uint32_t hash ) {
+  // play a track by the hash of its name
+  i2cSend( I2C_CMD_PLAY_HASH, hash & 0xFF, ( hash >> 8 ) & 0xFF, ( hash >> 16 ) & 0xFF, ( hash >> 24 ) & 0xFF );
+}
+
+void FtcSoundBar::rescan( void ) {
+  // read the sd card again
+  i2cSend( I2C_CMD_RESCAN );
+}
+
+uint8_t FtcSoundBar::getVersion( void ) {
+  // get playlist version
+  return i2cReceive( I2C_CMD_GET_VERSION );
+}
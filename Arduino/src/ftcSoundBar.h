@@ -29,6 +29,14 @@ typedef enum {
     STATE_ERROR
 } state_t;
 
+// ftcSoundBar waveforms to use with playTone()
+typedef enum {
+  TONE_SINE = 0,
+  TONE_SQUARE = 1,
+  TONE_SWEEP = 2,
+  TONE_NOISE = 3
+} tone_waveform_t;
+
 // internal definition of I2C-CMDs.
 typedef enum I2C_CMD {
   I2C_CMD_PLAY=0,
@@ -43,7 +51,20 @@ typedef enum I2C_CMD {
   I2C_CMD_GET_ACTIVE_TRACK=9,
   I2C_CMD_GET_TRACK_STATE=10,
   I2C_CMD_NEXT=11,
-  I2C_CMD_PREVIOUS=12
+  I2C_CMD_PREVIOUS=12,
+  I2C_CMD_PLAY_PRIORITY=13,
+  I2C_CMD_ENQUEUE=14,
+  I2C_CMD_CLEAR_QUEUE=15,
+  I2C_CMD_TONE=16,
+  I2C_CMD_PHRASE=17,
+  I2C_CMD_NUMBER=18,
+  I2C_CMD_SET_RATE=19,
+  I2C_CMD_PLAY_FOREGROUND=20,
+  I2C_CMD_SET_FOLDER=21,
+  I2C_CMD_SET_PLAYLIST=22,
+  I2C_CMD_PLAY_HASH=23,
+  I2C_CMD_RESCAN=24,
+  I2C_CMD_GET_VERSION=25
 } i2c_cmd_t;
 
 class FtcSoundBar {
@@ -51,12 +72,17 @@ class FtcSoundBar {
     uint8_t I2CAddress;
     void i2cSend( i2c_cmd_t cmd );
     void i2cSend( i2c_cmd_t cmd, uint8_t data );
+    void i2cSend( i2c_cmd_t cmd, uint8_t data1, uint8_t data2 );
+    void i2cSend( i2c_cmd_t cmd, uint8_t data1, uint8_t data2, uint8_t data3 );
+    void i2cSend( i2c_cmd_t cmd, uint8_t data1, uint8_t data2, uint8_t data3, uint8_t data4 );
     uint8_t i2cReceive( i2c_cmd_t cmd );
   public:
     FtcSoundBar( uint8_t myI2CAddress = 0x33 );
       // constructor
     void play( uint8_t track );
       // play Track;
+    void play( uint8_t track, uint8_t priority );
+      // play Track with priority 0..7, lower priority tracks resume afterwards
     void setVolume( uint8_t volume );
       // set volume
     uint8_t getVolume( void ); 
@@ -81,6 +107,34 @@ class FtcSoundBar {
       // play next track
     void previous( void ); 
       // play previous track
+    void enqueue( uint8_t track );
+      // play track after the queued tracks
+    void clearQueue( void );
+      // remove all queued tracks
+    void playTone( uint16_t frequency, uint16_t duration, tone_waveform_t waveform = TONE_SINE );
+      // play a tone, frequency in Hz, duration in ms (10ms steps, max. 2550ms)
+    void playPhrase( uint8_t track1, uint8_t track2, uint8_t track3 = 0xFF, uint8_t track4 = 0xFF );
+      // play up to 4 tracks without gaps, e.g. words of an announcement
+    void playNumber( uint32_t number );
+      // say a number up to 999999, needs the tracks 0..19, 20, 30, .. 90, 100 and 1000
+    void setRate( uint16_t rate );
+      // pitch and tempo in per mille (250..4000, 1000 = normal), e.g. an engine sound following the motor. Needs OUTPUT_RATE.
+    void playForeground( uint8_t track );
+      // play an effect over the music, which is ducked meanwhile. Needs DUCK and OUTPUT_RATE.
+    void setFolder( uint8_t folder );
+      // switch the playlist to a folder of the sd card, 0 is the root and the subfolders follow sorted by name.
+    void setPlaylist( uint8_t playlist );
+      // play the tracks in the order of a m3u file of the folder, 1 is the first by name. 0 - alphabetic order.
+    void playName( const char *name );
+      // play a track by its file name, e.g. "horn.mp3". Unlike the track number it stays valid when tracks are added.
+    static uint32_t hashName( const char *name );
+      // 32 bit FNV-1a of the lower case name as used by playName, e.g. to store it in a constant.
+    void playHash( uint32_t hash );
+      // play a track by the hash of its name.
+    void rescan( void );
+      // read the sd card again after tracks were copied onto it, in the background.
+    uint8_t getVersion( void );
+      // changes whenever the tracks change, e.g. after a rescan.
 };
 
 #endif
@@ -0,0 +1,353 @@
+/*
+ * adpcm_decoder.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#include <esp_log.h>
+#include <audio_mem.h>
+#include <string.h>
+
+#include "adpcm_decoder.h"
+
+#define TAGADPCM "::ADPCM"
+
+#define ADPCM_RAW_BLOCK 512
+#define ADPCM_SKIP_BUF  64
+
+typedef enum {
+	ADPCM_STATE_HEADER,
+	ADPCM_STATE_DATA,
+	ADPCM_STATE_RAW
+} adpcm_state_t;
+
+typedef struct {
+	int16_t predictor;
+	int8_t  index;
+} adpcm_channel_t;
+
+typedef struct {
+	adpcm_state_t   state;
+	int             channels;
+	int             rate;
+	int             block_align;
+	int             samples_per_block;
+	uint32_t        data_left;		// of the data chunk, trailing chunks are no audio
+	bool            open_end;		// see adpcm_decoder_set_open_end
+	uint8_t         *block;
+	int16_t         *pcm;
+	adpcm_channel_t channel[2];
+} adpcm_decoder_t;
+
+static const int16_t step_table[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+	253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+	1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+	3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+	12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t index_table[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static uint16_t le16( const uint8_t *p ) {
+	return p[0] | ( p[1] << 8 );
+}
+
+static uint32_t le32( const uint8_t *p ) {
+	return p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( (uint32_t)p[3] << 24 );
+}
+
+static inline int16_t adpcm_nibble( adpcm_channel_t *ch, uint8_t nibble ) {
+
+	int step = step_table[ ch->index ];
+	int diff = step >> 3;
+
+	if ( nibble & 1 ) diff += step >> 2;
+	if ( nibble & 2 ) diff += step >> 1;
+	if ( nibble & 4 ) diff += step;
+
+	int predictor = ch->predictor + ( ( nibble & 8 ) ? -diff : diff );
+	if ( predictor > 32767 ) predictor = 32767;
+	if ( predictor < -32768 ) predictor = -32768;
+	ch->predictor = predictor;
+
+	int index = ch->index + index_table[ nibble ];
+	if ( index < 0 ) index = 0;
+	if ( index > 88 ) index = 88;
+	ch->index = index;
+
+	return ch->predictor;
+
+}
+
+// decodes one wav block, returns the number of frames
+static int adpcm_decode_block( adpcm_decoder_t *adpcm, const uint8_t *block, int len ) {
+
+	int channels = adpcm->channels;
+	int header = 4 * channels;
+
+	if ( len < header ) return 0;
+
+	// block header: predictor, step index and the first sample of each channel
+	for ( int c = 0; c < channels; c++ ) {
+		adpcm->channel[c].predictor = (int16_t) le16( &block[ 4 * c ] );
+		adpcm->channel[c].index = ( block[ 4 * c + 2 ] > 88 ) ? 88 : block[ 4 * c + 2 ];
+		adpcm->pcm[c] = adpcm->channel[c].predictor;
+	}
+
+	// channels are interleaved in groups of 4 bytes = 8 samples
+	int groups = ( len - header ) / ( 4 * channels );
+	const uint8_t *p = &block[ header ];
+
+	for ( int g = 0; g < groups; g++ ) {
+		for ( int c = 0; c < channels; c++ ) {
+			int16_t *out = &adpcm->pcm[ ( 1 + 8 * g ) * channels + c ];
+			for ( int b = 0; b < 4; b++, p++ ) {
+				out[ ( 2 * b ) * channels ]     = adpcm_nibble( &adpcm->channel[c], *p & 0x0f );
+				out[ ( 2 * b + 1 ) * channels ] = adpcm_nibble( &adpcm->channel[c], *p >> 4 );
+			}
+		}
+	}
+
+	return 1 + 8 * groups;
+
+}
+
+// chunk sizes of 0 or 0xFFFFFFFF are written by streaming encoders which don't know the size yet
+#define ADPCM_DATA_UNKNOWN 0xFFFFFFFF
+
+// reads exactly len bytes unless the stream ends
+static int adpcm_read( audio_element_handle_t self, uint8_t *buf, int len ) {
+
+	int fill = 0;
+
+	while ( fill < len ) {
+		int r_size = audio_element_input( self, (char *) &buf[fill], len - fill );
+		if ( r_size <= 0 ) {
+			return ( fill > 0 ) ? fill : r_size;
+		}
+		fill += r_size;
+	}
+
+	return fill;
+
+}
+
+static int adpcm_skip( audio_element_handle_t self, uint32_t len ) {
+
+	uint8_t buf[ADPCM_SKIP_BUF];
+
+	while ( len > 0 ) {
+		int r_size = adpcm_read( self, buf, ( len < sizeof(buf) ) ? len : sizeof(buf) );
+		if ( r_size <= 0 ) return r_size;
+		len -= r_size;
+	}
+
+	return 1;
+
+}
+
+static esp_err_t adpcm_start( audio_element_handle_t self, adpcm_decoder_t *adpcm ) {
+
+	adpcm->block = (uint8_t *) audio_malloc( adpcm->block_align );
+	adpcm->pcm = (int16_t *) audio_malloc( adpcm->samples_per_block * adpcm->channels * sizeof(int16_t) );
+	AUDIO_MEM_CHECK( TAGADPCM, adpcm->block && adpcm->pcm, return ESP_FAIL );
+
+	ESP_LOGD( TAGADPCM, "%dHz %dch, block %d bytes/%d samples", adpcm->rate, adpcm->channels, adpcm->block_align, adpcm->samples_per_block );
+
+	audio_element_set_music_info( self, adpcm->rate, adpcm->channels, 16 );
+	audio_element_report_info( self );
+
+	return ESP_OK;
+
+}
+
+static audio_element_err_t adpcm_parse_header( audio_element_handle_t self, adpcm_decoder_t *adpcm ) {
+
+	uint8_t hdr[20];
+	int r_size;
+	bool fmt = false;
+
+	r_size = adpcm_read( self, hdr, 12 );
+	if ( r_size < 12 ) return ( r_size <= 0 ) ? (audio_element_err_t) r_size : AEL_IO_DONE;
+
+	if ( ( memcmp( hdr, "RIFF", 4 ) != 0 ) || ( memcmp( &hdr[8], "WAVE", 4 ) != 0 ) ) {
+
+		// raw stream, the bytes read so far are audio already
+		adpcm->state = ADPCM_STATE_RAW;
+		adpcm->channels = 1;
+		adpcm->rate = ADPCM_RAW_RATE;
+		adpcm->block_align = ADPCM_RAW_BLOCK;
+		adpcm->samples_per_block = 2 * ADPCM_RAW_BLOCK;
+		adpcm->channel[0].predictor = 0;
+		adpcm->channel[0].index = 0;
+		if ( adpcm_start( self, adpcm ) != ESP_OK ) return AEL_IO_FAIL;
+
+		for ( int i = 0; i < 12; i++ ) {
+			adpcm->pcm[ 2 * i ]     = adpcm_nibble( &adpcm->channel[0], hdr[i] & 0x0f );
+			adpcm->pcm[ 2 * i + 1 ] = adpcm_nibble( &adpcm->channel[0], hdr[i] >> 4 );
+		}
+		return audio_element_output( self, (char *) adpcm->pcm, 24 * sizeof(int16_t) );
+
+	}
+
+	while ( true ) {
+
+		r_size = adpcm_read( self, hdr, 8 );
+		if ( r_size < 8 ) return AEL_IO_FAIL;
+
+		uint32_t size = le32( &hdr[4] );
+
+		if ( memcmp( hdr, "fmt ", 4 ) == 0 ) {
+
+			if ( ( size < 20 ) || ( adpcm_read( self, hdr, 20 ) != 20 ) ) return AEL_IO_FAIL;
+			if ( le16( &hdr[0] ) != 0x11 ) {
+				ESP_LOGE( TAGADPCM, "format 0x%x is not IMA-ADPCM", le16( &hdr[0] ) );
+				return AEL_IO_FAIL;
+			}
+
+			adpcm->channels          = le16( &hdr[2] );
+			adpcm->rate              = le32( &hdr[4] );
+			adpcm->block_align       = le16( &hdr[12] );
+			adpcm->samples_per_block = le16( &hdr[18] );
+			if ( adpcm_skip( self, size - 20 + ( size & 1 ) ) <= 0 ) return AEL_IO_FAIL;
+			fmt = true;
+
+		} else if ( memcmp( hdr, "data", 4 ) == 0 ) {
+
+			if ( !fmt ) return AEL_IO_FAIL;
+			adpcm->data_left = ( ( size == 0 ) || adpcm->open_end ) ? ADPCM_DATA_UNKNOWN : size;
+			break;
+
+		} else if ( adpcm_skip( self, size + ( size & 1 ) ) <= 0 ) {
+
+			return AEL_IO_FAIL;
+
+		}
+	}
+
+	if ( ( adpcm->channels < 1 ) || ( adpcm->channels > 2 ) ||
+	     ( adpcm->block_align <= 4 * adpcm->channels ) || ( adpcm->block_align > ADPCM_MAX_BLOCK_ALIGN ) ||
+	     ( adpcm->samples_per_block != 1 + ( adpcm->block_align - 4 * adpcm->channels ) * 2 / adpcm->channels ) ) {
+		ESP_LOGE( TAGADPCM, "unsupported layout %dch block %d", adpcm->channels, adpcm->block_align );
+		return AEL_IO_FAIL;
+	}
+
+	adpcm->state = ADPCM_STATE_DATA;
+	if ( adpcm_start( self, adpcm ) != ESP_OK ) return AEL_IO_FAIL;
+
+	// nothing decoded yet, but the element must keep on running
+	return (audio_element_err_t) 1;
+
+}
+
+static esp_err_t adpcm_open( audio_element_handle_t self ) {
+
+	adpcm_decoder_t *adpcm = (adpcm_decoder_t *) audio_element_getdata( self );
+
+	adpcm->state = ADPCM_STATE_HEADER;
+
+	return ESP_OK;
+
+}
+
+static esp_err_t adpcm_close( audio_element_handle_t self ) {
+
+	adpcm_decoder_t *adpcm = (adpcm_decoder_t *) audio_element_getdata( self );
+
+	audio_free( adpcm->block );
+	audio_free( adpcm->pcm );
+	adpcm->block = NULL;
+	adpcm->pcm = NULL;
+	adpcm->open_end = false;
+
+	return ESP_OK;
+
+}
+
+static esp_err_t adpcm_destroy( audio_element_handle_t self ) {
+
+	adpcm_close( self );
+	audio_free( audio_element_getdata( self ) );
+
+	return ESP_OK;
+
+}
+
+static audio_element_err_t adpcm_process( audio_element_handle_t self, char *in_buffer, int in_len ) {
+
+	adpcm_decoder_t *adpcm = (adpcm_decoder_t *) audio_element_getdata( self );
+	int r_size, frames, len;
+
+	switch ( adpcm->state ) {
+
+	case ADPCM_STATE_HEADER:
+		return adpcm_parse_header( self, adpcm );
+
+	case ADPCM_STATE_DATA:
+		if ( adpcm->data_left == 0 ) return AEL_IO_DONE;
+
+		len = adpcm->block_align;
+		if ( ( adpcm->data_left != ADPCM_DATA_UNKNOWN ) && ( (uint32_t) len > adpcm->data_left ) ) len = adpcm->data_left;
+
+		r_size = adpcm_read( self, adpcm->block, len );
+		if ( r_size <= 0 ) return (audio_element_err_t) r_size;
+		if ( adpcm->data_left != ADPCM_DATA_UNKNOWN ) adpcm->data_left -= r_size;
+
+		// the last block may be shorter
+		frames = adpcm_decode_block( adpcm, adpcm->block, r_size );
+		if ( frames == 0 ) return AEL_IO_DONE;
+		return audio_element_output( self, (char *) adpcm->pcm, frames * adpcm->channels * sizeof(int16_t) );
+
+	case ADPCM_STATE_RAW:
+		r_size = audio_element_input( self, (char *) adpcm->block, ADPCM_RAW_BLOCK );
+		if ( r_size <= 0 ) return (audio_element_err_t) r_size;
+
+		for ( int i = 0; i < r_size; i++ ) {
+			adpcm->pcm[ 2 * i ]     = adpcm_nibble( &adpcm->channel[0], adpcm->block[i] & 0x0f );
+			adpcm->pcm[ 2 * i + 1 ] = adpcm_nibble( &adpcm->channel[0], adpcm->block[i] >> 4 );
+		}
+		return audio_element_output( self, (char *) adpcm->pcm, 2 * r_size * sizeof(int16_t) );
+
+	}
+
+	return AEL_IO_FAIL;
+
+}
+
+audio_element_handle_t adpcm_decoder_init( adpcm_decoder_cfg_t *config ) {
+
+	adpcm_decoder_t *adpcm = (adpcm_decoder_t *) audio_calloc( 1, sizeof(adpcm_decoder_t) );
+	AUDIO_MEM_CHECK( TAGADPCM, adpcm, return NULL );
+
+	audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+	cfg.open        = adpcm_open;
+	cfg.close       = adpcm_close;
+	cfg.process     = adpcm_process;
+	cfg.destroy     = adpcm_destroy;
+	cfg.tag         = "adpcm";
+	cfg.task_stack  = config->task_stack;
+	cfg.task_prio   = config->task_prio;
+	cfg.task_core   = config->task_core;
+	cfg.out_rb_size = config->out_rb_size;
+
+	audio_element_handle_t el = audio_element_init( &cfg );
+	AUDIO_MEM_CHECK( TAGADPCM, el, { audio_free( adpcm ); return NULL; } );
+	audio_element_setdata( el, adpcm );
+
+	return el;
+
+}
+
+void adpcm_decoder_set_open_end( audio_element_handle_t self, bool open_end ) {
+
+	adpcm_decoder_t *adpcm = (adpcm_decoder_t *) audio_element_getdata( self );
+
+	adpcm->open_end = open_end;
+
+}
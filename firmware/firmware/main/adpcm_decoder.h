@@ -0,0 +1,45 @@
+/*
+ * adpcm_decoder.h
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#ifndef MAIN_ADPCM_DECODER_H_
+#define MAIN_ADPCM_DECODER_H_
+
+#include <audio_element.h>
+
+// IMA-ADPCM decoder for RIFF/WAVE files with format tag 0x11.
+// Files without RIFF header are decoded as raw mono nibble stream with ADPCM_RAW_RATE.
+// wav files end with their data chunk, chunks behind it like LIST/INFO are not decoded. raw streams play until their end.
+
+#define ADPCM_RAW_RATE             22050
+#define ADPCM_MAX_BLOCK_ALIGN      4096
+
+#define ADPCM_DECODER_TASK_STACK   (3 * 1024)
+#define ADPCM_DECODER_TASK_CORE    (0)
+#define ADPCM_DECODER_TASK_PRIO    (5)
+#define ADPCM_DECODER_RINGBUFFER_SIZE (8 * 1024)
+
+typedef struct {
+	int out_rb_size;
+	int task_stack;
+	int task_core;
+	int task_prio;
+} adpcm_decoder_cfg_t;
+
+#define DEFAULT_ADPCM_DECODER_CONFIG() {               \
+	.out_rb_size = ADPCM_DECODER_RINGBUFFER_SIZE,      \
+	.task_stack  = ADPCM_DECODER_TASK_STACK,           \
+	.task_core   = ADPCM_DECODER_TASK_CORE,            \
+	.task_prio   = ADPCM_DECODER_TASK_PRIO             \
+}
+
+audio_element_handle_t adpcm_decoder_init( adpcm_decoder_cfg_t *config );
+
+// the reader appends further data or loops inside it, so the data chunk size doesn't tell the end.
+// the reader has to leave out the trailing chunks then. holds for the next run only.
+void adpcm_decoder_set_open_end( audio_element_handle_t self, bool open_end );
+
+#endif /* MAIN_ADPCM_DECODER_H_ */
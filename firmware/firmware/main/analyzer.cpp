@@ -0,0 +1,910 @@
+/*
+ * analyzer.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "playlist.h"
+#include "analyzer.h"
+#include "memorypolicy.h"
+
+#define TAGANALYZER "::ANALYZER"
+
+#define ANALYZER_BUFSIZE 4096
+
+// replay gain 2.0 reference level
+#define REPLAYGAIN_REFERENCE (-18)
+
+// bytes read of a tag text, enough for ANALYZER_TEXT_MAX characters in utf-16
+#define TAG_FRAME_MAX (2 * ANALYZER_TEXT_MAX + 2)
+
+#define OGG_PAGE_HEADER 27
+#define OGG_PAGE_MAX    65307
+
+typedef struct {
+	uint16_t format;
+	uint16_t channels;
+	uint32_t rate;
+	uint16_t block_align;
+	uint16_t bits;
+} wav_format_t;
+
+typedef struct {
+	int32_t start_ms;	// -1 = not set
+	int32_t end_ms;
+	int32_t loop_start_ms;
+	int32_t loop_end_ms;
+} analyzer_cue_t;
+
+typedef struct {
+	PlayList *playList;
+	char     directory[80];
+	char     indexFile[100];
+	bool     analyze;
+	int      target;
+	int      trim_level;
+} analyzer_job_t;
+
+static analyzer_job_t job;
+static volatile bool running = false;
+
+static uint16_t le16( const uint8_t *p ) {
+	return p[0] | ( p[1] << 8 );
+}
+
+static uint32_t le32( const uint8_t *p ) {
+	return p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( (uint32_t)p[3] << 24 );
+}
+
+static uint32_t be32( const uint8_t *p ) {
+	return ( (uint32_t)p[0] << 24 ) | ( p[1] << 16 ) | ( p[2] << 8 ) | p[3];
+}
+
+static uint32_t syncsafe32( const uint8_t *p ) {
+	return ( ( p[0] & 0x7f ) << 21 ) | ( ( p[1] & 0x7f ) << 14 ) | ( ( p[2] & 0x7f ) << 7 ) | ( p[3] & 0x7f );
+}
+
+static int8_t limit_gain( float gain, float peak_db ) {
+
+	// keep 1dB headroom
+	if ( gain > -1.0f - peak_db ) gain = -1.0f - peak_db;
+
+	if ( gain < ANALYZER_MIN_GAIN ) gain = ANALYZER_MIN_GAIN;
+	if ( gain > ANALYZER_MAX_GAIN ) gain = ANALYZER_MAX_GAIN;
+
+	return (int8_t) lrintf( gain );
+
+}
+
+// returns the file position of the data chunk or -1
+static long wav_find_data( FILE *f, wav_format_t *fmt, uint32_t *data_size ) {
+
+	uint8_t hdr[16];
+	uint32_t size;
+
+	if ( ( fread( hdr, 1, 12, f ) != 12 ) || ( memcmp( hdr, "RIFF", 4 ) != 0 ) || ( memcmp( &hdr[8], "WAVE", 4 ) != 0 ) ) {
+		return -1;
+	}
+
+	while ( fread( hdr, 1, 8, f ) == 8 ) {
+
+		size = le32( &hdr[4] );
+
+		if ( memcmp( hdr, "fmt ", 4 ) == 0 ) {
+
+			if ( ( size < 16 ) || ( fread( hdr, 1, 16, f ) != 16 ) ) return -1;
+			fmt->format   = le16( &hdr[0] );
+			fmt->channels = le16( &hdr[2] );
+			fmt->rate     = le32( &hdr[4] );
+			fmt->block_align = le16( &hdr[12] );
+			fmt->bits     = le16( &hdr[14] );
+			fseek( f, size - 16 + ( size & 1 ), SEEK_CUR );
+
+		} else if ( memcmp( hdr, "data", 4 ) == 0 ) {
+
+			*data_size = size;
+			return ftell( f );
+
+		} else {
+
+			fseek( f, size + ( size & 1 ), SEEK_CUR );
+
+		}
+	}
+
+	return -1;
+
+}
+
+// <track>.trim holds START=<ms>, END=<ms>, LOOP_START=<ms> and LOOP_END=<ms>, all are optional
+static bool read_cue( const char *path, analyzer_cue_t *cue ) {
+
+	char name[310];
+	char line[64];
+
+	cue->start_ms = -1;
+	cue->end_ms = -1;
+	cue->loop_start_ms = -1;
+	cue->loop_end_ms = -1;
+
+	snprintf( name, sizeof(name), "%s.trim", path );
+
+	FILE *f = fopen( name, "r" );
+	if ( f == NULL ) return false;
+
+	while ( fgets( line, sizeof(line), f ) != NULL ) {
+		if ( strncmp( line, "START=", 6 ) == 0 ) {
+			cue->start_ms = atoi( &line[6] );
+		} else if ( strncmp( line, "END=", 4 ) == 0 ) {
+			cue->end_ms = atoi( &line[4] );
+		} else if ( strncmp( line, "LOOP_START=", 11 ) == 0 ) {
+			cue->loop_start_ms = atoi( &line[11] );
+		} else if ( strncmp( line, "LOOP_END=", 9 ) == 0 ) {
+			cue->loop_end_ms = atoi( &line[9] );
+		}
+	}
+
+	fclose( f );
+
+	ESP_LOGD( TAGANALYZER, "%s: start %dms end %dms, loop %dms..%dms", name, cue->start_ms, cue->end_ms, cue->loop_start_ms, cue->loop_end_ms );
+
+	return ( cue->start_ms >= 0 ) || ( cue->end_ms >= 0 ) || ( cue->loop_start_ms >= 0 ) || ( cue->loop_end_ms >= 0 );
+
+}
+
+// file position of a cue point, rounded down to whole blocks
+static uint32_t wav_cue_pos( long data, uint32_t data_size, const wav_format_t *fmt, uint32_t samples_per_block, int32_t ms ) {
+
+	uint64_t pos = (uint64_t) ms * fmt->rate / 1000 / samples_per_block * fmt->block_align;
+	if ( pos > data_size ) pos = data_size;
+
+	return data + pos;
+
+}
+
+static bool analyze_wav( FILE *f, int target, int trim_level, const analyzer_cue_t *cue, analyzer_result_t *result ) {
+
+	wav_format_t fmt = {};
+	uint32_t data_size = 0;
+	uint32_t samples_per_block = 0;
+	bool found = false;
+
+	long data = wav_find_data( f, &fmt, &data_size );
+	if ( ( data < 0 ) || ( fmt.channels == 0 ) || ( fmt.block_align == 0 ) ) return false;
+
+	// 16 bit pcm or extensible
+	bool pcm = ( ( fmt.format == 1 ) || ( fmt.format == 0xfffe ) ) && ( fmt.bits == 16 );
+
+	if ( pcm ) {
+		samples_per_block = 1;
+	} else if ( ( fmt.format == 0x11 ) && ( fmt.block_align > 4 * fmt.channels ) ) {
+		// ima adpcm: 4 header bytes and 2 samples per byte per channel
+		samples_per_block = ( fmt.block_align - 4 * fmt.channels ) * 2 / fmt.channels + 1;
+	} else {
+		ESP_LOGD( TAGANALYZER, "unsupported wav format %d/%d bit", fmt.format, fmt.bits );
+		return false;
+	}
+
+	// first and last sample above the trim level
+	int64_t first = -1;
+	int64_t last = -1;
+
+	if ( pcm ) {
+
+		int16_t *buf = (int16_t *) memory_alloc( MEMORY_BULK, ANALYZER_BUFSIZE );
+		if ( buf == NULL ) return false;
+
+		int32_t threshold = ( trim_level < 0 ) ? lrintf( 32768.0f * powf( 10.0f, trim_level / 20.0f ) ) : 0;
+		uint32_t remaining = data_size;
+		uint64_t sum = 0;
+		uint32_t count = 0;
+		int32_t peak = 0;
+		int blocks = 0;
+		size_t n;
+
+		while ( ( remaining > 0 ) && ( ( n = fread( buf, 1, ( remaining < ANALYZER_BUFSIZE ) ? remaining : ANALYZER_BUFSIZE, f ) ) > 0 ) ) {
+
+			remaining -= n;
+
+			for ( size_t i = 0; i < n / 2; i++ ) {
+				int32_t x = buf[i];
+				sum += x * x;
+				if ( abs( x ) > peak ) peak = abs( x );
+				if ( abs( x ) > threshold ) {
+					if ( first < 0 ) first = count + i;
+					last = count + i;
+				}
+			}
+			count += n / 2;
+
+			// let the idle task feed the watchdog
+			if ( ( ++blocks & 0x0f ) == 0 ) vTaskDelay( 1 );
+
+		}
+
+		memory_free( buf );
+
+		if ( ( count > 0 ) && ( peak > 0 ) ) {
+
+			float rms_db  = 10.0f * log10f( (float) sum / count / ( 32768.0f * 32768.0f ) );
+			float peak_db = 20.0f * log10f( peak / 32768.0f );
+
+			result->gain = limit_gain( target - rms_db, peak_db );
+			found = true;
+
+			ESP_LOGD( TAGANALYZER, "rms=%.1fdB peak=%.1fdB gain=%ddB", rms_db, peak_db, result->gain );
+		}
+
+	}
+
+	uint32_t start = data;
+	uint32_t end = data + data_size;
+
+	// loop points alone keep the silence detection
+	bool cue_trim = ( cue != NULL ) && ( ( cue->start_ms >= 0 ) || ( cue->end_ms >= 0 ) );
+
+	if ( cue_trim ) {
+
+		if ( cue->start_ms >= 0 ) start = wav_cue_pos( data, data_size, &fmt, samples_per_block, cue->start_ms );
+		if ( cue->end_ms >= 0 ) end = wav_cue_pos( data, data_size, &fmt, samples_per_block, cue->end_ms );
+
+	} else if ( ( trim_level < 0 ) && ( first >= 0 ) ) {
+
+		int64_t margin = (int64_t) fmt.rate * ANALYZER_TRIM_MARGIN_MS / 1000;
+		int64_t frames = data_size / fmt.block_align;
+		int64_t first_frame = first / fmt.channels - margin;
+		int64_t last_frame = last / fmt.channels + 1 + margin;
+
+		if ( first_frame < 0 ) first_frame = 0;
+		if ( last_frame > frames ) last_frame = frames;
+
+		start = data + first_frame * fmt.block_align;
+		end = data + last_frame * fmt.block_align;
+
+	}
+
+	// the decoder needs the header in front of the audio
+	if ( ( start > (uint32_t) data ) || ( end < data + data_size ) ) {
+		result->head = data;
+		result->start = start;
+		result->end = ( end > start ) ? end : start + fmt.block_align;
+		found = true;
+
+		ESP_LOGD( TAGANALYZER, "trim %lu..%lu of %lu bytes", (unsigned long) start, (unsigned long) end, (unsigned long) ( data + data_size ) );
+	}
+
+	if ( ( cue != NULL ) && ( ( cue->loop_start_ms >= 0 ) || ( cue->loop_end_ms >= 0 ) ) ) {
+		if ( cue->loop_start_ms >= 0 ) result->loop_start = wav_cue_pos( data, data_size, &fmt, samples_per_block, cue->loop_start_ms );
+		if ( cue->loop_end_ms >= 0 ) result->loop_end = wav_cue_pos( data, data_size, &fmt, samples_per_block, cue->loop_end_ms );
+		found = true;
+
+		ESP_LOGD( TAGANALYZER, "loop %lu..%lu", (unsigned long) result->loop_start, (unsigned long) result->loop_end );
+	}
+
+	return found;
+
+}
+
+// average bitrate in kbit/s, from the xing header of vbr files or from the first frame
+static int mp3_bitrate( FILE *f, long audio, long *frame ) {
+
+	static const uint16_t bitrates[2][15] = {
+		{ 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },	// mpeg 1 layer 3
+		{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 }		// mpeg 2 and 2.5 layer 3
+	};
+	static const uint32_t samplerates[3] = { 44100, 48000, 32000 };
+
+	uint8_t hdr[64];
+
+	fseek( f, audio, SEEK_SET );
+
+	// search the first frame header
+	for ( long pos = audio; pos < audio + 4096; pos++ ) {
+
+		fseek( f, pos, SEEK_SET );
+		if ( fread( hdr, 1, sizeof(hdr), f ) != sizeof(hdr) ) return 0;
+
+		// sync and layer 3
+		if ( ( hdr[0] != 0xff ) || ( ( hdr[1] & 0xe0 ) != 0xe0 ) || ( ( hdr[1] & 0x06 ) != 0x02 ) ) continue;
+
+		int version = ( hdr[1] >> 3 ) & 0x03;		// 3 = mpeg 1, 2 = mpeg 2, 0 = mpeg 2.5
+		int index = hdr[2] >> 4;
+		int rate = ( hdr[2] >> 2 ) & 0x03;
+		if ( ( version == 1 ) || ( index == 0 ) || ( index == 15 ) || ( rate == 3 ) ) continue;
+
+		bool mpeg1 = ( version == 3 );
+		bool mono = ( hdr[3] >> 6 ) == 3;
+		int kbps = bitrates[mpeg1 ? 0 : 1][index];
+		*frame = pos;
+
+		// xing header behind the side info, frame count and byte count give the average
+		const uint8_t *xing = &hdr[4 + ( mpeg1 ? ( mono ? 17 : 32 ) : ( mono ? 9 : 17 ) )];
+		if ( ( ( memcmp( xing, "Xing", 4 ) == 0 ) || ( memcmp( xing, "Info", 4 ) == 0 ) ) && ( ( be32( &xing[4] ) & 0x03 ) == 0x03 ) ) {
+			uint64_t frames = be32( &xing[8] );
+			uint64_t bytes = be32( &xing[12] );
+			uint32_t samplerate = samplerates[rate] >> ( mpeg1 ? 0 : ( version == 2 ) ? 1 : 2 );
+			if ( frames > 0 ) kbps = bytes * 8 * samplerate / ( frames * ( mpeg1 ? 1152 : 576 ) * 1000 );
+		}
+
+		return kbps;
+
+	}
+
+	return 0;
+
+}
+
+static bool analyze_mp3( FILE *f, int target, const analyzer_cue_t *cue, analyzer_result_t *result ) {
+
+	uint8_t hdr[10];
+	char frame[128];
+	bool found = false;
+	float gain = 0;
+	float peak_db = -100.0f;
+	long end = 0;
+
+	// replay gain is stored in ID3v2 TXXX frames by the common taggers
+	bool tag = ( fread( hdr, 1, 10, f ) == 10 ) && ( memcmp( hdr, "ID3", 3 ) == 0 );
+
+	uint8_t version = tag ? hdr[3] : 0;
+	if ( tag ) end = 10 + syncsafe32( &hdr[6] );
+
+	while ( tag && ( version >= 3 ) && ( ftell( f ) + 10 <= end ) ) {
+
+		if ( fread( hdr, 1, 10, f ) != 10 ) break;
+		if ( hdr[0] == 0 ) break;	// padding
+
+		uint32_t size = ( version >= 4 ) ? syncsafe32( &hdr[4] ) : ( ( hdr[4] << 24 ) | ( hdr[5] << 16 ) | ( hdr[6] << 8 ) | hdr[7] );
+
+		if ( ( memcmp( hdr, "TXXX", 4 ) != 0 ) || ( size >= sizeof(frame) ) ) {
+			fseek( f, size, SEEK_CUR );
+			continue;
+		}
+
+		if ( fread( frame, 1, size, f ) != size ) break;
+		frame[size] = '\0';
+
+		// latin1 or utf-8 only: <encoding> <description> 0 <value>
+		if ( ( frame[0] != 0 ) && ( frame[0] != 3 ) ) continue;
+		const char *description = &frame[1];
+		const char *value = description + strlen( description ) + 1;
+		if ( value >= &frame[size] ) continue;
+
+		if ( strcasecmp( description, "REPLAYGAIN_TRACK_GAIN" ) == 0 ) {
+			gain = atof( value );
+			found = true;
+		} else if ( strcasecmp( description, "REPLAYGAIN_TRACK_PEAK" ) == 0 ) {
+			float peak = atof( value );
+			if ( peak > 0 ) peak_db = 20.0f * log10f( peak );
+		}
+
+	}
+
+	if ( found ) {
+		result->gain = limit_gain( gain + target - REPLAYGAIN_REFERENCE, peak_db );
+		ESP_LOGD( TAGANALYZER, "replay gain=%.1fdB peak=%.1fdB gain=%ddB", gain, peak_db, result->gain );
+	}
+
+	// mp3 has no header to keep, the decoder syncs on the next frame. trim points are exact for cbr only.
+	long first;
+	int kbps = ( cue != NULL ) ? mp3_bitrate( f, end, &first ) : 0;
+
+	if ( kbps > 0 ) {
+		if ( cue->start_ms >= 0 ) result->start = first + (uint64_t) cue->start_ms * kbps / 8;
+		if ( cue->end_ms >= 0 ) result->end = first + (uint64_t) cue->end_ms * kbps / 8;
+		if ( cue->loop_start_ms >= 0 ) result->loop_start = first + (uint64_t) cue->loop_start_ms * kbps / 8;
+		if ( cue->loop_end_ms >= 0 ) result->loop_end = first + (uint64_t) cue->loop_end_ms * kbps / 8;
+		found = true;
+
+		ESP_LOGD( TAGANALYZER, "%dkbit/s, trim %lu..%lu, loop %lu..%lu", kbps, (unsigned long) result->start, (unsigned long) result->end,
+				(unsigned long) result->loop_start, (unsigned long) result->loop_end );
+	}
+
+	return found;
+
+}
+
+bool analyzer_track( const char *path, audio_filetype_t filetype, int target, int trim_level, analyzer_result_t *result ) {
+
+	FILE *f;
+	bool ok = false;
+	analyzer_cue_t cue;
+
+	result->gain = 0;
+	result->head = 0;
+	result->start = 0;
+	result->end = 0;
+	result->loop_start = 0;
+	result->loop_end = 0;
+
+	// trim points from the sidecar file replace the silence detection
+	bool has_cue = read_cue( path, &cue );
+
+	f = fopen( path, "rb" );
+	if ( f == NULL ) {
+		ESP_LOGW( TAGANALYZER, "could not open %s", path );
+		return false;
+	}
+
+	switch ( filetype ) {
+	case FILETYPE_WAV:
+	case FILETYPE_ADPCM: ok = analyze_wav( f, target, trim_level, has_cue ? &cue : NULL, result ); break;
+	case FILETYPE_MP3: ok = analyze_mp3( f, target, has_cue ? &cue : NULL, result ); break;
+	default: break;
+	}
+
+	fclose( f );
+
+	return ok;
+
+}
+
+// appends a character as utf-8, returns false if the text is full
+static bool tag_put( char *text, size_t size, size_t *len, uint32_t c ) {
+
+	char utf8[4];
+	size_t n;
+
+	if ( c < ' ' ) c = ' ';
+
+	if ( c < 0x80 ) {
+		utf8[0] = c;
+		n = 1;
+	} else if ( c < 0x800 ) {
+		utf8[0] = 0xc0 | ( c >> 6 );
+		utf8[1] = 0x80 | ( c & 0x3f );
+		n = 2;
+	} else if ( c < 0x10000 ) {
+		utf8[0] = 0xe0 | ( c >> 12 );
+		utf8[1] = 0x80 | ( ( c >> 6 ) & 0x3f );
+		utf8[2] = 0x80 | ( c & 0x3f );
+		n = 3;
+	} else {
+		utf8[0] = 0xf0 | ( c >> 18 );
+		utf8[1] = 0x80 | ( ( c >> 12 ) & 0x3f );
+		utf8[2] = 0x80 | ( ( c >> 6 ) & 0x3f );
+		utf8[3] = 0x80 | ( c & 0x3f );
+		n = 4;
+	}
+
+	// a truncated text stays valid utf-8
+	if ( *len + n >= size ) return false;
+
+	memcpy( &text[*len], utf8, n );
+	*len += n;
+
+	return true;
+
+}
+
+// text in id3 encoding 0 latin1, 1 utf-16 with bom, 2 utf-16 big endian or 3 utf-8 to utf-8. it ends at the first 0.
+// invalid utf-8 is taken as latin1, RIFF INFO texts are either.
+static void tag_text( char *text, size_t size, const uint8_t *p, size_t n, uint8_t encoding ) {
+
+	size_t len = 0;
+	size_t i = 0;
+	bool utf16 = ( encoding == 1 ) || ( encoding == 2 );
+	bool be = ( encoding == 2 );
+
+	if ( ( encoding == 1 ) && ( n >= 2 ) && ( ( p[0] == 0xfe ) || ( p[0] == 0xff ) ) ) {
+		be = ( p[0] == 0xfe );
+		i = 2;
+	}
+
+	while ( i < n ) {
+
+		uint32_t c;
+
+		if ( utf16 ) {
+
+			if ( i + 1 >= n ) break;
+			c = be ? ( ( p[i] << 8 ) | p[i+1] ) : ( p[i] | ( p[i+1] << 8 ) );
+			i += 2;
+
+			if ( ( c >= 0xd800 ) && ( c < 0xdc00 ) && ( i + 1 < n ) ) {
+				uint32_t low = be ? ( ( p[i] << 8 ) | p[i+1] ) : ( p[i] | ( p[i+1] << 8 ) );
+				if ( ( low < 0xdc00 ) || ( low >= 0xe000 ) ) continue;
+				c = 0x10000 + ( ( c - 0xd800 ) << 10 ) + ( low - 0xdc00 );
+				i += 2;
+			} else if ( ( c >= 0xd800 ) && ( c < 0xe000 ) ) {
+				continue;
+			}
+
+		} else {
+
+			c = p[i++];
+
+			int follow = ( encoding != 3 ) ? 0 : ( ( c & 0xe0 ) == 0xc0 ) ? 1 : ( ( c & 0xf0 ) == 0xe0 ) ? 2 : ( ( c & 0xf8 ) == 0xf0 ) ? 3 : 0;
+			if ( ( follow > 0 ) && ( i + follow <= n ) ) {
+				uint32_t u = c & ( 0x3f >> follow );
+				int k = 0;
+				while ( ( k < follow ) && ( ( p[i+k] & 0xc0 ) == 0x80 ) ) {
+					u = ( u << 6 ) | ( p[i+k] & 0x3f );
+					k++;
+				}
+				if ( k == follow ) {
+					c = u;
+					i += follow;
+				}
+			}
+
+		}
+
+		if ( ( c == 0 ) || !tag_put( text, size, &len, c ) ) break;
+
+	}
+
+	// id3v1 pads with spaces
+	while ( ( len > 0 ) && ( text[len-1] == ' ' ) ) len--;
+	text[len] = '\0';
+
+}
+
+// title and artist of an ID3v2 tag at the current file position.
+// returns the size of the tag, 0 if there is none.
+static long id3v2_tags( FILE *f, analyzer_tags_t *tags ) {
+
+	uint8_t hdr[10];
+	uint8_t frame[TAG_FRAME_MAX];
+
+	long pos = ftell( f );
+	if ( ( fread( hdr, 1, 10, f ) != 10 ) || ( memcmp( hdr, "ID3", 3 ) != 0 ) ) return 0;
+
+	uint8_t version = hdr[3];
+	uint8_t flags = hdr[5];
+	long end = pos + 10 + syncsafe32( &hdr[6] );
+	long size = end - pos + ( ( flags & 0x10 ) ? 10 : 0 );	// footer
+
+	// extended header, its size counts itself in v2.4 only
+	if ( ( version >= 3 ) && ( flags & 0x40 ) ) {
+		if ( fread( hdr, 1, 4, f ) != 4 ) return size;
+		fseek( f, ( version >= 4 ) ? (long) syncsafe32( hdr ) - 4 : (long) be32( hdr ), SEEK_CUR );
+	}
+
+	// v2.2 has 3 character ids and 3 byte sizes
+	size_t header = ( version >= 3 ) ? 10 : 6;
+
+	while ( ftell( f ) + (long) header <= end ) {
+
+		if ( fread( hdr, 1, header, f ) != header ) break;
+		if ( hdr[0] == 0 ) break;	// padding
+
+		uint32_t n;
+		char *text = NULL;
+
+		if ( version >= 3 ) {
+			n = ( version >= 4 ) ? syncsafe32( &hdr[4] ) : be32( &hdr[4] );
+			if ( memcmp( hdr, "TIT2", 4 ) == 0 ) text = tags->title;
+			if ( memcmp( hdr, "TPE1", 4 ) == 0 ) text = tags->artist;
+			// compressed or encrypted
+			if ( hdr[9] & ( ( version >= 4 ) ? 0x0c : 0xc0 ) ) text = NULL;
+		} else {
+			n = ( hdr[3] << 16 ) | ( hdr[4] << 8 ) | hdr[5];
+			if ( memcmp( hdr, "TT2", 3 ) == 0 ) text = tags->title;
+			if ( memcmp( hdr, "TP1", 3 ) == 0 ) text = tags->artist;
+		}
+
+		if ( ( text == NULL ) || ( text[0] != '\0' ) || ( n < 2 ) ) {
+			fseek( f, n, SEEK_CUR );
+			continue;
+		}
+
+		// <encoding> <text>, the rest of a long text is skipped
+		uint32_t len = ( n < sizeof(frame) ) ? n : sizeof(frame);
+		if ( fread( frame, 1, len, f ) != len ) break;
+		fseek( f, n - len, SEEK_CUR );
+
+		tag_text( text, ANALYZER_TEXT_MAX, &frame[1], len - 1, frame[0] );
+
+	}
+
+	return size;
+
+}
+
+// returns true if the file ends with an ID3v1 tag, it fills title and artist missing in the ID3v2 tag
+static bool id3v1_tags( FILE *f, long file_size, analyzer_tags_t *tags ) {
+
+	uint8_t tag[128];
+
+	if ( ( file_size < 128 ) || ( fseek( f, file_size - 128, SEEK_SET ) != 0 ) || ( fread( tag, 1, 128, f ) != 128 ) || ( memcmp( tag, "TAG", 3 ) != 0 ) ) {
+		return false;
+	}
+
+	if ( tags->title[0] == '\0' ) tag_text( tags->title, ANALYZER_TEXT_MAX, &tag[3], 30, 0 );
+	if ( tags->artist[0] == '\0' ) tag_text( tags->artist, ANALYZER_TEXT_MAX, &tag[33], 30, 0 );
+
+	return true;
+
+}
+
+static void mp3_tags( FILE *f, long file_size, analyzer_tags_t *tags ) {
+
+	long audio = id3v2_tags( f, tags );
+	long end = id3v1_tags( f, file_size, tags ) ? file_size - 128 : file_size;
+	long frame;
+
+	// kbit/s are bits per ms
+	int kbps = mp3_bitrate( f, audio, &frame );
+	if ( ( kbps > 0 ) && ( end > frame ) ) {
+		tags->duration = (uint64_t) ( end - frame ) * 8 / kbps;
+	}
+
+}
+
+// walks all chunks, the INFO list may follow the data
+static void wav_tags( FILE *f, long file_size, analyzer_tags_t *tags ) {
+
+	uint8_t hdr[16];
+	uint8_t text[TAG_FRAME_MAX];
+	uint32_t byte_rate = 0;
+	uint32_t data_size = 0;
+
+	if ( ( fread( hdr, 1, 12, f ) != 12 ) || ( memcmp( hdr, "RIFF", 4 ) != 0 ) || ( memcmp( &hdr[8], "WAVE", 4 ) != 0 ) ) {
+		return;
+	}
+
+	while ( fread( hdr, 1, 8, f ) == 8 ) {
+
+		uint32_t size = le32( &hdr[4] );
+		long pos = ftell( f );
+		long next = pos + size + ( size & 1 );
+
+		if ( ( memcmp( hdr, "fmt ", 4 ) == 0 ) && ( size >= 16 ) ) {
+
+			if ( fread( hdr, 1, 16, f ) != 16 ) break;
+			byte_rate = le32( &hdr[8] );
+
+		} else if ( memcmp( hdr, "data", 4 ) == 0 ) {
+
+			// a stream written without its size claims more than the file holds
+			data_size = ( pos + (long) size > file_size ) ? file_size - pos : size;
+
+		} else if ( ( memcmp( hdr, "LIST", 4 ) == 0 ) && ( fread( hdr, 1, 4, f ) == 4 ) && ( memcmp( hdr, "INFO", 4 ) == 0 ) ) {
+
+			while ( ( ftell( f ) + 8 <= next ) && ( fread( hdr, 1, 8, f ) == 8 ) ) {
+
+				uint32_t n = le32( &hdr[4] );
+				long after = ftell( f ) + n + ( n & 1 );
+				char *dest = ( memcmp( hdr, "INAM", 4 ) == 0 ) ? tags->title : ( memcmp( hdr, "IART", 4 ) == 0 ) ? tags->artist : NULL;
+
+				if ( ( dest != NULL ) && ( dest[0] == '\0' ) ) {
+					uint32_t len = ( n < sizeof(text) ) ? n : sizeof(text);
+					if ( fread( text, 1, len, f ) != len ) break;
+					tag_text( dest, ANALYZER_TEXT_MAX, text, len, 3 );
+				}
+
+				fseek( f, after, SEEK_SET );
+
+			}
+
+		} else if ( ( memcmp( hdr, "id3 ", 4 ) == 0 ) || ( memcmp( hdr, "ID3 ", 4 ) == 0 ) ) {
+
+			id3v2_tags( f, tags );
+
+		}
+
+		if ( fseek( f, next, SEEK_SET ) != 0 ) break;
+
+	}
+
+	if ( byte_rate > 0 ) {
+		tags->duration = (uint64_t) data_size * 1000 / byte_rate;
+	}
+
+}
+
+// vorbis comment of the second page and the granule position of the last page
+static void ogg_tags( FILE *f, long file_size, analyzer_tags_t *tags ) {
+
+	uint8_t page[OGG_PAGE_HEADER + 255];
+	uint8_t text[TAG_FRAME_MAX];
+	uint32_t rate = 0;
+	uint32_t skip = 0;
+	bool opus = false;
+	long body = 0;
+	long end = 0;
+
+	for ( int nr = 0; nr < 2; nr++ ) {
+
+		if ( ( fseek( f, end, SEEK_SET ) != 0 ) || ( fread( page, 1, OGG_PAGE_HEADER, f ) != OGG_PAGE_HEADER ) || ( memcmp( page, "OggS", 4 ) != 0 ) ) return;
+		if ( fread( &page[OGG_PAGE_HEADER], 1, page[26], f ) != page[26] ) return;
+
+		body = end + OGG_PAGE_HEADER + page[26];
+		end = body;
+		for ( int i = 0; i < page[26]; i++ ) end += page[OGG_PAGE_HEADER + i];
+
+		if ( nr == 0 ) {
+			// identification header
+			if ( fread( text, 1, 16, f ) != 16 ) return;
+			if ( memcmp( text, "\x01vorbis", 7 ) == 0 ) {
+				rate = le32( &text[12] );
+			} else if ( memcmp( text, "OpusHead", 8 ) == 0 ) {
+				opus = true;
+				rate = 48000;
+				skip = le16( &text[10] );
+			}
+		}
+
+	}
+
+	if ( rate == 0 ) return;
+
+	// "\x03vorbis" or "OpusTags", <vendor length> <vendor> <count> { <length> <KEY=value> }
+	uint8_t len[4];
+
+	fseek( f, body + ( opus ? 8 : 7 ), SEEK_SET );
+	if ( fread( len, 1, 4, f ) == 4 ) {
+
+		fseek( f, le32( len ), SEEK_CUR );
+		uint32_t count = ( fread( len, 1, 4, f ) == 4 ) ? le32( len ) : 0;
+
+		// comments beyond the second page are ignored, e.g. behind cover art
+		for ( uint32_t i = 0; ( i < count ) && ( ftell( f ) + 4 <= end ) && ( fread( len, 1, 4, f ) == 4 ); i++ ) {
+
+			uint32_t n = le32( len );
+			long after = ftell( f ) + n;
+			uint32_t m = ( n < sizeof(text) ) ? n : sizeof(text);
+
+			if ( ( after > end ) || ( fread( text, 1, m, f ) != m ) ) break;
+
+			if ( ( m > 6 ) && ( strncasecmp( (char *) text, "TITLE=", 6 ) == 0 ) && ( tags->title[0] == '\0' ) ) {
+				tag_text( tags->title, ANALYZER_TEXT_MAX, &text[6], m - 6, 3 );
+			} else if ( ( m > 7 ) && ( strncasecmp( (char *) text, "ARTIST=", 7 ) == 0 ) && ( tags->artist[0] == '\0' ) ) {
+				tag_text( tags->artist, ANALYZER_TEXT_MAX, &text[7], m - 7, 3 );
+			}
+
+			fseek( f, after, SEEK_SET );
+
+		}
+
+	}
+
+	// the last page starts within its maximum size from the end
+	long start = ( file_size > OGG_PAGE_MAX ) ? file_size - OGG_PAGE_MAX : 0;
+	long last = -1;
+	uint32_t sync = 0;
+
+	fseek( f, start, SEEK_SET );
+	for ( long pos = start; pos < file_size; pos++ ) {
+		int c = fgetc( f );
+		if ( c == EOF ) break;
+		sync = ( sync << 8 ) | c;
+		if ( sync == 0x4f676753 ) last = pos - 3;	// OggS
+	}
+
+	if ( ( last < 0 ) || ( fseek( f, last, SEEK_SET ) != 0 ) || ( fread( page, 1, OGG_PAGE_HEADER, f ) != OGG_PAGE_HEADER ) ) return;
+
+	uint64_t granule = le32( &page[6] ) | ( (uint64_t) le32( &page[10] ) << 32 );
+	if ( ( granule > skip ) && ( granule != UINT64_MAX ) ) {
+		tags->duration = ( granule - skip ) * 1000 / rate;
+	}
+
+}
+
+bool analyzer_tags( const char *path, audio_filetype_t filetype, analyzer_tags_t *tags ) {
+
+	tags->title[0] = '\0';
+	tags->artist[0] = '\0';
+	tags->duration = 0;
+
+	FILE *f = fopen( path, "rb" );
+	if ( f == NULL ) {
+		ESP_LOGW( TAGANALYZER, "could not open %s", path );
+		return false;
+	}
+
+	fseek( f, 0, SEEK_END );
+	long file_size = ftell( f );
+	fseek( f, 0, SEEK_SET );
+
+	switch ( filetype ) {
+	case FILETYPE_WAV:
+	case FILETYPE_ADPCM: wav_tags( f, file_size, tags ); break;
+	case FILETYPE_MP3: mp3_tags( f, file_size, tags ); break;
+	case FILETYPE_OGG: ogg_tags( f, file_size, tags ); break;
+	default: break;
+	}
+
+	fclose( f );
+
+	return ( tags->title[0] != '\0' ) || ( tags->artist[0] != '\0' ) || ( tags->duration > 0 );
+
+}
+
+static void task_analyzer( void *pvParameter ) {
+
+	char path[300];
+	analyzer_result_t result;
+	analyzer_tags_t tags;
+	bool changed = false;
+
+	// tags first, they take a few reads per file
+	for ( int8_t i = 0; i < job.playList->getTracks(); i++ ) {
+
+		if ( job.playList->isTagged( i ) ) continue;
+
+		// a rescan frees removed names
+		job.playList->lock();
+		snprintf( path, sizeof(path), "%s/%s", job.directory, job.playList->getTrack( i ) );
+		job.playList->unlock();
+
+		// files without tags are stored as well, so they don't get parsed on every boot
+		analyzer_tags( path, job.playList->getFiletype( i ), &tags );
+		job.playList->setTags( i, tags.title, tags.artist, tags.duration );
+		changed = true;
+
+		ESP_LOGI( TAGANALYZER, "%s: \"%s\" by \"%s\", %lums", path, tags.title, tags.artist, (unsigned long) tags.duration );
+
+	}
+
+	if ( changed ) {
+		job.playList->saveIndex( job.indexFile );
+		changed = false;
+	}
+
+	for ( int8_t i = 0; job.analyze && ( i < job.playList->getTracks() ); i++ ) {
+
+		if ( job.playList->isAnalyzed( i ) ) continue;
+
+		// a rescan frees removed names
+		job.playList->lock();
+		snprintf( path, sizeof(path), "%s/%s", job.directory, job.playList->getTrack( i ) );
+		job.playList->unlock();
+
+		// files without usable data are stored with 0dB, so they don't get analyzed on every boot
+		analyzer_track( path, job.playList->getFiletype( i ), job.target, job.trim_level, &result );
+		job.playList->setGain( i, result.gain );
+		job.playList->setTrim( i, result.head, result.start, result.end );
+		job.playList->setLoop( i, result.loop_start, result.loop_end );
+		changed = true;
+
+		ESP_LOGI( TAGANALYZER, "%s: gain %ddB, start %lu, end %lu", path, result.gain, (unsigned long) result.start, (unsigned long) result.end );
+
+	}
+
+	if ( changed ) {
+		job.playList->saveIndex( job.indexFile );
+	}
+
+	ESP_LOGI( TAGANALYZER, "finished" );
+
+	running = false;
+	vTaskDelete( NULL );
+
+}
+
+bool analyzer_start( PlayList *playList, const char *directory, const char *indexFile, bool analyze, int target, int trim_level ) {
+
+	job.playList = playList;
+	job.analyze = analyze;
+	job.target = target;
+	job.trim_level = trim_level;
+	strlcpy( job.directory, directory, sizeof(job.directory) );
+	strlcpy( job.indexFile, indexFile, sizeof(job.indexFile) );
+
+	running = true;
+	if ( xTaskCreate( &task_analyzer, "analyzer", ANALYZER_TASK_STACK, NULL, ANALYZER_TASK_PRIO, NULL ) != pdPASS ) {
+		ESP_LOGE( TAGANALYZER, "no memory for the analyzer task" );
+		running = false;
+		return false;
+	}
+
+	return true;
+
+}
+
+bool analyzer_running( void ) {
+
+	return running;
+
+}
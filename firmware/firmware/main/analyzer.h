@@ -0,0 +1,56 @@
+/*
+ * analyzer.h
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#ifndef MAIN_ANALYZER_H_
+#define MAIN_ANALYZER_H_
+
+#include "playlist.h"
+
+#define ANALYZER_TASK_STACK (4 * 1024)
+#define ANALYZER_TASK_PRIO  (1)
+
+#define ANALYZER_MIN_GAIN   (-20)
+#define ANALYZER_MAX_GAIN   (12)
+
+// kept in front of and after the detected sound
+#define ANALYZER_TRIM_MARGIN_MS (10)
+
+typedef struct {
+	int8_t   gain;		// dB to reach the target level without clipping
+	uint32_t head;		// trim points, see track_t
+	uint32_t start;
+	uint32_t end;
+	uint32_t loop_start;	// loop region, 0 = not set
+	uint32_t loop_end;
+} analyzer_result_t;
+
+#define ANALYZER_TEXT_MAX   (64)
+
+typedef struct {
+	char     title[ANALYZER_TEXT_MAX];		// utf-8, "" = unknown
+	char     artist[ANALYZER_TEXT_MAX];
+	uint32_t duration;		// ms, 0 = unknown
+} analyzer_tags_t;
+
+// analyze a single file, returns false if nothing could be measured.
+// silence below trim_level dB is detected in 16 bit wav files, <file>.trim with START=<ms> and END=<ms> sets the trim points of any wav, adpcm or mp3 file.
+// LOOP_START=<ms> and LOOP_END=<ms> in the same file set the region repeated in repeat mode.
+bool analyzer_track( const char *path, audio_filetype_t filetype, int target, int trim_level, analyzer_result_t *result );
+
+// title, artist and duration of a single file, returns false if nothing was found.
+// ID3v2 and ID3v1 tags of mp3, RIFF INFO and id3 chunks of wav and adpcm and the vorbis comment of ogg files are read in small pieces.
+// the duration comes from the headers, only ogg reads its last page.
+bool analyzer_tags( const char *path, audio_filetype_t filetype, analyzer_tags_t *tags );
+
+// read the tags of all tracks missing in the index by a low priority task, with analyze the tracks are analyzed afterwards.
+// the index is saved after each pass. returns false if the task couldn't be created.
+bool analyzer_start( PlayList *playList, const char *directory, const char *indexFile, bool analyze, int target, int trim_level );
+
+// the playlist must not change while the analyzer works on it
+bool analyzer_running( void );
+
+#endif /* MAIN_ANALYZER_H_ */
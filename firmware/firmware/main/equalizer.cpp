@@ -0,0 +1,480 @@
+/*
+ * equalizer.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#include <esp_log.h>
+#include <audio_mem.h>
+#include <freertos/FreeRTOS.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "equalizer.h"
+#include "memorypolicy.h"
+
+#define TAGEQUALIZER "::EQUALIZER"
+
+#define EQ_COEF_BITS      28		// coefficients Q3.28
+#define EQ_EXTRA_BITS     8			// fraction bits the samples carry through the cascade
+#define EQ_RELEASE_SHIFT  11		// limiter release, about 50ms at 44.1kHz
+
+typedef struct {
+	int32_t b0, b1, b2;
+	int32_t a1, a2;			// negated, so everything is added
+} eq_coef_t;
+
+typedef struct {
+	int32_t x1, x2, y1, y2;
+} eq_state_t;
+
+typedef struct {
+	int        rate;
+	int        channels;
+	int        bits;
+	uint32_t   generation;	// of the settings the coefficients are designed for
+	int        bands;		// active sections
+	eq_coef_t  coef[EQ_BANDS];
+	eq_state_t state[EQ_BANDS][2];
+	int32_t    threshold;	// limiter, 0 = off
+	int32_t    gain;		// limiter gain, Q15
+	int        in_fill;		// bytes of an incomplete frame left in buf
+	int16_t    *buf;
+	int32_t    *work;
+	audio_element_handle_t source;
+} equalizer_t;
+
+static eq_band_t settings[EQ_BANDS];
+static int limiter = 0;
+static volatile uint32_t generation = 1;
+static portMUX_TYPE settings_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline int16_t saturate16( int32_t x ) {
+
+	if ( x > 32767 ) return 32767;
+	if ( x < -32768 ) return -32768;
+	return (int16_t) x;
+
+}
+
+bool equalizer_set_band( int band, const eq_band_t *value ) {
+
+	if ( ( band < 0 ) || ( band >= EQ_BANDS ) || ( value->type < EQ_OFF ) || ( value->type > EQ_HIGH_PASS ) ) {
+		return false;
+	}
+
+	eq_band_t b = *value;
+	if ( b.frequency < 20 ) b.frequency = 20;
+	if ( b.frequency > 20000 ) b.frequency = 20000;
+	if ( b.gain < -EQ_MAX_GAIN ) b.gain = -EQ_MAX_GAIN;
+	if ( b.gain > EQ_MAX_GAIN ) b.gain = EQ_MAX_GAIN;
+	if ( !( b.q >= 0.1f ) ) b.q = 0.1f;
+	if ( b.q > 10.0f ) b.q = 10.0f;
+
+	taskENTER_CRITICAL( &settings_lock );
+	settings[band] = b;
+	generation++;
+	taskEXIT_CRITICAL( &settings_lock );
+
+	return true;
+
+}
+
+eq_band_t equalizer_get_band( int band ) {
+
+	eq_band_t b = {};
+
+	if ( ( band >= 0 ) && ( band < EQ_BANDS ) ) {
+		taskENTER_CRITICAL( &settings_lock );
+		b = settings[band];
+		taskEXIT_CRITICAL( &settings_lock );
+	}
+
+	return b;
+
+}
+
+void equalizer_set_limiter( int threshold ) {
+
+	if ( threshold > 0 ) threshold = 0;
+	if ( threshold < -24 ) threshold = -24;
+
+	taskENTER_CRITICAL( &settings_lock );
+	limiter = threshold;
+	generation++;
+	taskEXIT_CRITICAL( &settings_lock );
+
+}
+
+int equalizer_get_limiter( void ) {
+
+	return limiter;
+
+}
+
+bool equalizer_parse( const char *key, const char *value ) {
+
+	if ( strcmp( key, "EQ_LIMITER" ) == 0 ) {
+		equalizer_set_limiter( atoi( value ) );
+		return true;
+	}
+
+	int band;
+	if ( sscanf( key, "EQ_BAND%d", &band ) != 1 ) {
+		return false;
+	}
+
+	int type;
+	eq_band_t b = {};
+	if ( ( sscanf( value, "%d,%d,%f,%f", &type, &b.frequency, &b.gain, &b.q ) != 4 ) ) {
+		ESP_LOGW( TAGEQUALIZER, "%s=%s: expected type,frequency,gain,q", key, value );
+		return true;
+	}
+
+	b.type = (eq_type_t) type;
+	if ( !equalizer_set_band( band - 1, &b ) ) {
+		ESP_LOGW( TAGEQUALIZER, "%s=%s: bands are 1..%d, types 0..5", key, value, EQ_BANDS );
+	}
+
+	return true;
+
+}
+
+void equalizer_write( FILE *f ) {
+
+	fprintf( f, "EQ_LIMITER=%d\n", limiter );
+
+	for ( int i = 0; i < EQ_BANDS; i++ ) {
+		eq_band_t b = equalizer_get_band( i );
+		fprintf( f, "EQ_BAND%d=%d,%d,%.1f,%.2f\n", i + 1, b.type, b.frequency, b.gain, b.q );
+	}
+
+}
+
+void equalizer_report( cJSON *root ) {
+
+	cJSON_AddNumberToObject( root, "limiter", limiter );
+
+	cJSON *bands = cJSON_AddArrayToObject( root, "bands" );
+
+	for ( int i = 0; i < EQ_BANDS; i++ ) {
+		eq_band_t b = equalizer_get_band( i );
+		cJSON *band = cJSON_CreateObject();
+		cJSON_AddNumberToObject( band, "type", b.type );
+		cJSON_AddNumberToObject( band, "frequency", b.frequency );
+		cJSON_AddNumberToObject( band, "gain", b.gain );
+		cJSON_AddNumberToObject( band, "q", b.q );
+		cJSON_AddItemToArray( bands, band );
+	}
+
+}
+
+// rbj audio eq cookbook, normalized to a0 = 1
+static bool equalizer_design_band( const eq_band_t *b, int rate, eq_coef_t *c ) {
+
+	if ( ( b->type == EQ_OFF ) || ( b->frequency >= rate * 0.45f ) ) {
+		return false;
+	}
+
+	float A     = powf( 10.0f, b->gain / 40.0f );
+	float w0    = 2.0f * (float) M_PI * b->frequency / rate;
+	float cs    = cosf( w0 );
+	float alpha = sinf( w0 ) / ( 2.0f * b->q );
+	float sq    = 2.0f * sqrtf( A ) * alpha;
+	float b0, b1, b2, a0, a1, a2;
+
+	switch ( b->type ) {
+	case EQ_PEAK:
+		b0 = 1 + alpha * A;  b1 = -2 * cs;  b2 = 1 - alpha * A;
+		a0 = 1 + alpha / A;  a1 = -2 * cs;  a2 = 1 - alpha / A;
+		break;
+	case EQ_LOW_SHELF:
+		b0 = A * ( ( A + 1 ) - ( A - 1 ) * cs + sq );
+		b1 = 2 * A * ( ( A - 1 ) - ( A + 1 ) * cs );
+		b2 = A * ( ( A + 1 ) - ( A - 1 ) * cs - sq );
+		a0 = ( A + 1 ) + ( A - 1 ) * cs + sq;
+		a1 = -2 * ( ( A - 1 ) + ( A + 1 ) * cs );
+		a2 = ( A + 1 ) + ( A - 1 ) * cs - sq;
+		break;
+	case EQ_HIGH_SHELF:
+		b0 = A * ( ( A + 1 ) + ( A - 1 ) * cs + sq );
+		b1 = -2 * A * ( ( A - 1 ) + ( A + 1 ) * cs );
+		b2 = A * ( ( A + 1 ) + ( A - 1 ) * cs - sq );
+		a0 = ( A + 1 ) - ( A - 1 ) * cs + sq;
+		a1 = 2 * ( ( A - 1 ) - ( A + 1 ) * cs );
+		a2 = ( A + 1 ) - ( A - 1 ) * cs - sq;
+		break;
+	case EQ_LOW_PASS:
+		b0 = ( 1 - cs ) / 2;  b1 = 1 - cs;  b2 = ( 1 - cs ) / 2;
+		a0 = 1 + alpha;  a1 = -2 * cs;  a2 = 1 - alpha;
+		break;
+	default:
+		b0 = ( 1 + cs ) / 2;  b1 = -( 1 + cs );  b2 = ( 1 + cs ) / 2;
+		a0 = 1 + alpha;  a1 = -2 * cs;  a2 = 1 - alpha;
+		break;
+	}
+
+	float coef[5] = { b0 / a0, b1 / a0, b2 / a0, -a1 / a0, -a2 / a0 };
+	int32_t q[5];
+
+	for ( int i = 0; i < 5; i++ ) {
+		if ( fabsf( coef[i] ) >= ( 1 << ( 31 - EQ_COEF_BITS ) ) ) {
+			ESP_LOGW( TAGEQUALIZER, "band at %dHz can't be realized", b->frequency );
+			return false;
+		}
+		q[i] = (int32_t) lrintf( coef[i] * ( 1 << EQ_COEF_BITS ) );
+	}
+
+	c->b0 = q[0];  c->b1 = q[1];  c->b2 = q[2];
+	c->a1 = q[3];  c->a2 = q[4];
+
+	return true;
+
+}
+
+static void equalizer_design( equalizer_t *eq ) {
+
+	eq_band_t bands[EQ_BANDS];
+	int threshold;
+
+	taskENTER_CRITICAL( &settings_lock );
+	memcpy( bands, settings, sizeof(bands) );
+	threshold = limiter;
+	eq->generation = generation;
+	taskEXIT_CRITICAL( &settings_lock );
+
+	eq->bands = 0;
+	for ( int i = 0; i < EQ_BANDS; i++ ) {
+		if ( equalizer_design_band( &bands[i], eq->rate, &eq->coef[eq->bands] ) ) {
+			eq->bands++;
+		}
+	}
+
+	// full scale in the resolution of the cascade
+	eq->threshold = ( threshold < 0 ) ? (int32_t) lrintf( 32767.0f * powf( 10.0f, threshold / 20.0f ) * ( 1 << EQ_EXTRA_BITS ) ) : 0;
+
+	// sections may have moved, start them over instead of ringing
+	memset( eq->state, 0, sizeof(eq->state) );
+
+	ESP_LOGI( TAGEQUALIZER, "%d sections at %dHz, limiter %ddB", eq->bands, eq->rate, threshold );
+
+}
+
+static void equalizer_update_source( equalizer_t *eq ) {
+
+	int rate = 44100;
+	int channels = 2;
+	int bits = 16;
+
+	if ( eq->source != NULL ) {
+		audio_element_info_t info = {};
+		audio_element_getinfo( eq->source, &info );
+		if ( info.sample_rates > 0 ) rate = info.sample_rates;
+		channels = info.channels;
+		bits = info.bits;
+	}
+
+	if ( ( rate != eq->rate ) || ( channels != eq->channels ) || ( bits != eq->bits ) ) {
+		eq->rate = rate;
+		eq->channels = channels;
+		eq->bits = bits;
+		eq->generation = 0;
+	}
+
+	if ( eq->generation != generation ) {
+		equalizer_design( eq );
+	}
+
+}
+
+// block processing: one section over all frames of one channel, the state stays in registers
+static void equalizer_section( const eq_coef_t *c, eq_state_t *s, int32_t *x, int frames, int stride ) {
+
+	int32_t x1 = s->x1, x2 = s->x2, y1 = s->y1, y2 = s->y2;
+
+	for ( int i = 0; i < frames; i++ ) {
+
+		int32_t x0 = x[ i * stride ];
+		int64_t acc = (int64_t) c->b0 * x0 + (int64_t) c->b1 * x1 + (int64_t) c->b2 * x2
+		            + (int64_t) c->a1 * y1 + (int64_t) c->a2 * y2;
+		int32_t y0 = (int32_t) ( acc >> EQ_COEF_BITS );
+
+		x2 = x1;  x1 = x0;
+		y2 = y1;  y1 = y0;
+		x[ i * stride ] = y0;
+
+	}
+
+	s->x1 = x1;  s->x2 = x2;  s->y1 = y1;  s->y2 = y2;
+
+}
+
+static void equalizer_limit( equalizer_t *eq, int32_t *x, int frames ) {
+
+	int ch = eq->channels;
+
+	for ( int i = 0; i < frames; i++ ) {
+
+		int32_t peak = 0;
+		for ( int c = 0; c < ch; c++ ) {
+			int32_t v = abs( x[ i * ch + c ] );
+			if ( v > peak ) peak = v;
+		}
+
+		// instant attack, exponential release
+		eq->gain += ( 32768 - eq->gain ) >> EQ_RELEASE_SHIFT;
+		if ( ( (int64_t) peak * eq->gain >> 15 ) > eq->threshold ) {
+			eq->gain = (int32_t) ( ( (int64_t) eq->threshold << 15 ) / peak );
+		}
+
+		for ( int c = 0; c < ch; c++ ) {
+			x[ i * ch + c ] = (int32_t) ( ( (int64_t) x[ i * ch + c ] * eq->gain ) >> 15 );
+		}
+
+	}
+
+}
+
+static void equalizer_run( equalizer_t *eq, int16_t *pcm, int frames ) {
+
+	int n = frames * eq->channels;
+
+	for ( int i = 0; i < n; i++ ) {
+		eq->work[i] = (int32_t) pcm[i] << EQ_EXTRA_BITS;
+	}
+
+	for ( int b = 0; b < eq->bands; b++ ) {
+		for ( int c = 0; c < eq->channels; c++ ) {
+			equalizer_section( &eq->coef[b], &eq->state[b][c], &eq->work[c], frames, eq->channels );
+		}
+	}
+
+	if ( eq->threshold > 0 ) {
+		equalizer_limit( eq, eq->work, frames );
+	}
+
+	for ( int i = 0; i < n; i++ ) {
+		pcm[i] = saturate16( ( eq->work[i] + ( 1 << ( EQ_EXTRA_BITS - 1 ) ) ) >> EQ_EXTRA_BITS );
+	}
+
+}
+
+static esp_err_t equalizer_open( audio_element_handle_t self ) {
+
+	equalizer_t *eq = (equalizer_t *) audio_element_getdata( self );
+
+	// force a design on the first block
+	eq->rate = 0;
+	eq->in_fill = 0;
+	eq->gain = 32768;
+
+	return ESP_OK;
+
+}
+
+static esp_err_t equalizer_close( audio_element_handle_t self ) {
+
+	return ESP_OK;
+
+}
+
+static void equalizer_free( equalizer_t *eq ) {
+
+	memory_free( eq->buf );
+	memory_free( eq->work );
+	audio_free( eq );
+
+}
+
+static esp_err_t equalizer_destroy( audio_element_handle_t self ) {
+
+	equalizer_free( (equalizer_t *) audio_element_getdata( self ) );
+
+	return ESP_OK;
+
+}
+
+static audio_element_err_t equalizer_process( audio_element_handle_t self, char *in_buffer, int in_len ) {
+
+	equalizer_t *eq = (equalizer_t *) audio_element_getdata( self );
+
+	equalizer_update_source( eq );
+
+	bool bypass = ( eq->bits != 16 ) || ( eq->channels < 1 ) || ( eq->channels > 2 ) || ( ( eq->bands == 0 ) && ( eq->threshold == 0 ) );
+	int frame_size = ( eq->channels > 0 ) ? eq->channels * sizeof(int16_t) : 1;
+	int size = EQ_BLOCK_FRAMES * 2 * sizeof(int16_t);
+
+	if ( !bypass ) size = EQ_BLOCK_FRAMES * frame_size;
+
+	int r_size = audio_element_input( self, (char *) eq->buf + eq->in_fill, size - eq->in_fill );
+	if ( r_size <= 0 ) {
+		return (audio_element_err_t) r_size;
+	}
+
+	int bytes = eq->in_fill + r_size;
+
+	if ( bypass ) {
+		eq->in_fill = 0;
+		int w_size = audio_element_output( self, (char *) eq->buf, bytes );
+		return ( w_size < 0 ) ? (audio_element_err_t) w_size : (audio_element_err_t) r_size;
+	}
+
+	// complete frames only, the rest waits for the next block
+	int frames = bytes / frame_size;
+	equalizer_run( eq, eq->buf, frames );
+
+	int w_size = ( frames > 0 ) ? audio_element_output( self, (char *) eq->buf, frames * frame_size ) : 0;
+
+	eq->in_fill = bytes - frames * frame_size;
+	if ( eq->in_fill > 0 ) {
+		memmove( eq->buf, (char *) eq->buf + frames * frame_size, eq->in_fill );
+	}
+
+	return ( w_size < 0 ) ? (audio_element_err_t) w_size : (audio_element_err_t) r_size;
+
+}
+
+audio_element_handle_t equalizer_init( equalizer_cfg_t *config ) {
+
+	equalizer_t *eq = (equalizer_t *) audio_calloc( 1, sizeof(equalizer_t) );
+	AUDIO_MEM_CHECK( TAGEQUALIZER, eq, return NULL );
+
+	// touched for every sample
+	eq->buf  = (int16_t *) memory_alloc( MEMORY_INTERNAL, EQ_BLOCK_FRAMES * 2 * sizeof(int16_t) );
+	eq->work = (int32_t *) memory_alloc( MEMORY_INTERNAL, EQ_BLOCK_FRAMES * 2 * sizeof(int32_t) );
+
+	if ( ( eq->buf == NULL ) || ( eq->work == NULL ) ) {
+		ESP_LOGE( TAGEQUALIZER, "no memory for buffers" );
+		equalizer_free( eq );
+		return NULL;
+	}
+
+	eq->gain = 32768;
+
+	audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+	cfg.open        = equalizer_open;
+	cfg.close       = equalizer_close;
+	cfg.process     = equalizer_process;
+	cfg.destroy     = equalizer_destroy;
+	cfg.tag         = "equalizer";
+	cfg.task_stack  = config->task_stack;
+	cfg.task_prio   = config->task_prio;
+	cfg.task_core   = config->task_core;
+	cfg.out_rb_size = config->out_rb_size;
+
+	audio_element_handle_t el = audio_element_init( &cfg );
+	AUDIO_MEM_CHECK( TAGEQUALIZER, el, { equalizer_free( eq ); return NULL; } );
+	audio_element_setdata( el, eq );
+
+	return el;
+
+}
+
+void equalizer_set_source( audio_element_handle_t self, audio_element_handle_t source ) {
+
+	equalizer_t *eq = (equalizer_t *) audio_element_getdata( self );
+	eq->source = source;
+
+}
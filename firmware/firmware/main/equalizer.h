@@ -0,0 +1,77 @@
+/*
+ * equalizer.h
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#ifndef MAIN_EQUALIZER_H_
+#define MAIN_EQUALIZER_H_
+
+#include <stdio.h>
+#include <audio_element.h>
+#include <cJSON.h>
+
+// parametric equalizer: a cascade of fixed point biquads (rbj cookbook) and a peak limiter.
+// the settings are shared by the config file, the api and the element, changes apply to the next block.
+
+#define EQ_BANDS          4
+#define EQ_MAX_GAIN       12		// dB
+#define EQ_BLOCK_FRAMES   256
+
+#define EQUALIZER_TASK_STACK  (3 * 1024)
+#define EQUALIZER_TASK_PRIO   (5)
+#define EQUALIZER_TASK_CORE   (0)
+#define EQUALIZER_RINGBUFFER_SIZE (8 * 1024)
+
+typedef enum {
+	EQ_OFF        = 0,
+	EQ_PEAK       = 1,
+	EQ_LOW_SHELF  = 2,
+	EQ_HIGH_SHELF = 3,
+	EQ_LOW_PASS   = 4,
+	EQ_HIGH_PASS  = 5
+} eq_type_t;
+
+typedef struct {
+	eq_type_t type;
+	int       frequency;	// Hz, center or corner
+	float     gain;			// dB, peak and shelves only
+	float     q;
+} eq_band_t;
+
+typedef struct {
+	int out_rb_size;
+	int task_stack;
+	int task_prio;
+	int task_core;
+} equalizer_cfg_t;
+
+#define DEFAULT_EQUALIZER_CONFIG() {                \
+	.out_rb_size = EQUALIZER_RINGBUFFER_SIZE,       \
+	.task_stack  = EQUALIZER_TASK_STACK,            \
+	.task_prio   = EQUALIZER_TASK_PRIO,             \
+	.task_core   = EQUALIZER_TASK_CORE              \
+}
+
+// EQ_BAND<n>=type,frequency,gain,q and EQ_LIMITER=dBFS
+bool equalizer_parse( const char *key, const char *value );
+void equalizer_write( FILE *f );
+
+// band 0..EQ_BANDS-1, values out of range are limited
+bool equalizer_set_band( int band, const eq_band_t *settings );
+eq_band_t equalizer_get_band( int band );
+
+// threshold in dBFS, 0 = off
+void equalizer_set_limiter( int threshold );
+int equalizer_get_limiter( void );
+
+// adds limiter and bands
+void equalizer_report( cJSON *root );
+
+audio_element_handle_t equalizer_init( equalizer_cfg_t *config );
+
+// element delivering the pcm stream, the rate is taken from its music info
+void equalizer_set_source( audio_element_handle_t self, audio_element_handle_t source );
+
+#endif /* MAIN_EQUALIZER_H_ */
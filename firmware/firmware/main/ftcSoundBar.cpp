@@ -15,6 +15,9 @@
 #include "playlist.h"
 #include "pipeline.h"
 #include "ftcSoundBar.h"
+#include "scheduling.h"
+#include "equalizer.h"
+#include "stream_reader.h"
 
 #define TAGFTCSOUNDBAR "::ftcSoundBar"
 
@@ -34,6 +37,31 @@ FtcSoundBar::FtcSoundBar( ) {
 
 	STARTUP_VOLUME = 15;
 
+	OUTPUT_RATE = 0;
+	RESAMPLE_QUALITY = 1;
+
+	NORMALIZE = false;
+	NORMALIZE_LEVEL = -18;
+	TRIM = true;
+	TRIM_LEVEL = -60;
+	LOOP_CROSSFADE = 10;
+	PRIORITY_POLICY = 0;
+	SD_MODE = 1;
+	SD_HIGHSPEED = false;
+	READ_SIZE = 16384;
+	READ_AHEAD = 32768;
+	FILE_CACHE = 2;
+	EQ = false;
+	DUCK = false;
+	DUCK_LEVEL = -12;
+	DUCK_ATTACK = 50;
+	DUCK_RELEASE = 300;
+	STREAM_PORT = 0;
+	STREAM_BUFFER = STREAM_READER_BUFFER;
+	HTTP_BUFFER = 64 * 1024;
+	strcpy( FOLDER, "" );
+	SHUFFLE_SEED = 0;
+
 }
 
 void FtcSoundBar::writeConfigFile( char *configFile )
@@ -55,6 +83,31 @@ void FtcSoundBar::writeConfigFile( char *configFile )
     fprintf( f, "DEBUG=%d\n", DEBUG);
     fprintf( f, "STARTUP_VOLUME=%d\n", STARTUP_VOLUME);
     fprintf( f, "HOSTNAME=%s\n", HOSTNAME);
+    fprintf( f, "OUTPUT_RATE=%d\n", OUTPUT_RATE);
+    fprintf( f, "RESAMPLE_QUALITY=%d\n", RESAMPLE_QUALITY);
+    fprintf( f, "NORMALIZE=%d\n", NORMALIZE);
+    fprintf( f, "NORMALIZE_LEVEL=%d\n", NORMALIZE_LEVEL);
+    fprintf( f, "TRIM=%d\n", TRIM);
+    fprintf( f, "TRIM_LEVEL=%d\n", TRIM_LEVEL);
+    fprintf( f, "LOOP_CROSSFADE=%d\n", LOOP_CROSSFADE);
+    fprintf( f, "PRIORITY_POLICY=%d\n", PRIORITY_POLICY);
+    fprintf( f, "SD_MODE=%d\n", SD_MODE);
+    fprintf( f, "SD_HIGHSPEED=%d\n", SD_HIGHSPEED);
+    fprintf( f, "READ_SIZE=%d\n", READ_SIZE);
+    fprintf( f, "READ_AHEAD=%d\n", READ_AHEAD);
+    fprintf( f, "FILE_CACHE=%d\n", FILE_CACHE);
+    fprintf( f, "EQ=%d\n", EQ);
+    fprintf( f, "DUCK=%d\n", DUCK);
+    fprintf( f, "DUCK_LEVEL=%d\n", DUCK_LEVEL);
+    fprintf( f, "DUCK_ATTACK=%d\n", DUCK_ATTACK);
+    fprintf( f, "DUCK_RELEASE=%d\n", DUCK_RELEASE);
+    fprintf( f, "STREAM_PORT=%d\n", STREAM_PORT);
+    fprintf( f, "STREAM_BUFFER=%d\n", STREAM_BUFFER);
+    fprintf( f, "HTTP_BUFFER=%d\n", HTTP_BUFFER);
+    fprintf( f, "FOLDER=%s\n", FOLDER);
+    fprintf( f, "SHUFFLE_SEED=%lu\n", (unsigned long) SHUFFLE_SEED);
+    equalizer_write( f );
+    sched_write( f );
 
     fclose(f);
 
@@ -80,7 +133,9 @@ void FtcSoundBar::readConfigFile( char *configFile )
 
     	while ( fscanf( f, "%s\n", line ) > 0 ) {
     		strcpy( key, strtok( line, "=" ) );
-    		strcpy( value, strtok( NULL, "=" ) );
+    		// e.g. FOLDER= for the root
+    		char *v = strtok( NULL, "=" );
+    		strcpy( value, ( v != NULL ) ? v : "" );
 
     		if ( strcmp( key, "WIFI_SSID" ) == 0 ) {
 
@@ -114,6 +169,106 @@ void FtcSoundBar::readConfigFile( char *configFile )
 
     			DEBUG = atoi( value );
 
+    		} else if ( strcmp( key, "OUTPUT_RATE" ) == 0 ) {
+
+    			OUTPUT_RATE = atoi( value );
+
+    		} else if ( strcmp( key, "RESAMPLE_QUALITY" ) == 0 ) {
+
+    			RESAMPLE_QUALITY = atoi( value );
+
+    		} else if ( strcmp( key, "NORMALIZE" ) == 0 ) {
+
+    			NORMALIZE = ( atoi( value ) != 0 );
+
+    		} else if ( strcmp( key, "NORMALIZE_LEVEL" ) == 0 ) {
+
+    			NORMALIZE_LEVEL = atoi( value );
+
+    		} else if ( strcmp( key, "TRIM" ) == 0 ) {
+
+    			TRIM = ( atoi( value ) != 0 );
+
+    		} else if ( strcmp( key, "TRIM_LEVEL" ) == 0 ) {
+
+    			TRIM_LEVEL = atoi( value );
+
+    		} else if ( strcmp( key, "LOOP_CROSSFADE" ) == 0 ) {
+
+    			LOOP_CROSSFADE = atoi( value );
+
+    		} else if ( strcmp( key, "PRIORITY_POLICY" ) == 0 ) {
+
+    			PRIORITY_POLICY = atoi( value );
+
+    		} else if ( strcmp( key, "SD_MODE" ) == 0 ) {
+
+    			SD_MODE = atoi( value );
+
+    		} else if ( strcmp( key, "SD_HIGHSPEED" ) == 0 ) {
+
+    			SD_HIGHSPEED = ( atoi( value ) != 0 );
+
+    		} else if ( strcmp( key, "READ_SIZE" ) == 0 ) {
+
+    			READ_SIZE = atoi( value );
+
+    		} else if ( strcmp( key, "READ_AHEAD" ) == 0 ) {
+
+    			READ_AHEAD = atoi( value );
+
+    		} else if ( strcmp( key, "FILE_CACHE" ) == 0 ) {
+
+    			FILE_CACHE = atoi( value );
+
+    		} else if ( strcmp( key, "EQ" ) == 0 ) {
+
+    			EQ = ( atoi( value ) != 0 );
+
+    		} else if ( strcmp( key, "DUCK" ) == 0 ) {
+
+    			DUCK = ( atoi( value ) != 0 );
+
+    		} else if ( strcmp( key, "DUCK_LEVEL" ) == 0 ) {
+
+    			DUCK_LEVEL = atoi( value );
+
+    		} else if ( strcmp( key, "DUCK_ATTACK" ) == 0 ) {
+
+    			DUCK_ATTACK = atoi( value );
+
+    		} else if ( strcmp( key, "DUCK_RELEASE" ) == 0 ) {
+
+    			DUCK_RELEASE = atoi( value );
+
+    		} else if ( strcmp( key, "STREAM_PORT" ) == 0 ) {
+
+    			STREAM_PORT = atoi( value );
+
+    		} else if ( strcmp( key, "STREAM_BUFFER" ) == 0 ) {
+
+    			STREAM_BUFFER = atoi( value );
+
+    		} else if ( strcmp( key, "HTTP_BUFFER" ) == 0 ) {
+
+    			HTTP_BUFFER = atoi( value );
+
+    		} else if ( strcmp( key, "FOLDER" ) == 0 ) {
+
+    			strlcpy( FOLDER, value, sizeof(FOLDER) );
+
+    		} else if ( strcmp( key, "SHUFFLE_SEED" ) == 0 ) {
+
+    			SHUFFLE_SEED = strtoul( value, NULL, 10 );
+
+    		} else if ( equalizer_parse( key, value ) ) {
+
+    			// EQ_LIMITER and EQ_BAND<n>=type,frequency,gain,q
+
+    		} else if ( sched_parse( key, value ) ) {
+
+    			// SCHED_PROFILE and SCHED_<TASK>=core,prio
+
     		} else {
 
     			ESP_LOGW(TAGFTCSOUNDBAR, "reading config file, ignoring pair (%s=%s)\n", key, value);
@@ -23,6 +23,29 @@ public:
 	bool DEBUG;
 	char HOSTNAME[64];
 	uint8_t STARTUP_VOLUME;
+	int OUTPUT_RATE;
+	uint8_t RESAMPLE_QUALITY;
+	bool NORMALIZE;
+	int NORMALIZE_LEVEL;
+	bool TRIM;
+	int TRIM_LEVEL;
+	int LOOP_CROSSFADE;
+	uint8_t PRIORITY_POLICY;
+	uint8_t SD_MODE;
+	bool SD_HIGHSPEED;
+	int READ_SIZE;
+	int READ_AHEAD;
+	uint8_t FILE_CACHE;
+	bool EQ;
+	bool DUCK;
+	int DUCK_LEVEL;
+	int DUCK_ATTACK;
+	int DUCK_RELEASE;
+	int STREAM_PORT;
+	int STREAM_BUFFER;
+	int HTTP_BUFFER;
+	char FOLDER[32];
+	uint32_t SHUFFLE_SEED;
 
 	TaskHandle_t xBlinky;
 
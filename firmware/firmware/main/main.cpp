@@ -46,6 +46,13 @@
 #include "ftcSoundBar.h"
 #include "blink.h"
 #include "ota.h"
+#include "analyzer.h"
+#include "storage.h"
+#include "scheduling.h"
+#include "memorypolicy.h"
+#include "equalizer.h"
+#include "stream_reader.h"
+#include "stream_server.h"
 
 extern "C" {
     void app_main(void);
@@ -58,6 +65,12 @@ static const char *TAG = "ftcSoundBar";
 #define FIRMWAREUPDATE "/sdcard/ftcSoundBar.bin"
 #define FIRMWARELOADER "/sdcard/loader.bin"
 
+#define RESCAN_TASK_STACK (4 * 1024)
+#define RESCAN_TASK_PRIO  (1)		// like the analyzer, below audio and network
+
+#define BENCHMARK_TASK_STACK (3 * 1024)
+#define BENCHMARK_TASK_PRIO  (1)	// reads compete with the sd reader, audio goes first
+
 static EventGroupHandle_t wifi_event_group;
 const int CONNECTED_BIT = BIT0;
 
@@ -518,7 +531,10 @@ static esp_err_t setup_html_get_handler(httpd_req_t *req )
 	httpd_resp_sendstr_chunk_cr(req, "	<tr></tr>" );
 	httpd_resp_sendstr_chunk_cr(req, "</table>" );
 
+	// names are copied under the lock, a rescan frees removed ones
+	ftcSoundBar.pipeline.playList.lock();
 	sprintf( line,  "<p id=\"activeTrack\" class=\"radioframe\">%s</p>", ftcSoundBar.pipeline.playList.getActiveTrack() );
+	ftcSoundBar.pipeline.playList.unlock();
 	httpd_resp_sendstr_chunk_cr(req, line );
 
 	// httpd_resp_sendstr_chunk_cr(req, "<div style=\"text-align: center;\"><input type=\"range\" value=\"0\" class=\"timeslider\" id=\"FilePos\" onkeypress=\"return false;\"></div>" );
@@ -557,7 +573,9 @@ static esp_err_t setup_html_get_handler(httpd_req_t *req )
 
 	  httpd_resp_sendstr_chunk(req, "	<tr>" );
 
+	  ftcSoundBar.pipeline.playList.lock();
 	  sprintf( line, "<td><a onclick=\"play(%d)\" class=\"select\">%03d %s</a></td></tr>", i, i, ftcSoundBar.pipeline.playList.getTrack(i) );
+	  ftcSoundBar.pipeline.playList.unlock();
 	  httpd_resp_sendstr_chunk(req, line);
 
 	  httpd_resp_sendstr_chunk_cr(req, "</tr>" );
@@ -591,6 +609,7 @@ static esp_err_t setup_html_get_handler(httpd_req_t *req )
 
      cJSON *root = cJSON_CreateObject();
      cJSON_AddNumberToObject(root, "tracks", ftcSoundBar.pipeline.playList.getTracks() );
+     cJSON_AddNumberToObject(root, "version", ftcSoundBar.pipeline.playList.getVersion() );
      const char *sys_info = cJSON_Print(root);
      httpd_resp_sendstr(req, sys_info);
 
@@ -615,11 +634,28 @@ static esp_err_t track_get_handler(httpd_req_t *req)
 
     cJSON_AddNumberToObject(root, "state", (int)ftcSoundBar.pipeline.getState() );
 
+    // cJSON copies the names, a rescan can't free them meanwhile
+    ftcSoundBar.pipeline.playList.lock();
+
     for (int i=0; i < ftcSoundBar.pipeline.playList.getTracks(); i++) {
           sprintf( tag, "track#%d", i );
           cJSON_AddStringToObject(root, tag, ftcSoundBar.pipeline.playList.getTrack(i) );
     }
 
+    // tags by track number, filled in background after boot. a track without them yet is an empty object.
+    cJSON *info = cJSON_AddArrayToObject(root, "info");
+    for (int i=0; i < ftcSoundBar.pipeline.playList.getTracks(); i++) {
+          cJSON *item = cJSON_CreateObject();
+          if ( ftcSoundBar.pipeline.playList.isTagged(i) ) {
+              if ( ftcSoundBar.pipeline.playList.getTitle(i) != NULL ) cJSON_AddStringToObject(item, "title", ftcSoundBar.pipeline.playList.getTitle(i) );
+              if ( ftcSoundBar.pipeline.playList.getArtist(i) != NULL ) cJSON_AddStringToObject(item, "artist", ftcSoundBar.pipeline.playList.getArtist(i) );
+              cJSON_AddNumberToObject(item, "duration", ftcSoundBar.pipeline.playList.getDuration(i) );
+          }
+          cJSON_AddItemToArray(info, item);
+    }
+
+    ftcSoundBar.pipeline.playList.unlock();
+
     const char *sys_info = cJSON_Print(root);
     httpd_resp_sendstr(req, sys_info);
 
@@ -638,10 +674,13 @@ static esp_err_t active_track_get_handler(httpd_req_t *req)
     httpd_resp_set_type(req, "application/json");
 
     cJSON *root = cJSON_CreateObject();
+    ftcSoundBar.pipeline.playList.lock();
     cJSON_AddStringToObject(root, "activeTrack", ftcSoundBar.pipeline.playList.getActiveTrack() );
+    ftcSoundBar.pipeline.playList.unlock();
     cJSON_AddNumberToObject(root, "activeTrackNr", ftcSoundBar.pipeline.playList.getActiveTrackNr() );
     cJSON_AddNumberToObject(root, "mode", ftcSoundBar.pipeline.getMode() );
     cJSON_AddNumberToObject(root, "state", ftcSoundBar.pipeline.getState() );
+    cJSON_AddNumberToObject(root, "priority", ftcSoundBar.pipeline.getPriority() );
 
     const char *sys_info = cJSON_Print(root);
     httpd_resp_sendstr(req, sys_info);
@@ -714,6 +753,18 @@ static char *getBody(httpd_req_t *req)
     return buf;
 }
 
+// rest and i2c accept PRIORITY_NORMAL up to PRIORITY_MAX
+static bool priority_valid( int priority )
+{
+	return ( priority >= PRIORITY_NORMAL ) && ( priority <= PRIORITY_MAX );
+}
+
+// track numbers of the active folder, 0 up to getTracks()-1
+static bool track_valid( int track )
+{
+	return ( track >= 0 ) && ( track < ftcSoundBar.pipeline.playList.getTracks() );
+}
+
 static esp_err_t play_post_handler(httpd_req_t *req)
 {
 	char *body = getBody(req);
@@ -727,13 +778,61 @@ static esp_err_t play_post_handler(httpd_req_t *req)
     cJSON *root = cJSON_Parse(body);
     if ( root == NULL ) { return ESP_FAIL; }
 
+    // a track on a media server
+    cJSON *JSONurl = cJSON_GetObjectItem(root, "url");
+    if ( cJSON_IsString( JSONurl ) ) {
+    	bool ok = ftcSoundBar.pipeline.playUrl( JSONurl->valuestring );
+    	cJSON_Delete(root);
+    	if ( !ok ) {
+    		httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "url can't be played, needs http://, a known extension and HTTP_BUFFER");
+    		return ESP_OK;
+    	}
+    	httpd_resp_sendstr(req, "Post control value successfully");
+    	return ESP_OK;
+    }
+
+    int track = ftcSoundBar.pipeline.playList.getActiveTrackNr();
     cJSON *JSONtrack = cJSON_GetObjectItem(root, "track");
     if ( JSONtrack != NULL ) {
-    	int track = JSONtrack->valueint;
-    	ftcSoundBar.pipeline.playList.setActiveTrackNr(track);
+    	track = JSONtrack->valueint;
+    	if ( !cJSON_IsNumber( JSONtrack ) || !track_valid( track ) ) {
+    		cJSON_Delete(root);
+    		httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "track out of range");
+    		return ESP_OK;
+    	}
+    }
+
+    // {"name": "horn.mp3"} or {"hash": <FNV-1a of the name>} stay valid when tracks are added, unlike the number
+    cJSON *JSONname = cJSON_GetObjectItem(root, "name");
+    cJSON *JSONhash = cJSON_GetObjectItem(root, "hash");
+    if ( cJSON_IsString( JSONname ) || cJSON_IsNumber( JSONhash ) ) {
+    	track = cJSON_IsString( JSONname ) ? ftcSoundBar.pipeline.playList.findName( JSONname->valuestring )
+    	                                   : ftcSoundBar.pipeline.playList.findHash( (uint32_t) JSONhash->valuedouble );
+    	if ( track < 0 ) {
+    		cJSON_Delete(root);
+    		httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, cJSON_IsString( JSONname ) ? "unknown track name" : "unknown or shared track hash");
+    		return ESP_OK;
+    	}
     }
 
-    ftcSoundBar.pipeline.play( );
+    int priority = PRIORITY_NORMAL;
+    cJSON *JSONpriority = cJSON_GetObjectItem(root, "priority");
+    if ( JSONpriority != NULL ) {
+    	priority = JSONpriority->valueint;
+    }
+    if ( !priority_valid( priority ) ) {
+    	cJSON_Delete(root);
+    	httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "priority out of range");
+    	return ESP_OK;
+    }
+
+    // an effect over the music, which is ducked meanwhile
+    cJSON *JSONforeground = cJSON_GetObjectItem(root, "foreground");
+    if ( cJSON_IsTrue( JSONforeground ) ) {
+    	ftcSoundBar.pipeline.playForeground( track );
+    } else {
+    	ftcSoundBar.pipeline.play( track, priority );
+    }
     cJSON_Delete(root);
     httpd_resp_sendstr(req, "Post control value successfully");
 
@@ -841,8 +940,7 @@ static esp_err_t previous_post_handler(httpd_req_t *req)
 
 	ESP_LOGD( TAGAPI, "POST previous: %s", body);
 
-    ftcSoundBar.pipeline.playList.prevTrack();
-    ftcSoundBar.pipeline.play( );
+    ftcSoundBar.pipeline.previous();
 
     httpd_resp_sendstr(req, "Post control value successfully");
 
@@ -859,8 +957,7 @@ static esp_err_t next_post_handler(httpd_req_t *req)
 
 	ESP_LOGD( TAGAPI, "POST next: %s", body);
 
-	ftcSoundBar.pipeline.playList.nextTrack();
-    ftcSoundBar.pipeline.play( );
+    ftcSoundBar.pipeline.next();
 
     httpd_resp_sendstr(req, "Post control value successfully");
 
@@ -897,6 +994,13 @@ static esp_err_t mode_post_handler(httpd_req_t *req)
 
     cJSON *root = cJSON_Parse(body);
     int mode = cJSON_GetObjectItem(root, "mode")->valueint;
+
+    // {"mode": 1, "seed": 42} repeats the same shuffle order, 0 - random
+    cJSON *JSONseed = cJSON_GetObjectItem(root, "seed");
+    if ( cJSON_IsNumber( JSONseed ) ) {
+    	ftcSoundBar.pipeline.playList.setShuffleSeed( (uint32_t) JSONseed->valuedouble );
+    }
+
     ftcSoundBar.pipeline.setMode( (play_mode_t) mode );
 
     cJSON_Delete(root);
@@ -939,21 +1043,613 @@ static esp_err_t resume_post_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+static esp_err_t queue_get_handler(httpd_req_t *req)
+{
+	ESP_LOGD( TAGAPI, "GET queue" );
+
+    httpd_resp_set_type(req, "application/json");
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON *queue = cJSON_AddArrayToObject(root, "queue");
+
+    for (int i=0; i < ftcSoundBar.pipeline.playList.getQueueLength(); i++) {
+    	int track = ftcSoundBar.pipeline.playList.getQueuedTrack(i);
+    	if ( track >= 0 ) { cJSON_AddItemToArray(queue, cJSON_CreateNumber(track) ); }
+    }
+
+    cJSON_AddNumberToObject(root, "length", cJSON_GetArraySize(queue) );
+    cJSON_AddNumberToObject(root, "max", MAXQUEUE );
+
+    const char *sys_info = cJSON_Print(root);
+    httpd_resp_sendstr(req, sys_info);
+
+	ESP_LOGD( TAGAPI, "GET queue: %s", sys_info);
+
+    free((void *)sys_info);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+static esp_err_t queue_post_handler(httpd_req_t *req)
+{
+	char *body = getBody(req);
+	if (body==NULL) {
+		ESP_LOGD( TAGAPI, "POST queue: <NULL>");
+		return ESP_FAIL;
+	}
+
+	ESP_LOGD( TAGAPI, "POST queue: %s", body);
+
+    cJSON *root = cJSON_Parse(body);
+    if ( root == NULL ) { return ESP_FAIL; }
+
+    bool ok = true;
+
+    // {"track": n} or {"tracks": [n, m, ...]}
+    cJSON *JSONtrack = cJSON_GetObjectItem(root, "track");
+    if ( JSONtrack != NULL ) {
+    	ok = track_valid( JSONtrack->valueint ) && ftcSoundBar.pipeline.enqueue( JSONtrack->valueint );
+    }
+
+    cJSON *JSONtracks = cJSON_GetObjectItem(root, "tracks");
+    if ( cJSON_IsArray( JSONtracks ) ) {
+    	cJSON *item;
+    	cJSON_ArrayForEach( item, JSONtracks ) {
+    		ok = track_valid( item->valueint ) && ftcSoundBar.pipeline.enqueue( item->valueint ) && ok;
+    	}
+    }
+
+    cJSON_Delete(root);
+
+    if ( !ok ) {
+    	httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "queue is full or track is invalid");
+    	return ESP_OK;
+    }
+
+    httpd_resp_sendstr(req, "Post control value successfully");
+
+    return ESP_OK;
+}
+
+static esp_err_t queue_delete_handler(httpd_req_t *req)
+{
+	ESP_LOGD( TAGAPI, "DELETE queue" );
+
+	ftcSoundBar.pipeline.playList.clearQueue();
+
+    httpd_resp_sendstr(req, "Post control value successfully");
+
+    return ESP_OK;
+}
+
+static esp_err_t phrase_post_handler(httpd_req_t *req)
+{
+	char *body = getBody(req);
+	if (body==NULL) {
+		ESP_LOGD( TAGAPI, "POST phrase: <NULL>");
+		return ESP_FAIL;
+	}
+
+	ESP_LOGD( TAGAPI, "POST phrase: %s", body);
+
+    cJSON *root = cJSON_Parse(body);
+    if ( root == NULL ) { return ESP_FAIL; }
+
+    int priority = PRIORITY_PHRASE;
+    cJSON *JSONpriority = cJSON_GetObjectItem(root, "priority");
+    if ( JSONpriority != NULL ) {
+    	priority = JSONpriority->valueint;
+    }
+    if ( !priority_valid( priority ) ) {
+    	cJSON_Delete(root);
+    	httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "priority out of range");
+    	return ESP_OK;
+    }
+
+    bool ok = false;
+
+    // {"tracks": [n, m, ...]} or {"number": n}
+    cJSON *JSONtracks = cJSON_GetObjectItem(root, "tracks");
+    cJSON *JSONnumber = cJSON_GetObjectItem(root, "number");
+    if ( cJSON_IsArray( JSONtracks ) ) {
+    	int8_t tracks[MAXPHRASE];
+    	int8_t count = 0;
+    	bool valid = true;
+    	cJSON *item;
+    	cJSON_ArrayForEach( item, JSONtracks ) {
+    		if ( count < MAXPHRASE ) { tracks[count] = item->valueint; }
+    		valid = valid && track_valid( item->valueint );
+    		count++;
+    	}
+    	ok = valid && ftcSoundBar.pipeline.playPhrase( tracks, count, priority );
+    } else if ( JSONnumber != NULL ) {
+    	ok = ftcSoundBar.pipeline.playNumber( JSONnumber->valueint, priority );
+    }
+
+    cJSON_Delete(root);
+
+    if ( !ok ) {
+    	httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "clips are missing, of different kind or a track with higher priority is playing");
+    	return ESP_OK;
+    }
+
+    httpd_resp_sendstr(req, "Post control value successfully");
+
+    return ESP_OK;
+}
+
+static esp_err_t eq_get_handler(httpd_req_t *req)
+{
+	ESP_LOGD( TAGAPI, "GET eq" );
+
+    httpd_resp_set_type(req, "application/json");
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "enabled", ftcSoundBar.EQ );
+    equalizer_report( root );
+    const char *sys_info = cJSON_Print(root);
+    httpd_resp_sendstr(req, sys_info);
+
+    free((void *)sys_info);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+static void analyze_folder( void )
+{
+	char indexFile[100];
+
+	ftcSoundBar.pipeline.playList.getIndexFile( indexFile, sizeof(indexFile) );
+	analyzer_start( &ftcSoundBar.pipeline.playList, ftcSoundBar.pipeline.playList.getDirectory(), indexFile, ftcSoundBar.NORMALIZE || ftcSoundBar.TRIM, ftcSoundBar.NORMALIZE_LEVEL, ftcSoundBar.TRIM_LEVEL );
+
+}
+
+static volatile bool rescanning = false;
+
+static void task_rescan( void *pvParameter )
+{
+	char indexFile[100];
+
+	if ( ftcSoundBar.pipeline.rescan() ) {
+
+		ftcSoundBar.pipeline.playList.getIndexFile( indexFile, sizeof(indexFile) );
+		ftcSoundBar.pipeline.playList.saveIndex( indexFile );
+
+		// new tracks get their tags read and analyzed
+		analyze_folder();
+
+	}
+
+	rescanning = false;
+	vTaskDelete( NULL );
+
+}
+
+static bool rescan_start( void )
+{
+	// both work on the track numbers
+	if ( rescanning || analyzer_running() ) {
+		ESP_LOGW( TAG, "rescan or analyzer is running" );
+		return false;
+	}
+
+	rescanning = true;
+	if ( xTaskCreate( &task_rescan, "rescan", RESCAN_TASK_STACK, NULL, RESCAN_TASK_PRIO, NULL ) != pdPASS ) {
+		rescanning = false;
+		return false;
+	}
+
+	return true;
+
+}
+
+static bool select_folder( int8_t folderNr )
+{
+	// the analyzer and the rescan work on the tracks of the active folder
+	if ( analyzer_running() || rescanning ) {
+		ESP_LOGW( TAG, "analyzer or rescan is running, folder stays" );
+		return false;
+	}
+
+	if ( !ftcSoundBar.pipeline.selectFolder( folderNr ) ) {
+		return false;
+	}
+
+	analyze_folder();
+
+	return true;
+
+}
+
+static esp_err_t rescan_get_handler(httpd_req_t *req)
+{
+	ESP_LOGD( TAGAPI, "GET rescan" );
+
+    httpd_resp_set_type(req, "application/json");
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "version", ftcSoundBar.pipeline.playList.getVersion() );
+    cJSON_AddBoolToObject(root, "running", rescanning );
+    const char *sys_info = cJSON_Print(root);
+    httpd_resp_sendstr(req, sys_info);
+
+    free((void *)sys_info);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+static esp_err_t rescan_post_handler(httpd_req_t *req)
+{
+	char *body = getBody(req);
+	if (body==NULL) {
+		ESP_LOGD( TAGAPI, "POST rescan: <NULL>");
+		return ESP_FAIL;
+	}
+
+	ESP_LOGD( TAGAPI, "POST rescan: %s", body);
+
+	// the new version shows up at GET /api/rescan when it is done
+	if ( !rescan_start() ) {
+		httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "rescan or analyzer is running");
+		return ESP_OK;
+	}
+
+    httpd_resp_sendstr(req, "Post control value successfully");
+
+    return ESP_OK;
+}
+
+static esp_err_t folders_get_handler(httpd_req_t *req)
+{
+	ESP_LOGD( TAGAPI, "GET folders" );
+
+    httpd_resp_set_type(req, "application/json");
+    cJSON *root = cJSON_CreateObject();
+    cJSON *folders = cJSON_AddArrayToObject(root, "folders");
+    for (int i=0; i < ftcSoundBar.pipeline.playList.getFolders(); i++) {
+    	cJSON_AddItemToArray(folders, cJSON_CreateString( ftcSoundBar.pipeline.playList.getFolder(i) ) );
+    }
+    cJSON_AddNumberToObject(root, "active", ftcSoundBar.pipeline.playList.getActiveFolderNr() );
+    const char *sys_info = cJSON_Print(root);
+    httpd_resp_sendstr(req, sys_info);
+
+    free((void *)sys_info);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+static esp_err_t folder_post_handler(httpd_req_t *req)
+{
+	char *body = getBody(req);
+	if (body==NULL) {
+		ESP_LOGD( TAGAPI, "POST folder: <NULL>");
+		return ESP_FAIL;
+	}
+
+	ESP_LOGD( TAGAPI, "POST folder: %s", body);
+
+    cJSON *root = cJSON_Parse(body);
+    if ( root == NULL ) { return ESP_FAIL; }
+
+    // {"folder": "crane"} or {"folder": 1}, "" or 0 is the root
+    int8_t folderNr = -1;
+    cJSON *JSONfolder = cJSON_GetObjectItem(root, "folder");
+    if ( cJSON_IsString( JSONfolder ) ) {
+    	folderNr = ftcSoundBar.pipeline.playList.findFolder( JSONfolder->valuestring );
+    } else if ( cJSON_IsNumber( JSONfolder ) ) {
+    	folderNr = JSONfolder->valueint;
+    }
+
+    cJSON_Delete(root);
+
+    if ( !select_folder( folderNr ) ) {
+    	httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "unknown folder or analyzer is running");
+    	return ESP_OK;
+    }
+
+    httpd_resp_sendstr(req, "Post control value successfully");
+
+    return ESP_OK;
+}
+
+static esp_err_t playlists_get_handler(httpd_req_t *req)
+{
+	ESP_LOGD( TAGAPI, "GET playlists" );
+
+    httpd_resp_set_type(req, "application/json");
+    cJSON *root = cJSON_CreateObject();
+    cJSON *playlists = cJSON_AddArrayToObject(root, "playlists");
+    ftcSoundBar.pipeline.playList.lock();
+    for (int i=0; i < ftcSoundBar.pipeline.playList.getLists(); i++) {
+    	cJSON_AddItemToArray(playlists, cJSON_CreateString( ftcSoundBar.pipeline.playList.getList(i) ) );
+    }
+    ftcSoundBar.pipeline.playList.unlock();
+    cJSON_AddNumberToObject(root, "active", ftcSoundBar.pipeline.playList.getActiveListNr() );
+    cJSON_AddNumberToObject(root, "entries", ftcSoundBar.pipeline.playList.getEntries() );
+    const char *sys_info = cJSON_Print(root);
+    httpd_resp_sendstr(req, sys_info);
+
+    free((void *)sys_info);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+static esp_err_t playlist_post_handler(httpd_req_t *req)
+{
+	char *body = getBody(req);
+	if (body==NULL) {
+		ESP_LOGD( TAGAPI, "POST playlist: <NULL>");
+		return ESP_FAIL;
+	}
+
+	ESP_LOGD( TAGAPI, "POST playlist: %s", body);
+
+    cJSON *root = cJSON_Parse(body);
+    if ( root == NULL ) { return ESP_FAIL; }
+
+    // {"playlist": "show.m3u"} or {"playlist": 1}, "" or 0 plays the folder in alphabetic order
+    int8_t listNr = -1;
+    cJSON *JSONlist = cJSON_GetObjectItem(root, "playlist");
+    if ( cJSON_IsString( JSONlist ) ) {
+    	listNr = ftcSoundBar.pipeline.playList.findList( JSONlist->valuestring );
+    } else if ( cJSON_IsNumber( JSONlist ) ) {
+    	listNr = JSONlist->valueint;
+    }
+
+    cJSON_Delete(root);
+
+    if ( !ftcSoundBar.pipeline.selectList( listNr ) ) {
+    	httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "unknown or empty playlist");
+    	return ESP_OK;
+    }
+
+    httpd_resp_sendstr(req, "Post control value successfully");
+
+    return ESP_OK;
+}
+
+static esp_err_t rate_get_handler(httpd_req_t *req)
+{
+	ESP_LOGD( TAGAPI, "GET rate" );
+
+    httpd_resp_set_type(req, "application/json");
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "rate", ftcSoundBar.pipeline.getPlaybackRate() );
+    cJSON_AddBoolToObject(root, "available", ftcSoundBar.OUTPUT_RATE > 0 );
+    const char *sys_info = cJSON_Print(root);
+    httpd_resp_sendstr(req, sys_info);
+
+    free((void *)sys_info);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+static esp_err_t rate_post_handler(httpd_req_t *req)
+{
+	char *body = getBody(req);
+	if (body==NULL) {
+		ESP_LOGD( TAGAPI, "POST rate: <NULL>");
+		return ESP_FAIL;
+	}
+
+	ESP_LOGD( TAGAPI, "POST rate: %s", body);
+
+    cJSON *root = cJSON_Parse(body);
+    if ( root == NULL ) { return ESP_FAIL; }
+
+    // {"rate": 250..4000}, per mille of the normal pitch and tempo
+    bool ok = false;
+    cJSON *JSONrate = cJSON_GetObjectItem(root, "rate");
+    if ( JSONrate != NULL ) {
+    	ok = ftcSoundBar.pipeline.setPlaybackRate( JSONrate->valueint );
+    }
+
+    cJSON_Delete(root);
+
+    if ( !ok ) {
+    	httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "rate needs OUTPUT_RATE in the config");
+    	return ESP_OK;
+    }
+
+    httpd_resp_sendstr(req, "Post control value successfully");
+
+    return ESP_OK;
+}
+
+static esp_err_t eq_post_handler(httpd_req_t *req)
+{
+	char *body = getBody(req);
+	if (body==NULL) {
+		ESP_LOGD( TAGAPI, "POST eq: <NULL>");
+		return ESP_FAIL;
+	}
+
+	ESP_LOGD( TAGAPI, "POST eq: %s", body);
+
+    cJSON *root = cJSON_Parse(body);
+    if ( root == NULL ) { return ESP_FAIL; }
+
+    bool ok = true;
+    cJSON *item;
+
+    // {"band": 1..4, "type": t, "frequency": f, "gain": g, "q": q}, missing fields keep their value
+    cJSON *JSONband = cJSON_GetObjectItem(root, "band");
+    if ( JSONband != NULL ) {
+    	eq_band_t band = equalizer_get_band( JSONband->valueint - 1 );
+    	if ( ( item = cJSON_GetObjectItem(root, "type") ) != NULL )      { band.type = (eq_type_t) item->valueint; }
+    	if ( ( item = cJSON_GetObjectItem(root, "frequency") ) != NULL ) { band.frequency = item->valueint; }
+    	if ( ( item = cJSON_GetObjectItem(root, "gain") ) != NULL )      { band.gain = item->valuedouble; }
+    	if ( ( item = cJSON_GetObjectItem(root, "q") ) != NULL )         { band.q = item->valuedouble; }
+    	ok = equalizer_set_band( JSONband->valueint - 1, &band );
+    }
+
+    if ( ( item = cJSON_GetObjectItem(root, "limiter") ) != NULL ) {
+    	equalizer_set_limiter( item->valueint );
+    }
+
+    // changes are live, save keeps them
+    if ( ok && cJSON_IsTrue( cJSON_GetObjectItem(root, "save") ) ) {
+    	ftcSoundBar.writeConfigFile( (char *) CONFIG_FILE );
+    }
+
+    cJSON_Delete(root);
+
+    if ( !ok ) {
+    	httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bands are 1..4, types 0..5");
+    	return ESP_OK;
+    }
+
+    httpd_resp_sendstr(req, "Post control value successfully");
+
+    return ESP_OK;
+}
+
+static esp_err_t tone_post_handler(httpd_req_t *req)
+{
+	char *body = getBody(req);
+	if (body==NULL) {
+		ESP_LOGD( TAGAPI, "POST tone: <NULL>");
+		return ESP_FAIL;
+	}
+
+	ESP_LOGD( TAGAPI, "POST tone: %s", body);
+
+    cJSON *root = cJSON_Parse(body);
+    if ( root == NULL ) { return ESP_FAIL; }
+
+    // all fields are optional, the defaults give a short beep
+    tone_t tone = TONE_DEFAULT();
+    cJSON *item;
+
+    if ( ( item = cJSON_GetObjectItem(root, "waveform") ) != NULL )      { tone.waveform = (tone_waveform_t) item->valueint; }
+    if ( ( item = cJSON_GetObjectItem(root, "frequency") ) != NULL )     { tone.frequency = tone.frequency_end = item->valueint; }
+    if ( ( item = cJSON_GetObjectItem(root, "frequency_end") ) != NULL ) { tone.frequency_end = item->valueint; }
+    if ( ( item = cJSON_GetObjectItem(root, "duration") ) != NULL )      { tone.duration = item->valueint; }
+    if ( ( item = cJSON_GetObjectItem(root, "attack") ) != NULL )        { tone.attack = item->valueint; }
+    if ( ( item = cJSON_GetObjectItem(root, "decay") ) != NULL )         { tone.decay = item->valueint; }
+    if ( ( item = cJSON_GetObjectItem(root, "sustain") ) != NULL )       { tone.sustain = item->valueint; }
+    if ( ( item = cJSON_GetObjectItem(root, "release") ) != NULL )       { tone.release = item->valueint; }
+    if ( ( item = cJSON_GetObjectItem(root, "level") ) != NULL )         { tone.level = item->valueint; }
+
+    int priority = PRIORITY_TONE;
+    if ( ( item = cJSON_GetObjectItem(root, "priority") ) != NULL )      { priority = item->valueint; }
+
+    cJSON_Delete(root);
+
+    if ( !priority_valid( priority ) ) {
+    	httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "priority out of range");
+    	return ESP_OK;
+    }
+
+    if ( !ftcSoundBar.pipeline.playTone( &tone, priority ) ) {
+    	httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "a track with higher priority is playing");
+    	return ESP_OK;
+    }
+
+    httpd_resp_sendstr(req, "Post control value successfully");
+
+    return ESP_OK;
+}
+
+static void sd_benchmark( int8_t trackNr )
+{
+	char path[300];
+
+	ftcSoundBar.pipeline.playList.getPath( trackNr, path, sizeof(path) );
+	storage_benchmark( path, ftcSoundBar.READ_SIZE, STORAGE_BENCHMARK_BYTES );
+
+}
+
+static volatile bool benchmarking = false;
+
+static void task_benchmark( void *pvParameter )
+{
+	sd_benchmark( 0 );
+
+	benchmarking = false;
+	vTaskDelete( NULL );
+
+}
+
+// the result shows up in the next /api/metrics
+static bool benchmark_start( void )
+{
+	if ( benchmarking ) return true;
+
+	benchmarking = true;
+	if ( xTaskCreate( &task_benchmark, "benchmark", BENCHMARK_TASK_STACK, NULL, BENCHMARK_TASK_PRIO, NULL ) != pdPASS ) {
+		benchmarking = false;
+		return false;
+	}
+
+	return true;
+
+}
+
+static esp_err_t metrics_get_handler(httpd_req_t *req)
+{
+	char query[32];
+	char value[8];
+
+	ESP_LOGD( TAGAPI, "GET metrics" );
+
+	// /api/metrics?benchmark=1 measures the sd card again in the background, the next call reports it
+	if ( ( httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK ) &&
+	     ( httpd_query_key_value(query, "benchmark", value, sizeof(value)) == ESP_OK ) &&
+	     ( atoi(value) != 0 ) && ( ftcSoundBar.pipeline.playList.getTracks() > 0 ) ) {
+		benchmark_start();
+	}
+
+    httpd_resp_set_type(req, "application/json");
+
+    storage_info_t *sd = storage_get_info();
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "sd_width", sd->width );
+    cJSON_AddNumberToObject(root, "sd_freq_khz", sd->freq_khz );
+    cJSON_AddNumberToObject(root, "sd_read_mbps", sd->read_mbps );
+    cJSON_AddBoolToObject(root, "sd_benchmark_running", benchmarking );
+    cJSON_AddNumberToObject(root, "sd_read_size", ftcSoundBar.READ_SIZE );
+    cJSON_AddNumberToObject(root, "sd_read_ahead", ftcSoundBar.READ_AHEAD );
+    cJSON_AddNumberToObject(root, "sched_profile", sched_get_profile() );
+    sched_report( cJSON_AddArrayToObject(root, "tasks") );
+    memory_report( cJSON_AddObjectToObject(root, "memory") );
+    if ( ftcSoundBar.pipeline.getStreamReader() != NULL ) {
+    	stream_reader_report( ftcSoundBar.pipeline.getStreamReader(), cJSON_AddObjectToObject(root, "stream") );
+    }
+
+    const char *sys_info = cJSON_Print(root);
+    httpd_resp_sendstr(req, sys_info);
+
+	ESP_LOGD( TAGAPI, "GET metrics: %s", sys_info);
+
+    free((void *)sys_info);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
 #define TAGWEB "WEBSERVER"
 
 /* Function to start the web server */
 esp_err_t start_web_server( const char *base_path )
 {
 
-    http_server_context_t *http_context = (http_server_context_t*)calloc(1, sizeof(http_server_context_t));
+    http_server_context_t *http_context = (http_server_context_t*)memory_calloc(MEMORY_BULK, 1, sizeof(http_server_context_t));
     strlcpy(http_context->base_path, base_path, sizeof(http_context->base_path));
 
     httpd_handle_t server = NULL;
 
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.uri_match_fn = httpd_uri_match_wildcard;
-    config.max_uri_handlers = 20;
+    config.max_uri_handlers = 38;
     config.stack_size = 20480;
+    config.core_id = sched_core( SCHED_HTTPD );
+    config.task_priority = sched_prio( SCHED_HTTPD );
 
     ESP_LOGI(TAGWEB, "Starting HTTP Server");
     if (httpd_start(&server, &config) != ESP_OK) {
@@ -1026,6 +1722,57 @@ esp_err_t start_web_server( const char *base_path )
     httpd_uri_t resume_post_uri = { .uri = "/api/track/resume", .method = HTTP_POST, .handler = resume_post_handler, .user_ctx = http_context };
     httpd_register_uri_handler(server, &resume_post_uri);
 
+    // queue
+    httpd_uri_t queue_get_uri = { .uri = "/api/queue", .method = HTTP_GET, .handler = queue_get_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &queue_get_uri);
+
+    httpd_uri_t queue_post_uri = { .uri = "/api/queue", .method = HTTP_POST, .handler = queue_post_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &queue_post_uri);
+
+    httpd_uri_t queue_delete_uri = { .uri = "/api/queue", .method = HTTP_DELETE, .handler = queue_delete_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &queue_delete_uri);
+
+    httpd_uri_t tone_post_uri = { .uri = "/api/tone", .method = HTTP_POST, .handler = tone_post_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &tone_post_uri);
+
+    httpd_uri_t phrase_post_uri = { .uri = "/api/phrase", .method = HTTP_POST, .handler = phrase_post_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &phrase_post_uri);
+
+    httpd_uri_t eq_get_uri = { .uri = "/api/eq", .method = HTTP_GET, .handler = eq_get_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &eq_get_uri);
+
+    httpd_uri_t eq_post_uri = { .uri = "/api/eq", .method = HTTP_POST, .handler = eq_post_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &eq_post_uri);
+
+    httpd_uri_t rate_get_uri = { .uri = "/api/rate", .method = HTTP_GET, .handler = rate_get_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &rate_get_uri);
+
+    httpd_uri_t rate_post_uri = { .uri = "/api/rate", .method = HTTP_POST, .handler = rate_post_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &rate_post_uri);
+
+    // folders
+    httpd_uri_t folders_get_uri = { .uri = "/api/folders", .method = HTTP_GET, .handler = folders_get_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &folders_get_uri);
+
+    httpd_uri_t folder_post_uri = { .uri = "/api/folder", .method = HTTP_POST, .handler = folder_post_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &folder_post_uri);
+
+    httpd_uri_t playlists_get_uri = { .uri = "/api/playlists", .method = HTTP_GET, .handler = playlists_get_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &playlists_get_uri);
+
+    httpd_uri_t playlist_post_uri = { .uri = "/api/playlist", .method = HTTP_POST, .handler = playlist_post_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &playlist_post_uri);
+
+    httpd_uri_t rescan_get_uri = { .uri = "/api/rescan", .method = HTTP_GET, .handler = rescan_get_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &rescan_get_uri);
+
+    httpd_uri_t rescan_post_uri = { .uri = "/api/rescan", .method = HTTP_POST, .handler = rescan_post_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &rescan_post_uri);
+
+    // metrics
+    httpd_uri_t metrics_get_uri = { .uri = "/api/metrics", .method = HTTP_GET, .handler = metrics_get_handler, .user_ctx = http_context };
+    httpd_register_uri_handler(server, &metrics_get_uri);
+
     return ESP_OK;
 }
 
@@ -1224,8 +1971,7 @@ static esp_err_t input_key_service_cb(periph_service_handle_t handle, periph_ser
             case INPUT_KEY_USER_ID_SET:
                 ESP_LOGI(TAGKEY, "[ * ] [Set] input key event");
                 ESP_LOGI(TAGKEY, "[ * ] Stopped, advancing to the next song");
-                ftcSoundBar.pipeline.playList.nextTrack();
-                ftcSoundBar.pipeline.play( );
+                ftcSoundBar.pipeline.next();
                 break;
             case INPUT_KEY_USER_ID_VOLUP:
                 ESP_LOGI(TAGKEY, "[ * ] [Vol+] input key event");
@@ -1307,10 +2053,55 @@ enum I2C_CMD {
 	I2C_CMD_GET_ACTIVE_TRACK=9,
 	I2C_CMD_GET_TRACK_STATE=10,
 	I2C_CMD_NEXT=11,
-	I2C_CMD_PREVIOUS=12
+	I2C_CMD_PREVIOUS=12,
+	I2C_CMD_PLAY_PRIORITY=13,
+	I2C_CMD_ENQUEUE=14,
+	I2C_CMD_CLEAR_QUEUE=15,
+	I2C_CMD_TONE=16,
+	I2C_CMD_PHRASE=17,
+	I2C_CMD_NUMBER=18,
+	I2C_CMD_SET_RATE=19,
+	I2C_CMD_PLAY_FOREGROUND=20,
+	I2C_CMD_SET_FOLDER=21,
+	I2C_CMD_SET_PLAYLIST=22,
+	I2C_CMD_PLAY_HASH=23,
+	I2C_CMD_RESCAN=24,
+	I2C_CMD_GET_VERSION=25
 };
 
 
+// frames from the i2c task to the main loop, cmd is the first byte, data holds up to 4 more
+#define I2C_EVENT_SOURCE 0x7F000000
+#define I2C_EVENT_QUEUE  8
+static audio_event_iface_handle_t i2c_evt = NULL;
+
+// bytes of a frame including the command, shorter frames are ignored
+static int i2c_frame_length( uint8_t cmd ) {
+
+	switch ( cmd ) {
+	case I2C_CMD_PLAY_HASH:
+	case I2C_CMD_TONE:
+		return 5;
+	case I2C_CMD_NUMBER:
+		return 4;
+	case I2C_CMD_PLAY_PRIORITY:
+	case I2C_CMD_SET_RATE:
+		return 3;
+	case I2C_CMD_PLAY:
+	case I2C_CMD_SET_VOLUME:
+	case I2C_CMD_SET_MODE:
+	case I2C_CMD_ENQUEUE:
+	case I2C_CMD_PHRASE:
+	case I2C_CMD_PLAY_FOREGROUND:
+	case I2C_CMD_SET_FOLDER:
+	case I2C_CMD_SET_PLAYLIST:
+		return 2;
+	default:
+		return 1;
+	}
+
+}
+
 void i2c_reply( uint8_t reply ) {
 
 	ESP_ERROR_CHECK( i2c_reset_tx_fifo( I2C_SLAVE_NUM ) ); 
@@ -1319,30 +2110,92 @@ void i2c_reply( uint8_t reply ) {
 }
 
 
-static void i2c_task(void)
+// commands run on the main task like the audio events, so they don't race the pipeline
+static void i2c_command( uint8_t *data, int bytes_read )
 {
-    int bytes_read = 0;
-
-    uint8_t data[10];    // receive buffer
-
-   	bytes_read = i2c_slave_read_buffer(I2C_SLAVE_NUM, data, 5, 0 );
-
-   	if (bytes_read > 0 ) {
-   		ESP_LOGD(TAGI2C, "%d bytes read.", bytes_read);
     	switch (data[0]) {
     	case I2C_CMD_PLAY:
 			ESP_LOGD(TAGI2C, "play %d", data[1]);
 			ftcSoundBar.pipeline.playList.setActiveTrackNr( data[1] );
 			ftcSoundBar.pipeline.play();
 			break;
+    	case I2C_CMD_PLAY_HASH: {
+			// FNV-1a of the lower case name, little endian
+			uint32_t hash = data[1] | ( data[2] << 8 ) | ( data[3] << 16 ) | ( (uint32_t) data[4] << 24 );
+			int8_t track = ftcSoundBar.pipeline.playList.findHash( hash );
+			ESP_LOGD(TAGI2C, "play hash %08lx, track %d", (unsigned long) hash, track);
+			if ( track >= 0 ) {
+				ftcSoundBar.pipeline.playList.setActiveTrackNr( track );
+				ftcSoundBar.pipeline.play();
+			}
+			break; }
+    	case I2C_CMD_PLAY_PRIORITY:
+			ESP_LOGD(TAGI2C, "play %d priority %d", data[1], data[2]);
+			if ( !priority_valid( data[2] ) ) {
+				ESP_LOGW(TAGI2C, "priority %d out of range", data[2]);
+				break;
+			}
+			if ( !track_valid( data[1] ) ) {
+				ESP_LOGW(TAGI2C, "track %d out of range", data[1]);
+				break;
+			}
+			ftcSoundBar.pipeline.play( data[1], data[2] );
+			break;
+    	case I2C_CMD_PLAY_FOREGROUND:
+			ESP_LOGD(TAGI2C, "play %d over the music", data[1]);
+			if ( !track_valid( data[1] ) ) {
+				ESP_LOGW(TAGI2C, "track %d out of range", data[1]);
+				break;
+			}
+			ftcSoundBar.pipeline.playForeground( data[1] );
+			break;
+    	case I2C_CMD_ENQUEUE:
+			ESP_LOGD(TAGI2C, "enqueue %d", data[1]);
+			ftcSoundBar.pipeline.enqueue( data[1] );
+			break;
+    	case I2C_CMD_SET_FOLDER:
+			ESP_LOGD(TAGI2C, "folder %d", data[1]);
+			select_folder( data[1] );
+			break;
+    	case I2C_CMD_SET_PLAYLIST:
+			ESP_LOGD(TAGI2C, "playlist %d", data[1]);
+			ftcSoundBar.pipeline.selectList( data[1] );
+			break;
+    	case I2C_CMD_CLEAR_QUEUE:
+			ESP_LOGD(TAGI2C, "clear queue");
+			ftcSoundBar.pipeline.playList.clearQueue();
+			break;
+    	case I2C_CMD_TONE: {
+			// frequency low, high byte, duration in 10ms, waveform
+			tone_t tone = TONE_DEFAULT();
+			tone.frequency = tone.frequency_end = data[1] | ( data[2] << 8 );
+			tone.duration = data[3] * 10;
+			tone.waveform = (tone_waveform_t) data[4];
+			ESP_LOGD(TAGI2C, "tone %dHz %dms waveform %d", tone.frequency, tone.duration, tone.waveform);
+			ftcSoundBar.pipeline.playTone( &tone );
+			break; }
+    	case I2C_CMD_PHRASE: {
+			// up to 4 tracks, 0xFF ends the phrase
+			int8_t count = 0;
+			while ( ( count < 4 ) && ( count + 1 < bytes_read ) && ( data[count + 1] != 0xFF ) ) { count++; }
+			ESP_LOGD(TAGI2C, "phrase of %d clips", count);
+			ftcSoundBar.pipeline.playPhrase( (int8_t *) &data[1], count );
+			break; }
+    	case I2C_CMD_NUMBER: {
+			uint32_t number = data[1] | ( data[2] << 8 ) | ( data[3] << 16 );
+			ESP_LOGD(TAGI2C, "number %lu", (unsigned long) number);
+			ftcSoundBar.pipeline.playNumber( number );
+			break; }
+    	case I2C_CMD_SET_RATE: {
+			// per mille, applied within one block
+			int rate = data[1] | ( data[2] << 8 );
+			ESP_LOGD(TAGI2C, "rate %d", rate);
+			ftcSoundBar.pipeline.setPlaybackRate( rate );
+			break; }
     	case I2C_CMD_SET_VOLUME:
 			ESP_LOGD(TAGI2C, "set volume %d", data[1]);
 			ftcSoundBar.pipeline.setVolume( data[1] );
 			break;
-    	case I2C_CMD_GET_VOLUME:
-			ESP_LOGD(TAGI2C, "get volume" );
-			i2c_reply( ftcSoundBar.pipeline.getVolume() );
-			break;
     	case I2C_CMD_STOP_TRACK:
 			ESP_LOGD(TAGI2C, "stop" );
 			ftcSoundBar.pipeline.stop();
@@ -1359,10 +2212,68 @@ static void i2c_task(void)
 			ESP_LOGD(TAGI2C, "set mode %d", data[1]);
 			ftcSoundBar.pipeline.setMode( (play_mode_t) data[1] );
 			break;
+    	case I2C_CMD_RESCAN:
+			ESP_LOGD(TAGI2C, "rescan");
+			rescan_start();
+			break;
+    	case I2C_CMD_NEXT:
+			ESP_LOGD(TAGI2C, "next");
+			ftcSoundBar.pipeline.playList.nextTrack();
+			break;
+    	case I2C_CMD_PREVIOUS:
+			ESP_LOGD(TAGI2C, "previous");
+			ftcSoundBar.pipeline.playList.prevTrack();
+			break;
+    	default:
+    		ESP_LOGE(TAGI2C, "unkown cmd");
+    		disp_buf(data, bytes_read);
+			break;
+    	}
+
+}
+
+static void i2c_event( audio_event_iface_msg_t *msg )
+{
+	uint8_t data[5];
+	uint32_t payload = (uint32_t) (uintptr_t) msg->data;
+
+	data[0] = msg->cmd;
+	for ( int i = 1; i < 5; i++ ) { data[i] = ( payload >> ( 8 * ( i - 1 ) ) ) & 0xFF; }
+
+	i2c_command( data, msg->data_len );
+
+}
+
+static void i2c_task(void)
+{
+    int bytes_read = 0;
+
+    uint8_t data[10];    // receive buffer
+
+   	bytes_read = i2c_slave_read_buffer(I2C_SLAVE_NUM, data, 5, 1 );
+
+   	if (bytes_read > 0 ) {
+   		ESP_LOGD(TAGI2C, "%d bytes read.", bytes_read);
+
+   		if ( bytes_read < i2c_frame_length( data[0] ) ) {
+   			ESP_LOGW(TAGI2C, "cmd %d needs %d bytes, got %d", data[0], i2c_frame_length( data[0] ), bytes_read);
+   			return;
+   		}
+
+    	switch (data[0]) {
+    	case I2C_CMD_GET_VOLUME:
+			ESP_LOGD(TAGI2C, "get volume" );
+			i2c_reply( ftcSoundBar.pipeline.getVolume() );
+			break;
     	case I2C_CMD_GET_MODE:
 			ESP_LOGD(TAGI2C, "get mode" );
 			i2c_reply( ftcSoundBar.pipeline.getMode() );
 			break;
+    	case I2C_CMD_GET_VERSION:
+			// the lower byte is enough to notice a change
+			ESP_LOGD(TAGI2C, "get version");
+			i2c_reply( ftcSoundBar.pipeline.playList.getVersion() & 0xFF );
+			break;
     	case I2C_CMD_GET_TRACKS:
 			ESP_LOGD(TAGI2C, "get tacks");
 			i2c_reply( ftcSoundBar.pipeline.playList.getTracks() );
@@ -1375,27 +2286,35 @@ static void i2c_task(void)
 			ESP_LOGD(TAGI2C, "get track state");
 			i2c_reply( ftcSoundBar.pipeline.getState() );
 			break;
-    	case I2C_CMD_NEXT:
-			ESP_LOGD(TAGI2C, "next");
-			ftcSoundBar.pipeline.playList.nextTrack();
-			break;
-    	case I2C_CMD_PREVIOUS:
-			ESP_LOGD(TAGI2C, "previous");
-			ftcSoundBar.pipeline.playList.prevTrack();
-			break;
-    	default:
-    		ESP_LOGE(TAGI2C, "unkown cmd");
-    		disp_buf(data, bytes_read);
-			break;
+    	default: {
+			// the master waits for nothing else, so the frame goes to the main task
+			audio_event_iface_msg_t msg = {};
+			uint32_t payload = 0;
+			for ( int i = bytes_read - 1; i >= 1; i-- ) { payload = ( payload << 8 ) | data[i]; }
+			msg.source_type = I2C_EVENT_SOURCE;
+			msg.cmd = data[0];
+			msg.data = (void *) (uintptr_t) payload;
+			msg.data_len = bytes_read;
+			if ( audio_event_iface_sendout( i2c_evt, &msg ) != ESP_OK ) {
+				ESP_LOGW(TAGI2C, "main task busy, cmd %d dropped", data[0]);
+			}
+			break; }
     	}
 
    	}
 
 }
 
+static void task_i2c(void *pvParameters)
+{
+	// i2c_slave_read_buffer blocks for a tick, so the task doesn't spin
+	while (1) { i2c_task(); }
+}
+
 void app_main(void)
 {
     esp_log_level_set("*", ESP_LOG_INFO);
+    memory_init();
 
 	ESP_LOGI(TAG, "**********************************************************************************************");
 	ESP_LOGI(TAG, "*                                                                                            *");
@@ -1418,23 +2337,52 @@ void app_main(void)
 	gpio_set_direction(BLINK_GPIO, GPIO_MODE_OUTPUT);
 
     ESP_LOGI(TAG, "[1.1] Initialize and start peripherals");
-    audio_board_sdcard_init(set, SD_MODE_1_LINE);
+    storage_mount(set, 1, false);
 
-    ESP_LOGI(TAG, "[1.2] Set up a sdcard playlist and scan sdcard music save to it");
-    ftcSoundBar.pipeline.playList.readDir( "/sdcard" );
-
-    ESP_LOGI(TAG, "[1.3] read config file");
+    ESP_LOGI(TAG, "[1.2] read config file");
     ftcSoundBar.readConfigFile( (char *) CONFIG_FILE );
     if (ftcSoundBar.DEBUG) {
     	ESP_LOGI( TAG, "Set log level to debug.");
     	esp_log_level_set("*", ESP_LOG_DEBUG);
     }
 
+    ftcSoundBar.pipeline.playList.setShuffleSeed( ftcSoundBar.SHUFFLE_SEED );
+
+    ESP_LOGI(TAG, "[1.3] Set up the playlist of folder \"%s\" and scan it for new tracks", ftcSoundBar.FOLDER);
+    ftcSoundBar.pipeline.playList.readFolders( STORAGE_ROOT );
+    int8_t folderNr = ftcSoundBar.pipeline.playList.findFolder( ftcSoundBar.FOLDER );
+    if ( folderNr < 0 ) {
+    	ESP_LOGW(TAG, "      folder \"%s\" not found, using the root", ftcSoundBar.FOLDER);
+    	folderNr = 0;
+    }
+    ftcSoundBar.pipeline.playList.selectFolder( folderNr, true );
+
+    if ( ( ftcSoundBar.SD_MODE == 4 ) || ftcSoundBar.SD_HIGHSPEED ) {
+    	ESP_LOGI(TAG, "[1.4] Remount sdcard in %d bit mode%s", ftcSoundBar.SD_MODE, ftcSoundBar.SD_HIGHSPEED ? " with high speed" : "" );
+    	storage_mount( set, ftcSoundBar.SD_MODE, ftcSoundBar.SD_HIGHSPEED );
+    }
+
+    if ( ftcSoundBar.pipeline.playList.getTracks() > 0 ) {
+    	ESP_LOGI(TAG, "[1.5] Measure sdcard read throughput");
+    	sd_benchmark( 0 );
+    }
+
     ESP_LOGI(TAG, "[2.0] Initialize wifi" );
-	if (ftcSoundBar.WIFI) init_wifi();
+	if (ftcSoundBar.WIFI) { init_wifi(); sched_apply_wifi(); }
 	else ESP_LOGI(TAG, "     wifi is disabled.");
 
     ESP_LOGI(TAG, "[3.0] Start codec chip");
+    ftcSoundBar.pipeline.setOutputRate( ftcSoundBar.OUTPUT_RATE, ftcSoundBar.RESAMPLE_QUALITY );
+    ftcSoundBar.pipeline.setNormalize( ftcSoundBar.NORMALIZE );
+    ftcSoundBar.pipeline.setTrim( ftcSoundBar.TRIM );
+    ftcSoundBar.pipeline.setLoopCrossfade( ftcSoundBar.LOOP_CROSSFADE );
+    ftcSoundBar.pipeline.setEqualizer( ftcSoundBar.EQ );
+    ftcSoundBar.pipeline.setDucking( ftcSoundBar.DUCK, ftcSoundBar.DUCK_LEVEL, ftcSoundBar.DUCK_ATTACK, ftcSoundBar.DUCK_RELEASE );
+    ftcSoundBar.pipeline.setReadAhead( ftcSoundBar.READ_SIZE, ftcSoundBar.READ_AHEAD );
+    ftcSoundBar.pipeline.setFileCache( ftcSoundBar.FILE_CACHE );
+    ftcSoundBar.pipeline.setStreamBuffer( ( ftcSoundBar.WIFI && ( ftcSoundBar.STREAM_PORT > 0 ) ) ? ftcSoundBar.STREAM_BUFFER : 0 );
+    ftcSoundBar.pipeline.setHttpBuffer( ftcSoundBar.WIFI ? ftcSoundBar.HTTP_BUFFER : 0 );
+    ftcSoundBar.pipeline.setPriorityPolicy( (priority_policy_t) ftcSoundBar.PRIORITY_POLICY );
     ftcSoundBar.pipeline.StartCodec();
     ftcSoundBar.pipeline.build( FILETYPE_MP3 );
 
@@ -1464,27 +2412,50 @@ void app_main(void)
     if (ftcSoundBar.WIFI) ESP_ERROR_CHECK( start_web_server( "localhost" ) );
 	else ESP_LOGI(TAG, "     Web Server is disabled.");
 
+    if (ftcSoundBar.WIFI && (ftcSoundBar.STREAM_PORT > 0)) {
+    	ESP_LOGI(TAG, "[5.1] Start stream server on port %d", ftcSoundBar.STREAM_PORT);
+    	stream_server_start( &ftcSoundBar.pipeline, ftcSoundBar.STREAM_PORT );
+    }
+
     ESP_LOGI(TAG, "[6.0] Set volume");
     ftcSoundBar.pipeline.setVolume( ftcSoundBar.STARTUP_VOLUME );
 
     ESP_LOGI(TAG, "[7.0] Everything started");
 
+    ESP_LOGI(TAG, "[7.1] Read tags of new tracks in background, analyze loudness and silence if enabled");
+    analyze_folder();
+
     audio_event_iface_cfg_t evt_cfg = AUDIO_EVENT_IFACE_DEFAULT_CFG();
+    evt_cfg.queue_set_size += I2C_EVENT_QUEUE + PIPELINE_REQUEST_QUEUE;
     audio_event_iface_handle_t evt = audio_event_iface_init(&evt_cfg);
     ftcSoundBar.pipeline.setListener( evt );
 
+    audio_event_iface_cfg_t i2c_cfg = AUDIO_EVENT_IFACE_DEFAULT_CFG();
+    i2c_cfg.external_queue_size = I2C_EVENT_QUEUE;
+    i2c_evt = audio_event_iface_init(&i2c_cfg);
+    audio_event_iface_set_listener( i2c_evt, evt );
+
 	if ( ftcSoundBar.xBlinky != NULL ) { vTaskDelete( ftcSoundBar.xBlinky ); }
 	gpio_set_level(BLINK_GPIO, 1);
 
+    // i2c gets its own task, so its priority and core are independent of the audio events
+    if ( ftcSoundBar.I2C_MODE) {
+    	xTaskCreatePinnedToCore(&task_i2c, "i2c", 4096, NULL, sched_prio( SCHED_I2C ), NULL, sched_core( SCHED_I2C ) );
+    }
+
     // run forever
     while (1) {
 
-    	if ( ftcSoundBar.I2C_MODE) { i2c_task(); };
-
     	// check on new song / repeat & shuffle
     	audio_event_iface_msg_t msg;
-    	esp_err_t ret = audio_event_iface_listen(evt, &msg, 10);
-    	if (ret == ESP_OK) { ftcSoundBar.pipeline.audioMessageHandler( msg ); }
+    	esp_err_t ret = audio_event_iface_listen(evt, &msg, portMAX_DELAY);
+    	if (ret != ESP_OK) continue;
+
+    	if ( msg.source_type == I2C_EVENT_SOURCE ) {
+    		i2c_event( &msg );
+    	} else {
+    		ftcSoundBar.pipeline.audioMessageHandler( msg );
+    	}
 
     }
 
@@ -0,0 +1,104 @@
+/*
+ * memorypolicy.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <string.h>
+
+#include "memorypolicy.h"
+
+#define TAGMEMORY "::MEMORY"
+
+static uint32_t memory_caps( memory_class_t cls ) {
+
+	switch ( cls ) {
+	case MEMORY_DMA:      return MALLOC_CAP_DMA | MALLOC_CAP_8BIT;
+	case MEMORY_INTERNAL: return MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+	default:              return MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+	}
+
+}
+
+static void *memory_bulk_alloc( size_t size ) {
+
+	return memory_alloc( MEMORY_BULK, size );
+
+}
+
+void memory_init( void ) {
+
+	cJSON_Hooks hooks = { .malloc_fn = memory_bulk_alloc, .free_fn = memory_free };
+	cJSON_InitHooks( &hooks );
+
+	ESP_LOGI( TAGMEMORY, "internal %u bytes free, psram %u bytes free",
+			heap_caps_get_free_size( MALLOC_CAP_INTERNAL ), heap_caps_get_free_size( MALLOC_CAP_SPIRAM ) );
+
+}
+
+void *memory_alloc( memory_class_t cls, size_t size ) {
+
+	void *ptr = heap_caps_malloc( size, memory_caps( cls ) );
+
+	// no psram or psram full: bulk data still fits internally
+	if ( ( ptr == NULL ) && ( cls == MEMORY_BULK ) ) {
+		ptr = heap_caps_malloc( size, memory_caps( MEMORY_INTERNAL ) );
+	}
+
+	if ( ptr == NULL ) {
+		ESP_LOGW( TAGMEMORY, "no memory for %u bytes of class %d", size, cls );
+	}
+
+	return ptr;
+
+}
+
+void *memory_calloc( memory_class_t cls, size_t n, size_t size ) {
+
+	void *ptr = memory_alloc( cls, n * size );
+	if ( ptr != NULL ) {
+		memset( ptr, 0, n * size );
+	}
+
+	return ptr;
+
+}
+
+char *memory_strdup( memory_class_t cls, const char *s ) {
+
+	char *ptr = (char *) memory_alloc( cls, strlen( s ) + 1 );
+	if ( ptr != NULL ) {
+		strcpy( ptr, s );
+	}
+
+	return ptr;
+
+}
+
+void memory_free( void *ptr ) {
+
+	heap_caps_free( ptr );
+
+}
+
+static void memory_report_region( cJSON *root, const char *name, uint32_t caps ) {
+
+	cJSON *region = cJSON_AddObjectToObject( root, name );
+	cJSON_AddNumberToObject( region, "size", heap_caps_get_total_size( caps ) );
+	cJSON_AddNumberToObject( region, "free", heap_caps_get_free_size( caps ) );
+	// high-water mark
+	cJSON_AddNumberToObject( region, "min_free", heap_caps_get_minimum_free_size( caps ) );
+	cJSON_AddNumberToObject( region, "largest_block", heap_caps_get_largest_free_block( caps ) );
+
+}
+
+void memory_report( cJSON *root ) {
+
+	memory_report_region( root, "internal", MALLOC_CAP_INTERNAL );
+	memory_report_region( root, "dma", MALLOC_CAP_DMA );
+	memory_report_region( root, "psram", MALLOC_CAP_SPIRAM );
+
+}
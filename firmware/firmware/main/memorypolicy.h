@@ -0,0 +1,38 @@
+/*
+ * memorypolicy.h
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#ifndef MAIN_MEMORYPOLICY_H_
+#define MAIN_MEMORYPOLICY_H_
+
+#include <stddef.h>
+#include <cJSON.h>
+
+// decides where buffers live:
+// bulk data (track names, index, json, scratch buffers) goes to psram if present,
+// dma buffers and data touched in time critical loops stay in internal ram.
+// audio elements keep using audio_malloc, which places their ringbuffers in psram already.
+
+typedef enum {
+	MEMORY_BULK = 0,		// psram, internal if there is no psram
+	MEMORY_INTERNAL,		// internal ram, fast
+	MEMORY_DMA				// internal ram, dma capable
+} memory_class_t;
+
+// routes cJSON to bulk memory, call it before any json is created
+void memory_init( void );
+
+void *memory_alloc( memory_class_t cls, size_t size );
+void *memory_calloc( memory_class_t cls, size_t n, size_t size );
+char *memory_strdup( memory_class_t cls, const char *s );
+
+// works for all classes, plain free() does as well
+void memory_free( void *ptr );
+
+// adds size, free, lowest free and largest block of internal, dma and psram
+void memory_report( cJSON *root );
+
+#endif /* MAIN_MEMORYPOLICY_H_ */
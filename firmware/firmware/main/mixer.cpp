@@ -0,0 +1,256 @@
+/*
+ * mixer.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#include <esp_log.h>
+#include <audio_mem.h>
+#include <string.h>
+#include <math.h>
+
+#include "mixer.h"
+#include "memorypolicy.h"
+
+#define TAGMIXER "::MIXER"
+
+#define MIXER_GAIN_BITS 27
+#define MIXER_UNITY ( 1 << MIXER_GAIN_BITS )	// Q27, steps of long ramps would be rounded off in Q15
+
+typedef struct {
+	int      rate;
+	int16_t  *buf;			// music, mixed in place
+	int16_t  *fg;			// foreground
+	int      in_fill;		// bytes of an incomplete frame left in buf
+	int      fg_fill;		// bytes of an incomplete frame left in fg
+	ringbuf_handle_t fg_rb;
+	volatile bool foreground;
+	int      starved;		// frames without foreground data
+	int32_t  gain;			// music gain, Q27
+	int32_t  duck_gain;
+	int32_t  attack_step;	// per frame
+	int32_t  release_step;
+} mixer_t;
+
+static inline int16_t saturate16( int32_t x ) {
+
+	if ( x > 32767 ) return 32767;
+	if ( x < -32768 ) return -32768;
+	return (int16_t) x;
+
+}
+
+static int32_t mixer_step( int32_t range, int ms, int rate ) {
+
+	int32_t frames = ms * rate / 1000;
+	return ( frames > 0 ) ? ( range + frames - 1 ) / frames : range;
+
+}
+
+static esp_err_t mixer_open( audio_element_handle_t self ) {
+
+	mixer_t *mix = (mixer_t *) audio_element_getdata( self );
+
+	// an effect might still be playing from the last track
+	mix->in_fill = 0;
+	mix->gain = mix->foreground ? mix->duck_gain : MIXER_UNITY;
+
+	audio_element_set_music_info( self, mix->rate, 2, 16 );
+
+	return ESP_OK;
+
+}
+
+static esp_err_t mixer_close( audio_element_handle_t self ) {
+
+	return ESP_OK;
+
+}
+
+// reads up to frames of the foreground without waiting, returns the frames read
+static int mixer_read_foreground( mixer_t *mix, int frames ) {
+
+	if ( !mix->foreground || ( mix->fg_rb == NULL ) ) {
+		return 0;
+	}
+
+	int r_size = rb_read( mix->fg_rb, (char *) mix->fg + mix->fg_fill, frames * 4 - mix->fg_fill, 0 );
+
+	if ( ( r_size == RB_DONE ) || ( r_size == RB_ABORT ) ) {
+		ESP_LOGD( TAGMIXER, "foreground done" );
+		mix->foreground = false;
+		return 0;
+	}
+
+	int bytes = mix->fg_fill + ( ( r_size > 0 ) ? r_size : 0 );
+	int n = bytes / 4;
+
+	mix->fg_fill = bytes - n * 4;
+	mix->starved = ( n > 0 ) ? 0 : mix->starved + frames;
+
+	// e.g. the file could not be decoded
+	if ( mix->starved > mix->rate * MIXER_STARVED_MS / 1000 ) {
+		ESP_LOGW( TAGMIXER, "foreground starved" );
+		mix->foreground = false;
+	}
+
+	return n;
+
+}
+
+static void mixer_run( mixer_t *mix, int frames, int fg_frames ) {
+
+	int16_t *x = mix->buf;
+	int16_t *f = mix->fg;
+
+	for ( int i = 0; i < frames; i++ ) {
+
+		// linear ramps, the target follows the foreground
+		int32_t target = mix->foreground ? mix->duck_gain : MIXER_UNITY;
+		if ( mix->gain > target ) {
+			mix->gain -= mix->attack_step;
+			if ( mix->gain < target ) mix->gain = target;
+		} else if ( mix->gain < target ) {
+			mix->gain += mix->release_step;
+			if ( mix->gain > target ) mix->gain = target;
+		}
+
+		int32_t gain = mix->gain >> ( MIXER_GAIN_BITS - 15 );
+		int32_t l = ( x[ 2 * i ] * gain ) >> 15;
+		int32_t r = ( x[ 2 * i + 1 ] * gain ) >> 15;
+
+		if ( i < fg_frames ) {
+			l += f[ 2 * i ];
+			r += f[ 2 * i + 1 ];
+		}
+
+		x[ 2 * i ]     = saturate16( l );
+		x[ 2 * i + 1 ] = saturate16( r );
+
+	}
+
+	// an incomplete frame stays for the next block
+	if ( fg_frames > 0 ) {
+		memmove( mix->fg, &mix->fg[ 2 * fg_frames ], mix->fg_fill );
+	}
+
+}
+
+static audio_element_err_t mixer_process( audio_element_handle_t self, char *in_buffer, int in_len ) {
+
+	mixer_t *mix = (mixer_t *) audio_element_getdata( self );
+	int size = MIXER_BLOCK_FRAMES * 4;
+
+	int r_size = audio_element_input( self, (char *) mix->buf + mix->in_fill, size - mix->in_fill );
+
+	if ( ( r_size == AEL_IO_DONE ) || ( r_size == AEL_IO_OK ) ) {
+		// the music is over, the effect plays to its end
+		if ( !mix->foreground ) {
+			return (audio_element_err_t) r_size;
+		}
+		memset( (char *) mix->buf + mix->in_fill, 0, size - mix->in_fill );
+		r_size = size - mix->in_fill;
+	} else if ( r_size < 0 ) {
+		return (audio_element_err_t) r_size;
+	}
+
+	int bytes = mix->in_fill + r_size;
+	int frames = bytes / 4;
+
+	mixer_run( mix, frames, mixer_read_foreground( mix, frames ) );
+
+	int w_size = ( frames > 0 ) ? audio_element_output( self, (char *) mix->buf, frames * 4 ) : 0;
+
+	mix->in_fill = bytes - frames * 4;
+	if ( mix->in_fill > 0 ) {
+		memmove( mix->buf, (char *) mix->buf + frames * 4, mix->in_fill );
+	}
+
+	return ( w_size < 0 ) ? (audio_element_err_t) w_size : (audio_element_err_t) r_size;
+
+}
+
+static void mixer_free( mixer_t *mix ) {
+
+	memory_free( mix->buf );
+	memory_free( mix->fg );
+	audio_free( mix );
+
+}
+
+static esp_err_t mixer_destroy( audio_element_handle_t self ) {
+
+	mixer_free( (mixer_t *) audio_element_getdata( self ) );
+
+	return ESP_OK;
+
+}
+
+audio_element_handle_t mixer_init( mixer_cfg_t *config ) {
+
+	mixer_t *mix = (mixer_t *) audio_calloc( 1, sizeof(mixer_t) );
+	AUDIO_MEM_CHECK( TAGMIXER, mix, return NULL );
+
+	// touched for every sample
+	mix->buf = (int16_t *) memory_alloc( MEMORY_INTERNAL, MIXER_BLOCK_FRAMES * 2 * sizeof(int16_t) );
+	mix->fg  = (int16_t *) memory_alloc( MEMORY_INTERNAL, MIXER_BLOCK_FRAMES * 2 * sizeof(int16_t) );
+
+	if ( ( mix->buf == NULL ) || ( mix->fg == NULL ) ) {
+		ESP_LOGE( TAGMIXER, "no memory for buffers" );
+		mixer_free( mix );
+		return NULL;
+	}
+
+	int level = config->duck_level;
+	if ( level > 0 ) level = 0;
+
+	mix->rate         = config->rate;
+	mix->gain         = MIXER_UNITY;
+	mix->duck_gain    = lrintf( MIXER_UNITY * powf( 10.0f, level / 20.0f ) );
+	mix->attack_step  = mixer_step( MIXER_UNITY - mix->duck_gain, config->attack, mix->rate );
+	mix->release_step = mixer_step( MIXER_UNITY - mix->duck_gain, config->release, mix->rate );
+
+	audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+	cfg.open        = mixer_open;
+	cfg.close       = mixer_close;
+	cfg.process     = mixer_process;
+	cfg.destroy     = mixer_destroy;
+	cfg.tag         = "mixer";
+	cfg.task_stack  = config->task_stack;
+	cfg.task_prio   = config->task_prio;
+	cfg.task_core   = config->task_core;
+	cfg.out_rb_size = config->out_rb_size;
+
+	audio_element_handle_t el = audio_element_init( &cfg );
+	AUDIO_MEM_CHECK( TAGMIXER, el, { mixer_free( mix ); return NULL; } );
+	audio_element_setdata( el, mix );
+
+	ESP_LOGI( TAGMIXER, "ducking to %ddB, attack %dms, release %dms", level, config->attack, config->release );
+
+	return el;
+
+}
+
+void mixer_set_foreground( audio_element_handle_t self, ringbuf_handle_t rb ) {
+
+	mixer_t *mix = (mixer_t *) audio_element_getdata( self );
+	mix->fg_rb = rb;
+
+}
+
+void mixer_start_foreground( audio_element_handle_t self ) {
+
+	mixer_t *mix = (mixer_t *) audio_element_getdata( self );
+
+	mix->fg_fill = 0;
+	mix->starved = 0;
+	mix->foreground = true;
+
+}
+
+bool mixer_foreground_active( audio_element_handle_t self ) {
+
+	return ( (mixer_t *) audio_element_getdata( self ) )->foreground;
+
+}
@@ -0,0 +1,58 @@
+/*
+ * mixer.h
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#ifndef MAIN_MIXER_H_
+#define MAIN_MIXER_H_
+
+#include <audio_element.h>
+#include <ringbuf.h>
+
+// mixes a foreground stream (an effect) over the pipeline's stream (the music), which is ducked while the foreground plays.
+// both streams are 16 bit stereo at the same rate, so the mixer needs OUTPUT_RATE.
+
+#define MIXER_BLOCK_FRAMES    256
+#define MIXER_FOREGROUND_SIZE (16 * 1024)	// ringbuffer between the foreground pipeline and the mixer
+#define MIXER_STARVED_MS      1000			// a foreground without data for this long is over
+
+#define MIXER_TASK_STACK      (3 * 1024)
+#define MIXER_TASK_PRIO       (5)
+#define MIXER_TASK_CORE       (0)
+#define MIXER_RINGBUFFER_SIZE (8 * 1024)
+
+typedef struct {
+	int rate;
+	int duck_level;		// dB, level of the music while the foreground plays
+	int attack;			// ms down to duck_level
+	int release;		// ms back to full level
+	int out_rb_size;
+	int task_stack;
+	int task_prio;
+	int task_core;
+} mixer_cfg_t;
+
+#define DEFAULT_MIXER_CONFIG() {                    \
+	.rate        = 44100,                           \
+	.duck_level  = -12,                             \
+	.attack      = 50,                              \
+	.release     = 300,                             \
+	.out_rb_size = MIXER_RINGBUFFER_SIZE,           \
+	.task_stack  = MIXER_TASK_STACK,                \
+	.task_prio   = MIXER_TASK_PRIO,                 \
+	.task_core   = MIXER_TASK_CORE                  \
+}
+
+audio_element_handle_t mixer_init( mixer_cfg_t *config );
+
+// ringbuffer written by the last element of the foreground pipeline
+void mixer_set_foreground( audio_element_handle_t self, ringbuf_handle_t rb );
+
+// ducks the music until the foreground ringbuffer is done, reset the ringbuffer before
+void mixer_start_foreground( audio_element_handle_t self );
+
+bool mixer_foreground_active( audio_element_handle_t self );
+
+#endif /* MAIN_MIXER_H_ */
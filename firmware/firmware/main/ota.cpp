@@ -15,6 +15,7 @@
 
 #include "ota.h"
 #include "blink.h"
+#include "memorypolicy.h"
 
 #define SOS_FILENOTFOUND 1
 #define SOS_READERROR 2
@@ -27,7 +28,6 @@
 #define SOS_SETBOOTPARTITION 9
 
 #define BUFFSIZE 1024
-static char ota_write_data[BUFFSIZE + 1] = { 0 };
 
 void ota( const char *tag, const char *firmware )
 {
@@ -47,6 +47,12 @@ void ota( const char *tag, const char *firmware )
     ESP_LOGI(tag, "Running partition type %d subtype %d (offset 0x%08lx)",
              running->type, running->subtype, running->address);
 
+    // only needed during the update, no need to keep it in internal ram
+    char *ota_write_data = (char *) memory_calloc( MEMORY_BULK, BUFFSIZE + 1, 1 );
+    if ( ota_write_data == NULL ) {
+    	SOS( SOS_READERROR );
+    }
+
     FILE *f;
     f = fopen(firmware, "rb");
     if ( f == NULL ) {
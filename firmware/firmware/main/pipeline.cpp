@@ -9,6 +9,7 @@
 #include <mp3_decoder.h>
 #include <wav_decoder.h>
 #include <ogg_decoder.h>
+#include <http_stream.h>
 
 #include <audio_pipeline.h>
 #include <audio_hal.h>
@@ -17,6 +18,13 @@
 #include "playlist.h"
 #include "pipeline.h"
 #include "adfcorrections.h"
+#include "resampler.h"
+#include "equalizer.h"
+#include "mixer.h"
+#include "adpcm_decoder.h"
+#include "sd_reader.h"
+#include "stream_reader.h"
+#include "scheduling.h"
 #include "driver/i2s_std.h"
 
 #define TAGPIPELINE "::PIPELINE"
@@ -25,13 +33,147 @@ Pipeline::Pipeline() {
 	board_handle = NULL;
 	pipeline = NULL;
 	i2s_stream_writer = NULL;
-	decoder_mp3 = NULL;
-	decoder_wav = NULL;
-	decoder_ogg = NULL;
 	decoder = NULL;
-	fatfs_stream_reader = NULL;
+	reader = NULL;
+	stream_reader = NULL;
+	http_reader = NULL;
+	input = NULL;
+	stream_buffer = 0;
+	http_buffer = 0;
+	resampler = NULL;
+	equalizer = NULL;
+	mixer = NULL;
+	fg_pipeline = NULL;
+	fg_reader = NULL;
+	fg_decoder = NULL;
+	fg_resampler = NULL;
+	fg_filetype = FILETYPE_UNKOWN;
+	fg_rb = NULL;
 	decoder_filetype = FILETYPE_UNKOWN;
 	mode = MODE_SINGLE_TRACK;
+	output_rate = 0;
+	resample_quality = RESAMPLE_QUALITY_MEDIUM;
+	normalize = false;
+	eq = false;
+	duck = false;
+	duck_level = -12;
+	duck_attack = 50;
+	duck_release = 300;
+	trim = false;
+	loop_crossfade = 0;
+	read_size = SD_READER_READ_SIZE;
+	read_ahead = SD_READER_READ_AHEAD;
+	file_cache = SD_READER_CACHE_SIZE;
+	listener = NULL;
+	listener_task = NULL;
+	requests = NULL;
+	request_lock = NULL;
+	request_done = NULL;
+	request_result = false;
+	priority = PRIORITY_NORMAL;
+	priority_policy = PRIORITY_POLICY_QUEUE;
+	oneshot = false;
+	phrase_length = 0;
+	preempted_count = 0;
+	has_pending = false;
+}
+
+void Pipeline::setOutputRate( int rate, int quality ) {
+
+	// needs to be called before StartCodec, 0 keeps i2s at the track's sample rate
+	output_rate = rate;
+	resample_quality = quality;
+
+}
+
+void Pipeline::setTrim( bool enable ) {
+	trim = enable;
+}
+
+void Pipeline::setLoopCrossfade( int ms ) {
+
+	// 16 bit wav only, the other formats jump back at the loop end
+	loop_crossfade = ms;
+
+}
+
+void Pipeline::setNormalize( bool enable ) {
+
+	// needs to be called before StartCodec, the track gain is applied by i2s' software volume
+	normalize = enable;
+
+}
+
+void Pipeline::setEqualizer( bool enable ) {
+
+	// needs to be called before StartCodec, the bands can be changed any time
+	eq = enable;
+
+}
+
+void Pipeline::setDucking( bool enable, int level, int attack, int release ) {
+
+	// needs to be called before StartCodec
+	duck = enable;
+	duck_level = level;
+	duck_attack = attack;
+	duck_release = release;
+
+}
+
+bool Pipeline::setPlaybackRate( int rate ) {
+
+	// pitch and tempo in per mille, the resampler only exists with a fixed output rate
+	if ( resampler == NULL ) {
+		return false;
+	}
+
+	resampler_set_speed( resampler, rate );
+	return true;
+
+}
+
+int Pipeline::getPlaybackRate( void ) {
+
+	return ( resampler != NULL ) ? resampler_get_speed( resampler ) : RESAMPLER_SPEED_NORMAL;
+
+}
+
+void Pipeline::setReadAhead( int size, int ahead ) {
+
+	// needs to be called before StartCodec
+	read_size = size;
+	read_ahead = ahead;
+
+}
+
+void Pipeline::setFileCache( int files ) {
+
+	// needs to be called before StartCodec
+	file_cache = files;
+
+}
+
+void Pipeline::setStreamBuffer( int size ) {
+
+	// needs to be called before StartCodec, 0 = no streams
+	stream_buffer = size;
+
+}
+
+void Pipeline::setHttpBuffer( int size ) {
+
+	// needs to be called before StartCodec, 0 = sd card only
+	http_buffer = size;
+
+}
+
+void Pipeline::setPriorityPolicy( priority_policy_t policy ) {
+	priority_policy = policy;
+}
+
+uint8_t Pipeline::getPriority( void ) {
+	return priority;
 }
 
 void Pipeline::StartCodec(void) {
@@ -44,72 +186,267 @@ void Pipeline::StartCodec(void) {
 	pipeline = audio_pipeline_init(&pipeline_cfg);
 	mem_assert(pipeline);
 
-	ESP_LOGD(TAGPIPELINE, "Create fatfs stream to read data from sdcard");
-	fatfs_stream_cfg_t fatfs_cfg = FATFS_STREAM_CFG_DEFAULT();
-	fatfs_cfg.type = AUDIO_STREAM_READER;
-	fatfs_stream_reader = fatfs_stream_init(&fatfs_cfg);
+	ESP_LOGD(TAGPIPELINE, "Create sd reader to read data from sdcard");
+	sd_reader_cfg_t reader_cfg = SD_READER_CFG_DEFAULT();
+	reader_cfg.read_size = read_size;
+	reader_cfg.out_rb_size = read_ahead;
+	reader_cfg.cache_size = file_cache;
+	reader_cfg.task_core = sched_core( SCHED_READER );
+	reader_cfg.task_prio = sched_prio( SCHED_READER );
+	reader = sd_reader_init(&reader_cfg);
+
+	if ( stream_buffer > 0 ) {
+		ESP_LOGD(TAGPIPELINE, "Create stream reader for audio sent over the network");
+		stream_reader_cfg_t stream_cfg = STREAM_READER_CFG_DEFAULT();
+		stream_cfg.buffer_size = stream_buffer;
+		stream_cfg.task_core = sched_core( SCHED_READER );
+		stream_cfg.task_prio = sched_prio( SCHED_READER );
+		stream_reader = stream_reader_init(&stream_cfg);
+	}
+
+	if ( http_buffer > 0 ) {
+		ESP_LOGD(TAGPIPELINE, "Create http reader for tracks on a media server");
+		http_stream_cfg_t http_cfg = HTTP_STREAM_CFG_DEFAULT();
+		http_cfg.type = AUDIO_STREAM_READER;
+		http_cfg.out_rb_size = http_buffer;		// prefetch, a range request resumes at the byte position
+		http_cfg.task_core = sched_core( SCHED_READER );
+		http_cfg.task_prio = sched_prio( SCHED_READER );
+		http_reader = http_stream_init(&http_cfg);
+	}
 
 	ESP_LOGD(TAGPIPELINE, "Create i2s stream to write data to codec chip");
 	// i2s_stream_cfg_t i2s_cfg = _I2S_STREAM_CFG_DEFAULT();
 	i2s_stream_cfg_t i2s_cfg = I2S_STREAM_CFG_DEFAULT();
 	i2s_cfg.type = AUDIO_STREAM_WRITER;
+	i2s_cfg.use_alc = normalize;
+	i2s_cfg.task_core = sched_core( SCHED_I2S );
+	i2s_cfg.task_prio = sched_prio( SCHED_I2S );
 	i2s_stream_writer = i2s_stream_init(&i2s_cfg);
 
-	ESP_LOGD(TAGPIPELINE, "Create mp3 decoder to decode mp3 file");
-	mp3_decoder_cfg_t mp3_cfg = DEFAULT_MP3_DECODER_CONFIG();
-	decoder_mp3 = mp3_decoder_init(&mp3_cfg);
+	if ( output_rate > 0 ) {
+		ESP_LOGD(TAGPIPELINE, "Create resampler to keep i2s clocked at %dHz", output_rate);
+		resampler_cfg_t rsp_cfg = DEFAULT_RESAMPLER_CONFIG();
+		rsp_cfg.out_rate = output_rate;
+		rsp_cfg.quality = (resample_quality_t) resample_quality;
+		rsp_cfg.task_core = sched_core( SCHED_DECODER );
+		rsp_cfg.task_prio = sched_prio( SCHED_DECODER );
+		resampler = resampler_init(&rsp_cfg);
+		i2s_stream_set_clk(i2s_stream_writer, output_rate, 16, 2);
+	}
 
-	ESP_LOGD(TAGPIPELINE, "Create wav decoder to decode wav file");
-	wav_decoder_cfg_t wav_cfg = DEFAULT_WAV_DECODER_CONFIG();
-	decoder_wav = wav_decoder_init(&wav_cfg);
+	if ( eq ) {
+		ESP_LOGD(TAGPIPELINE, "Create equalizer");
+		equalizer_cfg_t eq_cfg = DEFAULT_EQUALIZER_CONFIG();
+		eq_cfg.task_core = sched_core( SCHED_DECODER );
+		eq_cfg.task_prio = sched_prio( SCHED_DECODER );
+		equalizer = equalizer_init(&eq_cfg);
+	}
 
-	ESP_LOGD(TAGPIPELINE, "Create ogg decoder to decode ogg file");
-	ogg_decoder_cfg_t ogg_cfg = DEFAULT_OGG_DECODER_CONFIG();
-	decoder_ogg = ogg_decoder_init(&ogg_cfg);
+	if ( duck ) {
+		if ( output_rate > 0 ) {
+			StartForeground();
+		} else {
+			ESP_LOGW(TAGPIPELINE, "ducking needs OUTPUT_RATE, effects interrupt the music instead");
+		}
+	}
 
 }
 
-void Pipeline::build( audio_filetype_t filetype )
+void Pipeline::StartForeground( void ) {
+
+	ESP_LOGD(TAGPIPELINE, "Create mixer and foreground pipeline for effects");
+	mixer_cfg_t mix_cfg = DEFAULT_MIXER_CONFIG();
+	mix_cfg.rate = output_rate;
+	mix_cfg.duck_level = duck_level;
+	mix_cfg.attack = duck_attack;
+	mix_cfg.release = duck_release;
+	mix_cfg.task_core = sched_core( SCHED_DECODER );
+	mix_cfg.task_prio = sched_prio( SCHED_DECODER );
+	mixer = mixer_init(&mix_cfg);
+	if ( mixer == NULL ) {
+		return;
+	}
+
+	audio_pipeline_cfg_t pipeline_cfg = DEFAULT_AUDIO_PIPELINE_CONFIG();
+	fg_pipeline = audio_pipeline_init(&pipeline_cfg);
+	mem_assert(fg_pipeline);
+
+	// effects are short, a small read ahead does
+	sd_reader_cfg_t reader_cfg = SD_READER_CFG_DEFAULT();
+	reader_cfg.read_size = 4 * 1024;
+	reader_cfg.out_rb_size = 8 * 1024;
+	reader_cfg.cache_size = 1;
+	reader_cfg.task_core = sched_core( SCHED_READER );
+	reader_cfg.task_prio = sched_prio( SCHED_READER );
+	fg_reader = sd_reader_init(&reader_cfg);
+
+	// the mixer adds both streams sample by sample, so the effect needs the output rate as well
+	resampler_cfg_t rsp_cfg = DEFAULT_RESAMPLER_CONFIG();
+	rsp_cfg.out_rate = output_rate;
+	rsp_cfg.quality = (resample_quality_t) resample_quality;
+	rsp_cfg.task_core = sched_core( SCHED_DECODER );
+	rsp_cfg.task_prio = sched_prio( SCHED_DECODER );
+	fg_resampler = resampler_init(&rsp_cfg);
+
+	fg_rb = rb_create( MIXER_FOREGROUND_SIZE, 1 );
+	mixer_set_foreground( mixer, fg_rb );
+
+}
+
+void Pipeline::buildForeground( audio_filetype_t filetype ) {
+
+	if ( fg_decoder != NULL ) {
+		audio_pipeline_unregister(fg_pipeline, fg_reader);
+		audio_pipeline_unregister(fg_pipeline, fg_decoder);
+		audio_pipeline_unregister(fg_pipeline, fg_resampler);
+		audio_pipeline_unlink( fg_pipeline );
+
+		audio_element_deinit( fg_decoder );
+		fg_decoder = NULL;
+		fg_filetype = FILETYPE_UNKOWN;
+	}
+
+	fg_decoder = createDecoder( filetype );
+	if ( fg_decoder == NULL ) {
+		return;
+	}
+
+	fg_filetype = filetype;
+
+	audio_pipeline_register(fg_pipeline, fg_reader, "file");
+	audio_pipeline_register(fg_pipeline, fg_decoder, "decoder");
+	audio_pipeline_register(fg_pipeline, fg_resampler, "resampler");
+	resampler_set_source(fg_resampler, fg_decoder);
+
+	ESP_LOGD(TAGPIPELINE, "Link effects [sdcard]-->sd_reader-->decoder-->resampler-->[mixer]");
+	const char *link_tag[3] = { "file", "decoder", "resampler" };
+	audio_pipeline_link(fg_pipeline, &link_tag[0], 3);
+
+	// the last element writes to the mixer
+	audio_element_set_output_ringbuf(fg_resampler, fg_rb);
+
+}
+
+audio_element_handle_t Pipeline::createDecoder( audio_filetype_t filetype ) {
+
+	switch (filetype) {
+	case FILETYPE_MP3: {
+		ESP_LOGD(TAGPIPELINE, "Create mp3 decoder to decode mp3 file");
+		mp3_decoder_cfg_t mp3_cfg = DEFAULT_MP3_DECODER_CONFIG();
+		mp3_cfg.task_core = sched_core( SCHED_DECODER );
+		mp3_cfg.task_prio = sched_prio( SCHED_DECODER );
+		return mp3_decoder_init(&mp3_cfg); }
+	case FILETYPE_WAV: {
+		ESP_LOGD(TAGPIPELINE, "Create wav decoder to decode wav file");
+		wav_decoder_cfg_t wav_cfg = DEFAULT_WAV_DECODER_CONFIG();
+		wav_cfg.task_core = sched_core( SCHED_DECODER );
+		wav_cfg.task_prio = sched_prio( SCHED_DECODER );
+		return wav_decoder_init(&wav_cfg); }
+	case FILETYPE_OGG: {
+		ESP_LOGD(TAGPIPELINE, "Create ogg decoder to decode ogg file");
+		ogg_decoder_cfg_t ogg_cfg = DEFAULT_OGG_DECODER_CONFIG();
+		ogg_cfg.task_core = sched_core( SCHED_DECODER );
+		ogg_cfg.task_prio = sched_prio( SCHED_DECODER );
+		return ogg_decoder_init(&ogg_cfg); }
+	case FILETYPE_ADPCM: {
+		ESP_LOGD(TAGPIPELINE, "Create adpcm decoder to decode adpcm file");
+		adpcm_decoder_cfg_t adpcm_cfg = DEFAULT_ADPCM_DECODER_CONFIG();
+		adpcm_cfg.task_core = sched_core( SCHED_DECODER );
+		adpcm_cfg.task_prio = sched_prio( SCHED_DECODER );
+		return adpcm_decoder_init(&adpcm_cfg); }
+	case FILETYPE_TONE: {
+		ESP_LOGD(TAGPIPELINE, "Create tone generator");
+		tone_generator_cfg_t tone_cfg = DEFAULT_TONE_GENERATOR_CONFIG();
+		// generated at the i2s rate, no resampler needed
+		if ( output_rate > 0 ) { tone_cfg.rate = output_rate; }
+		tone_cfg.task_core = sched_core( SCHED_DECODER );
+		tone_cfg.task_prio = sched_prio( SCHED_DECODER );
+		return tone_generator_init(&tone_cfg); }
+	default:
+		return NULL;
+	}
+
+}
+
+void Pipeline::build( audio_filetype_t filetype, audio_element_handle_t source )
 {
 
 	// need to unregister old pipeline?
 	if (decoder != NULL ) {
-		// unregister_pipeline
-		audio_pipeline_unregister(pipeline, fatfs_stream_reader);
+		// unregister_pipeline, tones run without reader and resampler
+		if (input != NULL) { audio_pipeline_unregister(pipeline, input); }
 		audio_pipeline_unregister(pipeline, decoder);
+		if ((resampler != NULL) && (decoder_filetype != FILETYPE_TONE)) { audio_pipeline_unregister(pipeline, resampler); }
+		if (equalizer != NULL) { audio_pipeline_unregister(pipeline, equalizer); }
+		if (mixer != NULL) { audio_pipeline_unregister(pipeline, mixer); }
 		audio_pipeline_unregister(pipeline, i2s_stream_writer);
 		audio_pipeline_unlink( pipeline );
+
+		// decoders are only allocated while they are used
+		audio_element_deinit( decoder );
 		decoder = NULL;
 		decoder_filetype = FILETYPE_UNKOWN;
 	}
 
-	// choose new decoder
-	switch (filetype) {
-	case FILETYPE_MP3: decoder = decoder_mp3; break;
-	case FILETYPE_WAV: decoder = decoder_wav; break;
-	case FILETYPE_OGG: decoder = decoder_ogg; break;
-	default: return; break;
+	input = NULL;
+
+	// create new decoder
+	decoder = createDecoder( filetype );
+	if (decoder == NULL) {
+		return;
 	}
 
 	// save new filetype
 	decoder_filetype = filetype;
 
 	// build new pipeline
-	audio_pipeline_register(pipeline, fatfs_stream_reader, "file");
+	const char *link_tag[6];
+	int links = 0;
+
+	if (filetype != FILETYPE_TONE) {
+		input = ( source != NULL ) ? source : reader;
+		audio_pipeline_register(pipeline, input, "file");
+		link_tag[links++] = "file";
+	}
+
 	audio_pipeline_register(pipeline, decoder, "decoder");
 	audio_pipeline_register(pipeline, i2s_stream_writer, "i2s");
+	link_tag[links++] = "decoder";
+
+	if ((resampler != NULL) && (filetype != FILETYPE_TONE)) {
+		audio_pipeline_register(pipeline, resampler, "resampler");
+		resampler_set_source(resampler, decoder);
+		link_tag[links++] = "resampler";
+	}
+
+	if (equalizer != NULL) {
+		audio_pipeline_register(pipeline, equalizer, "equalizer");
+		equalizer_set_source(equalizer, ((resampler != NULL) && (filetype != FILETYPE_TONE)) ? resampler : decoder);
+		link_tag[links++] = "equalizer";
+	}
+
+	if (mixer != NULL) {
+		audio_pipeline_register(pipeline, mixer, "mixer");
+		link_tag[links++] = "mixer";
+	}
+
+	link_tag[links++] = "i2s";
 
 	//audio_element_set_event_callback(decoder, audio_element_event_handler, NULL);
-	//audio_element_set_event_callback(fatfs_stream_reader, audio_element_event_handler, NULL);
+	//audio_element_set_event_callback(reader, audio_element_event_handler, NULL);
 	//audio_element_set_event_callback(i2s_stream_writer, audio_element_event_handler, NULL);
 
-	ESP_LOGD(TAGPIPELINE, "Link it together [sdcard]-->fatfs_stream-->decoder-->i2s_stream-->[codec_chip]");
-	const char *link_tag[3] = {"file", "decoder", "i2s"};
-	audio_pipeline_link(pipeline, &link_tag[0], 3);
+	ESP_LOGD(TAGPIPELINE, "Link it together [sdcard]-->sd_reader|stream_reader|http_stream-->decoder-->[resampler]-->[equalizer]-->[mixer]-->i2s_stream-->[codec_chip]");
+	audio_pipeline_link(pipeline, &link_tag[0], links);
+
+	// the new decoder needs to report to the listener as well
+	if (listener != NULL) {
+		audio_pipeline_set_listener(pipeline, listener);
+	}
 
 }
 
-void Pipeline::stop( void ) {
+void Pipeline::stopPipeline( void ) {
 
 	ESP_LOGD( TAGPIPELINE, "stop_track");
 
@@ -119,15 +456,467 @@ void Pipeline::stop( void ) {
 
 }
 
+void Pipeline::stop( void ) {
+
+	request( PIPELINE_REQUEST_STOP, NULL );
+
+}
+
+void Pipeline::stopAll( void ) {
+
+	// an explicit stop ends interrupted, waiting and queued tracks as well
+	preempted_count = 0;
+	has_pending = false;
+	priority = PRIORITY_NORMAL;
+	playList.clearQueue();
+
+	stopPipeline();
+	stopForeground();
+
+}
+
+void Pipeline::stopForeground( void ) {
+
+	if ( fg_pipeline == NULL ) {
+		return;
+	}
+
+	// aborts the ringbuffer to the mixer as well
+	audio_pipeline_stop(fg_pipeline);
+	audio_pipeline_wait_for_stop(fg_pipeline);
+	audio_pipeline_terminate(fg_pipeline);
+
+}
+
+bool Pipeline::playForeground( int8_t trackNr ) {
+
+	return request( PIPELINE_REQUEST_FOREGROUND, &trackNr );
+
+}
+
+bool Pipeline::startEffect( int8_t trackNr ) {
+
+	audio_filetype_t filetype = playList.getFiletype( trackNr );
+
+	// without music to duck, the effect interrupts like a clip
+	if ( ( mixer == NULL ) || !isPlaying() ) {
+		return startTrack( trackNr, PRIORITY_FOREGROUND );
+	}
+
+	if ( filetype == FILETYPE_UNKOWN ) {
+		return false;
+	}
+
+	char path[300];
+	playList.getPath( trackNr, path, sizeof(path) );
+
+	stopForeground();
+
+	// a missing file would keep the music ducked until the mixer gives up
+	if ( sd_reader_preload( fg_reader, path ) != ESP_OK ) {
+		ESP_LOGW( TAGPIPELINE, "FOREGROUND: could not open %s", path );
+		return false;
+	}
+
+	// the ogg decoder keeps state between tracks, so it gets recreated for every track
+	if ( ( fg_filetype != filetype ) || ( filetype == FILETYPE_OGG ) ) {
+		buildForeground( filetype );
+		if ( fg_decoder == NULL ) { return false; }
+	}
+
+	ESP_LOGI( TAGPIPELINE, "FOREGROUND: track %d", trackNr );
+
+	uint32_t head = 0, start = 0, end = 0;
+	if ( trim ) {
+		playList.getTrim( trackNr, &head, &start, &end );
+	}
+	sd_reader_set_range( fg_reader, head, start, end );
+
+	esp_err_t err = audio_element_set_uri( fg_reader, path );
+	if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "FOREGROUND: audio_element_set_uri: %s %d", path, err ); }
+
+	err = audio_pipeline_reset_ringbuffer( fg_pipeline );
+	if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "FOREGROUND: audio_pipeline_reset_ringbuffer: %d", err ); }
+
+	err = audio_pipeline_reset_elements( fg_pipeline );
+	if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "FOREGROUND: audio_pipeline_reset_elements: %d", err ); }
+
+	rb_reset( fg_rb );
+	mixer_start_foreground( mixer );
+
+	err = audio_pipeline_run( fg_pipeline );
+	if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "FOREGROUND: audio_pipeline_run: %d", err ); }
+
+	return true;
+
+}
+
 void Pipeline::play( void ) {
 
-	play( playList.getActiveTrack(), playList.getActiveFiletype() );
+	play_request_t track = { -1, PRIORITY_NORMAL, 0 };
+	request( PIPELINE_REQUEST_PLAY, &track );
+
+}
+
+bool Pipeline::next( void ) {
+
+	int8_t step = 1;
+	return request( PIPELINE_REQUEST_SKIP, &step );
+
+}
+
+bool Pipeline::previous( void ) {
+
+	int8_t step = -1;
+	return request( PIPELINE_REQUEST_SKIP, &step );
+
+}
+
+bool Pipeline::skipTrack( int8_t step ) {
+
+	// the playlist steps through its entries and the shuffle order, which belong to this task
+	if ( step > 0 ) {
+		playList.nextTrack();
+	} else {
+		playList.prevTrack();
+	}
+
+	return startTrack( playList.getActiveTrackNr(), PRIORITY_NORMAL );
+
+}
+
+void Pipeline::playActive( audio_filetype_t filetype, int64_t byte_pos ) {
+
+	// a rescan must not free the name meanwhile
+	playList.lock();
+	play( playList.getActiveTrack(), filetype, byte_pos );
+	playList.unlock();
+
+}
+
+void Pipeline::savePosition( void ) {
+
+	// an interrupted tone or phrase is gone
+	if ( oneshot ) {
+		return;
+	}
+
+	if ( preempted_count >= MAXPREEMPTED ) {
+		ESP_LOGW( TAGPIPELINE, "PLAY: too many interrupted tracks, track %d will not resume", playList.getActiveTrackNr() );
+		return;
+	}
+
+	play_request_t *request = &preempted[preempted_count++];
+	request->trackNr = playList.getActiveTrackNr();
+	request->priority = priority;
+	request->byte_pos = 0;
+
+	// mp3 resyncs in the middle of a file. the sd reader puts the header of wav and adpcm in front and
+	// starts at a block, see sd_reader.h. ogg needs its header pages.
+	audio_filetype_t filetype = playList.getActiveFiletype();
+	if ( ( filetype == FILETYPE_MP3 ) || ( ( input == reader ) && ( ( filetype == FILETYPE_WAV ) || ( filetype == FILETYPE_ADPCM ) ) ) ) {
+		audio_element_info_t info = {};
+		audio_element_getinfo( input, &info );
+		request->byte_pos = info.byte_pos;
+
+		// data in the reader's ringbuffer has not been decoded yet
+		ringbuf_handle_t rb = audio_element_get_output_ringbuf( input );
+		if ( rb != NULL ) { request->byte_pos -= rb_bytes_filled( rb ); }
+		if ( request->byte_pos < 0 ) { request->byte_pos = 0; }
+	}
+
+	ESP_LOGI( TAGPIPELINE, "PLAY: interrupt track %d at %lld", request->trackNr, request->byte_pos );
+
+}
+
+bool Pipeline::play( int8_t trackNr, uint8_t newPriority ) {
+
+	play_request_t track = { trackNr, newPriority, 0 };
+	return request( PIPELINE_REQUEST_PLAY, &track );
+
+}
+
+bool Pipeline::startTrack( int8_t trackNr, uint8_t newPriority ) {
+
+	audio_element_state_t state = getState();
+	bool busy = ( state == AEL_STATE_RUNNING ) || ( state == AEL_STATE_PAUSED );
+
+	if ( busy && ( newPriority < priority ) ) {
+
+		if ( priority_policy == PRIORITY_POLICY_DROP ) {
+			ESP_LOGI( TAGPIPELINE, "PLAY: drop track %d, priority %d < %d", trackNr, newPriority, priority );
+			return false;
+		}
+
+		// only the latest request waits
+		ESP_LOGI( TAGPIPELINE, "PLAY: track %d waits, priority %d < %d", trackNr, newPriority, priority );
+		pending.trackNr = trackNr;
+		pending.priority = newPriority;
+		pending.byte_pos = 0;
+		has_pending = true;
+		return false;
+
+	}
+
+	if ( busy && ( newPriority > priority ) ) {
+		savePosition();
+	}
+
+	priority = newPriority;
+	playList.setActiveTrackNr( trackNr );
+	playActive( playList.getActiveFiletype() );
+
+	return true;
+
+}
+
+bool Pipeline::playTone( const tone_t *tone, uint8_t newPriority ) {
+
+	tone_request_t clip = { tone, newPriority };
+	return request( PIPELINE_REQUEST_TONE, &clip );
+
 }
 
+bool Pipeline::startTone( const tone_t *tone, uint8_t newPriority ) {
 
-void Pipeline::play( char *url, audio_filetype_t filetype) {
+	audio_element_state_t state = getState();
+	bool busy = ( state == AEL_STATE_RUNNING ) || ( state == AEL_STATE_PAUSED );
 
-	if (playList.getActiveTrackNr()<0) {
+	// a tone is a signal for now, it never waits
+	if ( busy && ( newPriority < priority ) ) {
+		ESP_LOGI( TAGPIPELINE, "TONE: dropped, priority %d < %d", newPriority, priority );
+		return false;
+	}
+
+	if ( busy && ( newPriority > priority ) ) {
+		savePosition();
+	}
+
+	ESP_LOGD( TAGPIPELINE, "TONE: waveform=%d frequency=%d duration=%d", tone->waveform, tone->frequency, tone->duration );
+
+	stopPipeline();
+
+	if ( decoder_filetype != FILETYPE_TONE ) {
+		build( FILETYPE_TONE );
+		if ( decoder == NULL ) { return false; }
+	}
+
+	priority = newPriority;
+	oneshot = true;
+	tone_generator_set( decoder, tone );
+
+	// the level is part of the tone
+	if ( normalize ) {
+		i2s_alc_volume_set( i2s_stream_writer, 0 );
+	}
+
+	esp_err_t err = audio_pipeline_reset_ringbuffer( pipeline );
+	if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "TONE: audio_pipeline_reset_ringbuffer: %d", err ); }
+
+	err = audio_pipeline_reset_elements( pipeline );
+	if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "TONE: audio_pipeline_reset_elements: %d", err ); }
+
+	err = audio_pipeline_run( pipeline );
+	if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "TONE: audio_pipeline_run: %d", err ); }
+
+	return true;
+
+}
+
+bool Pipeline::playPhrase( const int8_t *tracks, int8_t count, uint8_t newPriority ) {
+
+	phrase_request_t clips = { tracks, count, newPriority };
+	return request( PIPELINE_REQUEST_PHRASE, &clips );
+
+}
+
+bool Pipeline::startPhrase( const int8_t *tracks, int8_t count, uint8_t newPriority ) {
+
+	if ( ( count <= 0 ) || ( count > MAXPHRASE ) ) {
+		ESP_LOGW( TAGPIPELINE, "PHRASE: %d clips, 1..%d possible", count, MAXPHRASE );
+		return false;
+	}
+
+	// one decoder for all clips
+	audio_filetype_t filetype = playList.getFiletype( tracks[0] );
+	for ( int i = 0; i < count; i++ ) {
+		if ( ( playList.getFiletype( tracks[i] ) != filetype ) || ( filetype == FILETYPE_OGG ) || ( filetype == FILETYPE_UNKOWN ) ) {
+			ESP_LOGW( TAGPIPELINE, "PHRASE: clip %d, all clips need to be mp3, wav or adpcm of the same kind", tracks[i] );
+			return false;
+		}
+	}
+
+	audio_element_state_t state = getState();
+	bool busy = ( state == AEL_STATE_RUNNING ) || ( state == AEL_STATE_PAUSED );
+
+	// an announcement is for now, it never waits
+	if ( busy && ( newPriority < priority ) ) {
+		ESP_LOGI( TAGPIPELINE, "PHRASE: dropped, priority %d < %d", newPriority, priority );
+		return false;
+	}
+
+	if ( busy && ( newPriority > priority ) ) {
+		savePosition();
+	}
+
+	ESP_LOGD( TAGPIPELINE, "PHRASE: %d clips", count );
+
+	memcpy( phrase, tracks, count );
+	phrase_length = count;
+
+	// normalization uses the gain of the first clip
+	priority = newPriority;
+	playList.setActiveTrackNr( tracks[0] );
+	playActive( filetype );
+
+	return true;
+
+}
+
+bool Pipeline::playNumber( uint32_t number, uint8_t newPriority ) {
+
+	int8_t tracks[MAXPHRASE];
+	int8_t count = playList.spellNumber( number, tracks, MAXPHRASE );
+
+	if ( count <= 0 ) {
+		ESP_LOGW( TAGPIPELINE, "PHRASE: no clips to say %lu", (unsigned long) number );
+		return false;
+	}
+
+	return playPhrase( tracks, count, newPriority );
+
+}
+
+bool Pipeline::enqueue( int8_t trackNr ) {
+
+	return request( PIPELINE_REQUEST_QUEUE_TRACK, &trackNr );
+
+}
+
+bool Pipeline::queueTrack( int8_t trackNr ) {
+
+	if ( !playList.enqueue( trackNr ) ) {
+		ESP_LOGW( TAGPIPELINE, "QUEUE: track %d rejected, %d tracks queued", trackNr, playList.getQueueLength() );
+		return false;
+	}
+
+	// nothing to wait for
+	audio_element_state_t state = getState();
+	if ( ( state != AEL_STATE_RUNNING ) && ( state != AEL_STATE_PAUSED ) ) {
+		playQueued();
+	} else if ( playList.getQueueLength() == 1 ) {
+		preloadNext();
+		// a looping track makes room after this pass
+		if ( reader != NULL ) { sd_reader_stop_loop( reader ); }
+	}
+
+	return true;
+
+}
+
+bool Pipeline::playQueued( void ) {
+
+	int8_t trackNr = playList.dequeue();
+
+	if ( trackNr < 0 ) {
+		return false;
+	}
+
+	ESP_LOGI( TAGPIPELINE, "QUEUE next track=%d, %d left", trackNr, playList.getQueueLength() );
+	startTrack( trackNr, PRIORITY_NORMAL );
+
+	return true;
+
+}
+
+bool Pipeline::playPreempted( void ) {
+
+	// a waiting request goes first, if it would have interrupted the other track anyway
+	if ( has_pending && ( ( preempted_count == 0 ) || ( pending.priority > preempted[preempted_count-1].priority ) ) ) {
+		has_pending = false;
+		priority = pending.priority;
+		playList.setActiveTrackNr( pending.trackNr );
+		ESP_LOGI( TAGPIPELINE, "PLAY: waiting track %d", pending.trackNr );
+		playActive( playList.getActiveFiletype() );
+		return true;
+	}
+
+	if ( preempted_count > 0 ) {
+		play_request_t *request = &preempted[--preempted_count];
+		priority = request->priority;
+		playList.setActiveTrackNr( request->trackNr );
+		ESP_LOGI( TAGPIPELINE, "PLAY: resume track %d at %lld", request->trackNr, request->byte_pos );
+		playActive( playList.getActiveFiletype(), request->byte_pos );
+		return true;
+	}
+
+	priority = PRIORITY_NORMAL;
+	return false;
+
+}
+
+
+void Pipeline::prepareReader( char *url, audio_filetype_t filetype ) {
+
+    // set_uri keeps a copy
+    char url2[300];
+    snprintf( url2, sizeof(url2), "%s/%s", playList.getDirectory(), url );
+
+    // precomputed normalization gain of this track
+    if ( normalize ) {
+    	i2s_alc_volume_set( i2s_stream_writer, playList.getGain( playList.getActiveTrackNr() ) );
+    }
+
+    // skip silence, wav and adpcm still need their header
+    uint32_t head = 0, start = 0, end = 0;
+    if ( trim ) {
+    	playList.getTrim( playList.getActiveTrackNr(), &head, &start, &end );
+    }
+    sd_reader_set_range( reader, head, start, end );
+
+    // repeat loops inside the reader, so the decoder never stops. ogg pages can't be cut at byte positions.
+    bool looping = ( mode == MODE_REPEAT ) && !oneshot && ( priority == PRIORITY_NORMAL ) && ( filetype != FILETYPE_OGG ) && ( playList.getQueueLength() == 0 );
+    if ( looping ) {
+    	uint32_t loop_start, loop_end;
+    	playList.getLoop( playList.getActiveTrackNr(), &loop_start, &loop_end );
+    	sd_reader_set_loop( reader, loop_start, loop_end, loop_crossfade );
+    } else {
+    	sd_reader_stop_loop( reader );
+    }
+
+    // the rest of a phrase follows in the same run, without headers
+    sd_reader_clear_segments( reader );
+    for ( int i = 1; i < phrase_length; i++ ) {
+    	char path[300];
+    	playList.getPath( phrase[i], path, sizeof(path) );
+    	head = start = end = 0;
+    	if ( trim ) {
+    		playList.getTrim( phrase[i], &head, &start, &end );
+    	}
+    	sd_reader_add_segment( reader, path, start, end );
+    }
+
+    // the reader ends segments and loops at the data chunk, the decoder can't count their bytes
+    if ( ( filetype == FILETYPE_ADPCM ) && ( decoder != NULL ) ) {
+    	adpcm_decoder_set_open_end( decoder, looping || ( phrase_length > 1 ) );
+    }
+
+    esp_err_t err = audio_element_set_uri( reader, url2 );
+    if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "PLAY: audio_element_set_uri: %s %d", url2, err ); }
+
+}
+
+void Pipeline::play( char *url, audio_filetype_t filetype, int64_t byte_pos ) {
+
+	// urls of a media server are read by the http reader, everything else from the sd card
+	bool remote = ( strncmp( url, "http://", 7 ) == 0 );
+
+	if ( remote && ( http_reader == NULL ) ) {
+		ESP_LOGW( TAGPIPELINE, "PLAY: %s needs HTTP_BUFFER in the config", url );
+		return;
+	}
+
+	if ( !remote && (playList.getActiveTrackNr()<0) ) {
 		ESP_LOGD( TAGPIPELINE, "PLAY: no valid track selected");
 		return;
 	}
@@ -141,23 +930,36 @@ void Pipeline::play( char *url, audio_filetype_t filetype) {
 
     // stop running track
     //if ( audio_element_get_state(i2s_stream_writer) == AEL_STATE_RUNNING) {
-    	stop( );
+    	stopPipeline( );
     //}
 
-	if (decoder_filetype != filetype ) {
+	// an url which is no track of the playlist plays once
+	playList.lock();
+	char *active = playList.getActiveTrack();
+	oneshot = ( phrase_length > 0 ) || ( remote && ( ( active == NULL ) || ( strcmp( url, active ) != 0 ) ) );
+	playList.unlock();
+
+	// the ogg decoder keeps state between tracks, so it gets recreated for every track. a stream or url before needs the sd reader back.
+	audio_element_handle_t source = remote ? http_reader : reader;
+	if ( ( decoder_filetype != filetype ) || ( filetype == FILETYPE_OGG ) || ( input != source ) ) {
 		ESP_LOGD( TAGPIPELINE, "PLAY: relink ");
-		build( filetype );
+		build( filetype, source );
 
 	}
 
-    char *url2 = (char *) malloc( strlen( url ) + 10);
-    sprintf( url2, "/sdcard/%s", url );
-
     esp_err_t err;
 
-    // start track
-    err = audio_element_set_uri( fatfs_stream_reader, url2 );
-    if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "PLAY: audio_element_set_uri: %s %d", url2, err ); }
+    if ( remote ) {
+    	// tracks on a server are not analyzed
+    	if ( normalize ) {
+    		i2s_alc_volume_set( i2s_stream_writer, 0 );
+    	}
+    	err = audio_element_set_uri( http_reader, url );
+    	if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "PLAY: audio_element_set_uri: %s %d", url, err ); }
+    } else {
+    	prepareReader( url, filetype );
+    }
+    phrase_length = 0;
 
     err = audio_pipeline_reset_ringbuffer( pipeline );
     if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "PLAY: audio_pipeline_reset_ringbuffer: %d", err ); }
@@ -165,15 +967,211 @@ void Pipeline::play( char *url, audio_filetype_t filetype) {
     err = audio_pipeline_reset_elements( pipeline );
     if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "PLAY: audio_pipeline_reset_elements: %d", err ); }
 
+    // the readers seek on open, the http reader by a range request. they reset the position on close.
+    if ( ( byte_pos > 0 ) && ( input != NULL ) ) {
+    	audio_element_set_byte_pos( input, byte_pos );
+    }
+
     err = audio_pipeline_run( pipeline );
     if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "PLAY: audio_pipeline_run: %d", err ); }
 
-    free(url2);
+    preloadNext();
+
+}
+
+bool Pipeline::playStream( audio_filetype_t filetype, int rate, int channels ) {
+
+	// called by the stream server task
+	stream_request_t stream = { filetype, rate, channels };
+	return request( PIPELINE_REQUEST_STREAM, &stream );
+
+}
+
+bool Pipeline::startStream( const stream_request_t *stream ) {
+
+	audio_filetype_t filetype = stream->filetype;
+	int rate = stream->rate;
+	int channels = stream->channels;
+
+	if ( stream_reader == NULL ) {
+		ESP_LOGW( TAGPIPELINE, "STREAM: no stream reader" );
+		return false;
+	}
+
+	// a stream replaces normal tracks only, it can't wait
+	audio_element_state_t state = getState();
+	bool busy = ( state == AEL_STATE_RUNNING ) || ( state == AEL_STATE_PAUSED );
+
+	if ( busy && ( priority > PRIORITY_NORMAL ) ) {
+		ESP_LOGI( TAGPIPELINE, "STREAM: dropped, priority %d is playing", priority );
+		return false;
+	}
+
+	ESP_LOGD( TAGPIPELINE, "STREAM: filetype=%d rate=%d channels=%d", filetype, rate, channels );
+
+	stopPipeline();
+
+	// no resume, repeat or shuffle
+	oneshot = true;
+	priority = PRIORITY_NORMAL;
+
+	if ( ( decoder_filetype != filetype ) || ( filetype == FILETYPE_OGG ) || ( input != stream_reader ) ) {
+		build( filetype, stream_reader );
+		if ( decoder == NULL ) { return false; }
+	}
+
+	// the level of a stream is unknown
+	if ( normalize ) {
+		i2s_alc_volume_set( i2s_stream_writer, 0 );
+	}
+
+	stream_reader_begin( stream_reader, rate, channels );
+
+	esp_err_t err = audio_pipeline_reset_ringbuffer( pipeline );
+	if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "STREAM: audio_pipeline_reset_ringbuffer: %d", err ); }
+
+	err = audio_pipeline_reset_elements( pipeline );
+	if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "STREAM: audio_pipeline_reset_elements: %d", err ); }
+
+	err = audio_pipeline_run( pipeline );
+	if (err != ESP_OK) { ESP_LOGD( TAGPIPELINE, "STREAM: audio_pipeline_run: %d", err ); }
+
+	return true;
+
+}
+
+bool Pipeline::playUrl( char *url ) {
+
+	return request( PIPELINE_REQUEST_URL, url );
+
+}
+
+bool Pipeline::startUrl( char *url ) {
+
+	audio_filetype_t filetype = PlayList::filetypeOf( url );
+
+	if ( ( http_reader == NULL ) || ( strncmp( url, "http://", 7 ) != 0 ) || ( filetype == FILETYPE_UNKOWN ) ) {
+		ESP_LOGW( TAGPIPELINE, "URL: can't play %s", url );
+		return false;
+	}
+
+	// like a normal track, but it can't wait
+	audio_element_state_t state = getState();
+	bool busy = ( state == AEL_STATE_RUNNING ) || ( state == AEL_STATE_PAUSED );
+
+	if ( busy && ( priority > PRIORITY_NORMAL ) ) {
+		ESP_LOGI( TAGPIPELINE, "URL: dropped, priority %d is playing", priority );
+		return false;
+	}
+
+	priority = PRIORITY_NORMAL;
+	play( url, filetype );
+
+	return true;
+
+}
+
+bool Pipeline::selectFolder( int8_t folderNr ) {
+
+	// the tracks are freed and read again, the listener task must not use them meanwhile
+	return request( PIPELINE_REQUEST_FOLDER, &folderNr );
+
+}
+
+bool Pipeline::applyFolder( int8_t folderNr ) {
+
+	if ( ( folderNr < 0 ) || ( folderNr >= playList.getFolders() ) ) {
+		return false;
+	}
+
+	// cached files belong to the old folder
+	stopAll();
+	sd_reader_flush( reader );
+
+	return playList.selectFolder( folderNr, false );
+
+}
+
+bool Pipeline::selectList( int8_t listNr ) {
+
+	// the entries and the shuffle order are freed and read again
+	return request( PIPELINE_REQUEST_LIST, &listNr );
+
+}
+
+bool Pipeline::rescan( void ) {
+
+	// the directory is read by the calling task, the result is applied by the listener task
+	playlist_scan_t *scan = playList.scanFolder();
+	if ( scan == NULL ) {
+		return false;
+	}
+
+	return request( PIPELINE_REQUEST_RESCAN, scan );
+
+}
+
+bool Pipeline::applyScan( playlist_scan_t *scan ) {
+
+	int8_t remap[MAXTRACK];
+
+	if ( !playList.applyScan( scan, remap ) ) {
+		return false;
+	}
+
+	// interrupted and waiting tracks resume by name, removed ones are dropped
+	int8_t count = 0;
+	for ( int8_t i = 0; i < preempted_count; i++ ) {
+		if ( ( preempted[i].trackNr >= 0 ) && ( remap[ preempted[i].trackNr ] >= 0 ) ) {
+			preempted[count] = preempted[i];
+			preempted[count++].trackNr = remap[ preempted[i].trackNr ];
+		}
+	}
+	preempted_count = count;
+
+	if ( has_pending ) {
+		has_pending = ( pending.trackNr >= 0 ) && ( remap[ pending.trackNr ] >= 0 );
+		if ( has_pending ) pending.trackNr = remap[ pending.trackNr ];
+	}
+
+	// cached files of removed tracks
+	sd_reader_flush( reader );
+
+	return true;
+
+}
+
+audio_element_handle_t Pipeline::getStreamReader( void ) {
+	return stream_reader;
+}
+
+void Pipeline::preloadNext( void ) {
+
+	// open the next queued track while this one plays, so the change is immediate.
+	// shuffle knows its next track as well.
+	int8_t trackNr = playList.getQueuedTrack( 0 );
+	if ( ( trackNr < 0 ) && ( mode == MODE_SHUFFLE ) ) {
+		trackNr = playList.peekTrack();
+	}
+
+	if ( trackNr >= 0 ) {
+		char path[300];
+		playList.getPath( trackNr, path, sizeof(path) );
+		sd_reader_preload( reader, path );
+	}
 
 }
 
 void Pipeline::setMode( play_mode_t newMode ) {
+
 	mode = newMode;
+	playList.setShuffle( mode == MODE_SHUFFLE );
+
+	// a looping track ends after this pass
+	if ( ( mode != MODE_REPEAT ) && ( reader != NULL ) ) {
+		sd_reader_stop_loop( reader );
+	}
+
 }
 
 play_mode_t Pipeline::getMode( void ) {
@@ -229,14 +1227,96 @@ void Pipeline::setVolume( int volume ) {
 
 audio_element_state_t Pipeline::getState( void ) {
 
+	if ( decoder == NULL ) {
+		return AEL_STATE_NONE;
+	}
+
 	return audio_element_get_state( decoder );
 
 }
 
 void Pipeline::setListener( audio_event_iface_handle_t evt ) {
 
+	listener = evt;
 	audio_pipeline_set_listener( pipeline, evt );
 
+	// the task calling this listens to evt
+	listener_task = xTaskGetCurrentTaskHandle();
+	request_lock = xSemaphoreCreateMutex();
+	request_done = xSemaphoreCreateBinary();
+
+	audio_event_iface_cfg_t cfg = AUDIO_EVENT_IFACE_DEFAULT_CFG();
+	cfg.external_queue_size = PIPELINE_REQUEST_QUEUE;
+	requests = audio_event_iface_init( &cfg );
+	audio_event_iface_set_listener( requests, evt );
+
+}
+
+bool Pipeline::request( pipeline_request_t cmd, void *data ) {
+
+	// before the listener starts or on its own task there is nothing to race
+	if ( ( requests == NULL ) || ( xTaskGetCurrentTaskHandle() == listener_task ) ) {
+		return runRequest( cmd, data );
+	}
+
+	xSemaphoreTake( request_lock, portMAX_DELAY );
+
+	audio_event_iface_msg_t msg = {};
+	msg.source_type = PIPELINE_REQUEST_SOURCE;
+	msg.cmd = cmd;
+	msg.data = data;
+
+	bool result = false;
+	if ( audio_event_iface_sendout( requests, &msg ) == ESP_OK ) {
+		xSemaphoreTake( request_done, portMAX_DELAY );
+		result = request_result;
+	} else {
+		ESP_LOGW( TAGPIPELINE, "REQUEST: %d not sent", cmd );
+	}
+
+	xSemaphoreGive( request_lock );
+
+	return result;
+
+}
+
+bool Pipeline::runRequest( pipeline_request_t cmd, void *data ) {
+
+	switch ( cmd ) {
+	case PIPELINE_REQUEST_STREAM:
+		return startStream( (const stream_request_t *) data );
+	case PIPELINE_REQUEST_RESCAN:
+		return applyScan( (playlist_scan_t *) data );
+	case PIPELINE_REQUEST_FOLDER:
+		return applyFolder( *(int8_t *) data );
+	case PIPELINE_REQUEST_LIST:
+		return playList.selectList( *(int8_t *) data );
+	case PIPELINE_REQUEST_PLAY: {
+		// -1 is the active track, read on this task
+		const play_request_t *track = (const play_request_t *) data;
+		int8_t trackNr = ( track->trackNr < 0 ) ? playList.getActiveTrackNr() : track->trackNr;
+		return startTrack( trackNr, track->priority ); }
+	case PIPELINE_REQUEST_QUEUE_TRACK:
+		return queueTrack( *(int8_t *) data );
+	case PIPELINE_REQUEST_TONE: {
+		const tone_request_t *tone = (const tone_request_t *) data;
+		return startTone( tone->tone, tone->priority ); }
+	case PIPELINE_REQUEST_PHRASE: {
+		const phrase_request_t *phrase = (const phrase_request_t *) data;
+		return startPhrase( phrase->tracks, phrase->count, phrase->priority ); }
+	case PIPELINE_REQUEST_URL:
+		return startUrl( (char *) data );
+	case PIPELINE_REQUEST_FOREGROUND:
+		return startEffect( *(int8_t *) data );
+	case PIPELINE_REQUEST_STOP:
+		stopAll();
+		return true;
+	case PIPELINE_REQUEST_SKIP:
+		return skipTrack( *(int8_t *) data );
+	}
+
+	return false;
+
 }
 
 audio_board_handle_t Pipeline::getBoardHandle( void ) {
@@ -247,6 +1327,13 @@ audio_board_handle_t Pipeline::getBoardHandle( void ) {
 
 void Pipeline::audioMessageHandler( audio_event_iface_msg_t msg ) {
 
+	// the requesting task waits for the result
+	if ( msg.source_type == PIPELINE_REQUEST_SOURCE ) {
+		request_result = runRequest( (pipeline_request_t) msg.cmd, msg.data );
+		xSemaphoreGive( request_done );
+		return;
+	}
+
    	// check on next song
 
    	if ( ( msg.source_type == AUDIO_ELEMENT_TYPE_ELEMENT) &&
@@ -255,15 +1342,24 @@ void Pipeline::audioMessageHandler( audio_event_iface_msg_t msg ) {
    		if ( ( msg.cmd == AEL_MSG_CMD_REPORT_STATUS ) &&
 	         ( getState() == AEL_STATE_FINISHED ) ) {
 
+   			// queued tracks go first, repeat and shuffle apply to normal tracks only
+   			bool clip = ( priority != PRIORITY_NORMAL ) || oneshot;
+   			oneshot = false;
+
+   			if ( playPreempted() || playQueued() || clip ) {
+   				return;
+   			}
+
    			switch ((int) mode ) {
    			case MODE_SHUFFLE:
    				playList.setRandomTrack();
    				ESP_LOGI(TAGPIPELINE, "SHUFFLE next track=%d", playList.getActiveTrackNr() );
-   				play( playList.getActiveTrack(), playList.getActiveFiletype() );
+   				playActive( playList.getActiveFiletype() );
    				break;
    			case MODE_REPEAT:
+   				// ogg and tracks which played once before repeat got switched on
    				ESP_LOGI(TAGPIPELINE, "REPEAT");
-   				play( playList.getActiveTrack(), playList.getActiveFiletype() );
+   				playActive( playList.getActiveFiletype() );
    				break;
    			default:
    				break;
@@ -9,11 +9,13 @@
 #define MAIN_PIPELINE_H_
 
 #include <audio_pipeline.h>
-#include <fatfs_stream.h>
 #include <i2s_stream.h>
 #include <board.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
 
 #include "playlist.h"
+#include "tone_generator.h"
 
 typedef enum {
 	DEC_VOLUME = -2,
@@ -26,23 +28,173 @@ typedef enum {
 	MODE_REPEAT = 2
 } play_mode_t;
 
+typedef enum {
+	PRIORITY_POLICY_QUEUE = 0,	// lower priority requests wait for the running clip
+	PRIORITY_POLICY_DROP = 1	// lower priority requests are ignored
+} priority_policy_t;
+
+#define PRIORITY_NORMAL 0
+#define PRIORITY_TONE 1		// tones interrupt normal tracks, which resume afterwards
+#define PRIORITY_PHRASE 1	// so do phrases
+#define PRIORITY_FOREGROUND 1	// and effects without music to duck
+#define PRIORITY_MAX 7		// highest priority a request may ask for
+#define MAXPREEMPTED 4
+#define MAXPHRASE 16		// clips of one phrase, see SD_READER_SEGMENTS_MAX
+
+// other tasks hand work to the listener task, so it never races the audio events
+#define PIPELINE_REQUEST_SOURCE 0x7E000000	// source_type of these messages
+#define PIPELINE_REQUEST_QUEUE  1			// requests are serialized anyway
+
+typedef enum {
+	PIPELINE_REQUEST_STREAM = 1,
+	PIPELINE_REQUEST_RESCAN = 2,
+	PIPELINE_REQUEST_FOLDER = 3,
+	PIPELINE_REQUEST_LIST = 4,
+	PIPELINE_REQUEST_PLAY = 5,
+	PIPELINE_REQUEST_QUEUE_TRACK = 6,
+	PIPELINE_REQUEST_TONE = 7,
+	PIPELINE_REQUEST_PHRASE = 8,
+	PIPELINE_REQUEST_URL = 9,
+	PIPELINE_REQUEST_FOREGROUND = 10,
+	PIPELINE_REQUEST_STOP = 11,
+	PIPELINE_REQUEST_SKIP = 12
+} pipeline_request_t;
+
+typedef struct {
+	audio_filetype_t filetype;
+	int rate;
+	int channels;
+} stream_request_t;
+
+typedef struct {
+	int8_t   trackNr;
+	uint8_t  priority;
+	int64_t  byte_pos;		// reader position to resume at
+} play_request_t;
+
+typedef struct {
+	const tone_t *tone;
+	uint8_t priority;
+} tone_request_t;
+
+typedef struct {
+	const int8_t *tracks;
+	int8_t  count;
+	uint8_t priority;
+} phrase_request_t;
+
 class Pipeline {
 private:
 	audio_board_handle_t board_handle;
 	audio_pipeline_handle_t pipeline;
 	audio_element_handle_t i2s_stream_writer;
-	audio_element_handle_t decoder_mp3, decoder_wav, decoder_ogg, decoder;
-	audio_element_handle_t fatfs_stream_reader;
+	audio_element_handle_t decoder;
+	audio_element_handle_t reader;
+	audio_element_handle_t stream_reader;	// audio pushed over the network
+	audio_element_handle_t http_reader;		// tracks on a media server
+	audio_element_handle_t input;			// reader linked into the pipeline
+	int stream_buffer;
+	int http_buffer;
+	audio_element_handle_t resampler;
+	audio_element_handle_t equalizer;
+	audio_element_handle_t mixer;
+	audio_pipeline_handle_t fg_pipeline;	// effects mixed over the music
+	audio_element_handle_t fg_reader;
+	audio_element_handle_t fg_decoder;
+	audio_element_handle_t fg_resampler;
+	audio_filetype_t fg_filetype;
+	ringbuf_handle_t fg_rb;
 	audio_filetype_t decoder_filetype;
 	play_mode_t mode;
+	int output_rate;
+	int resample_quality;
+	bool normalize;
+	bool eq;
+	bool duck;
+	int duck_level;
+	int duck_attack;
+	int duck_release;
+	bool trim;
+	int loop_crossfade;
+	int read_size;
+	int read_ahead;
+	int file_cache;
+	audio_event_iface_handle_t listener;
+	TaskHandle_t listener_task;
+	audio_event_iface_handle_t requests;
+	SemaphoreHandle_t request_lock;		// one request at a time
+	SemaphoreHandle_t request_done;
+	bool request_result;
+	uint8_t priority;
+	priority_policy_t priority_policy;
+	play_request_t preempted[MAXPREEMPTED];
+	int8_t preempted_count;
+	play_request_t pending;
+	bool has_pending;
+	bool oneshot;		// tone or phrase: no resume, repeat or shuffle
+	int8_t phrase[MAXPHRASE];	// clips of the next play
+	int8_t phrase_length;
+	audio_element_handle_t createDecoder( audio_filetype_t filetype );
+	void stopPipeline( void );
+	void savePosition( void );
+	bool playPreempted( void );
+	bool playQueued( void );
+	void preloadNext( void );
+	void prepareReader( char *url, audio_filetype_t filetype );
+	void StartForeground( void );
+	void buildForeground( audio_filetype_t filetype );
+	void stopForeground( void );
+	bool request( pipeline_request_t cmd, void *data );
+	bool runRequest( pipeline_request_t cmd, void *data );
+	bool startStream( const stream_request_t *stream );
+	bool applyScan( playlist_scan_t *scan );
+	bool applyFolder( int8_t folderNr );
+	void stopAll( void );
+	bool startTrack( int8_t trackNr, uint8_t newPriority );
+	bool startTone( const tone_t *tone, uint8_t newPriority );
+	bool startPhrase( const int8_t *tracks, int8_t count, uint8_t newPriority );
+	bool startUrl( char *url );
+	bool startEffect( int8_t trackNr );
+	bool queueTrack( int8_t trackNr );
+	bool skipTrack( int8_t step );
+	void playActive( audio_filetype_t filetype, int64_t byte_pos = 0 );
 public:
 	PlayList playList;
 	Pipeline();
+	void setOutputRate( int rate, int quality );
+	void setNormalize( bool enable );
+	void setTrim( bool enable );
+	void setLoopCrossfade( int ms );
+	void setEqualizer( bool enable );
+	bool setPlaybackRate( int rate );
+	void setDucking( bool enable, int level, int attack, int release );
+	int getPlaybackRate( void );
+	void setReadAhead( int size, int ahead );
+	void setFileCache( int files );
+	void setStreamBuffer( int size );
+	void setHttpBuffer( int size );
+	void setPriorityPolicy( priority_policy_t policy );
+	uint8_t getPriority( void );
 	void StartCodec(void);
+	// called by other tasks these run on the listener task, between the audio events
 	void stop( void );
 	void play( void );
-	void play( char *url, audio_filetype_t filetype);
-	void build( audio_filetype_t filetype );
+	bool play( int8_t trackNr, uint8_t newPriority );
+	bool next( void );
+	bool previous( void );
+	bool enqueue( int8_t trackNr );
+	bool playTone( const tone_t *tone, uint8_t newPriority = PRIORITY_TONE );
+	bool playPhrase( const int8_t *tracks, int8_t count, uint8_t newPriority = PRIORITY_PHRASE );
+	bool playNumber( uint32_t number, uint8_t newPriority = PRIORITY_PHRASE );
+	bool playForeground( int8_t trackNr );
+	bool playStream( audio_filetype_t filetype, int rate = 0, int channels = 0 );
+	bool playUrl( char *url );
+	bool selectFolder( int8_t folderNr );	// the playlist changes on the listener task
+	bool selectList( int8_t listNr );		// so does the m3u list
+	bool rescan( void );		// reads the folder on the calling task, the playlist changes on the listener task
+	audio_element_handle_t getStreamReader( void );
+	void play( char *url, audio_filetype_t filetype, int64_t byte_pos = 0 );
+	void build( audio_filetype_t filetype, audio_element_handle_t source = NULL );
 	void setMode( play_mode_t newMode );
 	play_mode_t getMode( void );
 	esp_err_t resume( void );
@@ -8,91 +8,1025 @@
 #include <playlist.h>
 #include <dirent.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include "esp_log.h"
+#include <freertos/task.h>
+#include <esp_system.h>
+
+#include "memorypolicy.h"
 
 #define TAG "PLAYLIST"
 
-PlayList::PlayList() {
-	maxTrack = -1;
-	activeTrack = -1;
+PlayList::PlayList() {
+	maxTrack = -1;
+	activeTrack = -1;
+	maxFolder = -1;
+	activeFolder = 0;
+	root[0] = '\0';
+	directory[0] = '\0';
+	list[0] = (char *) "";
+	maxList = 0;
+	activeList = 0;
+	entryBuffer = NULL;
+	entry = NULL;
+	entryTrack = NULL;
+	entries = 0;
+	activeEntry = -1;
+	memset( hashTable, -1, sizeof(hashTable) );
+	shuffle = false;
+	shuffleOrder = NULL;
+	shuffleSize = 0;
+	shuffleSeed = 0;
+	version = 0;
+	queueHead = 0;
+	queueLength = 0;
+	portMUX_INITIALIZE( &queueLock );
+	tableLock = xSemaphoreCreateRecursiveMutex();
+}
+
+int8_t PlayList::addTrack( const char *name, audio_filetype_t filetype ) {
+
+	track_t temp;
+	int8_t i;
+
+	if ( maxTrack >= MAXTRACK - 1 ) {
+		ESP_LOGW(TAG, "more than %d tracks, %s is ignored", MAXTRACK, name);
+		return -1;
+	}
+
+	// add new entry
+	maxTrack++;
+	track[maxTrack].name     = memory_strdup( MEMORY_BULK, name );
+	track[maxTrack].hash     = hashName( name );
+	track[maxTrack].sharedHash = false;
+	track[maxTrack].filetype = filetype;
+	track[maxTrack].analyzed = false;
+	track[maxTrack].gain     = 0;
+	track[maxTrack].head     = 0;
+	track[maxTrack].start    = 0;
+	track[maxTrack].end      = 0;
+	track[maxTrack].loop_start = 0;
+	track[maxTrack].loop_end   = 0;
+	track[maxTrack].tagged   = false;
+	track[maxTrack].title    = NULL;
+	track[maxTrack].artist   = NULL;
+	track[maxTrack].duration = 0;
+
+	// bubble sort
+	i=maxTrack;
+	while (i>0) {
+		// check if swap needed
+		if ( strcasecmp( track[i].name, track[i-1].name ) < 0 ) {
+			temp       = track[i-1];
+			track[i-1] = track[i];
+			track[i]   = temp;
+			i--;
+		} else {
+			break;
+		}
+	}
+
+	return i;
+
+}
+
+int8_t PlayList::addList( const char *name ) {
+
+	char *temp;
+	int8_t i;
+
+	if ( maxList >= MAXLIST - 1 ) {
+		ESP_LOGW(TAG, "more than %d playlists, %s is ignored", MAXLIST - 1, name);
+		return -1;
+	}
+
+	maxList++;
+	list[maxList] = memory_strdup( MEMORY_BULK, name );
+
+	// bubble sort, the folder itself stays first
+	i=maxList;
+	while ( ( i>1 ) && ( strcasecmp( list[i], list[i-1] ) < 0 ) ) {
+		temp      = list[i-1];
+		list[i-1] = list[i];
+		list[i]   = temp;
+		i--;
+	}
+
+	return i;
+
+}
+
+void PlayList::clear( void ) {
+
+	// only the active folder is kept in memory
+	clearQueue();
+	clearEntries();
+
+	for ( int i=0; i<=maxTrack; i++ ) {
+		memory_free( track[i].name );
+		memory_free( track[i].title );
+		memory_free( track[i].artist );
+	}
+
+	for ( int i=1; i<=maxList; i++ ) {
+		memory_free( list[i] );
+	}
+
+	maxTrack = -1;
+	activeTrack = -1;
+	maxList = 0;
+	memset( hashTable, -1, sizeof(hashTable) );
+
+}
+
+void PlayList::clearEntries( void ) {
+
+	memory_free( entryBuffer );
+	memory_free( entry );
+	memory_free( entryTrack );
+
+	entryBuffer = NULL;
+	entry = NULL;
+	entryTrack = NULL;
+	entries = 0;
+	activeEntry = -1;
+	activeList = 0;
+
+}
+
+void PlayList::readDir( const char *directory ) {
+
+	DIR *d;
+    struct dirent *dir;
+    char *ext1;
+    audio_filetype_t ft;
+
+    d = opendir( directory );
+    if (!d) return;
+
+    while ((dir = readdir(d)) != NULL) {
+
+    	// filter apple stuff
+    	if ( dir->d_name[0] == '.' ) {
+    			continue;
+    	}
+
+        // check if file has a valid extention
+    	ext1 = strrchr( dir->d_name, '.' );
+        ft = FILETYPE_UNKOWN;
+
+        if ( ( ext1 != NULL ) && (strlen( ext1 ) < 10 ) ) {
+        	// . found, check on valid extentions
+        	ft = filetypeOf( strlwr( ext1 ) );
+        }
+
+        if ( ft != FILETYPE_UNKOWN ) {
+        	addTrack( dir->d_name, ft );
+        } else if ( ( ext1 != NULL ) && ( strcmp( ext1, ".m3u" ) == 0 ) ) {
+        	addList( dir->d_name );
+        }
+
+    }
+
+    closedir(d);
+
+    if (maxTrack >= 0) {
+    	activeTrack = 0;
+    }
+
+    for (int i=0; i<=maxTrack; i++) {
+    	ESP_LOGD(TAG, "track %d=%s", i, track[i].name);
+    }
+
+}
+
+playlist_scan_t *PlayList::scanFolder( void ) {
+
+	DIR *d;
+	struct dirent *dir;
+
+	playlist_scan_t *scan = (playlist_scan_t *) memory_calloc( MEMORY_BULK, 1, sizeof(playlist_scan_t) );
+	if ( scan == NULL ) return NULL;
+
+	lock();
+	strlcpy( scan->directory, directory, sizeof(scan->directory) );
+	unlock();
+
+	d = opendir( scan->directory );
+	if (!d) {
+		memory_free( scan );
+		return NULL;
+	}
+
+	// the slow part, the playlist isn't touched meanwhile
+	while ((dir = readdir(d)) != NULL) {
+
+		char *ext1 = strrchr( dir->d_name, '.' );
+		if ( ( dir->d_name[0] == '.' ) || ( ext1 == NULL ) || ( strlen( ext1 ) >= 10 ) ) {
+			continue;
+		}
+
+		audio_filetype_t ft = filetypeOf( strlwr( ext1 ) );
+
+		if ( ( ft != FILETYPE_UNKOWN ) && ( scan->tracks < MAXTRACK ) ) {
+
+			int8_t i = scan->tracks;
+			scan->track[i] = memory_strdup( MEMORY_BULK, dir->d_name );
+			scan->filetype[i] = ft;
+			if ( scan->track[i] == NULL ) continue;
+			scan->tracks++;
+
+			for ( ; ( i>0 ) && ( strcasecmp( scan->track[i], scan->track[i-1] ) < 0 ); i-- ) {
+				char *temp         = scan->track[i-1];
+				scan->track[i-1]   = scan->track[i];
+				scan->track[i]     = temp;
+				ft                 = scan->filetype[i-1];
+				scan->filetype[i-1] = scan->filetype[i];
+				scan->filetype[i]  = ft;
+			}
+
+		} else if ( ( strcmp( ext1, ".m3u" ) == 0 ) && ( scan->lists < MAXLIST - 1 ) ) {
+
+			int8_t i = scan->lists;
+			scan->list[i] = memory_strdup( MEMORY_BULK, dir->d_name );
+			if ( scan->list[i] == NULL ) continue;
+			scan->lists++;
+
+			for ( ; ( i>0 ) && ( strcasecmp( scan->list[i], scan->list[i-1] ) < 0 ); i-- ) {
+				char *temp      = scan->list[i-1];
+				scan->list[i-1] = scan->list[i];
+				scan->list[i]   = temp;
+			}
+
+		}
+
+	}
+
+	closedir(d);
+
+	return scan;
+
+}
+
+void PlayList::freeScan( playlist_scan_t *scan ) {
+
+	if ( scan == NULL ) return;
+
+	for ( int i=0; i<scan->tracks; i++ ) {
+		memory_free( scan->track[i] );
+	}
+	for ( int i=0; i<scan->lists; i++ ) {
+		memory_free( scan->list[i] );
+	}
+
+	memory_free( scan );
+
+}
+
+bool PlayList::applyScan( playlist_scan_t *scan, int8_t *remap ) {
+
+	track_t *table;
+	char *scanList[MAXLIST];
+	bool keptList[MAXLIST] = {};
+	int8_t scanActiveList = 0;
+	int removedFiles = 0;
+	bool changed = false;
+
+	if ( scan == NULL ) return false;
+
+	table = (track_t *) memory_alloc( MEMORY_BULK, MAXTRACK * sizeof(track_t) );
+	if ( table == NULL ) {
+		freeScan( scan );
+		return false;
+	}
+
+	lock();
+
+	// the folder was switched meanwhile
+	if ( strcmp( scan->directory, directory ) != 0 ) {
+		unlock();
+		memory_free( table );
+		freeScan( scan );
+		return false;
+	}
+
+	for ( int8_t i=0; i<=maxTrack; i++ ) {
+		remap[i] = -1;
+	}
+
+	// known tracks keep their index data and their name, the scanned name is dropped
+	for ( int8_t i=0; i<scan->tracks; i++ ) {
+		int8_t old = findName( scan->track[i] );
+		if ( ( old >= 0 ) && ( remap[old] < 0 ) ) {
+			table[i] = track[old];
+			remap[old] = i;
+			memory_free( scan->track[i] );
+		} else {
+			memset( &table[i], 0, sizeof(track_t) );
+			table[i].name     = scan->track[i];
+			table[i].hash     = hashName( scan->track[i] );
+			table[i].filetype = scan->filetype[i];
+			changed = true;
+		}
+		scan->track[i] = NULL;
+	}
+
+	scanList[0] = list[0];
+	for ( int8_t i=0; i<scan->lists; i++ ) {
+		int8_t old = findList( scan->list[i] );
+		if ( old > 0 ) {
+			scanList[i+1] = list[old];
+			keptList[old] = true;
+			if ( old == activeList ) scanActiveList = i+1;
+			memory_free( scan->list[i] );
+		} else {
+			scanList[i+1] = scan->list[i];
+			changed = true;
+		}
+		scan->list[i] = NULL;
+	}
+
+	for ( int8_t i=0; i<=maxTrack; i++ ) {
+		if ( remap[i] < 0 ) changed = true;
+	}
+	for ( int8_t i=1; i<=maxList; i++ ) {
+		if ( !keptList[i] ) changed = true;
+	}
+
+	if ( !changed ) {
+		unlock();
+		memory_free( table );
+		freeScan( scan );
+		return false;
+	}
+
+	// every reader of the names holds the lock, so removed ones can go right away
+	for ( int8_t i=0; i<=maxTrack; i++ ) {
+		if ( remap[i] < 0 ) {
+			removedFiles++;
+			memory_free( track[i].name );
+			memory_free( track[i].title );
+			memory_free( track[i].artist );
+		}
+	}
+	for ( int8_t i=1; i<=maxList; i++ ) {
+		if ( !keptList[i] ) {
+			removedFiles++;
+			memory_free( list[i] );
+		}
+	}
+
+	bool listRemoved = ( activeList > 0 ) && ( scanActiveList == 0 );
+	int8_t scanMaxTrack = scan->tracks - 1;
+
+	memcpy( track, table, scan->tracks * sizeof(track_t) );
+
+	// a removed active track is replaced by the one at its place
+	if ( activeTrack >= 0 ) {
+		activeTrack = ( remap[activeTrack] >= 0 ) ? remap[activeTrack] : ( ( activeTrack <= scanMaxTrack ) ? activeTrack : scanMaxTrack );
+	}
+	maxTrack = scanMaxTrack;
+	if ( ( activeTrack < 0 ) && ( maxTrack >= 0 ) ) {
+		activeTrack = 0;
+	}
+
+	// removed tracks leave the queue
+	taskENTER_CRITICAL( &queueLock );
+	int8_t length = 0;
+	for ( int8_t i=0; i<queueLength; i++ ) {
+		int8_t trackNr = remap[ queue[ ( queueHead + i ) % MAXQUEUE ] ];
+		if ( trackNr >= 0 ) queue[ ( queueHead + length++ ) % MAXQUEUE ] = trackNr;
+	}
+	queueLength = length;
+	taskEXIT_CRITICAL( &queueLock );
+
+	memcpy( list, scanList, ( scan->lists + 1 ) * sizeof(char *) );
+	maxList = scan->lists;
+	activeList = scanActiveList;
+
+	for ( int16_t i=0; i<entries; i++ ) {
+		entryTrack[i] = ENTRY_UNRESOLVED;
+	}
+
+	buildHash();
+
+	if ( listRemoved ) {
+		clearEntries();
+	}
+
+	version++;
+
+	unlock();
+
+	ESP_LOGI(TAG, "rescan of %s: %d tracks, %d files removed, playlist version %lu", scan->directory, scanMaxTrack + 1, removedFiles, (unsigned long) version);
+
+	memory_free( table );
+	freeScan( scan );
+
+	return true;
+
+}
+
+void PlayList::lock( void ) {
+	xSemaphoreTakeRecursive( tableLock, portMAX_DELAY );
+}
+
+void PlayList::unlock( void ) {
+	xSemaphoreGiveRecursive( tableLock );
+}
+
+uint32_t PlayList::getVersion( void ) {
+	return version;
+}
+
+int PlayList::loadIndex( const char *indexFile, bool create ) {
+
+	FILE *f;
+	char line[512];
+	char *token, *value, *next;
+	int8_t trackNr;
+	int entries = 0;
+
+	f = fopen( indexFile, "r" );
+	if ( f == NULL ) {
+		ESP_LOGI(TAG, "no index %s found", indexFile);
+		return -1;
+	}
+
+	// first line holds the version, an outdated index gets rebuilt.
+	// version 3 lists analyzed tracks only, so it can't replace reading the directory.
+	int version = 0;
+	if ( ( fgets( line, sizeof(line), f ) != NULL ) && ( strncmp( line, "INDEX_VERSION=", 14 ) == 0 ) ) {
+		version = atoi( &line[14] );
+	}
+
+	if ( ( version < 3 ) || ( version > INDEX_VERSION ) || ( create && ( version != INDEX_VERSION ) ) ) {
+		ESP_LOGW(TAG, "ignoring outdated index %s", indexFile);
+		fclose( f );
+		return -1;
+	}
+
+	// TRACK=<name>|KEY=value|...
+	while ( fgets( line, sizeof(line), f ) != NULL ) {
+
+		line[ strcspn( line, "\r\n" ) ] = '\0';
+		trackNr = -1;
+		token = line;
+
+		while ( token != NULL ) {
+
+			next = strchr( token, '|' );
+			if ( next != NULL ) { *next++ = '\0'; }
+
+			value = strchr( token, '=' );
+			if ( value != NULL ) {
+				*value++ = '\0';
+
+				if ( strcmp( token, "PLAYLIST" ) == 0 ) {
+					if ( ( create ? addList( value ) : findList( value ) ) >= 0 ) entries++;
+					break;
+
+				} else if ( strcmp( token, "TRACK" ) == 0 ) {
+					trackNr = findTrack( value );
+					if ( ( trackNr < 0 ) && create && ( filetypeOf( value ) != FILETYPE_UNKOWN ) ) {
+						trackNr = addTrack( value, filetypeOf( value ) );
+					}
+					if ( trackNr < 0 ) break;
+					entries++;
+
+				} else if ( trackNr < 0 ) {
+					break;
+
+				} else if ( strcmp( token, "GAIN" ) == 0 ) {
+					// tracks without index data are listed by name only
+					track[trackNr].gain = atoi( value );
+					track[trackNr].analyzed = true;
+
+				} else if ( strcmp( token, "HEAD" ) == 0 ) {
+					track[trackNr].head = strtoul( value, NULL, 10 );
+
+				} else if ( strcmp( token, "START" ) == 0 ) {
+					track[trackNr].start = strtoul( value, NULL, 10 );
+
+				} else if ( strcmp( token, "END" ) == 0 ) {
+					track[trackNr].end = strtoul( value, NULL, 10 );
+
+				} else if ( strcmp( token, "LOOP_START" ) == 0 ) {
+					track[trackNr].loop_start = strtoul( value, NULL, 10 );
+
+				} else if ( strcmp( token, "LOOP_END" ) == 0 ) {
+					track[trackNr].loop_end = strtoul( value, NULL, 10 );
+
+				} else if ( strcmp( token, "DURATION" ) == 0 ) {
+					// written for all tracks with parsed tags, title and artist only if there are any
+					track[trackNr].duration = strtoul( value, NULL, 10 );
+					track[trackNr].tagged = true;
+
+				} else if ( ( strcmp( token, "TITLE" ) == 0 ) && ( track[trackNr].title == NULL ) ) {
+					track[trackNr].title = memory_strdup( MEMORY_BULK, value );
+
+				} else if ( ( strcmp( token, "ARTIST" ) == 0 ) && ( track[trackNr].artist == NULL ) ) {
+					track[trackNr].artist = memory_strdup( MEMORY_BULK, value );
+
+				}
+			}
+
+			token = next;
+		}
+
+	}
+
+	fclose( f );
+
+	if ( create && ( maxTrack >= 0 ) ) {
+		activeTrack = 0;
+	}
+
+	ESP_LOGI(TAG, "%d tracks found in index %s", entries, indexFile);
+
+	return entries;
+
+}
+
+void PlayList::saveIndex( const char *indexFile ) {
+
+	FILE *f;
+
+	f = fopen( indexFile, "w" );
+	if ( f == NULL ) {
+		ESP_LOGE(TAG, "Could not write %s.", indexFile);
+		return;
+	}
+
+	fprintf( f, "INDEX_VERSION=%d\n", INDEX_VERSION );
+
+	lock();
+
+	for ( int i=0; i<=maxTrack; i++ ) {
+		fprintf( f, "TRACK=%s", track[i].name );
+		if ( track[i].analyzed ) {
+			fprintf( f, "|GAIN=%d|HEAD=%lu|START=%lu|END=%lu|LOOP_START=%lu|LOOP_END=%lu", track[i].gain,
+					(unsigned long) track[i].head, (unsigned long) track[i].start, (unsigned long) track[i].end,
+					(unsigned long) track[i].loop_start, (unsigned long) track[i].loop_end );
+		}
+		// the tag texts contain neither '|' nor line breaks, see setTags
+		if ( track[i].tagged ) {
+			fprintf( f, "|DURATION=%lu", (unsigned long) track[i].duration );
+			if ( track[i].title != NULL ) fprintf( f, "|TITLE=%s", track[i].title );
+			if ( track[i].artist != NULL ) fprintf( f, "|ARTIST=%s", track[i].artist );
+		}
+		fprintf( f, "\n" );
+	}
+
+	for ( int i=1; i<=maxList; i++ ) {
+		fprintf( f, "PLAYLIST=%s\n", list[i] );
+	}
+
+	unlock();
+
+	fclose( f );
+
+}
+
+void PlayList::readFolders( const char *path ) {
+
+	DIR *d;
+	struct dirent *dir;
+	char *temp;
+	int8_t i;
+
+	for ( i=1; i<=maxFolder; i++ ) {
+		memory_free( folder[i] );
+	}
+
+	// folder 0 is the root itself
+	strlcpy( root, path, sizeof(root) );
+	strlcpy( directory, root, sizeof(directory) );
+	folder[0] = (char *) "";
+	maxFolder = 0;
+	activeFolder = 0;
+
+	d = opendir( root );
+	if (!d) return;
+
+	while ((dir = readdir(d)) != NULL) {
+
+		if ( ( dir->d_type != DT_DIR ) || ( dir->d_name[0] == '.' ) ) {
+			continue;
+		}
+
+		if ( ( maxFolder >= MAXFOLDER - 1 ) || ( strlen( root ) + strlen( dir->d_name ) + 2 > sizeof(directory) ) ) {
+			ESP_LOGW(TAG, "folder %s is ignored", dir->d_name);
+			continue;
+		}
+
+		maxFolder++;
+		folder[maxFolder] = memory_strdup( MEMORY_BULK, dir->d_name );
+
+		// bubble sort, the root stays first
+		i=maxFolder;
+		while ( ( i>1 ) && ( strcasecmp( folder[i], folder[i-1] ) < 0 ) ) {
+			temp        = folder[i-1];
+			folder[i-1] = folder[i];
+			folder[i]   = temp;
+			i--;
+		}
+
+	}
+
+	closedir(d);
+
+	ESP_LOGI(TAG, "%d folders found in %s", maxFolder, root);
+
+}
+
+int8_t PlayList::getFolders( void ) {
+	return maxFolder + 1;
+}
+
+char *PlayList::getFolder( int8_t folderNr ) {
+
+	if ( ( folderNr > maxFolder ) || ( folderNr < 0 ) ) {
+		return "none";
+	} else {
+		return folder[folderNr];
+	}
+}
+
+int8_t PlayList::findFolder( const char *name ) {
+
+	// fat ignores the case
+	for ( int8_t i=0; i<=maxFolder; i++ ) {
+		if ( strcasecmp( folder[i], name ) == 0 ) {
+			return i;
+		}
+	}
+
+	return -1;
+
+}
+
+int8_t PlayList::getActiveFolderNr( void ) {
+	return activeFolder;
+}
+
+bool PlayList::selectFolder( int8_t folderNr, bool scan ) {
+
+	char indexFile[100];
+
+	if ( ( folderNr > maxFolder ) || ( folderNr < 0 ) ) {
+		return false;
+	}
+
+	lock();
+
+	clear();
+	activeFolder = folderNr;
+
+	if ( folderNr == 0 ) {
+		strlcpy( directory, root, sizeof(directory) );
+	} else {
+		snprintf( directory, sizeof(directory), "%s/%s", root, folder[folderNr] );
+	}
+
+	getIndexFile( indexFile, sizeof(indexFile) );
+
+	// the index lists all tracks, so switching doesn't read the directory
+	if ( scan || ( loadIndex( indexFile, true ) < 0 ) ) {
+
+		// new tracks get into the index right away
+		readDir( directory );
+		if ( loadIndex( indexFile ) != getTracks() + maxList ) {
+			saveIndex( indexFile );
+		}
+
+	}
+
+	// track numbers are final now
+	buildHash();
+	shuffleReset();
+	version++;
+
+	unlock();
+
+	return true;
+
+}
+
+const char *PlayList::getDirectory( void ) {
+	return directory;
+}
+
+void PlayList::getPath( int8_t trackNr, char *path, size_t size ) {
+	lock();
+	snprintf( path, size, "%s/%s", directory, getTrack( trackNr ) );
+	unlock();
+}
+
+void PlayList::getIndexFile( char *path, size_t size ) {
+	snprintf( path, size, "%s/%s", directory, INDEX_NAME );
+}
+
+int8_t PlayList::getLists( void ) {
+	return maxList + 1;
+}
+
+char *PlayList::getList( int8_t listNr ) {
+
+	if ( ( listNr > maxList ) || ( listNr < 0 ) ) {
+		return "none";
+	} else {
+		return list[listNr];
+	}
+}
+
+int8_t PlayList::findList( const char *name ) {
+
+	int8_t listNr = -1;
+
+	lock();
+	for ( int8_t i=0; ( i<=maxList ) && ( listNr < 0 ); i++ ) {
+		if ( strcasecmp( list[i], name ) == 0 ) {
+			listNr = i;
+		}
+	}
+	unlock();
+
+	return listNr;
+
+}
+
+int8_t PlayList::getActiveListNr( void ) {
+	return activeList;
+}
+
+int16_t PlayList::getEntries( void ) {
+	return entries;
+}
+
+bool PlayList::selectList( int8_t listNr ) {
+
+	FILE *f;
+	char path[300];
+	long size;
+
+	if ( ( listNr > maxList ) || ( listNr < 0 ) ) {
+		return false;
+	}
+
+	clearEntries();
+
+	if ( listNr == 0 ) {
+		shuffleReset();
+		return true;
+	}
+
+	// one read for the whole file, the entries aren't checked on the card
+	snprintf( path, sizeof(path), "%s/%s", directory, list[listNr] );
+	f = fopen( path, "r" );
+	if ( f == NULL ) {
+		ESP_LOGE(TAG, "Could not read %s.", path);
+		return false;
+	}
+
+	fseek( f, 0, SEEK_END );
+	size = ftell( f );
+	fseek( f, 0, SEEK_SET );
+
+	if ( ( size <= 0 ) || ( size > M3U_MAX_SIZE ) ) {
+		ESP_LOGW(TAG, "%s has %ld bytes, ignored", path, size);
+		fclose( f );
+		return false;
+	}
+
+	entryBuffer = (char *) memory_alloc( MEMORY_BULK, size + 1 );
+	if ( entryBuffer == NULL ) {
+		fclose( f );
+		return false;
+	}
+
+	size = fread( entryBuffer, 1, size, f );
+	entryBuffer[size] = '\0';
+	fclose( f );
+
+	int16_t lines = 1;
+	for ( char *p = entryBuffer; ( *p != '\0' ) && ( lines < M3U_MAX_ENTRIES ); p++ ) {
+		if ( *p == '\n' ) lines++;
+	}
+
+	entry      = (char **) memory_alloc( MEMORY_BULK, lines * sizeof(char *) );
+	entryTrack = (int8_t *) memory_alloc( MEMORY_BULK, lines );
+	if ( ( entry == NULL ) || ( entryTrack == NULL ) ) {
+		clearEntries();
+		return false;
+	}
+
+	// split in place, #EXTM3U, #EXTINF and empty lines are skipped
+	char *line = entryBuffer;
+	if ( strncmp( line, "\xEF\xBB\xBF", 3 ) == 0 ) line += 3;
+
+	while ( ( line != NULL ) && ( entries < lines ) ) {
+
+		char *next = strchr( line, '\n' );
+		if ( next != NULL ) { *next++ = '\0'; }
+		line[ strcspn( line, "\r" ) ] = '\0';
+
+		if ( ( line[0] != '\0' ) && ( line[0] != '#' ) ) {
+			entry[entries]      = line;
+			entryTrack[entries] = ENTRY_UNRESOLVED;
+			entries++;
+		}
+
+		line = next;
+	}
+
+	if ( entries == 0 ) {
+		ESP_LOGW(TAG, "%s is empty", path);
+		clearEntries();
+		return false;
+	}
+
+	activeList = listNr;
+	shuffleReset();
+	stepEntry( 1 );
+
+	ESP_LOGI(TAG, "%d entries in %s", entries, path);
+
+	return true;
+
+}
+
+int8_t PlayList::resolveEntry( int16_t pos ) {
+
+	if ( entryTrack[pos] != ENTRY_UNRESOLVED ) {
+		return entryTrack[pos];
+	}
+
+	char *name = entry[pos];
+	int8_t trackNr = -1;
+
+	// windows playlists
+	for ( char *p = name; *p != '\0'; p++ ) {
+		if ( *p == '\\' ) *p = '/';
+	}
+
+	while ( strncmp( name, "./", 2 ) == 0 ) {
+		name += 2;
+	}
+
+	char *base = strrchr( name, '/' );
+
+	if ( base == NULL ) {
+		trackNr = findName( name );
+	} else {
+		// /sdcard/crane/horn.mp3 or crane/horn.mp3, if crane is the active folder
+		size_t len = base - name;
+		const char *folderName = ( maxFolder >= 0 ) ? folder[activeFolder] : "";
+		if ( ( ( len == strlen( directory ) ) && ( strncasecmp( name, directory, len ) == 0 ) ) ||
+			 ( ( len == strlen( folderName ) ) && ( strncasecmp( name, folderName, len ) == 0 ) ) ) {
+			trackNr = findName( base + 1 );
+		}
+	}
+
+	if ( trackNr < 0 ) {
+		ESP_LOGW(TAG, "playlist entry %s not found", entry[pos]);
+	}
+
+	entryTrack[pos] = trackNr;
+	return trackNr;
+
+}
+
+void PlayList::stepEntry( int16_t step ) {
+
+	// missing tracks are skipped, at most one round
+	for ( int16_t i = 0; i < entries; i++ ) {
+
+		activeEntry = ( ( activeEntry + step ) % entries + entries ) % entries;
+
+		int8_t trackNr = resolveEntry( activeEntry );
+		if ( trackNr >= 0 ) {
+			activeTrack = trackNr;
+			return;
+		}
+
+	}
+
 }
 
-void PlayList::readDir( const char *directory ) {
+int8_t PlayList::findTrack( const char *name ) {
 
-	DIR *d;
-    struct dirent *dir;
-    char *ext1;
-    char ext[10];
-    audio_filetype_t ft;
-    char *temp;
-    int8_t i;
+	int8_t trackNr = -1;
 
-    d = opendir( directory );
-    if (!d) return;
+	lock();
+	for ( int8_t i=0; ( i<=maxTrack ) && ( trackNr < 0 ); i++ ) {
+		if ( strcmp( track[i].name, name ) == 0 ) {
+			trackNr = i;
+		}
+	}
+	unlock();
 
-    while ((dir = readdir(d)) != NULL) {
+	return trackNr;
 
-    	// filter apple stuff
-    	if ( dir->d_name[0] == '.' ) {
-    			continue;
-    	}
+}
 
-        // check if file has a valid extention
-    	ext1 = strrchr( dir->d_name, '.' );
-        ft = FILETYPE_UNKOWN;
+uint32_t PlayList::hashName( const char *name ) {
 
-        if ( ( ext1 != NULL ) && (strlen( ext1 ) < 10 ) ) {
-        	// . found, get extention
-        	strcpy( ext, strlwr( ext1 ) );
+	uint32_t hash = 2166136261u;
 
-        	// check on valid extentions
+	for ( const char *p = name; *p != '\0'; p++ ) {
+		char c = *p;
+		if ( ( c >= 'A' ) && ( c <= 'Z' ) ) c += 'a' - 'A';
+		hash = ( hash ^ (uint8_t) c ) * 16777619u;
+	}
 
-        	if ( strcmp( ext, ".mp3") == 0 )  { ft = FILETYPE_MP3; }
+	return hash;
 
-        	// ogg has problems playing a song twice
-        	// else if ( strcmp( ext, ".ogg") == 0 )  { ft = FILETYPE_OGG; }
+}
 
-        	else if ( strcmp( ext, ".wav") == 0 )  { ft = FILETYPE_WAV; }
-        }
+void PlayList::buildHash( void ) {
 
-        if ( ft != FILETYPE_UNKOWN ) {
+	memset( hashTable, -1, sizeof(hashTable) );
 
-        	// add new entry
-        	maxTrack++;
-        	track[maxTrack]    = (char *)malloc( strlen(dir->d_name) + 1 );
-        	filetype[maxTrack] = ft;
-        	strcpy( track[maxTrack], dir->d_name );
-
-        	// bubble sort
-        	i=maxTrack;
-        	while (i>0) {
-        		// check if swap needed
-        		if ( strcasecmp( track[i], track[i-1] ) < 0 ) {
-        			temp          = track[i-1];
-        			track[i-1]    = track[i];
-        			track[i]      = temp;
-        			ft            = filetype[i-1];
-        			filetype[i-1] = filetype[i];
-        			filetype[i]   = ft;
-        			i--;
-        		} else {
-        			break;
-        		}
-        	}
+	// open addressing, linear probing
+	for ( int8_t i=0; i<=maxTrack; i++ ) {
 
-        }
+		uint32_t slot = track[i].hash & ( HASH_SIZE - 1 );
+		track[i].sharedHash = false;
 
-    }
+		while ( hashTable[slot] >= 0 ) {
+			if ( track[ hashTable[slot] ].hash == track[i].hash ) {
+				ESP_LOGW(TAG, "%s and %s have the same hash, neither plays by hash", track[ hashTable[slot] ].name, track[i].name);
+				track[ hashTable[slot] ].sharedHash = true;
+				track[i].sharedHash = true;
+			}
+			slot = ( slot + 1 ) & ( HASH_SIZE - 1 );
+		}
 
-    closedir(d);
+		hashTable[slot] = i;
 
-    if (maxTrack >= 0) {
-    	activeTrack = 0;
-    }
+	}
 
-    for (int i=0; i<=maxTrack; i++) {
-    	ESP_LOGD(TAG, "track %d=%s", i, track[i]);
-    }
+}
+
+int8_t PlayList::findHash( uint32_t hash ) {
+
+	int8_t trackNr = -1;
+
+	lock();
+	// the table has more slots than tracks, so there is always an empty one
+	for ( uint32_t slot = hash & ( HASH_SIZE - 1 ); hashTable[slot] >= 0; slot = ( slot + 1 ) & ( HASH_SIZE - 1 ) ) {
+		if ( track[ hashTable[slot] ].hash == hash ) {
+			trackNr = hashTable[slot];
+			break;
+		}
+	}
+	// playing one of them could be the wrong track
+	if ( ( trackNr >= 0 ) && track[trackNr].sharedHash ) {
+		ESP_LOGW(TAG, "hash %08lx is shared by more than one track", (unsigned long) hash);
+		trackNr = -1;
+	}
+	unlock();
+
+	return trackNr;
+
+}
+
+int8_t PlayList::findName( const char *name ) {
+
+	uint32_t hash = hashName( name );
+	int8_t found = -1;
+
+	lock();
+	// names with the same hash are told apart here
+	for ( uint32_t slot = hash & ( HASH_SIZE - 1 ); hashTable[slot] >= 0; slot = ( slot + 1 ) & ( HASH_SIZE - 1 ) ) {
+		int8_t trackNr = hashTable[slot];
+		if ( ( track[trackNr].hash == hash ) && ( strcasecmp( track[trackNr].name, name ) == 0 ) ) {
+			found = trackNr;
+			break;
+		}
+	}
+	unlock();
+
+	return found;
+
+}
+
+int8_t PlayList::findClip( const char *name ) {
+
+	size_t len = strlen( name );
+	int8_t trackNr = -1;
+
+	lock();
+	for ( int8_t i=0; ( i<=maxTrack ) && ( trackNr < 0 ); i++ ) {
+		if ( ( strncasecmp( track[i].name, name, len ) == 0 ) && ( track[i].name[len] == '.' ) ) {
+			trackNr = i;
+		}
+	}
+	unlock();
+
+	return trackNr;
 
 }
 
@@ -101,8 +1035,39 @@ char *PlayList::getTrack( int8_t trackNr ) {
 	if ( ( trackNr > maxTrack ) || ( trackNr < 0 ) ) {
 		return "none";
 	} else {
-		return track[trackNr];
+		return track[trackNr].name;
+	}
+}
+
+audio_filetype_t PlayList::filetypeOf( const char *name ) {
+
+	static const struct { const char *ext; audio_filetype_t filetype; } extensions[] = {
+		{ ".mp3", FILETYPE_MP3 }, { ".ogg", FILETYPE_OGG }, { ".wav", FILETYPE_WAV }, { ".adpcm", FILETYPE_ADPCM }
+	};
+
+	// http://host/track.mp3?id=1
+	size_t len = strcspn( name, "?#" );
+	const char *ext = NULL;
+
+	for ( const char *p = name; p < name + len; p++ ) {
+		if ( *p == '.' ) ext = p;
+		else if ( *p == '/' ) ext = NULL;
+	}
+
+	if ( ext == NULL ) {
+		return FILETYPE_UNKOWN;
+	}
+
+	len -= ext - name;
+
+	for ( size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++ ) {
+		if ( ( strlen( extensions[i].ext ) == len ) && ( strncasecmp( ext, extensions[i].ext, len ) == 0 ) ) {
+			return extensions[i].filetype;
+		}
 	}
+
+	return FILETYPE_UNKOWN;
+
 }
 
 char *PlayList::getActiveTrack( void ) {
@@ -125,8 +1090,146 @@ audio_filetype_t PlayList::getFiletype(int8_t trackNr) {
 	if ( ( trackNr > maxTrack ) || ( trackNr < 0 ) ) {
 		return FILETYPE_UNKOWN;
 	} else {
-		return filetype[trackNr];
+		return track[trackNr].filetype;
+	}
+}
+
+bool PlayList::isAnalyzed( int8_t trackNr ) {
+
+	if ( ( trackNr > maxTrack ) || ( trackNr < 0 ) ) {
+		return false;
+	} else {
+		return track[trackNr].analyzed;
+	}
+}
+
+int8_t PlayList::getGain( int8_t trackNr ) {
+
+	if ( ( trackNr > maxTrack ) || ( trackNr < 0 ) ) {
+		return 0;
+	} else {
+		return track[trackNr].gain;
+	}
+}
+
+void PlayList::setGain( int8_t trackNr, int8_t gain ) {
+
+	if ( ( trackNr >=0 ) && ( trackNr <= maxTrack ) ) {
+		track[trackNr].gain     = gain;
+		track[trackNr].analyzed = true;
+	}
+
+}
+
+bool PlayList::getTrim( int8_t trackNr, uint32_t *head, uint32_t *start, uint32_t *end ) {
+
+	if ( ( trackNr > maxTrack ) || ( trackNr < 0 ) || ( ( track[trackNr].start == 0 ) && ( track[trackNr].end == 0 ) ) ) {
+		*head = *start = *end = 0;
+		return false;
+	}
+
+	*head  = track[trackNr].head;
+	*start = track[trackNr].start;
+	*end   = track[trackNr].end;
+	return true;
+
+}
+
+void PlayList::setTrim( int8_t trackNr, uint32_t head, uint32_t start, uint32_t end ) {
+
+	if ( ( trackNr >=0 ) && ( trackNr <= maxTrack ) ) {
+		track[trackNr].head     = head;
+		track[trackNr].start    = start;
+		track[trackNr].end      = end;
+		track[trackNr].analyzed = true;
+	}
+
+}
+
+bool PlayList::getLoop( int8_t trackNr, uint32_t *start, uint32_t *end ) {
+
+	if ( ( trackNr > maxTrack ) || ( trackNr < 0 ) || ( ( track[trackNr].loop_start == 0 ) && ( track[trackNr].loop_end == 0 ) ) ) {
+		*start = *end = 0;
+		return false;
+	}
+
+	*start = track[trackNr].loop_start;
+	*end   = track[trackNr].loop_end;
+	return true;
+
+}
+
+void PlayList::setLoop( int8_t trackNr, uint32_t start, uint32_t end ) {
+
+	if ( ( trackNr >=0 ) && ( trackNr <= maxTrack ) ) {
+		track[trackNr].loop_start = start;
+		track[trackNr].loop_end   = end;
+		track[trackNr].analyzed   = true;
+	}
+
+}
+
+bool PlayList::isTagged( int8_t trackNr ) {
+
+	if ( ( trackNr > maxTrack ) || ( trackNr < 0 ) ) {
+		return false;
+	} else {
+		return track[trackNr].tagged;
+	}
+}
+
+char *PlayList::getTitle( int8_t trackNr ) {
+
+	if ( ( trackNr > maxTrack ) || ( trackNr < 0 ) ) {
+		return NULL;
+	} else {
+		return track[trackNr].title;
+	}
+}
+
+char *PlayList::getArtist( int8_t trackNr ) {
+
+	if ( ( trackNr > maxTrack ) || ( trackNr < 0 ) ) {
+		return NULL;
+	} else {
+		return track[trackNr].artist;
+	}
+}
+
+uint32_t PlayList::getDuration( int8_t trackNr ) {
+
+	if ( ( trackNr > maxTrack ) || ( trackNr < 0 ) ) {
+		return 0;
+	} else {
+		return track[trackNr].duration;
+	}
+}
+
+static char *tagText( const char *text ) {
+
+	if ( ( text == NULL ) || ( text[0] == '\0' ) ) return NULL;
+
+	// '|' separates the fields of the index, a line break the tracks
+	char *copy = memory_strdup( MEMORY_BULK, text );
+	for ( char *c = copy; ( c != NULL ) && ( *c != '\0' ); c++ ) {
+		if ( ( *c == '|' ) || ( (uint8_t) *c < ' ' ) ) *c = ' ';
+	}
+
+	return copy;
+
+}
+
+void PlayList::setTags( int8_t trackNr, const char *title, const char *artist, uint32_t duration ) {
+
+	lock();
+	if ( ( trackNr >=0 ) && ( trackNr <= maxTrack ) && !track[trackNr].tagged ) {
+		track[trackNr].title    = tagText( title );
+		track[trackNr].artist   = tagText( artist );
+		track[trackNr].duration = duration;
+		track[trackNr].tagged   = true;
 	}
+	unlock();
+
 }
 
 
@@ -150,7 +1253,11 @@ int8_t PlayList::getActiveTrackNr(void) {
 
 void PlayList::nextTrack( void ) {
 
-	if ( activeTrack >= maxTrack ) {
+	if ( shuffle ) {
+		shuffleStep( true );
+	} else if ( entries > 0 ) {
+		stepEntry( 1 );
+	} else if ( activeTrack >= maxTrack ) {
 		activeTrack = 0;
 	} else {
 		activeTrack++;
@@ -160,7 +1267,11 @@ void PlayList::nextTrack( void ) {
 
 void PlayList::prevTrack( void ) {
 
-	if ( activeTrack <= 0 ) {
+	if ( shuffle ) {
+		shuffleStep( false );
+	} else if ( entries > 0 ) {
+		stepEntry( -1 );
+	} else if ( activeTrack <= 0 ) {
 		activeTrack = maxTrack;
 	} else {
 		activeTrack--;
@@ -171,6 +1282,257 @@ void PlayList::prevTrack( void ) {
 
 void PlayList::setRandomTrack() {
 
-	activeTrack = rand() % ( maxTrack + 1 );
+	shuffleStep( true );
+
+}
+
+void PlayList::setShuffle( bool on ) {
+
+	// a new pass when switched on
+	if ( on && !shuffle ) {
+		shuffleReset();
+	}
+
+	shuffle = on;
+
+}
+
+void PlayList::setShuffleSeed( uint32_t seed ) {
+
+	shuffleSeed = seed;
+	shuffleReset();
+
+}
+
+uint32_t PlayList::shuffleRandom( uint32_t range ) {
+
+	uint32_t x = shuffleState;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	shuffleState = x;
+
+	// scaled instead of modulo, no bias worth mentioning for these ranges
+	return (uint32_t) ( ( (uint64_t) x * range ) >> 32 );
+
+}
+
+void PlayList::shuffleReset( void ) {
+
+	int16_t size = ( entries > 0 ) ? entries : getTracks();
+
+	if ( size != shuffleSize ) {
+		memory_free( shuffleOrder );
+		shuffleOrder = ( size > 0 ) ? (int16_t *) memory_alloc( MEMORY_BULK, size * sizeof(int16_t) ) : NULL;
+		shuffleSize = ( shuffleOrder != NULL ) ? size : 0;
+	}
+
+	for ( int16_t i = 0; i < shuffleSize; i++ ) {
+		shuffleOrder[i] = i;
+	}
+
+	shufflePos = -1;
+	shuffleDrawn = 0;
+	shuffleCarry = -1;
+	// small seeds like 1, 2, 3 get mixed, xorshift alone starts too similar for them
+	uint32_t x = ( shuffleSeed != 0 ) ? shuffleSeed : esp_random();
+	x = ( x ^ ( x >> 16 ) ) * 0x7FEB352Du;
+	x = ( x ^ ( x >> 15 ) ) * 0x846CA68Bu;
+	x ^= x >> 16;
+	shuffleState = ( x != 0 ) ? x : 1;
+
+}
+
+int16_t PlayList::shufflePeek( void ) {
+
+	// one Fisher-Yates step when the next position isn't drawn yet
+	if ( shufflePos + 1 < shuffleSize ) {
+		if ( shufflePos + 1 == shuffleDrawn ) {
+			int16_t j = shuffleDrawn + shuffleRandom( shuffleSize - shuffleDrawn );
+			int16_t temp = shuffleOrder[shuffleDrawn];
+			shuffleOrder[shuffleDrawn] = shuffleOrder[j];
+			shuffleOrder[j] = temp;
+			shuffleDrawn++;
+		}
+		return shuffleOrder[ shufflePos + 1 ];
+	}
+
+	// the next pass starts with another one than the last, which stays in place until then
+	if ( shuffleCarry < 0 ) {
+		shuffleCarry = ( shuffleSize > 1 ) ? shuffleRandom( shuffleSize - 1 ) : 0;
+	}
+
+	return shuffleOrder[shuffleCarry];
+
+}
+
+void PlayList::shuffleStep( bool forward ) {
+
+	if ( shuffleSize != ( ( entries > 0 ) ? entries : getTracks() ) ) {
+		shuffleReset();
+	}
+
+	// missing playlist entries are skipped
+	for ( int16_t i = 0; i < shuffleSize; i++ ) {
+
+		int16_t item;
+
+		if ( !forward ) {
+			// back to the beginning of this pass at most
+			if ( shufflePos <= 0 ) return;
+			item = shuffleOrder[ --shufflePos ];
+		} else if ( shufflePos + 1 < shuffleSize ) {
+			item = shufflePeek();
+			shufflePos++;
+		} else {
+			item = shufflePeek();
+			shuffleOrder[shuffleCarry] = shuffleOrder[0];
+			shuffleOrder[0] = item;
+			shufflePos = 0;
+			shuffleDrawn = 1;
+			shuffleCarry = -1;
+		}
+
+		int8_t trackNr = ( entries > 0 ) ? resolveEntry( item ) : item;
+		if ( trackNr >= 0 ) {
+			activeTrack = trackNr;
+			if ( entries > 0 ) activeEntry = item;
+			return;
+		}
+
+	}
+
+}
+
+int8_t PlayList::peekTrack( void ) {
+
+	if ( !shuffle || ( shuffleSize == 0 ) || ( shuffleSize != ( ( entries > 0 ) ? entries : getTracks() ) ) ) {
+		return -1;
+	}
+
+	int16_t item = shufflePeek();
+
+	return ( entries > 0 ) ? resolveEntry( item ) : item;
+
+}
+
+bool PlayList::enqueue( int8_t trackNr ) {
+
+	bool ok = false;
+
+	if ( ( trackNr < 0 ) || ( trackNr > maxTrack ) ) {
+		return false;
+	}
+
+	// the queue is used by the web server and the main task
+	taskENTER_CRITICAL( &queueLock );
+	if ( queueLength < MAXQUEUE ) {
+		queue[ ( queueHead + queueLength ) % MAXQUEUE ] = trackNr;
+		queueLength++;
+		ok = true;
+	}
+	taskEXIT_CRITICAL( &queueLock );
+
+	return ok;
+
+}
+
+int8_t PlayList::dequeue( void ) {
+
+	int8_t trackNr = -1;
+
+	taskENTER_CRITICAL( &queueLock );
+	if ( queueLength > 0 ) {
+		trackNr = queue[queueHead];
+		queueHead = ( queueHead + 1 ) % MAXQUEUE;
+		queueLength--;
+	}
+	taskEXIT_CRITICAL( &queueLock );
+
+	return trackNr;
+
+}
+
+int8_t PlayList::getQueueLength( void ) {
+
+	return queueLength;
+
+}
+
+int8_t PlayList::getQueuedTrack( int8_t pos ) {
+
+	int8_t trackNr = -1;
+
+	taskENTER_CRITICAL( &queueLock );
+	if ( ( pos >= 0 ) && ( pos < queueLength ) ) {
+		trackNr = queue[ ( queueHead + pos ) % MAXQUEUE ];
+	}
+	taskEXIT_CRITICAL( &queueLock );
+
+	return trackNr;
+
+}
+
+void PlayList::clearQueue( void ) {
+
+	taskENTER_CRITICAL( &queueLock );
+	queueHead = 0;
+	queueLength = 0;
+	taskEXIT_CRITICAL( &queueLock );
+
+}
+
+bool PlayList::addClip( uint32_t number, int8_t *tracks, int8_t *count, int8_t maxTracks ) {
+
+	char name[12];
+	snprintf( name, sizeof(name), "%lu", (unsigned long) number );
+
+	int8_t trackNr = findClip( name );
+	if ( ( trackNr < 0 ) || ( *count >= maxTracks ) ) {
+		return false;
+	}
+
+	tracks[(*count)++] = trackNr;
+	return true;
+
+}
+
+bool PlayList::spellClips( uint32_t number, int8_t *tracks, int8_t *count, int8_t maxTracks ) {
+
+	// a recorded number wins, e.g. 21 for languages saying "one and twenty"
+	if ( addClip( number, tracks, count, maxTracks ) ) {
+		return true;
+	}
+
+	if ( number >= 1000 ) {
+		if ( !spellClips( number / 1000, tracks, count, maxTracks ) || !addClip( 1000, tracks, count, maxTracks ) ) return false;
+		return ( number % 1000 == 0 ) || spellClips( number % 1000, tracks, count, maxTracks );
+	}
+
+	if ( number >= 100 ) {
+		if ( !spellClips( number / 100, tracks, count, maxTracks ) || !addClip( 100, tracks, count, maxTracks ) ) return false;
+		return ( number % 100 == 0 ) || spellClips( number % 100, tracks, count, maxTracks );
+	}
+
+	if ( number >= 20 ) {
+		if ( !addClip( number / 10 * 10, tracks, count, maxTracks ) ) return false;
+		return ( number % 10 == 0 ) || spellClips( number % 10, tracks, count, maxTracks );
+	}
+
+	// 0..19 need a clip of their own
+	return false;
+
+}
+
+int8_t PlayList::spellNumber( uint32_t number, int8_t *tracks, int8_t maxTracks ) {
+
+	int8_t count = 0;
+
+	if ( ( number > 999999 ) || !spellClips( number, tracks, &count, maxTracks ) ) {
+		return -1;
+	}
+
+	return count;
 
 }
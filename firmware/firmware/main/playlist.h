@@ -9,35 +9,186 @@
 #define MAIN_PLAYLIST_H_
 
 #include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 #define MAXTRACK 100
+#define MAXQUEUE 16
+#define MAXFOLDER 16		// folder 0 is the root, the others are its subfolders
+#define MAXLIST 16			// list 0 plays the folder in alphabetic order, the others are its m3u files
+#define M3U_MAX_SIZE    (64 * 1024)
+#define M3U_MAX_ENTRIES 2000
+#define ENTRY_UNRESOLVED -2
+#define HASH_SIZE 256		// power of two, at least twice MAXTRACK for short probe sequences
+
+#define INDEX_VERSION 4
+#define INDEX_NAME "ftcSoundBar.idx"	// one per folder, it lists all tracks of the folder
 
 typedef enum {
 	FILETYPE_UNKOWN,
 	FILETYPE_MP3,
 	FILETYPE_OGG,
-	FILETYPE_WAV
+	FILETYPE_WAV,
+	FILETYPE_ADPCM,
+	FILETYPE_TONE		// generated, no file
 } audio_filetype_t;
 
+typedef struct {
+	char             *name;
+	uint32_t         hash;		// of the name, see hashName
+	bool             sharedHash;	// another track has the same hash, it doesn't play by hash
+	audio_filetype_t filetype;
+	bool             analyzed;	// index data below is valid
+	int8_t           gain;		// normalization gain in dB
+	uint32_t         head;		// trim points in bytes: [0, head) + [start, end) is played
+	uint32_t         start;		// 0 = from the beginning
+	uint32_t         end;		// 0 = end of file
+	uint32_t         loop_start;	// loop region in bytes for repeat mode, 0 = start of the audio
+	uint32_t         loop_end;		// 0 = end of the audio
+	bool             tagged;	// metadata below is valid
+	char             *title;		// from the tags, NULL = unknown
+	char             *artist;
+	uint32_t         duration;	// ms, 0 = unknown
+} track_t;
+
+// the tracks and playlists of the active folder as read by scanFolder, not applied yet
+typedef struct {
+	char             directory[80];
+	int8_t           tracks;
+	int8_t           lists;
+	char             *track[MAXTRACK];	// sorted like the playlist
+	audio_filetype_t filetype[MAXTRACK];
+	char             *list[MAXLIST];	// m3u files, without the folder itself
+} playlist_scan_t;
+
 class PlayList {
 private:
 	int8_t maxTrack;
 	int8_t activeTrack;
-	char   *track[MAXTRACK];
-	audio_filetype_t filetype[MAXTRACK];
+	track_t track[MAXTRACK];
+	int8_t hashTable[HASH_SIZE];	// track numbers by name hash, -1 = empty
+	char *folder[MAXFOLDER];
+	int8_t maxFolder;
+	int8_t activeFolder;
+	char root[32];
+	char directory[80];			// of the active folder
+	char *list[MAXLIST];
+	int8_t maxList;
+	int8_t activeList;
+	char *entryBuffer;			// the m3u file, entries point into it
+	char **entry;
+	int8_t *entryTrack;			// track of an entry, ENTRY_UNRESOLVED until it is played the first time
+	int16_t entries;
+	int16_t activeEntry;
+	bool shuffle;
+	int16_t *shuffleOrder;		// permutation of the tracks or the playlist entries
+	int16_t shuffleSize;
+	int16_t shufflePos;			// current position, -1 before the first
+	int16_t shuffleDrawn;		// positions [0, drawn) of this pass are fixed
+	int16_t shuffleCarry;		// drawn first position of the next pass, -1 = not yet
+	uint32_t shuffleSeed;		// 0 = random
+	uint32_t shuffleState;		// xorshift32
+	uint32_t version;			// changes with the tracks
+	int8_t queue[MAXQUEUE];		// ring buffer of track numbers
+	int8_t queueHead;
+	int8_t queueLength;
+	portMUX_TYPE queueLock;
+	SemaphoreHandle_t tableLock;	// recursive, see lock
+	bool addClip( uint32_t number, int8_t *tracks, int8_t *count, int8_t maxTracks );
+	bool spellClips( uint32_t number, int8_t *tracks, int8_t *count, int8_t maxTracks );
+	int8_t addTrack( const char *name, audio_filetype_t filetype );
+	int8_t addList( const char *name );
+	void clear( void );
+	void clearEntries( void );
+	int8_t resolveEntry( int16_t pos );
+	void stepEntry( int16_t step );
+	void buildHash( void );
+	uint32_t shuffleRandom( uint32_t range );
+	void shuffleReset( void );
+	int16_t shufflePeek( void );
+	void shuffleStep( bool forward );
 public:
 	PlayList();
 	void readDir( const char *directory );
+	// reads the active folder again without changing the playlist, so it can run in the background.
+	// returns NULL if the folder can't be read.
+	playlist_scan_t *scanFolder( void );
+	// applies additions and removals of a scan and frees it, tracks keep their index data.
+	// the active and queued tracks stay the same by name. remap gets the new number of each old track, -1 if removed.
+	// returns false if nothing changed or the folder was switched since the scan.
+	bool applyScan( playlist_scan_t *scan, int8_t *remap );
+	static void freeScan( playlist_scan_t *scan );
+	// names, titles and playlists returned as pointers are freed by applyScan and selectFolder,
+	// hold the lock while using them. the find functions and getPath take it themselves.
+	void lock( void );
+	void unlock( void );
+	uint32_t getVersion( void );
+	// create adds the tracks and playlists of the index instead of matching them to the ones read before.
+	// returns the tracks and playlists found or -1 without a valid index.
+	int loadIndex( const char *indexFile, bool create = false );
+	void saveIndex( const char *indexFile );
+	// folders of root, the tracks of only one of them are in memory
+	void readFolders( const char *path );
+	int8_t getFolders( void );
+	char *getFolder( int8_t folderNr );
+	int8_t findFolder( const char *name );
+	int8_t getActiveFolderNr( void );
+	// scan reads the directory and completes the index, otherwise the index alone is loaded if there is one
+	bool selectFolder( int8_t folderNr, bool scan );
+	const char *getDirectory( void );
+	void getPath( int8_t trackNr, char *path, size_t size );
+	void getIndexFile( char *path, size_t size );
+	// m3u files of the active folder, their entries are paths relative to the folder or the sd card.
+	// entries are matched to the tracks when they get played, only tracks of the active folder can be played.
+	int8_t getLists( void );
+	char *getList( int8_t listNr );
+	int8_t findList( const char *name );
+	int8_t getActiveListNr( void );
+	bool selectList( int8_t listNr );
+	int16_t getEntries( void );
+	int8_t findTrack( const char *name );
+	// 32 bit FNV-1a of the lower case name, e.g. "horn.mp3". it doesn't change when tracks are added, unlike the track number.
+	static uint32_t hashName( const char *name );
+	int8_t findHash( uint32_t hash );		// -1 if the hash is unknown or shared
+	int8_t findName( const char *name );	// ignores the case like the sd card
+	int8_t findClip( const char *name );		// name without extension, ignores the case too
+	static audio_filetype_t filetypeOf( const char *name );	// by extension, a query of an url is ignored
 	char *getTrack( int8_t trackNr );
 	char *getActiveTrack( void );
 	void setActiveTrackNr( int8_t trackNr );
 	int8_t getActiveTrackNr(void);
 	audio_filetype_t getActiveFiletype(void);
 	audio_filetype_t getFiletype(int8_t trackNr);
+	bool isAnalyzed( int8_t trackNr );
+	int8_t getGain( int8_t trackNr );
+	void setGain( int8_t trackNr, int8_t gain );
+	bool getTrim( int8_t trackNr, uint32_t *head, uint32_t *start, uint32_t *end );
+	void setTrim( int8_t trackNr, uint32_t head, uint32_t start, uint32_t end );
+	bool getLoop( int8_t trackNr, uint32_t *start, uint32_t *end );
+	void setLoop( int8_t trackNr, uint32_t start, uint32_t end );
+	bool isTagged( int8_t trackNr );
+	char *getTitle( int8_t trackNr );
+	char *getArtist( int8_t trackNr );
+	uint32_t getDuration( int8_t trackNr );
+	// title and artist are copied, NULL or "" = unknown. set once, they don't change until the folder is read again.
+	void setTags( int8_t trackNr, const char *title, const char *artist, uint32_t duration );
 	int8_t getTracks( void );
 	void nextTrack( void );
 	void prevTrack( void );
 	void setRandomTrack( void );
+	// next and previous follow an incremental Fisher-Yates permutation, every track plays once per pass.
+	// the same seed gives the same order, 0 draws a random seed.
+	void setShuffle( bool on );
+	void setShuffleSeed( uint32_t seed );
+	int8_t peekTrack( void );		// the track shuffle plays next, -1 if unknown
+	bool enqueue( int8_t trackNr );
+	int8_t dequeue( void );
+	int8_t getQueueLength( void );
+	int8_t getQueuedTrack( int8_t pos );
+	void clearQueue( void );
+	// clips to say a number up to 999999: 0..19, 20, 30, .. 90, 100 and 1000, e.g. 7.wav.
+	// returns the number of clips or -1, if a clip is missing
+	int8_t spellNumber( uint32_t number, int8_t *tracks, int8_t maxTracks );
 };
 
 #endif /* MAIN_PLAYLIST_H_ */
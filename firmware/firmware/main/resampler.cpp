@@ -0,0 +1,389 @@
+/*
+ * resampler.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#include <esp_log.h>
+#include <audio_mem.h>
+#include <string.h>
+#include <math.h>
+
+#include "resampler.h"
+
+#define TAGRESAMPLER "::RESAMPLER"
+
+#define RESAMPLER_IN_FRAMES  256
+#define RESAMPLER_BUF_FRAMES (RESAMPLER_MAX_TAPS + RESAMPLER_IN_FRAMES)
+
+typedef struct {
+	int      out_rate;
+	int      taps;
+	int      src_rate;		// rate the filter is designed for, 0 = unknown
+	int      src_channels;
+	int      src_bits;
+	bool     bypass;
+	uint64_t pos;			// read position in history, Q32.32
+	uint64_t step;			// src_rate / out_rate * speed, Q32.32
+	uint64_t base_step;		// src_rate / out_rate, Q32.32
+	uint64_t target_step;	// end of the speed ramp
+	int64_t  step_inc;
+	int      ramp;			// output frames left to reach target_step
+	volatile int speed;		// requested, see resampler_set_speed
+	int      active_speed;	// speed of target_step
+	int      design_speed;	// speed the filter is designed for
+	int      frames;		// valid stereo frames in history
+	int      in_fill;		// bytes of an incomplete frame left in in
+	int16_t  *coef;			// [RESAMPLER_PHASES][taps], Q14
+	int16_t  *history;		// stereo frames
+	int16_t  *in;
+	int16_t  *out;
+	audio_element_handle_t source;
+} resampler_t;
+
+static inline int16_t saturate16( int32_t x ) {
+
+	if ( x > 32767 ) return 32767;
+	if ( x < -32768 ) return -32768;
+	return (int16_t) x;
+
+}
+
+// faster playback is downsampling, the filter follows in steps of 1/8 to keep redesigns rare
+static int resampler_design_speed( int speed ) {
+
+	if ( speed <= RESAMPLER_SPEED_NORMAL ) return RESAMPLER_SPEED_NORMAL;
+	return ( speed + 124 ) / 125 * 125;
+
+}
+
+static void resampler_design( resampler_t *rsp, int speed ) {
+
+	rsp->design_speed = resampler_design_speed( speed );
+
+	// cutoff relative to the input nyquist frequency, below the output nyquist frequency on downsampling
+	float fc = 0.9f;
+	float ratio = (float) rsp->out_rate * RESAMPLER_SPEED_NORMAL / ( (float) rsp->src_rate * rsp->design_speed );
+	if ( ratio < 1.0f ) {
+		fc = fc * ratio;
+	}
+
+	int half = rsp->taps / 2;
+
+	for ( int p = 0; p < RESAMPLER_PHASES; p++ ) {
+
+		float frac = (float) p / RESAMPLER_PHASES;
+		float h[RESAMPLER_MAX_TAPS];
+		float sum = 0;
+
+		// blackman windowed sinc
+		for ( int k = 0; k < rsp->taps; k++ ) {
+			float x = k - ( half - 1 ) - frac;
+			float t = x / half;
+			float w = ( fabsf( t ) >= 1.0f ) ? 0.0f : 0.42f + 0.5f * cosf( M_PI * t ) + 0.08f * cosf( 2 * M_PI * t );
+			float s = ( x == 0.0f ) ? fc : sinf( M_PI * fc * x ) / ( M_PI * x );
+			h[k] = s * w;
+			sum += h[k];
+		}
+
+		// unity gain on every phase
+		for ( int k = 0; k < rsp->taps; k++ ) {
+			rsp->coef[ p * rsp->taps + k ] = (int16_t) lrintf( h[k] / sum * 16384.0f );
+		}
+
+	}
+
+}
+
+static void resampler_reset( resampler_t *rsp ) {
+
+	// start with half a filter of silence, so the first output sample matches the first input sample
+	rsp->frames = rsp->taps / 2 - 1;
+	memset( rsp->history, 0, rsp->frames * 2 * sizeof(int16_t) );
+	rsp->pos = 0;
+	rsp->in_fill = 0;
+
+}
+
+static void resampler_update_source( resampler_t *rsp ) {
+
+	int rate = rsp->out_rate;
+	int channels = 2;
+	int bits = 16;
+
+	if ( rsp->source != NULL ) {
+		audio_element_info_t info = {};
+		audio_element_getinfo( rsp->source, &info );
+		rate = info.sample_rates;
+		channels = info.channels;
+		bits = info.bits;
+	}
+
+	if ( ( rate == rsp->src_rate ) && ( channels == rsp->src_channels ) && ( bits == rsp->src_bits ) ) {
+		return;
+	}
+
+	ESP_LOGI( TAGRESAMPLER, "source %dHz %dch %dbit -> %dHz", rate, channels, bits, rsp->out_rate );
+
+	rsp->src_rate = rate;
+	rsp->src_channels = channels;
+	rsp->src_bits = bits;
+	rsp->bypass = ( ( rate == rsp->out_rate ) && ( rsp->active_speed == RESAMPLER_SPEED_NORMAL ) ) || ( rate <= 0 ) || ( bits != 16 ) || ( channels < 1 ) || ( channels > 2 );
+
+	if ( rate > 0 ) {
+		rsp->base_step = ( (uint64_t) rate << 32 ) / rsp->out_rate;
+		rsp->step = rsp->target_step = rsp->base_step * rsp->active_speed / RESAMPLER_SPEED_NORMAL;
+		rsp->ramp = 0;
+	}
+
+	if ( !rsp->bypass ) {
+		resampler_design( rsp, rsp->active_speed );
+	}
+
+	resampler_reset( rsp );
+
+}
+
+// ramps to a new speed, the bypass keeps the last frames in history, so the filter continues seamlessly
+static void resampler_update_speed( resampler_t *rsp, int speed ) {
+
+	if ( rsp->bypass ) {
+		rsp->bypass = false;
+		rsp->pos = 0;
+		rsp->step = rsp->base_step;
+	}
+
+	if ( resampler_design_speed( speed ) != rsp->design_speed ) {
+		resampler_design( rsp, speed );
+	}
+
+	rsp->target_step = rsp->base_step * speed / RESAMPLER_SPEED_NORMAL;
+	rsp->step_inc = ( (int64_t) rsp->target_step - (int64_t) rsp->step ) / RESAMPLER_RAMP_FRAMES;
+	rsp->ramp = RESAMPLER_RAMP_FRAMES;
+	rsp->active_speed = speed;
+
+	ESP_LOGD( TAGRESAMPLER, "speed %d", speed );
+
+}
+
+static esp_err_t resampler_open( audio_element_handle_t self ) {
+
+	resampler_t *rsp = (resampler_t *) audio_element_getdata( self );
+
+	// force a source check on the first block
+	rsp->src_rate = 0;
+	rsp->active_speed = rsp->speed;
+	resampler_reset( rsp );
+
+	audio_element_set_music_info( self, rsp->out_rate, 2, 16 );
+
+	return ESP_OK;
+
+}
+
+static esp_err_t resampler_close( audio_element_handle_t self ) {
+
+	return ESP_OK;
+
+}
+
+static void resampler_free( resampler_t *rsp ) {
+
+	audio_free( rsp->coef );
+	audio_free( rsp->history );
+	audio_free( rsp->in );
+	audio_free( rsp->out );
+	audio_free( rsp );
+
+}
+
+static esp_err_t resampler_destroy( audio_element_handle_t self ) {
+
+	resampler_free( (resampler_t *) audio_element_getdata( self ) );
+
+	return ESP_OK;
+
+}
+
+static audio_element_err_t resampler_process( audio_element_handle_t self, char *in_buffer, int in_len ) {
+
+	resampler_t *rsp = (resampler_t *) audio_element_getdata( self );
+
+	resampler_update_source( rsp );
+
+	if ( ( rsp->src_bits != 16 ) || ( rsp->src_channels < 1 ) || ( rsp->src_channels > 2 ) ) {
+		// unsupported format, pass it through untouched
+		int r_size = audio_element_input( self, in_buffer, in_len );
+		if ( r_size <= 0 ) return (audio_element_err_t) r_size;
+		return audio_element_output( self, in_buffer, r_size );
+	}
+
+	int speed = rsp->speed;
+	if ( ( speed != rsp->active_speed ) && ( rsp->src_rate > 0 ) ) {
+		resampler_update_speed( rsp, speed );
+	}
+
+	int frame_size = rsp->src_channels * sizeof(int16_t);
+	int free_frames = RESAMPLER_BUF_FRAMES - rsp->frames;
+	if ( rsp->bypass ) free_frames = RESAMPLER_BUF_FRAMES;
+
+	int r_size = audio_element_input( self, (char *) rsp->in + rsp->in_fill, free_frames * frame_size - rsp->in_fill );
+	if ( r_size <= 0 ) {
+		return (audio_element_err_t) r_size;
+	}
+
+	int bytes = rsp->in_fill + r_size;
+	int n = bytes / frame_size;
+
+	// convert complete frames to stereo
+	int16_t *dest = rsp->bypass ? rsp->out : &rsp->history[ 2 * rsp->frames ];
+	if ( rsp->src_channels == 1 ) {
+		for ( int i = 0; i < n; i++ ) {
+			dest[ 2 * i ] = dest[ 2 * i + 1 ] = rsp->in[i];
+		}
+	} else {
+		memcpy( dest, rsp->in, n * 2 * sizeof(int16_t) );
+	}
+
+	rsp->in_fill = bytes - n * frame_size;
+	if ( rsp->in_fill > 0 ) {
+		memmove( rsp->in, (char *) rsp->in + n * frame_size, rsp->in_fill );
+	}
+
+	if ( rsp->bypass ) {
+		// the filter needs the last frames, if the speed changes
+		int keep = rsp->frames;
+		if ( n >= keep ) {
+			memcpy( rsp->history, &rsp->out[ 2 * ( n - keep ) ], keep * 2 * sizeof(int16_t) );
+		} else if ( n > 0 ) {
+			memmove( rsp->history, &rsp->history[ 2 * n ], ( keep - n ) * 2 * sizeof(int16_t) );
+			memcpy( &rsp->history[ 2 * ( keep - n ) ], rsp->out, n * 2 * sizeof(int16_t) );
+		}
+		if ( n > 0 ) {
+			int w_size = audio_element_output( self, (char *) rsp->out, n * 2 * sizeof(int16_t) );
+			if ( w_size < 0 ) return (audio_element_err_t) w_size;
+		}
+		return (audio_element_err_t) r_size;
+	}
+
+	rsp->frames += n;
+
+	// polyphase filter, one output frame per step
+	int out_frames = 0;
+	while ( true ) {
+
+		int i = (int) ( rsp->pos >> 32 );
+		if ( i + rsp->taps > rsp->frames ) break;
+
+		const int16_t *h = &rsp->coef[ ( (uint32_t) rsp->pos >> ( 32 - RESAMPLER_PHASE_BITS ) ) * rsp->taps ];
+		const int16_t *x = &rsp->history[ 2 * i ];
+		int32_t l = 0;
+		int32_t r = 0;
+
+		for ( int k = 0; k < rsp->taps; k++ ) {
+			l += x[ 2 * k ] * h[k];
+			r += x[ 2 * k + 1 ] * h[k];
+		}
+
+		rsp->out[ 2 * out_frames ]     = saturate16( ( l + 8192 ) >> 14 );
+		rsp->out[ 2 * out_frames + 1 ] = saturate16( ( r + 8192 ) >> 14 );
+		rsp->pos += rsp->step;
+
+		if ( rsp->ramp > 0 ) {
+			rsp->step += rsp->step_inc;
+			if ( --rsp->ramp == 0 ) rsp->step = rsp->target_step;
+		}
+
+		if ( ++out_frames == RESAMPLER_BUF_FRAMES ) {
+			int w_size = audio_element_output( self, (char *) rsp->out, out_frames * 2 * sizeof(int16_t) );
+			if ( w_size < 0 ) return (audio_element_err_t) w_size;
+			out_frames = 0;
+		}
+
+	}
+
+	if ( out_frames > 0 ) {
+		int w_size = audio_element_output( self, (char *) rsp->out, out_frames * 2 * sizeof(int16_t) );
+		if ( w_size < 0 ) return (audio_element_err_t) w_size;
+	}
+
+	// drop consumed frames
+	int used = (int) ( rsp->pos >> 32 );
+	if ( used > rsp->frames ) used = rsp->frames;
+	memmove( rsp->history, &rsp->history[ 2 * used ], ( rsp->frames - used ) * 2 * sizeof(int16_t) );
+	rsp->frames -= used;
+	rsp->pos -= (uint64_t) used << 32;
+
+	return (audio_element_err_t) r_size;
+
+}
+
+audio_element_handle_t resampler_init( resampler_cfg_t *config ) {
+
+	resampler_t *rsp = (resampler_t *) audio_calloc( 1, sizeof(resampler_t) );
+	AUDIO_MEM_CHECK( TAGRESAMPLER, rsp, return NULL );
+
+	switch ( config->quality ) {
+	case RESAMPLE_QUALITY_LOW:  rsp->taps = 8;  break;
+	case RESAMPLE_QUALITY_HIGH: rsp->taps = 32; break;
+	default:                    rsp->taps = 16; break;
+	}
+
+	rsp->out_rate = config->out_rate;
+	rsp->speed = RESAMPLER_SPEED_NORMAL;
+	rsp->coef    = (int16_t *) audio_calloc( RESAMPLER_PHASES * rsp->taps, sizeof(int16_t) );
+	rsp->history = (int16_t *) audio_calloc( RESAMPLER_BUF_FRAMES * 2, sizeof(int16_t) );
+	rsp->in      = (int16_t *) audio_calloc( RESAMPLER_BUF_FRAMES * 2, sizeof(int16_t) );
+	rsp->out     = (int16_t *) audio_calloc( RESAMPLER_BUF_FRAMES * 2, sizeof(int16_t) );
+
+	if ( ( rsp->coef == NULL ) || ( rsp->history == NULL ) || ( rsp->in == NULL ) || ( rsp->out == NULL ) ) {
+		ESP_LOGE( TAGRESAMPLER, "no memory for buffers" );
+		resampler_free( rsp );
+		return NULL;
+	}
+
+	audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+	cfg.open        = resampler_open;
+	cfg.close       = resampler_close;
+	cfg.process     = resampler_process;
+	cfg.destroy     = resampler_destroy;
+	cfg.tag         = "resampler";
+	cfg.task_stack  = config->task_stack;
+	cfg.task_prio   = config->task_prio;
+	cfg.task_core   = config->task_core;
+	cfg.out_rb_size = config->out_rb_size;
+
+	audio_element_handle_t el = audio_element_init( &cfg );
+	AUDIO_MEM_CHECK( TAGRESAMPLER, el, { resampler_free( rsp ); return NULL; } );
+	audio_element_setdata( el, rsp );
+
+	ESP_LOGI( TAGRESAMPLER, "output %dHz, %d taps x %d phases", rsp->out_rate, rsp->taps, RESAMPLER_PHASES );
+
+	return el;
+
+}
+
+void resampler_set_source( audio_element_handle_t self, audio_element_handle_t source ) {
+
+	resampler_t *rsp = (resampler_t *) audio_element_getdata( self );
+	rsp->source = source;
+
+}
+
+void resampler_set_speed( audio_element_handle_t self, int speed ) {
+
+	resampler_t *rsp = (resampler_t *) audio_element_getdata( self );
+
+	if ( speed < RESAMPLER_SPEED_MIN ) speed = RESAMPLER_SPEED_MIN;
+	if ( speed > RESAMPLER_SPEED_MAX ) speed = RESAMPLER_SPEED_MAX;
+
+	rsp->speed = speed;
+
+}
+
+int resampler_get_speed( audio_element_handle_t self ) {
+
+	return ( (resampler_t *) audio_element_getdata( self ) )->speed;
+
+}
@@ -0,0 +1,63 @@
+/*
+ * resampler.h
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#ifndef MAIN_RESAMPLER_H_
+#define MAIN_RESAMPLER_H_
+
+#include <audio_element.h>
+
+// polyphase fir resampler, converts decoded 16 bit pcm to a fixed output rate (always stereo).
+// the speed changes pitch and tempo together, e.g. an engine sound following the motor.
+
+#define RESAMPLER_PHASE_BITS  7
+#define RESAMPLER_PHASES      (1 << RESAMPLER_PHASE_BITS)
+#define RESAMPLER_MAX_TAPS    32
+
+#define RESAMPLER_SPEED_NORMAL 1000		// per mille
+#define RESAMPLER_SPEED_MIN    250
+#define RESAMPLER_SPEED_MAX    4000
+#define RESAMPLER_RAMP_FRAMES  256		// a new speed is reached within this many output frames
+
+#define RESAMPLER_TASK_STACK  (3 * 1024)
+#define RESAMPLER_TASK_PRIO   (5)
+#define RESAMPLER_TASK_CORE   (0)
+#define RESAMPLER_RINGBUFFER_SIZE (8 * 1024)
+
+typedef enum {
+	RESAMPLE_QUALITY_LOW    = 0,	// 8 taps per phase
+	RESAMPLE_QUALITY_MEDIUM = 1,	// 16 taps per phase
+	RESAMPLE_QUALITY_HIGH   = 2		// 32 taps per phase
+} resample_quality_t;
+
+typedef struct {
+	int                out_rate;
+	resample_quality_t quality;
+	int                out_rb_size;
+	int                task_stack;
+	int                task_prio;
+	int                task_core;
+} resampler_cfg_t;
+
+#define DEFAULT_RESAMPLER_CONFIG() {                \
+	.out_rate    = 44100,                           \
+	.quality     = RESAMPLE_QUALITY_MEDIUM,         \
+	.out_rb_size = RESAMPLER_RINGBUFFER_SIZE,       \
+	.task_stack  = RESAMPLER_TASK_STACK,            \
+	.task_prio   = RESAMPLER_TASK_PRIO,             \
+	.task_core   = RESAMPLER_TASK_CORE              \
+}
+
+audio_element_handle_t resampler_init( resampler_cfg_t *config );
+
+// element delivering the pcm stream, the source rate is taken from its music info
+void resampler_set_source( audio_element_handle_t self, audio_element_handle_t source );
+
+// per mille of the normal speed, applies to the next block, values out of range are limited
+void resampler_set_speed( audio_element_handle_t self, int speed );
+int resampler_get_speed( audio_element_handle_t self );
+
+#endif /* MAIN_RESAMPLER_H_ */
@@ -0,0 +1,211 @@
+/*
+ * scheduling.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scheduling.h"
+#include "memorypolicy.h"
+
+#define TAGSCHED "::SCHED"
+
+#define SCHED_STATS_MAX 32
+
+static const char *sched_names[SCHED_TASKS] = { "DECODER", "I2S", "READER", "HTTPD", "I2C", "WIFI" };
+
+static const sched_entry_t sched_profiles[][SCHED_TASKS] = {
+	// audio first: the sd reader refills before the decoder runs, i2s is never late. core 0 keeps wifi, lwip, httpd and i2c.
+	{ { 1, 10 }, { 1, 23 }, { 1, 12 }, { 0, 5 }, { 0, 8 }, { 0, 20 } },
+	// adf: element defaults, httpd floating, i2c at the priority of the main task
+	{ { 0, 5 }, { 0, 23 }, { 0, 4 }, { SCHED_ANY_CORE, 5 }, { 0, 1 }, { 0, 20 } }
+};
+
+static sched_profile_t profile = SCHED_PROFILE_AUDIO_FIRST;
+static sched_entry_t entries[SCHED_TASKS];
+static bool custom[SCHED_TASKS];
+static bool initialized = false;
+
+static void sched_init( void ) {
+
+	if ( !initialized ) {
+		memcpy( entries, sched_profiles[profile], sizeof(entries) );
+		initialized = true;
+	}
+
+}
+
+void sched_set_profile( sched_profile_t newProfile ) {
+
+	if ( ( newProfile != SCHED_PROFILE_AUDIO_FIRST ) && ( newProfile != SCHED_PROFILE_ADF ) ) {
+		ESP_LOGW( TAGSCHED, "unknown profile %d, using audio first", newProfile );
+		newProfile = SCHED_PROFILE_AUDIO_FIRST;
+	}
+
+	profile = newProfile;
+	sched_init();
+
+	// entries set in the config file win, regardless of the order of the lines
+	for ( int i = 0; i < SCHED_TASKS; i++ ) {
+		if ( !custom[i] ) entries[i] = sched_profiles[profile][i];
+	}
+
+}
+
+sched_profile_t sched_get_profile( void ) {
+
+	return profile;
+
+}
+
+bool sched_parse( const char *key, const char *value ) {
+
+	if ( strcmp( key, "SCHED_PROFILE" ) == 0 ) {
+		sched_set_profile( (sched_profile_t) atoi( value ) );
+		return true;
+	}
+
+	if ( strncmp( key, "SCHED_", 6 ) != 0 ) {
+		return false;
+	}
+
+	for ( int i = 0; i < SCHED_TASKS; i++ ) {
+
+		if ( strcmp( key + 6, sched_names[i] ) == 0 ) {
+
+			int core, prio;
+			if ( ( sscanf( value, "%d,%d", &core, &prio ) != 2 ) ||
+			     ( core < SCHED_ANY_CORE ) || ( core >= portNUM_PROCESSORS ) ||
+			     ( prio < 1 ) || ( prio >= configMAX_PRIORITIES ) ) {
+				ESP_LOGW( TAGSCHED, "%s=%s: expected core,priority", key, value );
+				return true;
+			}
+
+			sched_init();
+			entries[i].core = core;
+			entries[i].prio = prio;
+			custom[i] = true;
+			return true;
+		}
+
+	}
+
+	return false;
+
+}
+
+void sched_write( FILE *f ) {
+
+	sched_init();
+
+	fprintf( f, "SCHED_PROFILE=%d\n", profile );
+
+	for ( int i = 0; i < SCHED_TASKS; i++ ) {
+		if ( ( entries[i].core != sched_profiles[profile][i].core ) || ( entries[i].prio != sched_profiles[profile][i].prio ) ) {
+			fprintf( f, "SCHED_%s=%d,%d\n", sched_names[i], entries[i].core, entries[i].prio );
+		}
+	}
+
+}
+
+BaseType_t sched_core( sched_task_t task ) {
+
+	sched_init();
+
+	return ( entries[task].core == SCHED_ANY_CORE ) ? tskNO_AFFINITY : entries[task].core;
+
+}
+
+UBaseType_t sched_prio( sched_task_t task ) {
+
+	sched_init();
+
+	return entries[task].prio;
+
+}
+
+void sched_apply_wifi( void ) {
+
+	sched_init();
+
+	TaskHandle_t handle = xTaskGetHandle( "sys_evt" );
+	if ( handle == NULL ) {
+		ESP_LOGW( TAGSCHED, "event loop task not found" );
+		return;
+	}
+
+	// the affinity of a running task can't be changed
+	if ( ( entries[SCHED_WIFI].core != SCHED_ANY_CORE ) && ( entries[SCHED_WIFI].core != xTaskGetAffinity( handle ) ) ) {
+		ESP_LOGW( TAGSCHED, "wifi events stay on core %d", xTaskGetAffinity( handle ) );
+	}
+
+	vTaskPrioritySet( handle, sched_prio( SCHED_WIFI ) );
+
+}
+
+void sched_report( cJSON *tasks ) {
+
+#if ( configUSE_TRACE_FACILITY == 1 ) && ( configGENERATE_RUN_TIME_STATS == 1 )
+
+	// the counters wrap after about 71 minutes, so report the usage since the last call
+	static UBaseType_t last_number[SCHED_STATS_MAX];
+	static uint32_t    last_runtime[SCHED_STATS_MAX];
+	static int         last_count = 0;
+	static uint32_t    last_total = 0;
+
+	UBaseType_t count = uxTaskGetNumberOfTasks() + 2;
+	TaskStatus_t *status = (TaskStatus_t *) memory_alloc( MEMORY_BULK, count * sizeof(TaskStatus_t) );
+	if ( status == NULL ) {
+		ESP_LOGW( TAGSCHED, "no memory for task stats" );
+		return;
+	}
+
+	uint32_t total;
+	count = uxTaskGetSystemState( status, count, &total );
+
+	uint32_t elapsed = total - last_total;
+
+	for ( UBaseType_t i = 0; i < count; i++ ) {
+
+		uint32_t runtime = status[i].ulRunTimeCounter;
+		for ( int j = 0; j < last_count; j++ ) {
+			if ( last_number[j] == status[i].xTaskNumber ) {
+				runtime -= last_runtime[j];
+				break;
+			}
+		}
+
+		BaseType_t core = xTaskGetAffinity( status[i].xHandle );
+
+		cJSON *task = cJSON_CreateObject();
+		cJSON_AddStringToObject( task, "name", status[i].pcTaskName );
+		cJSON_AddNumberToObject( task, "core", ( core == tskNO_AFFINITY ) ? SCHED_ANY_CORE : core );
+		cJSON_AddNumberToObject( task, "prio", status[i].uxCurrentPriority );
+		// percent of one core
+		cJSON_AddNumberToObject( task, "cpu", ( elapsed > 0 ) ? ( runtime * 100.0 ) / elapsed : 0 );
+		cJSON_AddNumberToObject( task, "stack_free", status[i].usStackHighWaterMark );
+		cJSON_AddItemToArray( tasks, task );
+
+	}
+
+	last_count = ( count < SCHED_STATS_MAX ) ? (int) count : SCHED_STATS_MAX;
+	for ( int i = 0; i < last_count; i++ ) {
+		last_number[i] = status[i].xTaskNumber;
+		last_runtime[i] = status[i].ulRunTimeCounter;
+	}
+	last_total = total;
+
+	memory_free( status );
+
+#else
+	(void) tasks;
+	ESP_LOGW( TAGSCHED, "task stats need CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS" );
+#endif
+
+}
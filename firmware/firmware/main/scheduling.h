@@ -0,0 +1,58 @@
+/*
+ * scheduling.h
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#ifndef MAIN_SCHEDULING_H_
+#define MAIN_SCHEDULING_H_
+
+#include <stdio.h>
+#include <freertos/FreeRTOS.h>
+#include <cJSON.h>
+
+// core affinity and priority of the subsystems, set by a profile and single SCHED_<TASK>=core,prio lines in the config file.
+// core -1 lets the scheduler choose.
+
+typedef enum {
+	SCHED_DECODER = 0,		// decoder and resampler
+	SCHED_I2S,
+	SCHED_READER,
+	SCHED_HTTPD,
+	SCHED_I2C,
+	SCHED_WIFI,				// event loop task, wifi itself is pinned by sdkconfig
+	SCHED_TASKS
+} sched_task_t;
+
+typedef enum {
+	SCHED_PROFILE_AUDIO_FIRST = 0,	// audio on core 1, network and control on core 0
+	SCHED_PROFILE_ADF = 1			// adf and esp-idf defaults, everything on core 0
+} sched_profile_t;
+
+#define SCHED_ANY_CORE -1
+
+typedef struct {
+	int core;
+	int prio;
+} sched_entry_t;
+
+void sched_set_profile( sched_profile_t profile );
+sched_profile_t sched_get_profile( void );
+
+// handles SCHED_PROFILE and SCHED_<TASK> config lines, returns false on unknown keys
+bool sched_parse( const char *key, const char *value );
+
+// writes the profile and all entries which differ from it
+void sched_write( FILE *f );
+
+BaseType_t sched_core( sched_task_t task );
+UBaseType_t sched_prio( sched_task_t task );
+
+// sets the priority of the default event loop task, needs to be called after it has been created
+void sched_apply_wifi( void );
+
+// adds core, priority and cpu usage since the last call of each task
+void sched_report( cJSON *tasks );
+
+#endif /* MAIN_SCHEDULING_H_ */
@@ -0,0 +1,856 @@
+/*
+ * sd_reader.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#include <esp_log.h>
+#include <audio_mem.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <errno.h>
+
+#include "sd_reader.h"
+#include "memorypolicy.h"
+
+#define TAGSDREADER "::SDREADER"
+
+#define SD_READER_SHARED (-2)		// segment uses the fd of an earlier file
+
+typedef struct {
+	char     *path;		// NULL = free entry
+	int      fd;
+	int64_t  size;
+	uint32_t used;		// lru counter
+	bool     busy;		// opened by the element
+} sd_reader_file_t;
+
+typedef struct {
+	char    *path;
+	int     fd;
+	int     slot;		// cache entry, -1 = not cached
+	int64_t start;
+	int64_t end;
+} sd_reader_segment_t;
+
+typedef struct {
+	uint16_t format;	// 1 = pcm
+	uint16_t channels;
+	uint32_t rate;
+	uint16_t block_align;
+	uint16_t bits;
+} sd_reader_format_t;
+
+typedef struct {
+	int  fd;
+	int  slot;			// cache entry of fd, -1 = not cached
+	int  read_size;
+	char *buf;
+	int  cache_size;
+	uint32_t tick;
+	int64_t head;		// range, see sd_reader_set_range
+	int64_t start;
+	int64_t range_head;		// as set, a resume moves head and start for one file
+	int64_t range_start;
+	int64_t end;
+	sd_reader_segment_t segment[SD_READER_SEGMENTS_MAX];
+	int     segments;
+	int     current;		// segment being read, -1 = first file
+	int64_t data_end;		// audio end of the first file, if segments follow or it loops
+	int64_t seg_pos;
+	volatile bool loop;		// see sd_reader_set_loop
+	int64_t loop_start;
+	int64_t loop_end;
+	int     crossfade_ms;
+	int64_t loop_from;		// loop of the open file, seam 0 = no loop
+	int64_t seam;			// loop end minus crossfade
+	int     fade;			// crossfade in bytes
+	int     channels;
+	int16_t *fade_buf;		// audio behind the loop start, mixed into the end
+	sd_reader_file_t cache[SD_READER_CACHE_MAX];
+	SemaphoreHandle_t lock;		// cache is used by the element task and by preload
+} sd_reader_t;
+
+static int sd_reader_lookup( sd_reader_t *rdr, const char *path ) {
+
+	for ( int i = 0; i < rdr->cache_size; i++ ) {
+		if ( ( rdr->cache[i].path != NULL ) && ( strcmp( rdr->cache[i].path, path ) == 0 ) ) {
+			return i;
+		}
+	}
+
+	return -1;
+
+}
+
+// returns the cache entry of the new file or -1, if every entry is busy
+static int sd_reader_insert( sd_reader_t *rdr, const char *path, int fd, int64_t size ) {
+
+	int slot = -1;
+
+	for ( int i = 0; i < rdr->cache_size; i++ ) {
+		if ( rdr->cache[i].path == NULL ) {
+			slot = i;
+			break;
+		}
+		if ( !rdr->cache[i].busy && ( ( slot < 0 ) || ( rdr->cache[i].used < rdr->cache[slot].used ) ) ) {
+			slot = i;
+		}
+	}
+
+	if ( slot < 0 ) {
+		return -1;
+	}
+
+	sd_reader_file_t *file = &rdr->cache[slot];
+
+	if ( file->path != NULL ) {
+		ESP_LOGD( TAGSDREADER, "close %s", file->path );
+		close( file->fd );
+		audio_free( file->path );
+		file->path = NULL;
+	}
+
+	file->path = audio_strdup( path );
+	if ( file->path == NULL ) {
+		return -1;
+	}
+
+	file->fd = fd;
+	file->size = size;
+	file->used = ++rdr->tick;
+	file->busy = false;
+
+	return slot;
+
+}
+
+static int sd_reader_open_file( const char *path, int64_t *size ) {
+
+	struct stat st;
+
+	int fd = open( path, O_RDONLY );
+	if ( fd < 0 ) {
+		ESP_LOGE( TAGSDREADER, "could not open %s: %s", path, strerror( errno ) );
+		return -1;
+	}
+
+	*size = ( fstat( fd, &st ) == 0 ) ? st.st_size : 0;
+
+	return fd;
+
+}
+
+// opens a file or takes it from the cache, call it with the lock taken
+static int sd_reader_acquire( sd_reader_t *rdr, const char *path, int *slot, int64_t *size ) {
+
+	int fd;
+
+	*slot = sd_reader_lookup( rdr, path );
+
+	if ( ( *slot >= 0 ) && !rdr->cache[*slot].busy ) {
+
+		// already open, no directory search
+		fd = rdr->cache[*slot].fd;
+		*size = rdr->cache[*slot].size;
+		ESP_LOGD( TAGSDREADER, "%s is cached", path );
+
+	} else {
+
+		fd = sd_reader_open_file( path, size );
+		*slot = ( fd >= 0 ) ? sd_reader_insert( rdr, path, fd, *size ) : -1;
+
+	}
+
+	if ( *slot >= 0 ) {
+		rdr->cache[*slot].busy = true;
+	}
+
+	return fd;
+
+}
+
+static void sd_reader_drop( sd_reader_t *rdr, int fd, int slot ) {
+
+	if ( slot >= 0 ) {
+		// keep it open for the next time
+		rdr->cache[slot].busy = false;
+		rdr->cache[slot].used = ++rdr->tick;
+	} else if ( ( slot != SD_READER_SHARED ) && ( fd >= 0 ) ) {
+		close( fd );
+	}
+
+}
+
+// audio data of a wav file or an mp3 file without id3 tags, fmt is optional and stays empty for mp3
+static void sd_reader_data_range( int fd, int64_t size, int64_t *start, int64_t *end, sd_reader_format_t *fmt ) {
+
+	uint8_t hdr[16];
+
+	*start = 0;
+	*end = size;
+
+	if ( ( lseek( fd, 0, SEEK_SET ) < 0 ) || ( read( fd, hdr, 12 ) != 12 ) ) {
+		return;
+	}
+
+	if ( ( memcmp( hdr, "RIFF", 4 ) == 0 ) && ( memcmp( &hdr[8], "WAVE", 4 ) == 0 ) ) {
+
+		int64_t offset = 12;
+		for ( int i = 0; ( i < 16 ) && ( lseek( fd, offset, SEEK_SET ) >= 0 ) && ( read( fd, hdr, 8 ) == 8 ); i++ ) {
+			uint32_t chunk = hdr[4] | ( hdr[5] << 8 ) | ( hdr[6] << 16 ) | ( (uint32_t) hdr[7] << 24 );
+			if ( memcmp( hdr, "data", 4 ) == 0 ) {
+				*start = offset + 8;
+				if ( *start + chunk < size ) *end = *start + chunk;
+				return;
+			}
+			if ( ( memcmp( hdr, "fmt ", 4 ) == 0 ) && ( fmt != NULL ) && ( chunk >= 16 ) && ( read( fd, hdr, 16 ) == 16 ) ) {
+				fmt->format      = hdr[0] | ( hdr[1] << 8 );
+				fmt->channels    = hdr[2] | ( hdr[3] << 8 );
+				fmt->rate        = hdr[4] | ( hdr[5] << 8 ) | ( hdr[6] << 16 ) | ( (uint32_t) hdr[7] << 24 );
+				fmt->block_align = hdr[12] | ( hdr[13] << 8 );
+				fmt->bits        = hdr[14] | ( hdr[15] << 8 );
+			}
+			offset += 8 + chunk + ( chunk & 1 );
+		}
+
+	} else if ( memcmp( hdr, "ID3", 3 ) == 0 ) {
+
+		// syncsafe size, plus footer
+		*start = 10 + ( ( hdr[6] << 21 ) | ( hdr[7] << 14 ) | ( hdr[8] << 7 ) | hdr[9] );
+		if ( hdr[5] & 0x10 ) *start += 10;
+
+	}
+
+	// id3v1 tag at the end
+	if ( ( size > 128 ) && ( lseek( fd, size - 128, SEEK_SET ) >= 0 ) && ( read( fd, hdr, 3 ) == 3 ) && ( memcmp( hdr, "TAG", 3 ) == 0 ) ) {
+		*end = size - 128;
+	}
+
+}
+
+// bytes of all segments, their files are opened later
+static int64_t sd_reader_segments_size( sd_reader_t *rdr ) {
+
+	int64_t total = 0;
+	struct stat st;
+
+	for ( int i = 0; i < rdr->segments; i++ ) {
+
+		sd_reader_segment_t *seg = &rdr->segment[i];
+
+		seg->fd = -1;
+		seg->slot = -1;
+
+		if ( seg->end > 0 ) {
+			total += seg->end - seg->start;
+		} else if ( stat( seg->path, &st ) == 0 ) {
+			// headers included, the range is known after opening
+			total += st.st_size - seg->start;
+		}
+
+	}
+
+	return total;
+
+}
+
+// opens a segment file while the clip before plays, so switching doesn't wait for the directory search.
+// call it with the lock taken and before seeking in the clip before, the fd might be the same.
+static void sd_reader_segment_open( sd_reader_t *rdr, int i, const char *path ) {
+
+	if ( i >= rdr->segments ) return;
+
+	sd_reader_segment_t *seg = &rdr->segment[i];
+	sd_reader_segment_t *prev = ( i > 0 ) ? &rdr->segment[i - 1] : NULL;
+	int64_t size = 0;
+
+	if ( seg->fd >= 0 ) return;
+
+	// the same clip twice in a row: reads are sequential, so the fd can be shared
+	if ( ( prev != NULL ) && ( prev->fd >= 0 ) && ( strcmp( seg->path, prev->path ) == 0 ) ) {
+		seg->fd = prev->fd;
+		seg->slot = SD_READER_SHARED;
+	} else if ( ( rdr->fd >= 0 ) && ( strcmp( seg->path, path ) == 0 ) ) {
+		seg->fd = rdr->fd;
+		seg->slot = SD_READER_SHARED;
+	}
+
+	if ( seg->fd < 0 ) {
+		seg->fd = sd_reader_acquire( rdr, seg->path, &seg->slot, &size );
+	} else {
+		size = lseek( seg->fd, 0, SEEK_END );
+	}
+
+	if ( seg->fd < 0 ) {
+		ESP_LOGW( TAGSDREADER, "segment %s skipped", seg->path );
+		return;
+	}
+
+	if ( ( seg->start == 0 ) && ( seg->end == 0 ) ) {
+		sd_reader_data_range( seg->fd, size, &seg->start, &seg->end, NULL );
+	} else if ( ( seg->end == 0 ) || ( seg->end > size ) ) {
+		seg->end = size;
+	}
+
+}
+
+// call it with the lock taken
+static void sd_reader_segment_close( sd_reader_t *rdr, int i ) {
+
+	sd_reader_segment_t *seg = &rdr->segment[i];
+
+	if ( seg->fd < 0 ) return;
+
+	// the next clip shares the fd, it owns it from now on
+	if ( ( i + 1 < rdr->segments ) && ( rdr->segment[i + 1].fd == seg->fd ) && ( seg->slot != SD_READER_SHARED ) ) {
+		rdr->segment[i + 1].slot = seg->slot;
+	} else {
+		sd_reader_drop( rdr, seg->fd, seg->slot );
+	}
+
+	seg->fd = -1;
+	seg->slot = -1;
+
+}
+
+static void sd_reader_release( sd_reader_t *rdr ) {
+
+	xSemaphoreTake( rdr->lock, portMAX_DELAY );
+
+	sd_reader_drop( rdr, rdr->fd, rdr->slot );
+	rdr->fd = -1;
+	rdr->slot = -1;
+
+	for ( int i = 0; i < rdr->segments; i++ ) {
+		sd_reader_segment_close( rdr, i );
+	}
+
+	xSemaphoreGive( rdr->lock );
+
+}
+
+// loop region of the opened file in bytes, the crossfade is limited to half of the loop
+static void sd_reader_prepare_loop( sd_reader_t *rdr, int64_t size ) {
+
+	sd_reader_format_t fmt = {};
+	int64_t data_start, data_end;
+
+	sd_reader_data_range( rdr->fd, size, &data_start, &data_end, &fmt );
+
+	int64_t start = rdr->loop_start;
+	int64_t end = rdr->loop_end;
+
+	if ( start == 0 ) start = data_start;
+	if ( end == 0 ) end = ( rdr->end > 0 ) ? rdr->end : data_end;
+
+	// never into the header or the skipped silence
+	if ( start < data_start ) start = data_start;
+	if ( start < rdr->start ) start = rdr->start;
+	if ( end > data_end ) end = data_end;
+
+	int align = ( fmt.block_align > 0 ) ? fmt.block_align : 1;
+	if ( end - start < align ) {
+		ESP_LOGW( TAGSDREADER, "loop %lld..%lld too short", start, end );
+		return;
+	}
+
+	rdr->fade = 0;
+	if ( ( fmt.format == 1 ) && ( fmt.bits == 16 ) && ( fmt.channels > 0 ) && ( rdr->fade_buf != NULL ) ) {
+		int64_t fade = (int64_t) fmt.rate * rdr->crossfade_ms / 1000 * fmt.block_align;
+		if ( fade > SD_READER_FADE_MAX ) fade = SD_READER_FADE_MAX;
+		if ( fade > rdr->read_size ) fade = rdr->read_size;
+		if ( fade > ( end - start ) / 2 ) fade = ( end - start ) / 2;
+		rdr->fade = fade / fmt.block_align * fmt.block_align;
+		rdr->channels = fmt.channels;
+	}
+
+	rdr->loop_from = start;
+	rdr->seam = end - rdr->fade;
+
+	ESP_LOGD( TAGSDREADER, "loop %lld..%lld, crossfade %d bytes", start, end, rdr->fade );
+
+}
+
+static esp_err_t sd_reader_open( audio_element_handle_t self ) {
+
+	sd_reader_t *rdr = (sd_reader_t *) audio_element_getdata( self );
+	audio_element_info_t info = {};
+
+	if ( rdr->fd >= 0 ) {
+		ESP_LOGE( TAGSDREADER, "already opened" );
+		return ESP_FAIL;
+	}
+
+	char *path = audio_element_get_uri( self );
+	if ( path == NULL ) {
+		ESP_LOGE( TAGSDREADER, "no file set" );
+		return ESP_FAIL;
+	}
+
+	audio_element_getinfo( self, &info );
+
+	xSemaphoreTake( rdr->lock, portMAX_DELAY );
+	rdr->fd = sd_reader_acquire( rdr, path, &rdr->slot, &info.total_bytes );
+	xSemaphoreGive( rdr->lock );
+
+	if ( rdr->fd < 0 ) {
+		return ESP_FAIL;
+	}
+
+	rdr->current = -1;
+	rdr->data_end = 0;
+	if ( ( rdr->segments > 0 ) || rdr->loop ) {
+		// chunks behind the audio of the first file must not get between the clips or after the last pass of a loop
+		int64_t data_start;
+		sd_reader_data_range( rdr->fd, info.total_bytes, &data_start, &rdr->data_end, NULL );
+	}
+	if ( rdr->segments > 0 ) {
+		info.total_bytes += sd_reader_segments_size( rdr );
+		xSemaphoreTake( rdr->lock, portMAX_DELAY );
+		sd_reader_segment_open( rdr, 0, path );
+		xSemaphoreGive( rdr->lock );
+	}
+
+	rdr->seam = 0;
+	if ( rdr->loop && ( rdr->segments == 0 ) ) {
+		sd_reader_prepare_loop( rdr, info.total_bytes );
+	}
+
+	// a wav or adpcm track resumed in the middle: the decoder needs the header first, the audio continues at a block
+	if ( ( info.byte_pos > 0 ) && ( rdr->segments == 0 ) ) {
+		int64_t data_start, data_end;
+		sd_reader_format_t fmt = {};
+		sd_reader_data_range( rdr->fd, info.total_bytes, &data_start, &data_end, &fmt );
+		if ( ( fmt.block_align > 0 ) && ( info.byte_pos > data_start ) ) {
+			int64_t block = data_start + ( info.byte_pos - data_start ) / fmt.block_align * fmt.block_align;
+			rdr->head = data_start;
+			if ( block > rdr->start ) rdr->start = block;
+			info.byte_pos = 0;
+		}
+	}
+
+	// a trimmed track starts behind the silence, unless the header is read first
+	if ( ( rdr->start > 0 ) && ( info.byte_pos >= rdr->head ) && ( info.byte_pos < rdr->start ) ) {
+		info.byte_pos = rdr->start;
+	}
+
+	// cached files are positioned anywhere, the position might be set from outside to resume a track
+	if ( lseek( rdr->fd, info.byte_pos, SEEK_SET ) < 0 ) {
+		ESP_LOGE( TAGSDREADER, "could not seek to %lld", info.byte_pos );
+		sd_reader_release( rdr );
+		return ESP_FAIL;
+	}
+
+	ESP_LOGD( TAGSDREADER, "%s: %lld bytes, position %lld", path, info.total_bytes, info.byte_pos );
+
+	return audio_element_setinfo( self, &info );
+
+}
+
+// after a seek, shorten the first read to get back to sector boundaries
+static int sd_reader_align( int64_t pos, int len ) {
+
+	int misalign = pos % SD_READER_SECTOR_SIZE;
+	if ( ( misalign > 0 ) && ( len > SD_READER_SECTOR_SIZE ) ) {
+		len -= misalign;
+	}
+
+	return len;
+
+}
+
+// the bytes before the seam fade out while the ones behind the loop start fade in, reading continues behind them
+static int sd_reader_crossfade( audio_element_handle_t self, sd_reader_t *rdr, char *buffer ) {
+
+	int fade = rdr->fade;
+
+	if ( ( read( rdr->fd, buffer, fade ) != fade ) ||
+	     ( lseek( rdr->fd, rdr->loop_from, SEEK_SET ) < 0 ) ||
+	     ( read( rdr->fd, rdr->fade_buf, fade ) != fade ) ) {
+		ESP_LOGE( TAGSDREADER, "crossfade failed" );
+		return AEL_IO_FAIL;
+	}
+
+	int16_t *out = (int16_t *) buffer;
+	int frames = fade / ( 2 * rdr->channels );
+
+	for ( int f = 0, i = 0; f < frames; f++ ) {
+		int32_t g = ( f << 15 ) / frames;
+		for ( int c = 0; c < rdr->channels; c++, i++ ) {
+			out[i] = ( out[i] * ( 32768 - g ) + rdr->fade_buf[i] * g ) >> 15;
+		}
+	}
+
+	audio_element_set_byte_pos( self, rdr->loop_from + fade );
+
+	return fade;
+
+}
+
+static int sd_reader_read_segment( audio_element_handle_t self, sd_reader_t *rdr, char *buffer, int len ) {
+
+	while ( rdr->current < rdr->segments ) {
+
+		sd_reader_segment_t *seg = ( rdr->current >= 0 ) ? &rdr->segment[rdr->current] : NULL;
+
+		if ( ( seg == NULL ) || ( seg->fd < 0 ) || ( rdr->seg_pos >= seg->end ) ) {
+			// next clip, only the one playing and the one behind it are open
+			xSemaphoreTake( rdr->lock, portMAX_DELAY );
+			if ( rdr->current >= 0 ) sd_reader_segment_close( rdr, rdr->current );
+			rdr->current++;
+			sd_reader_segment_open( rdr, rdr->current, audio_element_get_uri( self ) );
+			sd_reader_segment_open( rdr, rdr->current + 1, audio_element_get_uri( self ) );
+			xSemaphoreGive( rdr->lock );
+			if ( rdr->current >= rdr->segments ) break;
+			seg = &rdr->segment[rdr->current];
+			if ( ( seg->fd < 0 ) || ( lseek( seg->fd, seg->start, SEEK_SET ) < 0 ) ) continue;
+			rdr->seg_pos = seg->start;
+			ESP_LOGD( TAGSDREADER, "segment %s", seg->path );
+		}
+
+		if ( len > seg->end - rdr->seg_pos ) {
+			len = seg->end - rdr->seg_pos;
+		}
+
+		int rlen = read( seg->fd, buffer, sd_reader_align( rdr->seg_pos, len ) );
+		if ( rlen < 0 ) {
+			return rlen;
+		}
+		if ( rlen == 0 ) {
+			// shorter than expected
+			seg->end = rdr->seg_pos;
+			continue;
+		}
+
+		rdr->seg_pos += rlen;
+		audio_element_update_byte_pos( self, rlen );
+		return rlen;
+
+	}
+
+	ESP_LOGD( TAGSDREADER, "end of segments" );
+	return AEL_IO_OK;
+
+}
+
+static audio_element_err_t sd_reader_read( audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context ) {
+
+	sd_reader_t *rdr = (sd_reader_t *) audio_element_getdata( self );
+	audio_element_info_t info = {};
+
+	if ( rdr->current >= 0 ) {
+		return (audio_element_err_t) sd_reader_read_segment( self, rdr, buffer, len );
+	}
+
+	audio_element_getinfo( self, &info );
+	int64_t pos = info.byte_pos;
+
+	if ( rdr->start > 0 ) {
+
+		// header done, continue behind the silence
+		if ( ( pos >= rdr->head ) && ( pos < rdr->start ) ) {
+			if ( lseek( rdr->fd, rdr->start, SEEK_SET ) < 0 ) {
+				ESP_LOGE( TAGSDREADER, "could not seek to %lld", rdr->start );
+				return AEL_IO_FAIL;
+			}
+			pos = rdr->start;
+			audio_element_set_byte_pos( self, pos );
+		}
+
+		if ( ( pos < rdr->head ) && ( len > rdr->head - pos ) ) {
+			len = rdr->head - pos;
+		}
+
+	}
+
+	if ( rdr->loop && ( rdr->seam > 0 ) ) {
+
+		// back to the loop start, the decoder keeps running
+		if ( pos >= rdr->seam ) {
+			if ( ( rdr->fade > 0 ) && ( pos == rdr->seam ) && ( len >= rdr->fade ) ) {
+				return (audio_element_err_t) sd_reader_crossfade( self, rdr, buffer );
+			}
+			if ( lseek( rdr->fd, rdr->loop_from, SEEK_SET ) < 0 ) {
+				ESP_LOGE( TAGSDREADER, "could not seek to %lld", rdr->loop_from );
+				return AEL_IO_FAIL;
+			}
+			pos = rdr->loop_from;
+			audio_element_set_byte_pos( self, pos );
+		}
+
+		if ( len > rdr->seam - pos ) {
+			len = rdr->seam - pos;
+		}
+
+	}
+
+	int64_t end = ( rdr->end > 0 ) ? rdr->end : rdr->data_end;
+	if ( end > 0 ) {
+		if ( pos >= end ) {
+			ESP_LOGD( TAGSDREADER, "end of range" );
+			return (audio_element_err_t) sd_reader_read_segment( self, rdr, buffer, len );
+		}
+		if ( len > end - pos ) {
+			len = end - pos;
+		}
+	}
+
+	int rlen = read( rdr->fd, buffer, sd_reader_align( pos, len ) );
+	if ( rlen < 0 ) {
+		ESP_LOGD( TAGSDREADER, "read failed, ret:%d", rlen );
+	} else if ( rlen == 0 ) {
+		ESP_LOGD( TAGSDREADER, "no more data" );
+		return (audio_element_err_t) sd_reader_read_segment( self, rdr, buffer, len );
+	} else {
+		audio_element_update_byte_pos( self, rlen );
+	}
+
+	return (audio_element_err_t) rlen;
+
+}
+
+static audio_element_err_t sd_reader_process( audio_element_handle_t self, char *in_buffer, int in_len ) {
+
+	sd_reader_t *rdr = (sd_reader_t *) audio_element_getdata( self );
+
+	// the element's own buffer is not dma capable, use ours
+	int r_size = audio_element_input( self, rdr->buf, rdr->read_size );
+	if ( r_size <= 0 ) {
+		return (audio_element_err_t) r_size;
+	}
+
+	return audio_element_output( self, rdr->buf, r_size );
+
+}
+
+static esp_err_t sd_reader_close( audio_element_handle_t self ) {
+
+	sd_reader_t *rdr = (sd_reader_t *) audio_element_getdata( self );
+
+	sd_reader_release( rdr );
+	rdr->head = rdr->range_head;
+	rdr->start = rdr->range_start;
+
+	// keep the position while paused, start over otherwise
+	if ( audio_element_get_state( self ) != AEL_STATE_PAUSED ) {
+		audio_element_report_pos( self );
+		audio_element_set_byte_pos( self, 0 );
+	}
+
+	return ESP_OK;
+
+}
+
+static void sd_reader_free_segments( sd_reader_t *rdr ) {
+
+	for ( int i = 0; i < rdr->segments; i++ ) {
+		memory_free( rdr->segment[i].path );
+	}
+
+	rdr->segments = 0;
+
+}
+
+static void sd_reader_free( sd_reader_t *rdr ) {
+
+	sd_reader_free_segments( rdr );
+
+	for ( int i = 0; i < rdr->cache_size; i++ ) {
+		if ( rdr->cache[i].path != NULL ) {
+			close( rdr->cache[i].fd );
+			audio_free( rdr->cache[i].path );
+		}
+	}
+
+	if ( rdr->lock != NULL ) vSemaphoreDelete( rdr->lock );
+	memory_free( rdr->fade_buf );
+	memory_free( rdr->buf );
+	audio_free( rdr );
+
+}
+
+static esp_err_t sd_reader_destroy( audio_element_handle_t self ) {
+
+	sd_reader_free( (sd_reader_t *) audio_element_getdata( self ) );
+
+	return ESP_OK;
+
+}
+
+audio_element_handle_t sd_reader_init( sd_reader_cfg_t *config ) {
+
+	sd_reader_t *rdr = (sd_reader_t *) audio_calloc( 1, sizeof(sd_reader_t) );
+	AUDIO_MEM_CHECK( TAGSDREADER, rdr, return NULL );
+
+	rdr->fd = -1;
+	rdr->slot = -1;
+	rdr->current = -1;
+
+	rdr->cache_size = config->cache_size;
+	if ( rdr->cache_size < 0 ) rdr->cache_size = 0;
+	if ( rdr->cache_size > SD_READER_CACHE_MAX ) rdr->cache_size = SD_READER_CACHE_MAX;
+
+	rdr->lock = xSemaphoreCreateMutex();
+	AUDIO_MEM_CHECK( TAGSDREADER, rdr->lock, { sd_reader_free( rdr ); return NULL; } );
+
+	// whole sectors only
+	rdr->read_size = ( config->read_size + SD_READER_SECTOR_SIZE - 1 ) & ~( SD_READER_SECTOR_SIZE - 1 );
+	if ( rdr->read_size < SD_READER_SECTOR_SIZE ) rdr->read_size = SD_READER_SECTOR_SIZE;
+
+	rdr->buf = (char *) memory_alloc( MEMORY_DMA, rdr->read_size );
+	if ( rdr->buf == NULL ) {
+		// works as well, but the sdmmc driver copies every sector
+		ESP_LOGW( TAGSDREADER, "no dma memory for %d bytes, using internal memory", rdr->read_size );
+		rdr->buf = (char *) memory_alloc( MEMORY_INTERNAL, rdr->read_size );
+	}
+	AUDIO_MEM_CHECK( TAGSDREADER, rdr->buf, { sd_reader_free( rdr ); return NULL; } );
+
+	audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+	cfg.open        = sd_reader_open;
+	cfg.close       = sd_reader_close;
+	cfg.process     = sd_reader_process;
+	cfg.destroy     = sd_reader_destroy;
+	cfg.read        = sd_reader_read;
+	cfg.tag         = "sd_reader";
+	cfg.task_stack  = config->task_stack;
+	cfg.task_prio   = config->task_prio;
+	cfg.task_core   = config->task_core;
+
+	// double buffering: the reader fills one read while the decoder consumes the other
+	cfg.out_rb_size = config->out_rb_size;
+	if ( cfg.out_rb_size < 2 * rdr->read_size ) cfg.out_rb_size = 2 * rdr->read_size;
+
+	audio_element_handle_t el = audio_element_init( &cfg );
+	AUDIO_MEM_CHECK( TAGSDREADER, el, { sd_reader_free( rdr ); return NULL; } );
+	audio_element_setdata( el, rdr );
+
+	ESP_LOGI( TAGSDREADER, "read size %d bytes, read ahead %d bytes, %d cached files", rdr->read_size, cfg.out_rb_size, rdr->cache_size );
+
+	return el;
+
+}
+
+esp_err_t sd_reader_preload( audio_element_handle_t self, const char *path ) {
+
+	sd_reader_t *rdr = (sd_reader_t *) audio_element_getdata( self );
+	esp_err_t ret = ESP_OK;
+	int64_t size;
+
+	if ( rdr->cache_size == 0 ) {
+		return ESP_FAIL;
+	}
+
+	xSemaphoreTake( rdr->lock, portMAX_DELAY );
+
+	int slot = sd_reader_lookup( rdr, path );
+
+	if ( slot >= 0 ) {
+		rdr->cache[slot].used = ++rdr->tick;
+	} else {
+		int fd = sd_reader_open_file( path, &size );
+		if ( ( fd < 0 ) || ( sd_reader_insert( rdr, path, fd, size ) < 0 ) ) {
+			if ( fd >= 0 ) close( fd );
+			ret = ESP_FAIL;
+		} else {
+			ESP_LOGD( TAGSDREADER, "preloaded %s", path );
+		}
+	}
+
+	xSemaphoreGive( rdr->lock );
+
+	return ret;
+
+}
+
+void sd_reader_flush( audio_element_handle_t self ) {
+
+	sd_reader_t *rdr = (sd_reader_t *) audio_element_getdata( self );
+
+	xSemaphoreTake( rdr->lock, portMAX_DELAY );
+
+	for ( int i = 0; i < rdr->cache_size; i++ ) {
+		if ( ( rdr->cache[i].path != NULL ) && !rdr->cache[i].busy ) {
+			close( rdr->cache[i].fd );
+			audio_free( rdr->cache[i].path );
+			rdr->cache[i].path = NULL;
+		}
+	}
+
+	xSemaphoreGive( rdr->lock );
+
+}
+
+void sd_reader_set_range( audio_element_handle_t self, int64_t head, int64_t start, int64_t end ) {
+
+	sd_reader_t *rdr = (sd_reader_t *) audio_element_getdata( self );
+
+	// a header behind the start makes no sense
+	if ( head > start ) head = 0;
+
+	rdr->head = rdr->range_head = head;
+	rdr->start = rdr->range_start = start;
+	rdr->end = end;
+
+}
+
+esp_err_t sd_reader_add_segment( audio_element_handle_t self, const char *path, int64_t start, int64_t end ) {
+
+	sd_reader_t *rdr = (sd_reader_t *) audio_element_getdata( self );
+
+	if ( rdr->segments >= SD_READER_SEGMENTS_MAX ) {
+		ESP_LOGW( TAGSDREADER, "too many segments, %s dropped", path );
+		return ESP_FAIL;
+	}
+
+	sd_reader_segment_t *seg = &rdr->segment[rdr->segments];
+
+	seg->path = memory_strdup( MEMORY_BULK, path );
+	if ( seg->path == NULL ) {
+		return ESP_FAIL;
+	}
+
+	seg->fd = -1;
+	seg->slot = -1;
+	seg->start = start;
+	seg->end = end;
+	rdr->segments++;
+
+	return ESP_OK;
+
+}
+
+void sd_reader_clear_segments( audio_element_handle_t self ) {
+
+	sd_reader_free_segments( (sd_reader_t *) audio_element_getdata( self ) );
+
+}
+
+void sd_reader_set_loop( audio_element_handle_t self, int64_t start, int64_t end, int crossfade_ms ) {
+
+	sd_reader_t *rdr = (sd_reader_t *) audio_element_getdata( self );
+
+	if ( ( crossfade_ms > 0 ) && ( rdr->fade_buf == NULL ) ) {
+		rdr->fade_buf = (int16_t *) memory_alloc( MEMORY_BULK, SD_READER_FADE_MAX );
+		if ( rdr->fade_buf == NULL ) {
+			ESP_LOGW( TAGSDREADER, "no memory for the crossfade, loops will jump" );
+		}
+	}
+
+	rdr->loop_start = start;
+	rdr->loop_end = end;
+	rdr->crossfade_ms = crossfade_ms;
+	rdr->loop = true;
+
+}
+
+void sd_reader_stop_loop( audio_element_handle_t self ) {
+
+	( (sd_reader_t *) audio_element_getdata( self ) )->loop = false;
+
+}
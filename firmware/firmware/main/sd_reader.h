@@ -0,0 +1,81 @@
+/*
+ * sd_reader.h
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#ifndef MAIN_SD_READER_H_
+#define MAIN_SD_READER_H_
+
+#include <audio_element.h>
+
+// file reader for the sd card, replaces fatfs_stream for playback.
+// reads whole sectors into a dma capable buffer, so fatfs hands them to the sdmmc driver without bounce copies.
+// the output ringbuffer is the read ahead, it holds at least two reads (double buffering).
+// recently played files stay open, so playing them again skips the fat directory search.
+// a range skips silence at the beginning and at the end of a track.
+// segments are further files read behind the first one without their headers, so clips join gaplessly.
+// a loop jumps back inside the file instead of ending it, so the decoder never sees a gap.
+
+#define SD_READER_SECTOR_SIZE     512
+
+#define SD_READER_READ_SIZE       (16 * 1024)
+#define SD_READER_READ_AHEAD      (32 * 1024)
+#define SD_READER_CACHE_MAX       4
+#define SD_READER_CACHE_SIZE      2
+#define SD_READER_SEGMENTS_MAX    16
+#define SD_READER_FADE_MAX        (8 * 1024)
+
+#define SD_READER_TASK_STACK      (3 * 1024)
+#define SD_READER_TASK_CORE       (0)
+#define SD_READER_TASK_PRIO       (4)
+
+typedef struct {
+	int read_size;		// bytes per read, rounded to whole sectors
+	int out_rb_size;	// read ahead
+	int cache_size;		// files kept open, 0..SD_READER_CACHE_MAX
+	int task_stack;
+	int task_core;
+	int task_prio;
+} sd_reader_cfg_t;
+
+#define SD_READER_CFG_DEFAULT() {                   \
+	.read_size   = SD_READER_READ_SIZE,             \
+	.out_rb_size = SD_READER_READ_AHEAD,            \
+	.cache_size  = SD_READER_CACHE_SIZE,            \
+	.task_stack  = SD_READER_TASK_STACK,            \
+	.task_core   = SD_READER_TASK_CORE,             \
+	.task_prio   = SD_READER_TASK_PRIO              \
+}
+
+audio_element_handle_t sd_reader_init( sd_reader_cfg_t *config );
+
+// opens a file in advance, e.g. the next track of the queue
+esp_err_t sd_reader_preload( audio_element_handle_t self, const char *path );
+
+// closes all cached files which are not in use
+void sd_reader_flush( audio_element_handle_t self );
+
+// reads [0, head) followed by [start, end) of the next file, e.g. the wav header and the audio without silence.
+// start 0 reads the whole file, end 0 reads up to the end of the file.
+void sd_reader_set_range( audio_element_handle_t self, int64_t head, int64_t start, int64_t end );
+
+// a byte position set before the next file opens resumes it there. wav and adpcm get their header first
+// and continue at the block the position is in, mp3 continues right there and resyncs.
+
+// appends [start, end) of a file behind the current one, all files need the same format.
+// start 0 and end 0 skip the wav header and id3 tags. segment files are opened one clip ahead and closed
+// behind it, so a phrase of any length keeps at most two of them open besides the first file.
+esp_err_t sd_reader_add_segment( audio_element_handle_t self, const char *path, int64_t start, int64_t end );
+
+void sd_reader_clear_segments( audio_element_handle_t self );
+
+// repeats [start, end) of the next file until the loop is stopped, start 0 and end 0 loop the whole range.
+// 16 bit pcm wav crossfades the last crossfade_ms before end with the first ones behind start, the other formats just jump.
+void sd_reader_set_loop( audio_element_handle_t self, int64_t start, int64_t end, int crossfade_ms );
+
+// the running file plays to its end after the next pass
+void sd_reader_stop_loop( audio_element_handle_t self );
+
+#endif /* MAIN_SD_READER_H_ */
@@ -0,0 +1,142 @@
+/*
+ * storage.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_vfs_fat.h>
+#include <driver/sdmmc_host.h>
+#include <sdmmc_cmd.h>
+#include <board.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "storage.h"
+#include "memorypolicy.h"
+
+#define TAGSTORAGE "::STORAGE"
+
+static storage_info_t info = { .width = 1, .freq_khz = SDMMC_FREQ_DEFAULT, .read_mbps = 0, .read_size = 0 };
+
+static sdmmc_card_t *card = NULL;
+static bool board_mounted = false;
+
+static esp_err_t storage_sdmmc_mount( int width, bool highspeed ) {
+
+	sdmmc_host_t host = SDMMC_HOST_DEFAULT();
+	host.max_freq_khz = highspeed ? SDMMC_FREQ_HIGHSPEED : SDMMC_FREQ_DEFAULT;
+
+	sdmmc_slot_config_t slot = SDMMC_SLOT_CONFIG_DEFAULT();
+	slot.width = width;
+	slot.flags |= SDMMC_SLOT_FLAG_INTERNAL_PULLUP;
+
+	esp_vfs_fat_sdmmc_mount_config_t mount_cfg = {};
+	mount_cfg.format_if_mount_failed = false;
+	mount_cfg.max_files = STORAGE_MAX_FILES;
+
+	// mounting reads the boot sector, so broken data lines fail here already
+	esp_err_t err = esp_vfs_fat_sdmmc_mount( STORAGE_ROOT, &host, &slot, &mount_cfg, &card );
+	if ( err != ESP_OK ) {
+		ESP_LOGW( TAGSTORAGE, "%d bit mode at %dkHz failed: %s", width, host.max_freq_khz, esp_err_to_name( err ) );
+		card = NULL;
+		return err;
+	}
+
+	info.width = width;
+	info.freq_khz = host.max_freq_khz;
+
+	ESP_LOGI( TAGSTORAGE, "sd card mounted, %d bit mode at %dkHz", info.width, info.freq_khz );
+
+	return ESP_OK;
+
+}
+
+esp_err_t storage_mount( esp_periph_set_handle_t set, int width, bool highspeed ) {
+
+	if ( board_mounted ) {
+		ESP_LOGW( TAGSTORAGE, "mounted by the board support, keeping 1 line mode" );
+		return ESP_OK;
+	}
+
+	// remount, e.g. after the config file has been read
+	if ( card != NULL ) {
+		if ( ( width == info.width ) && ( ( highspeed ? SDMMC_FREQ_HIGHSPEED : SDMMC_FREQ_DEFAULT ) == info.freq_khz ) ) {
+			return ESP_OK;
+		}
+		esp_vfs_fat_sdcard_unmount( STORAGE_ROOT, card );
+		card = NULL;
+	}
+
+	if ( ( width == 4 ) && ( storage_sdmmc_mount( 4, highspeed ) == ESP_OK ) ) {
+		return ESP_OK;
+	}
+
+	if ( highspeed && ( storage_sdmmc_mount( 1, true ) == ESP_OK ) ) {
+		return ESP_OK;
+	}
+
+	if ( ( width == 4 ) || highspeed ) {
+		ESP_LOGW( TAGSTORAGE, "falling back to 1 line mode" );
+	}
+
+	if ( storage_sdmmc_mount( 1, false ) == ESP_OK ) {
+		return ESP_OK;
+	}
+
+	// last resort: the board support package
+	info.width = 1;
+	info.freq_khz = SDMMC_FREQ_DEFAULT;
+
+	esp_err_t err = audio_board_sdcard_init( set, SD_MODE_1_LINE );
+	board_mounted = ( err == ESP_OK );
+
+	return err;
+
+}
+
+float storage_benchmark( const char *path, int read_size, int max_bytes ) {
+
+	char *buf = (char *) memory_alloc( MEMORY_DMA, read_size );
+	if ( buf == NULL ) {
+		ESP_LOGW( TAGSTORAGE, "benchmark: no dma memory for %d bytes", read_size );
+		return 0;
+	}
+
+	int fd = open( path, O_RDONLY );
+	if ( fd < 0 ) {
+		ESP_LOGW( TAGSTORAGE, "benchmark: could not open %s", path );
+		memory_free( buf );
+		return 0;
+	}
+
+	int total = 0;
+	int n;
+	int64_t start = esp_timer_get_time();
+
+	while ( ( total < max_bytes ) && ( ( n = read( fd, buf, read_size ) ) > 0 ) ) {
+		total += n;
+	}
+
+	int64_t duration = esp_timer_get_time() - start;
+
+	close( fd );
+	memory_free( buf );
+
+	// bytes per microsecond equals MB/s
+	info.read_mbps = ( duration > 0 ) ? (float) total / duration : 0;
+	info.read_size = read_size;
+
+	ESP_LOGI( TAGSTORAGE, "benchmark: %d bytes in %lldus, %.2f MB/s", total, duration, info.read_mbps );
+
+	return info.read_mbps;
+
+}
+
+storage_info_t *storage_get_info( void ) {
+
+	return &info;
+
+}
@@ -0,0 +1,33 @@
+/*
+ * storage.h
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#ifndef MAIN_STORAGE_H_
+#define MAIN_STORAGE_H_
+
+#include <esp_peripherals.h>
+
+#define STORAGE_ROOT            "/sdcard"
+#define STORAGE_MAX_FILES       10	// includes the files kept open by sd_reader
+#define STORAGE_BENCHMARK_BYTES (512 * 1024)
+
+typedef struct {
+	int   width;		// sd bus width in bits
+	int   freq_khz;		// sd bus clock
+	float read_mbps;	// result of the last benchmark, 0 = not measured
+	int   read_size;	// bytes per read of the last benchmark
+} storage_info_t;
+
+// mounts the sd card with 4 bit bus and/or high speed clock if requested, falls back to 1 line mode.
+// calling it again remounts the card with the new settings.
+esp_err_t storage_mount( esp_periph_set_handle_t set, int width, bool highspeed );
+
+// reads up to max_bytes of a file and returns MB/s
+float storage_benchmark( const char *path, int read_size, int max_bytes );
+
+storage_info_t *storage_get_info( void );
+
+#endif /* MAIN_STORAGE_H_ */
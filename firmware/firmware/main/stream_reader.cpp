@@ -0,0 +1,323 @@
+/*
+ * stream_reader.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#include <esp_log.h>
+#include <audio_mem.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <string.h>
+
+#include "stream_reader.h"
+#include "memorypolicy.h"
+
+#define TAGSTREAM "::STREAM"
+
+#define STREAM_READER_MIN_BUFFER  (4 * 1024)
+#define STREAM_READER_POLL_MS     100		// the element task checks for stop at least this often
+#define STREAM_READER_HEADER      44
+#define STREAM_READER_DATA_SIZE   0x7FFFFF00	// size of a pcm stream, unknown
+
+typedef struct {
+	char     *ring;
+	uint32_t size;			// power of two, so the counters may wrap
+	uint32_t written;		// bytes ever written by the sender
+	uint32_t consumed;		// bytes ever read by the element
+	uint32_t prefill;		// fill level to start and to recover from an underrun
+	volatile bool active;	// between begin and close
+	volatile bool finished;
+	bool     buffering;
+	int      stalled;		// ms without data
+	uint8_t  header[STREAM_READER_HEADER];
+	int      header_len;
+	int      header_pos;
+	uint32_t received;
+	uint32_t underruns;
+	SemaphoreHandle_t data;		// given by the sender
+	SemaphoreHandle_t space;	// given by the element
+} stream_reader_t;
+
+// written and consumed have one writer each, the other side only reads them
+static inline uint32_t stream_reader_load( uint32_t *counter ) {
+
+	return __atomic_load_n( counter, __ATOMIC_ACQUIRE );
+
+}
+
+static inline void stream_reader_store( uint32_t *counter, uint32_t value ) {
+
+	__atomic_store_n( counter, value, __ATOMIC_RELEASE );
+
+}
+
+static void stream_reader_put( uint8_t *p, uint32_t value, int bytes ) {
+
+	for ( int i = 0; i < bytes; i++ ) {
+		p[i] = ( value >> ( 8 * i ) ) & 0xFF;
+	}
+
+}
+
+static void stream_reader_wav_header( stream_reader_t *rdr, int rate, int channels ) {
+
+	uint8_t *h = rdr->header;
+
+	memcpy( h, "RIFF", 4 );
+	stream_reader_put( h + 4, STREAM_READER_DATA_SIZE + 36, 4 );
+	memcpy( h + 8, "WAVEfmt ", 8 );
+	stream_reader_put( h + 16, 16, 4 );
+	stream_reader_put( h + 20, 1, 2 );					// pcm
+	stream_reader_put( h + 22, channels, 2 );
+	stream_reader_put( h + 24, rate, 4 );
+	stream_reader_put( h + 28, rate * channels * 2, 4 );
+	stream_reader_put( h + 32, channels * 2, 2 );
+	stream_reader_put( h + 34, 16, 2 );
+	memcpy( h + 36, "data", 4 );
+	stream_reader_put( h + 40, STREAM_READER_DATA_SIZE, 4 );
+
+	rdr->header_len = STREAM_READER_HEADER;
+
+}
+
+static esp_err_t stream_reader_open( audio_element_handle_t self ) {
+
+	stream_reader_t *rdr = (stream_reader_t *) audio_element_getdata( self );
+
+	if ( !rdr->active ) {
+		ESP_LOGE( TAGSTREAM, "no stream" );
+		return ESP_FAIL;
+	}
+
+	return ESP_OK;
+
+}
+
+static audio_element_err_t stream_reader_read( audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context ) {
+
+	stream_reader_t *rdr = (stream_reader_t *) audio_element_getdata( self );
+
+	// the wav header of raw pcm goes first
+	if ( rdr->header_pos < rdr->header_len ) {
+		int n = rdr->header_len - rdr->header_pos;
+		if ( n > len ) n = len;
+		memcpy( buffer, rdr->header + rdr->header_pos, n );
+		rdr->header_pos += n;
+		audio_element_update_byte_pos( self, n );
+		return (audio_element_err_t) n;
+	}
+
+	// finished first, the data written before it is counted then
+	bool finished = rdr->finished;
+	uint32_t fill = stream_reader_load( &rdr->written ) - rdr->consumed;
+
+	if ( rdr->buffering && ( ( fill >= rdr->prefill ) || finished ) ) {
+		ESP_LOGD( TAGSTREAM, "playing, %lu bytes buffered", (unsigned long) fill );
+		rdr->buffering = false;
+	}
+
+	if ( !rdr->buffering && ( fill == 0 ) ) {
+		if ( finished ) {
+			ESP_LOGI( TAGSTREAM, "done, %lu bytes, %lu underruns", (unsigned long) rdr->received, (unsigned long) rdr->underruns );
+			return AEL_IO_DONE;
+		}
+		rdr->underruns++;
+		rdr->buffering = true;
+		ESP_LOGW( TAGSTREAM, "underrun %lu, buffering", (unsigned long) rdr->underruns );
+	}
+
+	if ( rdr->buffering ) {
+		// returns to the element task regularly, so the pipeline can be stopped
+		if ( xSemaphoreTake( rdr->data, pdMS_TO_TICKS( STREAM_READER_POLL_MS ) ) == pdTRUE ) {
+			rdr->stalled = 0;
+		} else if ( ( rdr->stalled += STREAM_READER_POLL_MS ) >= STREAM_READER_TIMEOUT_MS ) {
+			ESP_LOGW( TAGSTREAM, "no data for %dms, stream ends", rdr->stalled );
+			return AEL_IO_DONE;
+		}
+		return AEL_IO_TIMEOUT;
+	}
+
+	rdr->stalled = 0;
+
+	uint32_t n = ( fill < (uint32_t) len ) ? fill : len;
+	uint32_t pos = rdr->consumed & ( rdr->size - 1 );
+	uint32_t first = ( n < rdr->size - pos ) ? n : rdr->size - pos;
+
+	memcpy( buffer, rdr->ring + pos, first );
+	memcpy( buffer + first, rdr->ring, n - first );
+
+	stream_reader_store( &rdr->consumed, rdr->consumed + n );
+	xSemaphoreGive( rdr->space );
+
+	audio_element_update_byte_pos( self, n );
+
+	return (audio_element_err_t) n;
+
+}
+
+static audio_element_err_t stream_reader_process( audio_element_handle_t self, char *in_buffer, int in_len ) {
+
+	int r_size = audio_element_input( self, in_buffer, in_len );
+	if ( r_size <= 0 ) {
+		return (audio_element_err_t) r_size;
+	}
+
+	return audio_element_output( self, in_buffer, r_size );
+
+}
+
+static esp_err_t stream_reader_close( audio_element_handle_t self ) {
+
+	stream_reader_t *rdr = (stream_reader_t *) audio_element_getdata( self );
+
+	// while paused the sender just waits for space
+	if ( audio_element_get_state( self ) != AEL_STATE_PAUSED ) {
+		rdr->active = false;
+		xSemaphoreGive( rdr->space );
+		audio_element_set_byte_pos( self, 0 );
+	}
+
+	return ESP_OK;
+
+}
+
+static void stream_reader_free( stream_reader_t *rdr ) {
+
+	if ( rdr->data != NULL ) vSemaphoreDelete( rdr->data );
+	if ( rdr->space != NULL ) vSemaphoreDelete( rdr->space );
+	memory_free( rdr->ring );
+	audio_free( rdr );
+
+}
+
+static esp_err_t stream_reader_destroy( audio_element_handle_t self ) {
+
+	stream_reader_free( (stream_reader_t *) audio_element_getdata( self ) );
+
+	return ESP_OK;
+
+}
+
+audio_element_handle_t stream_reader_init( stream_reader_cfg_t *config ) {
+
+	stream_reader_t *rdr = (stream_reader_t *) audio_calloc( 1, sizeof(stream_reader_t) );
+	AUDIO_MEM_CHECK( TAGSTREAM, rdr, return NULL );
+
+	rdr->size = STREAM_READER_MIN_BUFFER;
+	while ( rdr->size < (uint32_t) config->buffer_size ) rdr->size <<= 1;
+	rdr->prefill = rdr->size / 2;
+
+	rdr->ring = (char *) memory_alloc( MEMORY_BULK, rdr->size );
+	rdr->data = xSemaphoreCreateBinary();
+	rdr->space = xSemaphoreCreateBinary();
+
+	if ( ( rdr->ring == NULL ) || ( rdr->data == NULL ) || ( rdr->space == NULL ) ) {
+		ESP_LOGE( TAGSTREAM, "no memory for %lu bytes", (unsigned long) rdr->size );
+		stream_reader_free( rdr );
+		return NULL;
+	}
+
+	audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+	cfg.open        = stream_reader_open;
+	cfg.close       = stream_reader_close;
+	cfg.process     = stream_reader_process;
+	cfg.destroy     = stream_reader_destroy;
+	cfg.read        = stream_reader_read;
+	cfg.tag         = "stream_reader";
+	cfg.task_stack  = config->task_stack;
+	cfg.task_prio   = config->task_prio;
+	cfg.task_core   = config->task_core;
+	cfg.out_rb_size = config->out_rb_size;
+
+	audio_element_handle_t el = audio_element_init( &cfg );
+	AUDIO_MEM_CHECK( TAGSTREAM, el, { stream_reader_free( rdr ); return NULL; } );
+	audio_element_setdata( el, rdr );
+
+	ESP_LOGI( TAGSTREAM, "jitter buffer %lu bytes", (unsigned long) rdr->size );
+
+	return el;
+
+}
+
+void stream_reader_begin( audio_element_handle_t self, int rate, int channels ) {
+
+	stream_reader_t *rdr = (stream_reader_t *) audio_element_getdata( self );
+
+	rdr->written = 0;
+	rdr->consumed = 0;
+	rdr->finished = false;
+	rdr->buffering = true;
+	rdr->stalled = 0;
+	rdr->received = 0;
+	rdr->underruns = 0;
+	rdr->header_len = 0;
+	rdr->header_pos = 0;
+
+	if ( ( rate > 0 ) && ( channels > 0 ) ) {
+		stream_reader_wav_header( rdr, rate, channels );
+	}
+
+	// signals of the last stream
+	xSemaphoreTake( rdr->data, 0 );
+	xSemaphoreTake( rdr->space, 0 );
+
+	rdr->active = true;
+
+}
+
+int stream_reader_span( audio_element_handle_t self, char **span, TickType_t ticks ) {
+
+	stream_reader_t *rdr = (stream_reader_t *) audio_element_getdata( self );
+
+	while ( rdr->active ) {
+
+		uint32_t free = rdr->size - ( rdr->written - stream_reader_load( &rdr->consumed ) );
+
+		if ( free > 0 ) {
+			uint32_t pos = rdr->written & ( rdr->size - 1 );
+			*span = rdr->ring + pos;
+			return ( free < rdr->size - pos ) ? free : rdr->size - pos;
+		}
+
+		if ( xSemaphoreTake( rdr->space, ticks ) != pdTRUE ) {
+			return 0;
+		}
+
+	}
+
+	return -1;
+
+}
+
+void stream_reader_commit( audio_element_handle_t self, int len ) {
+
+	stream_reader_t *rdr = (stream_reader_t *) audio_element_getdata( self );
+
+	rdr->received += len;
+	stream_reader_store( &rdr->written, rdr->written + len );
+	xSemaphoreGive( rdr->data );
+
+}
+
+void stream_reader_finish( audio_element_handle_t self ) {
+
+	stream_reader_t *rdr = (stream_reader_t *) audio_element_getdata( self );
+
+	rdr->finished = true;
+	xSemaphoreGive( rdr->data );
+
+}
+
+void stream_reader_report( audio_element_handle_t self, cJSON *stream ) {
+
+	stream_reader_t *rdr = (stream_reader_t *) audio_element_getdata( self );
+
+	cJSON_AddBoolToObject( stream, "active", rdr->active );
+	cJSON_AddNumberToObject( stream, "buffer", rdr->size );
+	cJSON_AddNumberToObject( stream, "fill", rdr->written - rdr->consumed );
+	cJSON_AddNumberToObject( stream, "received", rdr->received );
+	cJSON_AddNumberToObject( stream, "underruns", rdr->underruns );
+
+}
@@ -0,0 +1,62 @@
+/*
+ * stream_reader.h
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#ifndef MAIN_STREAM_READER_H_
+#define MAIN_STREAM_READER_H_
+
+#include <audio_element.h>
+#include <cJSON.h>
+
+// reader for audio pushed over the network, replaces the sd reader while a stream plays.
+// the sender writes into a jitter ring, socket data is received directly into its free space.
+// playback starts when the ring is half full, an empty ring is an underrun: playback waits until it is half full again.
+// raw pcm gets a wav header in front, so the wav decoder plays it.
+
+#define STREAM_READER_BUFFER      (32 * 1024)
+#define STREAM_READER_TIMEOUT_MS  5000		// a sender without data for this long ends the stream
+
+#define STREAM_READER_TASK_STACK  (3 * 1024)
+#define STREAM_READER_TASK_CORE   (0)
+#define STREAM_READER_TASK_PRIO   (4)
+#define STREAM_READER_RINGBUFFER_SIZE (8 * 1024)
+
+typedef struct {
+	int buffer_size;	// jitter ring
+	int out_rb_size;
+	int task_stack;
+	int task_core;
+	int task_prio;
+} stream_reader_cfg_t;
+
+#define STREAM_READER_CFG_DEFAULT() {               \
+	.buffer_size = STREAM_READER_BUFFER,            \
+	.out_rb_size = STREAM_READER_RINGBUFFER_SIZE,   \
+	.task_stack  = STREAM_READER_TASK_STACK,        \
+	.task_core   = STREAM_READER_TASK_CORE,         \
+	.task_prio   = STREAM_READER_TASK_PRIO          \
+}
+
+audio_element_handle_t stream_reader_init( stream_reader_cfg_t *config );
+
+// empties the ring for a new stream, before the pipeline runs.
+// rate and channels > 0: the stream is 16 bit little endian pcm without header.
+void stream_reader_begin( audio_element_handle_t self, int rate, int channels );
+
+// contiguous free space of the ring, waits up to ticks for it.
+// returns the bytes which can be written to *span, 0 on timeout, -1 if the stream was stopped.
+int stream_reader_span( audio_element_handle_t self, char **span, TickType_t ticks );
+
+// len bytes have been written to the span
+void stream_reader_commit( audio_element_handle_t self, int len );
+
+// the sender is done, the ring plays to its end
+void stream_reader_finish( audio_element_handle_t self );
+
+// adds received bytes, underruns and fill level
+void stream_reader_report( audio_element_handle_t self, cJSON *stream );
+
+#endif /* MAIN_STREAM_READER_H_ */
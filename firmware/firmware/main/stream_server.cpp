@@ -0,0 +1,170 @@
+/*
+ * stream_server.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <lwip/sockets.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "stream_server.h"
+#include "stream_reader.h"
+#include "scheduling.h"
+
+#define TAGSTREAMSERVER "::STREAMSERVER"
+
+static struct {
+	Pipeline *pipeline;
+	int      port;
+} server;
+
+// reads the format line, returns false if the sender closed the connection before
+static bool stream_server_header( int sock, char *line, int size ) {
+
+	int len = 0;
+
+	while ( len < size - 1 ) {
+		char c;
+		if ( recv( sock, &c, 1, 0 ) != 1 ) return false;
+		if ( c == '\n' ) break;
+		if ( c != '\r' ) line[len++] = c;
+	}
+
+	line[len] = '\0';
+	return true;
+
+}
+
+static audio_filetype_t stream_server_format( const char *line, int *rate, int *channels ) {
+
+	char format[8] = "";
+
+	*rate = 0;
+	*channels = 0;
+	sscanf( line, "%7s %d %d", format, rate, channels );
+
+	if ( strcmp( format, "mp3" ) == 0 ) return FILETYPE_MP3;
+	if ( strcmp( format, "wav" ) == 0 ) return FILETYPE_WAV;
+	if ( strcmp( format, "ogg" ) == 0 ) return FILETYPE_OGG;
+	if ( strcmp( format, "adpcm" ) == 0 ) return FILETYPE_ADPCM;
+
+	// raw pcm plays as wav, the reader adds the header
+	if ( ( strcmp( format, "pcm" ) == 0 ) && ( *rate >= 8000 ) && ( *rate <= 48000 ) && ( *channels >= 1 ) && ( *channels <= 2 ) ) return FILETYPE_WAV;
+
+	return FILETYPE_UNKOWN;
+
+}
+
+static void stream_server_receive( int sock ) {
+
+	char line[STREAM_SERVER_HEADER_MAX];
+	int rate, channels;
+
+	if ( !stream_server_header( sock, line, sizeof(line) ) ) {
+		return;
+	}
+
+	audio_filetype_t filetype = stream_server_format( line, &rate, &channels );
+	if ( filetype == FILETYPE_UNKOWN ) {
+		ESP_LOGW( TAGSTREAMSERVER, "unknown format \"%s\"", line );
+		send( sock, "unknown format\n", 15, 0 );
+		return;
+	}
+
+	if ( !server.pipeline->playStream( filetype, rate, channels ) ) {
+		send( sock, "busy\n", 5, 0 );
+		return;
+	}
+
+	ESP_LOGI( TAGSTREAMSERVER, "stream \"%s\"", line );
+
+	audio_element_handle_t reader = server.pipeline->getStreamReader();
+
+	// the socket receives straight into the jitter ring, no copy in between
+	while ( true ) {
+
+		char *span;
+		int free = stream_reader_span( reader, &span, pdMS_TO_TICKS( STREAM_SERVER_WAIT_MS ) );
+
+		if ( free < 0 ) {
+			ESP_LOGI( TAGSTREAMSERVER, "stream stopped" );
+			break;
+		}
+
+		// ring full, e.g. paused
+		if ( free == 0 ) continue;
+
+		int len = recv( sock, span, free, 0 );
+
+		if ( len > 0 ) {
+			stream_reader_commit( reader, len );
+		} else if ( ( len < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) ) {
+			continue;
+		} else {
+			break;
+		}
+
+	}
+
+	stream_reader_finish( reader );
+
+}
+
+static void task_stream_server( void *pvParameter ) {
+
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl( INADDR_ANY );
+	addr.sin_port = htons( server.port );
+
+	int listener = socket( AF_INET, SOCK_STREAM, IPPROTO_IP );
+	if ( ( listener < 0 ) || ( bind( listener, (struct sockaddr *) &addr, sizeof(addr) ) != 0 ) || ( listen( listener, 1 ) != 0 ) ) {
+		ESP_LOGE( TAGSTREAMSERVER, "could not listen on port %d, errno %d", server.port, errno );
+		if ( listener >= 0 ) close( listener );
+		vTaskDelete( NULL );
+		return;
+	}
+
+	ESP_LOGI( TAGSTREAMSERVER, "listening on port %d", server.port );
+
+	while ( true ) {
+
+		int sock = accept( listener, NULL, NULL );
+		if ( sock < 0 ) {
+			ESP_LOGW( TAGSTREAMSERVER, "accept failed, errno %d", errno );
+			continue;
+		}
+
+		// recv returns regularly, so a stopped stream is noticed while the sender is silent
+		struct timeval timeout = { .tv_sec = STREAM_SERVER_WAIT_MS / 1000, .tv_usec = ( STREAM_SERVER_WAIT_MS % 1000 ) * 1000 };
+		setsockopt( sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout) );
+
+		stream_server_receive( sock );
+
+		shutdown( sock, SHUT_RDWR );
+		close( sock );
+
+	}
+
+}
+
+void stream_server_start( Pipeline *pipeline, int port ) {
+
+	if ( pipeline->getStreamReader() == NULL ) {
+		ESP_LOGE( TAGSTREAMSERVER, "no stream reader" );
+		return;
+	}
+
+	server.pipeline = pipeline;
+	server.port = port;
+
+	// network side, next to the web server
+	xTaskCreatePinnedToCore( &task_stream_server, "stream", STREAM_SERVER_TASK_STACK, NULL, sched_prio( SCHED_HTTPD ), NULL, sched_core( SCHED_HTTPD ) );
+
+}
@@ -0,0 +1,24 @@
+/*
+ * stream_server.h
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#ifndef MAIN_STREAM_SERVER_H_
+#define MAIN_STREAM_SERVER_H_
+
+#include "pipeline.h"
+
+// tcp input for audio generated on the TXT or a PC, e.g. text to speech.
+// a sender connects, writes one line with the format and then the audio. closing the connection ends the stream.
+//   mp3 | wav | ogg | adpcm | pcm <rate> <channels>
+// pcm is 16 bit little endian. one stream at a time, further senders wait for the connection.
+
+#define STREAM_SERVER_TASK_STACK (4 * 1024)
+#define STREAM_SERVER_HEADER_MAX 64
+#define STREAM_SERVER_WAIT_MS    1000		// checks for a stopped stream while the ring is full or the sender is silent
+
+void stream_server_start( Pipeline *pipeline, int port );
+
+#endif /* MAIN_STREAM_SERVER_H_ */
@@ -0,0 +1,245 @@
+/*
+ * tone_generator.cpp
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#include <esp_log.h>
+#include <audio_mem.h>
+#include <string.h>
+#include <math.h>
+
+#include "tone_generator.h"
+#include "memorypolicy.h"
+
+#define TAGTONE "::TONE"
+
+#define TONE_TABLE_SIZE  ( 1 << TONE_TABLE_BITS )
+#define TONE_FRAC_BITS   ( 32 - TONE_TABLE_BITS )
+#define TONE_ENV_ONE     ( 1 << 30 )
+
+typedef struct {
+	tone_t   tone;
+	int      rate;
+	int16_t  *buf;			// one block, stereo
+	uint32_t phase;			// phase accumulator, 2^32 = one period
+	int64_t  inc;			// phase increment per sample << 16, changes while sweeping
+	int64_t  inc_step;
+	uint32_t noise;			// xorshift state
+	int32_t  amplitude;		// Q15
+	uint32_t pos;			// samples so far
+	uint32_t length;		// samples of the whole tone
+	uint32_t attack;		// envelope in samples
+	uint32_t decay;
+	uint32_t release;
+	int32_t  sustain;		// Q30
+	int32_t  env;			// Q30
+	int32_t  env_step;
+	uint32_t seg_end;		// sample of the next envelope segment
+} tone_generator_t;
+
+// one extra entry, so interpolation doesn't need to wrap
+static int16_t sine_table[TONE_TABLE_SIZE + 1];
+static bool sine_table_ready = false;
+
+static int64_t tone_increment( tone_generator_t *gen, uint16_t frequency ) {
+
+	return ( ( (int64_t) frequency << 32 ) / gen->rate ) << 16;
+
+}
+
+// linear ramp to the level of the segment the current sample belongs to
+static void tone_segment( tone_generator_t *gen ) {
+
+	uint32_t decay_start = gen->attack;
+	uint32_t sustain_start = decay_start + gen->decay;
+	uint32_t release_start = gen->length - gen->release;
+	int32_t target;
+
+	if ( gen->pos < decay_start ) {
+		target = TONE_ENV_ONE;
+		gen->seg_end = decay_start;
+	} else if ( gen->pos < sustain_start ) {
+		target = gen->sustain;
+		gen->seg_end = sustain_start;
+	} else if ( gen->pos < release_start ) {
+		gen->env = gen->sustain;
+		gen->env_step = 0;
+		gen->seg_end = release_start;
+		return;
+	} else {
+		target = 0;
+		gen->seg_end = gen->length;
+	}
+
+	// a tone of 0ms has no samples to ramp over
+	gen->env_step = ( gen->seg_end > gen->pos ) ? ( target - gen->env ) / (int32_t) ( gen->seg_end - gen->pos ) : 0;
+
+}
+
+static inline int32_t tone_sample( tone_generator_t *gen ) {
+
+	uint32_t phase = gen->phase;
+	gen->phase += (uint32_t) ( gen->inc >> 16 );
+
+	switch ( gen->tone.waveform ) {
+
+	case TONE_SQUARE:
+		return ( phase & 0x80000000 ) ? -32767 : 32767;
+
+	case TONE_NOISE:
+		gen->noise ^= gen->noise << 13;
+		gen->noise ^= gen->noise >> 17;
+		gen->noise ^= gen->noise << 5;
+		return (int16_t) ( gen->noise >> 16 );
+
+	default: {
+		uint32_t index = phase >> TONE_FRAC_BITS;
+		int32_t frac = ( phase >> ( TONE_FRAC_BITS - 15 ) ) & 0x7fff;
+		int32_t a = sine_table[index];
+		return a + ( ( ( sine_table[index + 1] - a ) * frac ) >> 15 ); }
+
+	}
+
+}
+
+static esp_err_t tone_open( audio_element_handle_t self ) {
+
+	tone_generator_t *gen = (tone_generator_t *) audio_element_getdata( self );
+	tone_t *tone = &gen->tone;
+
+	gen->length  = (uint32_t) tone->duration * gen->rate / 1000;
+	gen->release = (uint32_t) tone->release * gen->rate / 1000;
+	gen->attack  = (uint32_t) tone->attack * gen->rate / 1000;
+	gen->decay   = (uint32_t) tone->decay * gen->rate / 1000;
+
+	// the envelope has to fit into the tone
+	if ( gen->release > gen->length ) gen->release = gen->length;
+	if ( gen->attack > gen->length - gen->release ) gen->attack = gen->length - gen->release;
+	if ( gen->decay > gen->length - gen->release - gen->attack ) gen->decay = gen->length - gen->release - gen->attack;
+
+	gen->sustain   = (int32_t) ( (int64_t) tone->sustain * TONE_ENV_ONE / 100 );
+	gen->amplitude = tone->level * 32767 / 100;
+	gen->env       = ( gen->attack > 0 ) ? 0 : TONE_ENV_ONE;
+	gen->phase     = 0;
+	gen->noise     = 0x12345678;
+	gen->pos       = 0;
+
+	gen->inc = tone_increment( gen, tone->frequency );
+	gen->inc_step = 0;
+	if ( ( tone->waveform == TONE_SWEEP ) && ( gen->length > 0 ) ) {
+		gen->inc_step = ( tone_increment( gen, tone->frequency_end ) - gen->inc ) / gen->length;
+	}
+
+	tone_segment( gen );
+
+	ESP_LOGD( TAGTONE, "waveform %d, %dHz, %d samples", tone->waveform, tone->frequency, gen->length );
+
+	audio_element_set_music_info( self, gen->rate, 2, 16 );
+	audio_element_report_info( self );
+
+	return ESP_OK;
+
+}
+
+static audio_element_err_t tone_process( audio_element_handle_t self, char *in_buffer, int in_len ) {
+
+	tone_generator_t *gen = (tone_generator_t *) audio_element_getdata( self );
+
+	if ( gen->pos >= gen->length ) {
+		return AEL_IO_DONE;
+	}
+
+	uint32_t frames = gen->length - gen->pos;
+	if ( frames > TONE_BLOCK_FRAMES ) frames = TONE_BLOCK_FRAMES;
+
+	for ( uint32_t i = 0; i < frames; i++ ) {
+
+		if ( gen->pos == gen->seg_end ) tone_segment( gen );
+
+		int32_t gain = ( ( gen->env >> 15 ) * gen->amplitude ) >> 15;
+		int16_t v = ( tone_sample( gen ) * gain ) >> 15;
+
+		gen->buf[ 2 * i ] = v;
+		gen->buf[ 2 * i + 1 ] = v;
+
+		gen->env += gen->env_step;
+		gen->inc += gen->inc_step;
+		gen->pos++;
+
+	}
+
+	return audio_element_output( self, (char *) gen->buf, frames * 2 * sizeof(int16_t) );
+
+}
+
+static esp_err_t tone_destroy( audio_element_handle_t self ) {
+
+	tone_generator_t *gen = (tone_generator_t *) audio_element_getdata( self );
+
+	memory_free( gen->buf );
+	audio_free( gen );
+
+	return ESP_OK;
+
+}
+
+void tone_generator_set( audio_element_handle_t self, const tone_t *tone ) {
+
+	tone_generator_t *gen = (tone_generator_t *) audio_element_getdata( self );
+
+	gen->tone = *tone;
+
+	// nyquist
+	int max_frequency = ( gen->rate / 2 < TONE_MAX_FREQUENCY ) ? gen->rate / 2 : TONE_MAX_FREQUENCY;
+
+	if ( gen->tone.frequency < TONE_MIN_FREQUENCY ) gen->tone.frequency = TONE_MIN_FREQUENCY;
+	if ( gen->tone.frequency > max_frequency ) gen->tone.frequency = max_frequency;
+	if ( gen->tone.frequency_end < TONE_MIN_FREQUENCY ) gen->tone.frequency_end = TONE_MIN_FREQUENCY;
+	if ( gen->tone.frequency_end > max_frequency ) gen->tone.frequency_end = max_frequency;
+	if ( gen->tone.duration > TONE_MAX_DURATION ) gen->tone.duration = TONE_MAX_DURATION;
+	if ( gen->tone.sustain > 100 ) gen->tone.sustain = 100;
+	if ( gen->tone.level > 100 ) gen->tone.level = 100;
+	if ( gen->tone.waveform > TONE_NOISE ) gen->tone.waveform = TONE_SINE;
+
+}
+
+audio_element_handle_t tone_generator_init( tone_generator_cfg_t *config ) {
+
+	if ( !sine_table_ready ) {
+		for ( int i = 0; i <= TONE_TABLE_SIZE; i++ ) {
+			sine_table[i] = (int16_t) lrintf( 32767.0f * sinf( 2.0f * (float) M_PI * i / TONE_TABLE_SIZE ) );
+		}
+		sine_table_ready = true;
+	}
+
+	tone_generator_t *gen = (tone_generator_t *) audio_calloc( 1, sizeof(tone_generator_t) );
+	AUDIO_MEM_CHECK( TAGTONE, gen, return NULL );
+
+	gen->rate = config->rate;
+
+	// written sample by sample, keep it internal
+	gen->buf = (int16_t *) memory_alloc( MEMORY_INTERNAL, TONE_BLOCK_FRAMES * 2 * sizeof(int16_t) );
+	AUDIO_MEM_CHECK( TAGTONE, gen->buf, { audio_free( gen ); return NULL; } );
+
+	audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+	cfg.open        = tone_open;
+	cfg.process     = tone_process;
+	cfg.destroy     = tone_destroy;
+	cfg.tag         = "tone";
+	cfg.task_stack  = config->task_stack;
+	cfg.task_prio   = config->task_prio;
+	cfg.task_core   = config->task_core;
+	cfg.out_rb_size = config->out_rb_size;
+
+	audio_element_handle_t el = audio_element_init( &cfg );
+	AUDIO_MEM_CHECK( TAGTONE, el, { memory_free( gen->buf ); audio_free( gen ); return NULL; } );
+	audio_element_setdata( el, gen );
+
+	tone_t tone = TONE_DEFAULT();
+	tone_generator_set( el, &tone );
+
+	return el;
+
+}
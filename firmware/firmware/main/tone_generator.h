@@ -0,0 +1,81 @@
+/*
+ * tone_generator.h
+ *
+ *  Created on: 19.10.2026
+ *      Author: ftcSoundBar team
+ */
+
+#ifndef MAIN_TONE_GENERATOR_H_
+#define MAIN_TONE_GENERATOR_H_
+
+#include <audio_element.h>
+
+// source element synthesizing beeps and alarms without sd card access.
+// sine is read from a table with linear interpolation, the envelope is a linear ADSR.
+// output is 16 bit stereo at the rate given in the config.
+
+#define TONE_TABLE_BITS          8
+#define TONE_BLOCK_FRAMES        256
+
+#define TONE_MIN_FREQUENCY       20
+#define TONE_MAX_FREQUENCY       20000
+#define TONE_MAX_DURATION        10000
+
+#define TONE_GENERATOR_TASK_STACK   (3 * 1024)
+#define TONE_GENERATOR_TASK_CORE    (0)
+#define TONE_GENERATOR_TASK_PRIO    (5)
+#define TONE_GENERATOR_RINGBUFFER_SIZE (4 * 1024)
+
+typedef enum {
+	TONE_SINE   = 0,
+	TONE_SQUARE = 1,
+	TONE_SWEEP  = 2,	// sine, linear from frequency to frequency_end
+	TONE_NOISE  = 3
+} tone_waveform_t;
+
+typedef struct {
+	tone_waveform_t waveform;
+	uint16_t frequency;		// Hz
+	uint16_t frequency_end;	// Hz, sweep only
+	uint16_t duration;		// ms, release included
+	uint16_t attack;		// ms
+	uint16_t decay;			// ms
+	uint8_t  sustain;		// level after the decay in percent
+	uint16_t release;		// ms
+	uint8_t  level;			// percent of full scale
+} tone_t;
+
+#define TONE_DEFAULT() {          \
+	.waveform      = TONE_SINE,   \
+	.frequency     = 1000,        \
+	.frequency_end = 1000,        \
+	.duration      = 200,         \
+	.attack        = 5,           \
+	.decay         = 0,           \
+	.sustain       = 100,         \
+	.release       = 20,          \
+	.level         = 50           \
+}
+
+typedef struct {
+	int rate;
+	int out_rb_size;
+	int task_stack;
+	int task_core;
+	int task_prio;
+} tone_generator_cfg_t;
+
+#define DEFAULT_TONE_GENERATOR_CONFIG() {               \
+	.rate        = 44100,                               \
+	.out_rb_size = TONE_GENERATOR_RINGBUFFER_SIZE,      \
+	.task_stack  = TONE_GENERATOR_TASK_STACK,           \
+	.task_core   = TONE_GENERATOR_TASK_CORE,            \
+	.task_prio   = TONE_GENERATOR_TASK_PRIO             \
+}
+
+audio_element_handle_t tone_generator_init( tone_generator_cfg_t *config );
+
+// sets the next tone, call it before the pipeline runs. values out of range are limited.
+void tone_generator_set( audio_element_handle_t self, const tone_t *tone );
+
+#endif /* MAIN_TONE_GENERATOR_H_ */
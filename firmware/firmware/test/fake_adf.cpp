@@ -0,0 +1,1109 @@
+/*
+ * fake_adf.cpp
+ *
+ * host implementation of the stubs: elements without tasks, pipelines which only set their state,
+ * fifo ringbuffers, non blocking semaphores and malloc for every memory class. the http reader is a
+ * small blocking client, so it can be run against a server on the loopback.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <deque>
+#include <string>
+#include <algorithm>
+
+#include <audio_element.h>
+#include <audio_pipeline.h>
+#include <audio_hal.h>
+#include <board.h>
+#include <i2s_stream.h>
+#include <http_stream.h>
+#include <mp3_decoder.h>
+#include <wav_decoder.h>
+#include <ogg_decoder.h>
+#include <ringbuf.h>
+#include <esp_system.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <cJSON.h>
+
+#include "memorypolicy.h"
+#include "fake_adf.h"
+
+struct audio_element {
+	audio_element_cfg_t   cfg;
+	void                  *data;
+	audio_element_info_t  info;
+	char                  *uri;
+	audio_element_state_t state;
+	std::vector<uint8_t>  input;
+	size_t                input_pos;
+	int                   input_chunk;
+	std::vector<uint8_t>  output;
+	std::vector<char>     buffer;
+	ringbuf_handle_t      out_rb;
+};
+
+static int elements_alive = 0;
+static int elements_created = 0;
+
+audio_element_handle_t audio_element_init( audio_element_cfg_t *config ) {
+
+	audio_element_handle_t el = new audio_element();
+	el->cfg = *config;
+	el->data = config->data;
+	el->state = AEL_STATE_INIT;
+	el->buffer.resize( ( config->buffer_len > 0 ) ? config->buffer_len : DEFAULT_ELEMENT_BUFFER_LENGTH );
+	elements_alive++;
+	elements_created++;
+
+	return el;
+
+}
+
+esp_err_t audio_element_deinit( audio_element_handle_t el ) {
+
+	if ( el->cfg.destroy != NULL ) el->cfg.destroy( el );
+	free( el->uri );
+	delete el;
+	elements_alive--;
+
+	return ESP_OK;
+
+}
+
+esp_err_t audio_element_setdata( audio_element_handle_t el, void *data ) {
+
+	el->data = data;
+	return ESP_OK;
+
+}
+
+void *audio_element_getdata( audio_element_handle_t el ) {
+
+	return el->data;
+
+}
+
+esp_err_t audio_element_setinfo( audio_element_handle_t el, audio_element_info_t *info ) {
+
+	el->info = *info;
+	return ESP_OK;
+
+}
+
+esp_err_t audio_element_getinfo( audio_element_handle_t el, audio_element_info_t *info ) {
+
+	*info = el->info;
+	return ESP_OK;
+
+}
+
+esp_err_t audio_element_set_music_info( audio_element_handle_t el, int sample_rates, int channels, int bits ) {
+
+	el->info.sample_rates = sample_rates;
+	el->info.channels = channels;
+	el->info.bits = bits;
+	return ESP_OK;
+
+}
+
+esp_err_t audio_element_report_info( audio_element_handle_t el ) {
+
+	return ESP_OK;
+
+}
+
+esp_err_t audio_element_report_pos( audio_element_handle_t el ) {
+
+	return ESP_OK;
+
+}
+
+esp_err_t audio_element_set_byte_pos( audio_element_handle_t el, int64_t pos ) {
+
+	el->info.byte_pos = pos;
+	return ESP_OK;
+
+}
+
+esp_err_t audio_element_update_byte_pos( audio_element_handle_t el, int pos ) {
+
+	el->info.byte_pos += pos;
+	return ESP_OK;
+
+}
+
+esp_err_t audio_element_set_total_bytes( audio_element_handle_t el, int64_t total_bytes ) {
+
+	el->info.total_bytes = total_bytes;
+	return ESP_OK;
+
+}
+
+esp_err_t audio_element_set_uri( audio_element_handle_t el, const char *uri ) {
+
+	free( el->uri );
+	el->uri = ( uri != NULL ) ? strdup( uri ) : NULL;
+	return ESP_OK;
+
+}
+
+char *audio_element_get_uri( audio_element_handle_t el ) {
+
+	return el->uri;
+
+}
+
+audio_element_state_t audio_element_get_state( audio_element_handle_t el ) {
+
+	return el->state;
+
+}
+
+esp_err_t audio_element_set_output_ringbuf( audio_element_handle_t el, ringbuf_handle_t rb ) {
+
+	el->out_rb = rb;
+	return ESP_OK;
+
+}
+
+ringbuf_handle_t audio_element_get_output_ringbuf( audio_element_handle_t el ) {
+
+	return el->out_rb;
+
+}
+
+audio_element_err_t audio_element_input( audio_element_handle_t el, char *buffer, int wanted_size ) {
+
+	if ( el->cfg.read != NULL ) {
+		return el->cfg.read( el, buffer, wanted_size, portMAX_DELAY, NULL );
+	}
+
+	int left = (int) ( el->input.size() - el->input_pos );
+	if ( left <= 0 ) {
+		return AEL_IO_DONE;
+	}
+
+	int len = ( wanted_size < left ) ? wanted_size : left;
+	if ( ( el->input_chunk > 0 ) && ( len > el->input_chunk ) ) len = el->input_chunk;
+
+	memcpy( buffer, &el->input[ el->input_pos ], len );
+	el->input_pos += len;
+
+	return (audio_element_err_t) len;
+
+}
+
+audio_element_err_t audio_element_output( audio_element_handle_t el, char *buffer, int write_size ) {
+
+	el->output.insert( el->output.end(), (uint8_t *) buffer, (uint8_t *) buffer + write_size );
+	return (audio_element_err_t) write_size;
+
+}
+
+void fake_element_set_input( audio_element_handle_t el, const void *data, int len, int chunk ) {
+
+	el->input.assign( (const uint8_t *) data, (const uint8_t *) data + len );
+	el->input_pos = 0;
+	el->input_chunk = chunk;
+
+}
+
+std::vector<uint8_t> &fake_element_output( audio_element_handle_t el ) {
+
+	return el->output;
+
+}
+
+std::vector<int16_t> fake_element_pcm( audio_element_handle_t el ) {
+
+	std::vector<int16_t> pcm( el->output.size() / sizeof(int16_t) );
+	memcpy( pcm.data(), el->output.data(), pcm.size() * sizeof(int16_t) );
+	return pcm;
+
+}
+
+esp_err_t fake_element_open( audio_element_handle_t el ) {
+
+	el->state = AEL_STATE_RUNNING;
+	return ( el->cfg.open != NULL ) ? el->cfg.open( el ) : ESP_OK;
+
+}
+
+int fake_element_process( audio_element_handle_t el ) {
+
+	return el->cfg.process( el, el->buffer.data(), (int) el->buffer.size() );
+
+}
+
+esp_err_t fake_element_close( audio_element_handle_t el ) {
+
+	el->state = AEL_STATE_STOPPED;
+	return ( el->cfg.close != NULL ) ? el->cfg.close( el ) : ESP_OK;
+
+}
+
+int fake_element_run( audio_element_handle_t el, int max_blocks ) {
+
+	if ( fake_element_open( el ) != ESP_OK ) {
+		return AEL_IO_FAIL;
+	}
+
+	int ret = AEL_IO_OK;
+	for ( int i = 0; i < max_blocks; i++ ) {
+		ret = fake_element_process( el );
+		if ( ret <= 0 ) break;
+	}
+
+	fake_element_close( el );
+
+	return ret;
+
+}
+
+int fake_elements_alive( void ) {
+
+	return elements_alive;
+
+}
+
+int fake_elements_created( void ) {
+
+	return elements_created;
+
+}
+
+// elements of esp-adf, they are never run except the http reader
+
+static audio_element_handle_t fake_stream_init( const char *tag, int task_prio, int task_core ) {
+
+	audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+	cfg.tag = tag;
+	cfg.task_prio = task_prio;
+	cfg.task_core = task_core;
+
+	return audio_element_init( &cfg );
+
+}
+
+audio_element_handle_t i2s_stream_init( i2s_stream_cfg_t *config ) {
+
+	return fake_stream_init( "iis", config->task_prio, config->task_core );
+
+}
+
+esp_err_t i2s_stream_set_clk( audio_element_handle_t i2s_stream, int rate, int bits, int ch ) {
+
+	return audio_element_set_music_info( i2s_stream, rate, ch, bits );
+
+}
+
+esp_err_t i2s_alc_volume_set( audio_element_handle_t i2s_stream, int volume ) {
+
+	return ESP_OK;
+
+}
+
+// the http reader of esp-adf: GET of the uri, a byte position asks for the rest by a range request.
+// plain http/1.1 over a socket, the body is read until the server closes the connection.
+
+typedef struct {
+	int               sock;
+	std::vector<char> body;		// received with the header, not output yet
+} fake_http_t;
+
+static esp_err_t fake_http_open( audio_element_handle_t el ) {
+
+	fake_http_t *http = (fake_http_t *) el->data;
+	char host[64], port[8] = "80";
+
+	if ( ( el->uri == NULL ) || ( strncmp( el->uri, "http://", 7 ) != 0 ) ) return ESP_FAIL;
+	const char *name = el->uri + 7;
+	const char *path = strchr( name, '/' );
+	if ( path == NULL ) path = name + strlen( name );
+	const char *colon = (const char *) memchr( name, ':', path - name );
+	const char *end = ( colon != NULL ) ? colon : path;
+	snprintf( host, sizeof(host), "%.*s", (int) ( end - name ), name );
+	if ( colon != NULL ) snprintf( port, sizeof(port), "%.*s", (int) ( path - colon - 1 ), colon + 1 );
+
+	struct addrinfo hints = {}, *addr;
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if ( getaddrinfo( host, port, &hints, &addr ) != 0 ) return ESP_FAIL;
+	http->sock = socket( addr->ai_family, addr->ai_socktype, addr->ai_protocol );
+	int err = ( http->sock >= 0 ) ? connect( http->sock, addr->ai_addr, addr->ai_addrlen ) : -1;
+	freeaddrinfo( addr );
+	if ( err != 0 ) return ESP_FAIL;
+
+	std::string request = std::string( "GET " ) + ( ( *path != '\0' ) ? path : "/" ) + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: close\r\n";
+	if ( el->info.byte_pos > 0 ) request += "Range: bytes=" + std::to_string( el->info.byte_pos ) + "-\r\n";
+	request += "\r\n";
+	if ( send( http->sock, request.data(), request.size(), 0 ) != (ssize_t) request.size() ) return ESP_FAIL;
+
+	// the header, the start of the body comes with it
+	std::string header;
+	size_t header_end;
+	char buf[1024];
+	while ( ( header_end = header.find( "\r\n\r\n" ) ) == std::string::npos ) {
+		ssize_t n = recv( http->sock, buf, sizeof(buf), 0 );
+		if ( ( n <= 0 ) || ( header.size() > 8192 ) ) return ESP_FAIL;
+		header.append( buf, n );
+	}
+	http->body.assign( header.begin() + header_end + 4, header.end() );
+	header.resize( header_end );
+
+	// a range needs 206, a server ignoring it would send the start again
+	int status = 0;
+	sscanf( header.c_str(), "HTTP/%*s %d", &status );
+	if ( status != ( ( el->info.byte_pos > 0 ) ? 206 : 200 ) ) return ESP_FAIL;
+
+	std::transform( header.begin(), header.end(), header.begin(), ::tolower );
+	size_t length = header.find( "\r\ncontent-length:" );
+	el->info.total_bytes = ( length != std::string::npos ) ? el->info.byte_pos + atoll( header.c_str() + length + 17 ) : 0;
+
+	return ESP_OK;
+
+}
+
+static audio_element_err_t fake_http_process( audio_element_handle_t el, char *buffer, int len ) {
+
+	fake_http_t *http = (fake_http_t *) el->data;
+	int n;
+
+	if ( !http->body.empty() ) {
+		n = std::min( len, (int) http->body.size() );
+		memcpy( buffer, http->body.data(), n );
+		http->body.erase( http->body.begin(), http->body.begin() + n );
+	} else {
+		n = recv( http->sock, buffer, len, 0 );
+		if ( n == 0 ) return AEL_IO_DONE;
+		if ( n < 0 ) return AEL_IO_FAIL;
+	}
+
+	el->info.byte_pos += n;
+	return audio_element_output( el, buffer, n );
+
+}
+
+static esp_err_t fake_http_close( audio_element_handle_t el ) {
+
+	fake_http_t *http = (fake_http_t *) el->data;
+
+	if ( http->sock >= 0 ) close( http->sock );
+	http->sock = -1;
+	http->body.clear();
+
+	// like the readers, a stopped stream starts over
+	if ( el->state != AEL_STATE_PAUSED ) el->info.byte_pos = 0;
+
+	return ESP_OK;
+
+}
+
+static esp_err_t fake_http_destroy( audio_element_handle_t el ) {
+
+	fake_http_close( el );
+	delete (fake_http_t *) el->data;
+
+	return ESP_OK;
+
+}
+
+audio_element_handle_t http_stream_init( http_stream_cfg_t *config ) {
+
+	fake_http_t *http = new fake_http_t();
+	http->sock = -1;
+
+	audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+	cfg.open = fake_http_open;
+	cfg.process = fake_http_process;
+	cfg.close = fake_http_close;
+	cfg.destroy = fake_http_destroy;
+	cfg.data = http;
+	cfg.buffer_len = 4096;
+	cfg.tag = "http";
+	cfg.task_prio = config->task_prio;
+	cfg.task_core = config->task_core;
+
+	return audio_element_init( &cfg );
+
+}
+
+audio_element_handle_t mp3_decoder_init( mp3_decoder_cfg_t *config ) {
+
+	return fake_stream_init( "mp3", config->task_prio, config->task_core );
+
+}
+
+audio_element_handle_t wav_decoder_init( wav_decoder_cfg_t *config ) {
+
+	return fake_stream_init( "wav", config->task_prio, config->task_core );
+
+}
+
+audio_element_handle_t ogg_decoder_init( ogg_decoder_cfg_t *config ) {
+
+	return fake_stream_init( "ogg", config->task_prio, config->task_core );
+
+}
+
+// board and codec
+
+static struct audio_hal hal;
+
+audio_board_handle_t audio_board_init( void ) {
+
+	static struct audio_board_handle board = { &hal };
+	return &board;
+
+}
+
+esp_err_t audio_hal_ctrl_codec( audio_hal_handle_t hal, audio_hal_codec_mode_t mode, audio_hal_ctrl_t ctrl ) {
+
+	return ESP_OK;
+
+}
+
+esp_err_t audio_hal_set_volume( audio_hal_handle_t hal, int volume ) {
+
+	hal->volume = volume;
+	return ESP_OK;
+
+}
+
+esp_err_t audio_hal_get_volume( audio_hal_handle_t hal, int *volume ) {
+
+	*volume = hal->volume;
+	return ESP_OK;
+
+}
+
+// events, messages wait in the queue of the listener
+
+struct audio_event_iface {
+	audio_event_iface_handle_t           listener;
+	std::deque<audio_event_iface_msg_t> queue;
+};
+
+audio_event_iface_handle_t audio_event_iface_init( audio_event_iface_cfg_t *config ) {
+
+	return new audio_event_iface();
+
+}
+
+esp_err_t audio_event_iface_destroy( audio_event_iface_handle_t evt ) {
+
+	delete evt;
+	return ESP_OK;
+
+}
+
+esp_err_t audio_event_iface_set_listener( audio_event_iface_handle_t evt, audio_event_iface_handle_t listener ) {
+
+	evt->listener = listener;
+	return ESP_OK;
+
+}
+
+esp_err_t audio_event_iface_sendout( audio_event_iface_handle_t evt, audio_event_iface_msg_t *msg ) {
+
+	if ( evt->listener == NULL ) return ESP_FAIL;
+
+	evt->listener->queue.push_back( *msg );
+	return ESP_OK;
+
+}
+
+esp_err_t audio_event_iface_listen( audio_event_iface_handle_t evt, audio_event_iface_msg_t *msg, TickType_t wait_time ) {
+
+	if ( evt->queue.empty() ) return ESP_FAIL;
+
+	*msg = evt->queue.front();
+	evt->queue.pop_front();
+	return ESP_OK;
+
+}
+
+// pipelines
+
+struct audio_pipeline {
+	std::vector<std::pair<std::string, audio_element_handle_t>> registered;
+	std::vector<audio_element_handle_t> linked;		// first to last
+	std::vector<ringbuf_handle_t> rbs;			// between the linked elements
+	std::vector<fake_run_t> runs;
+};
+
+static std::vector<audio_pipeline_handle_t> pipelines;
+
+static void pipeline_set_state( audio_pipeline_handle_t pipeline, audio_element_state_t state ) {
+
+	for ( audio_element_handle_t el : pipeline->linked ) el->state = state;
+
+}
+
+audio_pipeline_handle_t audio_pipeline_init( audio_pipeline_cfg_t *config ) {
+
+	audio_pipeline_handle_t pipeline = new audio_pipeline();
+	pipelines.push_back( pipeline );
+
+	return pipeline;
+
+}
+
+esp_err_t audio_pipeline_deinit( audio_pipeline_handle_t pipeline ) {
+
+	audio_pipeline_unlink( pipeline );
+	pipelines.erase( std::find( pipelines.begin(), pipelines.end(), pipeline ) );
+	delete pipeline;
+
+	return ESP_OK;
+
+}
+
+esp_err_t audio_pipeline_register( audio_pipeline_handle_t pipeline, audio_element_handle_t el, const char *name ) {
+
+	audio_pipeline_unregister( pipeline, el );
+	pipeline->registered.push_back( { name, el } );
+
+	return ESP_OK;
+
+}
+
+esp_err_t audio_pipeline_unregister( audio_pipeline_handle_t pipeline, audio_element_handle_t el ) {
+
+	auto &r = pipeline->registered;
+	for ( auto it = r.begin(); it != r.end(); it++ ) {
+		if ( it->second == el ) {
+			r.erase( it );
+			return ESP_OK;
+		}
+	}
+
+	return ESP_FAIL;
+
+}
+
+audio_element_handle_t fake_pipeline_element( audio_pipeline_handle_t pipeline, const char *name ) {
+
+	for ( auto &r : pipeline->registered ) {
+		if ( ( r.first == name ) && ( std::find( pipeline->linked.begin(), pipeline->linked.end(), r.second ) != pipeline->linked.end() ) ) {
+			return r.second;
+		}
+	}
+
+	return NULL;
+
+}
+
+// like esp-adf every element but the last writes into a ringbuffer to the next one
+esp_err_t audio_pipeline_link( audio_pipeline_handle_t pipeline, const char *link_tag[], int link_num ) {
+
+	audio_pipeline_unlink( pipeline );
+
+	for ( int i = 0; i < link_num; i++ ) {
+		audio_element_handle_t el = NULL;
+		for ( auto &r : pipeline->registered ) {
+			if ( r.first == link_tag[i] ) el = r.second;
+		}
+		if ( el == NULL ) return ESP_FAIL;
+
+		pipeline->linked.push_back( el );
+		if ( i + 1 < link_num ) {
+			ringbuf_handle_t rb = rb_create( DEFAULT_PIPELINE_RINGBUF_SIZE, 1 );
+			pipeline->rbs.push_back( rb );
+			el->out_rb = rb;
+		}
+	}
+
+	return ESP_OK;
+
+}
+
+esp_err_t audio_pipeline_unlink( audio_pipeline_handle_t pipeline ) {
+
+	for ( size_t i = 0; i < pipeline->rbs.size(); i++ ) {
+		pipeline->linked[i]->out_rb = NULL;
+		rb_destroy( pipeline->rbs[i] );
+	}
+
+	pipeline->rbs.clear();
+	pipeline->linked.clear();
+
+	return ESP_OK;
+
+}
+
+esp_err_t audio_pipeline_set_listener( audio_pipeline_handle_t pipeline, audio_event_iface_handle_t evt ) {
+
+	return ESP_OK;
+
+}
+
+esp_err_t audio_pipeline_run( audio_pipeline_handle_t pipeline ) {
+
+	if ( pipeline->linked.empty() ) return ESP_FAIL;
+
+	fake_run_t run = { "", 0, "", xTaskGetCurrentTaskHandle() };
+	audio_element_handle_t file = fake_pipeline_element( pipeline, "file" );
+	audio_element_handle_t decoder = fake_pipeline_element( pipeline, "decoder" );
+
+	if ( file != NULL ) {
+		run.uri = ( file->uri != NULL ) ? file->uri : "";
+		run.byte_pos = file->info.byte_pos;
+	}
+	if ( decoder != NULL ) {
+		run.decoder = decoder->cfg.tag;
+	}
+
+	pipeline->runs.push_back( run );
+	pipeline_set_state( pipeline, AEL_STATE_RUNNING );
+
+	return ESP_OK;
+
+}
+
+esp_err_t audio_pipeline_stop( audio_pipeline_handle_t pipeline ) {
+
+	// the readers reset their position on close
+	for ( audio_element_handle_t el : pipeline->linked ) {
+		if ( ( el->state == AEL_STATE_RUNNING ) || ( el->state == AEL_STATE_PAUSED ) ) el->info.byte_pos = 0;
+	}
+
+	pipeline_set_state( pipeline, AEL_STATE_STOPPED );
+
+	return ESP_OK;
+
+}
+
+esp_err_t audio_pipeline_wait_for_stop( audio_pipeline_handle_t pipeline ) {
+
+	return ESP_OK;
+
+}
+
+esp_err_t audio_pipeline_terminate( audio_pipeline_handle_t pipeline ) {
+
+	return ESP_OK;
+
+}
+
+esp_err_t audio_pipeline_pause( audio_pipeline_handle_t pipeline ) {
+
+	pipeline_set_state( pipeline, AEL_STATE_PAUSED );
+	return ESP_OK;
+
+}
+
+esp_err_t audio_pipeline_resume( audio_pipeline_handle_t pipeline ) {
+
+	pipeline_set_state( pipeline, AEL_STATE_RUNNING );
+	return ESP_OK;
+
+}
+
+esp_err_t audio_pipeline_reset_ringbuffer( audio_pipeline_handle_t pipeline ) {
+
+	for ( ringbuf_handle_t rb : pipeline->rbs ) rb_reset( rb );
+	return ESP_OK;
+
+}
+
+esp_err_t audio_pipeline_reset_elements( audio_pipeline_handle_t pipeline ) {
+
+	return ESP_OK;
+
+}
+
+audio_pipeline_handle_t fake_pipeline( int nr ) {
+
+	return ( nr < (int) pipelines.size() ) ? pipelines[nr] : NULL;
+
+}
+
+std::vector<fake_run_t> &fake_pipeline_runs( audio_pipeline_handle_t pipeline ) {
+
+	return pipeline->runs;
+
+}
+
+void fake_pipeline_finish( audio_pipeline_handle_t pipeline ) {
+
+	pipeline_set_state( pipeline, AEL_STATE_FINISHED );
+
+	for ( audio_element_handle_t el : pipeline->linked ) el->info.byte_pos = 0;
+	for ( ringbuf_handle_t rb : pipeline->rbs ) rb_reset( rb );
+
+}
+
+// ringbuffer
+
+struct ringbuf {
+	std::deque<char> data;
+	int  size;
+	bool done;
+	bool abort;
+};
+
+ringbuf_handle_t rb_create( int block_size, int n_blocks ) {
+
+	ringbuf_handle_t rb = new ringbuf();
+	rb->size = block_size * n_blocks;
+	return rb;
+
+}
+
+esp_err_t rb_destroy( ringbuf_handle_t rb ) {
+
+	delete rb;
+	return ESP_OK;
+
+}
+
+esp_err_t rb_reset( ringbuf_handle_t rb ) {
+
+	rb->data.clear();
+	rb->done = false;
+	rb->abort = false;
+	return ESP_OK;
+
+}
+
+int rb_read( ringbuf_handle_t rb, char *buf, int len, TickType_t ticks_to_wait ) {
+
+	if ( rb->abort ) return RB_ABORT;
+
+	if ( rb->data.empty() ) {
+		return rb->done ? RB_DONE : RB_TIMEOUT;
+	}
+
+	int n = ( len < (int) rb->data.size() ) ? len : (int) rb->data.size();
+	for ( int i = 0; i < n; i++ ) {
+		buf[i] = rb->data.front();
+		rb->data.pop_front();
+	}
+
+	return n;
+
+}
+
+int rb_write( ringbuf_handle_t rb, char *buf, int len, TickType_t ticks_to_wait ) {
+
+	if ( rb->abort ) return RB_ABORT;
+	if ( rb->done ) return RB_DONE;
+
+	rb->data.insert( rb->data.end(), buf, buf + len );
+	return len;
+
+}
+
+esp_err_t rb_done_write( ringbuf_handle_t rb ) {
+
+	rb->done = true;
+	return ESP_OK;
+
+}
+
+esp_err_t rb_abort( ringbuf_handle_t rb ) {
+
+	rb->abort = true;
+	return ESP_OK;
+
+}
+
+int rb_bytes_filled( ringbuf_handle_t rb ) {
+
+	return (int) rb->data.size();
+
+}
+
+int rb_get_size( ringbuf_handle_t rb ) {
+
+	return rb->size;
+
+}
+
+// freertos
+
+struct fake_semaphore {
+	int count;
+	int max;		// a binary semaphore given twice is still 1
+};
+
+static SemaphoreHandle_t fake_semaphore_create( int count, int max ) {
+
+	SemaphoreHandle_t sem = new fake_semaphore();
+	sem->count = count;
+	sem->max = max;
+	return sem;
+
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex( void ) {
+
+	return fake_semaphore_create( 1, 1 );
+
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex( void ) {
+
+	return fake_semaphore_create( 1, 1 << 30 );
+
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary( void ) {
+
+	return fake_semaphore_create( 0, 1 );
+
+}
+
+static void (*block_scheduler)( void ) = NULL;
+
+void fake_on_block( void (*scheduler)( void ) ) {
+
+	block_scheduler = scheduler;
+
+}
+
+BaseType_t xSemaphoreTake( SemaphoreHandle_t sem, TickType_t ticks ) {
+
+	// instead of waiting the other task runs, once
+	static bool scheduling = false;
+	if ( ( sem->count <= 0 ) && ( ticks > 0 ) && ( block_scheduler != NULL ) && !scheduling ) {
+		scheduling = true;
+		block_scheduler();
+		scheduling = false;
+	}
+
+	if ( sem->count <= 0 ) return pdFALSE;
+	sem->count--;
+	return pdTRUE;
+
+}
+
+BaseType_t xSemaphoreGive( SemaphoreHandle_t sem ) {
+
+	if ( sem->count >= sem->max ) return pdFALSE;
+	sem->count++;
+	return pdTRUE;
+
+}
+
+// one thread owns everything
+BaseType_t xSemaphoreTakeRecursive( SemaphoreHandle_t sem, TickType_t ticks ) {
+
+	sem->count--;
+	return pdTRUE;
+
+}
+
+BaseType_t xSemaphoreGiveRecursive( SemaphoreHandle_t sem ) {
+
+	sem->count++;
+	return pdTRUE;
+
+}
+
+void vSemaphoreDelete( SemaphoreHandle_t sem ) {
+
+	delete sem;
+
+}
+
+static int tasks_created = 0;
+static TickType_t ticks = 0;
+
+BaseType_t xTaskCreate( TaskFunction_t code, const char *name, uint32_t stack, void *parameter, UBaseType_t prio, TaskHandle_t *handle ) {
+
+	tasks_created++;
+	if ( handle != NULL ) *handle = (TaskHandle_t) code;
+	return pdPASS;
+
+}
+
+BaseType_t xTaskCreatePinnedToCore( TaskFunction_t code, const char *name, uint32_t stack, void *parameter, UBaseType_t prio, TaskHandle_t *handle, BaseType_t core ) {
+
+	return xTaskCreate( code, name, stack, parameter, prio, handle );
+
+}
+
+void vTaskDelete( TaskHandle_t task ) {
+}
+
+void vTaskDelay( TickType_t n ) {
+
+	ticks += n;
+
+}
+
+static TaskHandle_t current_task = (TaskHandle_t) &tasks_created;
+
+TaskHandle_t fake_task_switch( TaskHandle_t task ) {
+
+	TaskHandle_t previous = current_task;
+	current_task = task;
+	return previous;
+
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void ) {
+
+	return current_task;
+
+}
+
+TickType_t xTaskGetTickCount( void ) {
+
+	return ticks;
+
+}
+
+// no system tasks
+TaskHandle_t xTaskGetHandle( const char *name ) {
+
+	return NULL;
+
+}
+
+BaseType_t xTaskGetAffinity( TaskHandle_t task ) {
+
+	return tskNO_AFFINITY;
+
+}
+
+void vTaskPrioritySet( TaskHandle_t task, UBaseType_t prio ) {
+}
+
+int fake_tasks_created( void ) {
+
+	return tasks_created;
+
+}
+
+// esp
+
+static uint32_t random_state = 1;
+
+void fake_random_seed( uint32_t seed ) {
+
+	random_state = ( seed != 0 ) ? seed : 1;
+
+}
+
+uint32_t esp_random( void ) {
+
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+
+}
+
+// memory policy, all classes are the heap
+
+void memory_init( void ) {
+}
+
+void *memory_alloc( memory_class_t cls, size_t size ) {
+
+	return malloc( size );
+
+}
+
+void *memory_calloc( memory_class_t cls, size_t n, size_t size ) {
+
+	return calloc( n, size );
+
+}
+
+char *memory_strdup( memory_class_t cls, const char *s ) {
+
+	return strdup( s );
+
+}
+
+void memory_free( void *ptr ) {
+
+	free( ptr );
+
+}
+
+void memory_report( cJSON *root ) {
+}
+
+// cJSON, the reports aren't checked
+
+void cJSON_InitHooks( cJSON_Hooks *hooks ) {
+}
+
+cJSON *cJSON_CreateObject( void ) {
+
+	return NULL;
+
+}
+
+cJSON *cJSON_AddNumberToObject( cJSON *object, const char *name, double number ) {
+
+	return NULL;
+
+}
+
+cJSON *cJSON_AddStringToObject( cJSON *object, const char *name, const char *string ) {
+
+	return NULL;
+
+}
+
+cJSON *cJSON_AddBoolToObject( cJSON *object, const char *name, int boolean ) {
+
+	return NULL;
+
+}
+
+cJSON *cJSON_AddArrayToObject( cJSON *object, const char *name ) {
+
+	return NULL;
+
+}
+
+cJSON *cJSON_AddObjectToObject( cJSON *object, const char *name ) {
+
+	return NULL;
+
+}
+
+int cJSON_AddItemToArray( cJSON *array, cJSON *item ) {
+
+	return 1;
+
+}
+
+void cJSON_Delete( cJSON *item ) {
+}
+
+// newlib
+
+char *strlwr( char *s ) {
+
+	for ( char *p = s; *p; p++ ) *p = tolower( (unsigned char) *p );
+	return s;
+
+}
+
+size_t strlcpy( char *dst, const char *src, size_t size ) {
+
+	size_t len = strlen( src );
+
+	if ( size > 0 ) {
+		size_t n = ( len < size - 1 ) ? len : size - 1;
+		memcpy( dst, src, n );
+		dst[n] = 0;
+	}
+
+	return len;
+
+}
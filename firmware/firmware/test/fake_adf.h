@@ -0,0 +1,72 @@
+/*
+ * fake_adf.h
+ *
+ * drives elements of the firmware on the host: the test sets the input of an element,
+ * runs it like the element task would and checks what it wrote.
+ */
+
+#ifndef TEST_FAKE_ADF_H_
+#define TEST_FAKE_ADF_H_
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <audio_element.h>
+#include <audio_pipeline.h>
+#include <freertos/task.h>
+
+// bytes audio_element_input delivers, an element with a read callback reads from it instead.
+// chunk limits the bytes per call to exercise incomplete frames, 0 = as many as wanted.
+void fake_element_set_input( audio_element_handle_t el, const void *data, int len, int chunk = 0 );
+
+// everything the element wrote with audio_element_output since the last clear
+std::vector<uint8_t> &fake_element_output( audio_element_handle_t el );
+std::vector<int16_t> fake_element_pcm( audio_element_handle_t el );
+
+// open, process until it returns <= 0 or max_blocks are done, close. returns the last result of process.
+int fake_element_run( audio_element_handle_t el, int max_blocks = 1000000 );
+
+// single steps for tests changing settings while running
+esp_err_t fake_element_open( audio_element_handle_t el );
+int fake_element_process( audio_element_handle_t el );
+esp_err_t fake_element_close( audio_element_handle_t el );
+
+// elements initialized and not deinitialized yet, and all initialized so far
+int fake_elements_alive( void );
+int fake_elements_created( void );
+
+// a run of a pipeline: the uri and start position of the element registered as "file", the tag of the "decoder"
+// and the task which started it
+typedef struct {
+	std::string  uri;
+	int64_t      byte_pos;
+	std::string  decoder;
+	TaskHandle_t task;
+} fake_run_t;
+
+// pipelines in the order they were created, NULL if there are less.
+// audio_pipeline_run sets the linked elements running and adds a run, stop sets them stopped.
+audio_pipeline_handle_t fake_pipeline( int nr );
+std::vector<fake_run_t> &fake_pipeline_runs( audio_pipeline_handle_t pipeline );
+
+// a linked element by the name it was registered with, NULL if there is none
+audio_element_handle_t fake_pipeline_element( audio_pipeline_handle_t pipeline, const char *name );
+
+// the last byte went to i2s: the elements are finished, their ringbuffers empty
+void fake_pipeline_finish( audio_pipeline_handle_t pipeline );
+
+// calls of xTaskCreate and its variants so far
+int fake_tasks_created( void );
+
+// the task xTaskGetCurrentTaskHandle returns from now on, returns the one before.
+// the test starts as one task, which is the listener once it calls setListener.
+TaskHandle_t fake_task_switch( TaskHandle_t task );
+
+// a task waiting for an empty semaphore lets the scheduler run instead, once, then takes it if it was given.
+// the scheduler switches to the other task, runs it and switches back.
+void fake_on_block( void (*scheduler)( void ) );
+
+// esp_random returns this sequence
+void fake_random_seed( uint32_t seed );
+
+#endif /* TEST_FAKE_ADF_H_ */
@@ -0,0 +1,28 @@
+/*
+ * audio_common.h
+ *
+ * host stub for the tests
+ */
+
+#ifndef TEST_STUBS_AUDIO_COMMON_H_
+#define TEST_STUBS_AUDIO_COMMON_H_
+
+typedef enum {
+	AUDIO_ELEMENT_TYPE_UNKNOW = 0x01 << 24,
+	AUDIO_ELEMENT_TYPE_ELEMENT = 0x01 << 25,
+	AUDIO_ELEMENT_TYPE_PLAYER = 0x01 << 26,
+	AUDIO_ELEMENT_TYPE_SERVICE = 0x01 << 27,
+	AUDIO_ELEMENT_TYPE_PERIPH = 0x01 << 28
+} audio_element_type_t;
+
+typedef enum {
+	AUDIO_STREAM_NONE = 0,
+	AUDIO_STREAM_READER,
+	AUDIO_STREAM_WRITER
+} audio_stream_type_t;
+
+typedef enum {
+	ESP_CODEC_TYPE_UNKNOW = 0
+} esp_codec_type_t;
+
+#endif /* TEST_STUBS_AUDIO_COMMON_H_ */
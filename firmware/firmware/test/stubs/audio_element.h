@@ -0,0 +1,120 @@
+/*
+ * audio_element.h
+ *
+ * host stub for the tests: the element api of esp-adf without a task.
+ * fake_adf.h feeds the input and collects the output.
+ */
+
+#ifndef TEST_STUBS_AUDIO_ELEMENT_H_
+#define TEST_STUBS_AUDIO_ELEMENT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "ringbuf.h"
+#include "audio_common.h"
+#include "audio_error.h"
+#include "audio_event_iface.h"
+
+typedef enum {
+	AEL_IO_OK        = ESP_OK,
+	AEL_IO_FAIL      = ESP_FAIL,
+	AEL_IO_DONE      = -2,
+	AEL_IO_ABORT     = -3,
+	AEL_IO_TIMEOUT   = -4,
+	AEL_PROCESS_FAIL = -5
+} audio_element_err_t;
+
+typedef enum {
+	AEL_STATE_NONE = 0,
+	AEL_STATE_INIT,
+	AEL_STATE_INITIALIZING,
+	AEL_STATE_RUNNING,
+	AEL_STATE_PAUSED,
+	AEL_STATE_STOPPED,
+	AEL_STATE_FINISHED,
+	AEL_STATE_ERROR
+} audio_element_state_t;
+
+typedef enum {
+	AEL_MSG_CMD_NONE          = 0,
+	AEL_MSG_CMD_FINISH        = 2,
+	AEL_MSG_CMD_STOP          = 3,
+	AEL_MSG_CMD_PAUSE         = 4,
+	AEL_MSG_CMD_RESUME        = 5,
+	AEL_MSG_CMD_DESTROY       = 6,
+	AEL_MSG_CMD_REPORT_STATUS = 8
+} audio_element_msg_cmd_t;
+
+typedef struct {
+	int     sample_rates;
+	int     channels;
+	int     bits;
+	int     bps;
+	int64_t byte_pos;
+	int64_t total_bytes;
+	int     duration;
+	char    *uri;
+	int     codec_fmt;
+} audio_element_info_t;
+
+typedef struct audio_element *audio_element_handle_t;
+
+typedef esp_err_t (*el_io_func)( audio_element_handle_t self );
+typedef audio_element_err_t (*process_func)( audio_element_handle_t self, char *el_buffer, int el_buf_len );
+typedef audio_element_err_t (*stream_func)( audio_element_handle_t self, char *buffer, int len, TickType_t ticks_to_wait, void *context );
+
+#define DEFAULT_ELEMENT_BUFFER_LENGTH  1024
+
+typedef struct {
+	el_io_func   open;
+	el_io_func   close;
+	process_func process;
+	el_io_func   destroy;
+	stream_func  read;
+	stream_func  write;
+	int          buffer_len;
+	int          task_stack;
+	int          task_prio;
+	int          task_core;
+	int          out_rb_size;
+	void         *data;
+	const char   *tag;
+	bool         stack_in_ext;
+} audio_element_cfg_t;
+
+#define DEFAULT_AUDIO_ELEMENT_CONFIG() {              \
+	.buffer_len  = DEFAULT_ELEMENT_BUFFER_LENGTH,     \
+	.task_stack  = 3 * 1024,                          \
+	.task_prio   = 5,                                 \
+	.task_core   = 0,                                 \
+	.out_rb_size = 8 * 1024                           \
+}
+
+audio_element_handle_t audio_element_init( audio_element_cfg_t *config );
+esp_err_t audio_element_deinit( audio_element_handle_t el );
+
+esp_err_t audio_element_setdata( audio_element_handle_t el, void *data );
+void *audio_element_getdata( audio_element_handle_t el );
+
+esp_err_t audio_element_setinfo( audio_element_handle_t el, audio_element_info_t *info );
+esp_err_t audio_element_getinfo( audio_element_handle_t el, audio_element_info_t *info );
+esp_err_t audio_element_set_music_info( audio_element_handle_t el, int sample_rates, int channels, int bits );
+esp_err_t audio_element_report_info( audio_element_handle_t el );
+esp_err_t audio_element_report_pos( audio_element_handle_t el );
+esp_err_t audio_element_set_byte_pos( audio_element_handle_t el, int64_t pos );
+esp_err_t audio_element_update_byte_pos( audio_element_handle_t el, int pos );
+esp_err_t audio_element_set_total_bytes( audio_element_handle_t el, int64_t total_bytes );
+
+esp_err_t audio_element_set_uri( audio_element_handle_t el, const char *uri );
+char *audio_element_get_uri( audio_element_handle_t el );
+audio_element_state_t audio_element_get_state( audio_element_handle_t el );
+
+esp_err_t audio_element_set_output_ringbuf( audio_element_handle_t el, ringbuf_handle_t rb );
+ringbuf_handle_t audio_element_get_output_ringbuf( audio_element_handle_t el );
+
+audio_element_err_t audio_element_input( audio_element_handle_t el, char *buffer, int wanted_size );
+audio_element_err_t audio_element_output( audio_element_handle_t el, char *buffer, int write_size );
+
+#endif /* TEST_STUBS_AUDIO_ELEMENT_H_ */
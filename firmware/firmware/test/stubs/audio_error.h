@@ -0,0 +1,14 @@
+/*
+ * audio_error.h
+ *
+ * host stub for the tests
+ */
+
+#ifndef TEST_STUBS_AUDIO_ERROR_H_
+#define TEST_STUBS_AUDIO_ERROR_H_
+
+#include <assert.h>
+
+#define mem_assert( x ) assert( x )
+
+#endif /* TEST_STUBS_AUDIO_ERROR_H_ */
@@ -0,0 +1,47 @@
+/*
+ * audio_event_iface.h
+ *
+ * host stub for the tests: messages are delivered by the test calling the handler
+ */
+
+#ifndef TEST_STUBS_AUDIO_EVENT_IFACE_H_
+#define TEST_STUBS_AUDIO_EVENT_IFACE_H_
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+	int  cmd;
+	void *data;
+	int  data_len;
+	void *source;
+	int  source_type;
+	bool need_free_data;
+} audio_event_iface_msg_t;
+
+typedef struct audio_event_iface *audio_event_iface_handle_t;
+
+typedef struct {
+	int        internal_queue_size;
+	int        external_queue_size;
+	int        queue_set_size;
+	TickType_t wait_time;
+	void       *context;
+} audio_event_iface_cfg_t;
+
+#define AUDIO_EVENT_IFACE_DEFAULT_CFG() {   \
+	.internal_queue_size = 5,               \
+	.external_queue_size = 5,               \
+	.queue_set_size = 5,                    \
+	.wait_time = portMAX_DELAY,             \
+	.context = NULL                         \
+}
+
+audio_event_iface_handle_t audio_event_iface_init( audio_event_iface_cfg_t *config );
+esp_err_t audio_event_iface_destroy( audio_event_iface_handle_t evt );
+esp_err_t audio_event_iface_set_listener( audio_event_iface_handle_t evt, audio_event_iface_handle_t listener );
+esp_err_t audio_event_iface_sendout( audio_event_iface_handle_t evt, audio_event_iface_msg_t *msg );
+esp_err_t audio_event_iface_listen( audio_event_iface_handle_t evt, audio_event_iface_msg_t *msg, TickType_t wait_time );
+
+#endif /* TEST_STUBS_AUDIO_EVENT_IFACE_H_ */
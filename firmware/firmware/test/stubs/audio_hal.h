@@ -0,0 +1,32 @@
+/*
+ * audio_hal.h
+ *
+ * host stub for the tests: a codec which only keeps its volume
+ */
+
+#ifndef TEST_STUBS_AUDIO_HAL_H_
+#define TEST_STUBS_AUDIO_HAL_H_
+
+#include "esp_err.h"
+
+typedef enum {
+	AUDIO_HAL_CODEC_MODE_ENCODE = 1,
+	AUDIO_HAL_CODEC_MODE_DECODE,
+	AUDIO_HAL_CODEC_MODE_BOTH,
+	AUDIO_HAL_CODEC_MODE_LINE_IN
+} audio_hal_codec_mode_t;
+
+typedef enum {
+	AUDIO_HAL_CTRL_STOP = 0,
+	AUDIO_HAL_CTRL_START
+} audio_hal_ctrl_t;
+
+typedef struct audio_hal {
+	int volume;
+} *audio_hal_handle_t;
+
+esp_err_t audio_hal_ctrl_codec( audio_hal_handle_t hal, audio_hal_codec_mode_t mode, audio_hal_ctrl_t ctrl );
+esp_err_t audio_hal_set_volume( audio_hal_handle_t hal, int volume );
+esp_err_t audio_hal_get_volume( audio_hal_handle_t hal, int *volume );
+
+#endif /* TEST_STUBS_AUDIO_HAL_H_ */
@@ -0,0 +1,21 @@
+/*
+ * audio_mem.h
+ *
+ * host stub for the tests
+ */
+
+#ifndef TEST_STUBS_AUDIO_MEM_H_
+#define TEST_STUBS_AUDIO_MEM_H_
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+
+#define audio_malloc( size )     malloc( size )
+#define audio_calloc( n, size )  calloc( n, size )
+#define audio_free( ptr )        free( ptr )
+#define audio_strdup( s )        strdup( s )
+
+#define AUDIO_MEM_CHECK( tag, x, action ) if ( !( x ) ) { ESP_LOGE( tag, "memory exhausted" ); action; }
+
+#endif /* TEST_STUBS_AUDIO_MEM_H_ */
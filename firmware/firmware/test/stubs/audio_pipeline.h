@@ -0,0 +1,42 @@
+/*
+ * audio_pipeline.h
+ *
+ * host stub for the tests: a pipeline sets the state of its elements, nothing runs.
+ * fake_adf.h lets the test look at the runs and finish them.
+ */
+
+#ifndef TEST_STUBS_AUDIO_PIPELINE_H_
+#define TEST_STUBS_AUDIO_PIPELINE_H_
+
+#include "audio_element.h"
+#include "audio_event_iface.h"
+
+typedef struct audio_pipeline *audio_pipeline_handle_t;
+
+typedef struct {
+	int rb_size;
+} audio_pipeline_cfg_t;
+
+#define DEFAULT_PIPELINE_RINGBUF_SIZE (8 * 1024)
+
+#define DEFAULT_AUDIO_PIPELINE_CONFIG() {   \
+	.rb_size = DEFAULT_PIPELINE_RINGBUF_SIZE \
+}
+
+audio_pipeline_handle_t audio_pipeline_init( audio_pipeline_cfg_t *config );
+esp_err_t audio_pipeline_deinit( audio_pipeline_handle_t pipeline );
+esp_err_t audio_pipeline_register( audio_pipeline_handle_t pipeline, audio_element_handle_t el, const char *name );
+esp_err_t audio_pipeline_unregister( audio_pipeline_handle_t pipeline, audio_element_handle_t el );
+esp_err_t audio_pipeline_link( audio_pipeline_handle_t pipeline, const char *link_tag[], int link_num );
+esp_err_t audio_pipeline_unlink( audio_pipeline_handle_t pipeline );
+esp_err_t audio_pipeline_set_listener( audio_pipeline_handle_t pipeline, audio_event_iface_handle_t evt );
+esp_err_t audio_pipeline_run( audio_pipeline_handle_t pipeline );
+esp_err_t audio_pipeline_stop( audio_pipeline_handle_t pipeline );
+esp_err_t audio_pipeline_wait_for_stop( audio_pipeline_handle_t pipeline );
+esp_err_t audio_pipeline_terminate( audio_pipeline_handle_t pipeline );
+esp_err_t audio_pipeline_pause( audio_pipeline_handle_t pipeline );
+esp_err_t audio_pipeline_resume( audio_pipeline_handle_t pipeline );
+esp_err_t audio_pipeline_reset_ringbuffer( audio_pipeline_handle_t pipeline );
+esp_err_t audio_pipeline_reset_elements( audio_pipeline_handle_t pipeline );
+
+#endif /* TEST_STUBS_AUDIO_PIPELINE_H_ */
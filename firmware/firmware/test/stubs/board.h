@@ -0,0 +1,20 @@
+/*
+ * board.h
+ *
+ * host stub for the tests
+ */
+
+#ifndef TEST_STUBS_BOARD_H_
+#define TEST_STUBS_BOARD_H_
+
+#include "audio_hal.h"
+
+struct audio_board_handle {
+	audio_hal_handle_t audio_hal;
+};
+
+typedef struct audio_board_handle *audio_board_handle_t;
+
+audio_board_handle_t audio_board_init( void );
+
+#endif /* TEST_STUBS_BOARD_H_ */
@@ -0,0 +1,29 @@
+/*
+ * cJSON.h
+ *
+ * host stub for the tests, the reports build nothing
+ */
+
+#ifndef TEST_STUBS_CJSON_H_
+#define TEST_STUBS_CJSON_H_
+
+#include <stddef.h>
+
+typedef struct cJSON cJSON;
+
+typedef struct {
+	void *(*malloc_fn)( size_t size );
+	void (*free_fn)( void *ptr );
+} cJSON_Hooks;
+
+void cJSON_InitHooks( cJSON_Hooks *hooks );
+cJSON *cJSON_CreateObject( void );
+cJSON *cJSON_AddNumberToObject( cJSON *object, const char *name, double number );
+cJSON *cJSON_AddStringToObject( cJSON *object, const char *name, const char *string );
+cJSON *cJSON_AddBoolToObject( cJSON *object, const char *name, int boolean );
+cJSON *cJSON_AddArrayToObject( cJSON *object, const char *name );
+cJSON *cJSON_AddObjectToObject( cJSON *object, const char *name );
+int cJSON_AddItemToArray( cJSON *array, cJSON *item );
+void cJSON_Delete( cJSON *item );
+
+#endif /* TEST_STUBS_CJSON_H_ */
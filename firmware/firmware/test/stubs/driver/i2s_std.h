@@ -0,0 +1,10 @@
+/*
+ * i2s_std.h
+ *
+ * host stub for the tests
+ */
+
+#ifndef TEST_STUBS_DRIVER_I2S_STD_H_
+#define TEST_STUBS_DRIVER_I2S_STD_H_
+
+#endif /* TEST_STUBS_DRIVER_I2S_STD_H_ */
@@ -0,0 +1,17 @@
+/*
+ * esp_err.h
+ *
+ * host stub for the tests, only what the firmware uses
+ */
+
+#ifndef TEST_STUBS_ESP_ERR_H_
+#define TEST_STUBS_ESP_ERR_H_
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK    0
+#define ESP_FAIL  -1
+
+#endif /* TEST_STUBS_ESP_ERR_H_ */
@@ -0,0 +1,19 @@
+/*
+ * esp_log.h
+ *
+ * host stub for the tests, warnings and errors go to stderr
+ */
+
+#ifndef TEST_STUBS_ESP_LOG_H_
+#define TEST_STUBS_ESP_LOG_H_
+
+#include <stdio.h>
+#include "esp_err.h"
+
+#define ESP_LOGE( tag, format, ... ) fprintf( stderr, "E %s: " format "\n", tag, ##__VA_ARGS__ )
+#define ESP_LOGW( tag, format, ... ) fprintf( stderr, "W %s: " format "\n", tag, ##__VA_ARGS__ )
+#define ESP_LOGI( tag, format, ... ) do {} while ( 0 )
+#define ESP_LOGD( tag, format, ... ) do {} while ( 0 )
+#define ESP_LOGV( tag, format, ... ) do {} while ( 0 )
+
+#endif /* TEST_STUBS_ESP_LOG_H_ */
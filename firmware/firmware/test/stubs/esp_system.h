@@ -0,0 +1,14 @@
+/*
+ * esp_system.h
+ *
+ * host stub for the tests
+ */
+
+#ifndef TEST_STUBS_ESP_SYSTEM_H_
+#define TEST_STUBS_ESP_SYSTEM_H_
+
+#include <stdint.h>
+
+uint32_t esp_random( void );
+
+#endif /* TEST_STUBS_ESP_SYSTEM_H_ */
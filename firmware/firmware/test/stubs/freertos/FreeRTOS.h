@@ -0,0 +1,37 @@
+/*
+ * FreeRTOS.h
+ *
+ * host stub for the tests. tests run on one thread, critical sections are empty.
+ */
+
+#ifndef TEST_STUBS_FREERTOS_H_
+#define TEST_STUBS_FREERTOS_H_
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define portMAX_DELAY        0xffffffffUL
+#define portTICK_PERIOD_MS   10
+#define portTICK_RATE_MS     portTICK_PERIOD_MS
+#define pdMS_TO_TICKS( ms )  ( (TickType_t) ( ms ) / portTICK_PERIOD_MS )
+
+#define portNUM_PROCESSORS    2
+#define configMAX_PRIORITIES  25
+
+#define pdFALSE  0
+#define pdTRUE   1
+#define pdFAIL   pdFALSE
+#define pdPASS   pdTRUE
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED  0
+#define portMUX_INITIALIZE( mux )     ( *( mux ) = 0 )
+#define portENTER_CRITICAL( mux )     ( (void) ( mux ) )
+#define portEXIT_CRITICAL( mux )      ( (void) ( mux ) )
+#define taskENTER_CRITICAL( mux )     ( (void) ( mux ) )
+#define taskEXIT_CRITICAL( mux )      ( (void) ( mux ) )
+
+#endif /* TEST_STUBS_FREERTOS_H_ */
@@ -0,0 +1,23 @@
+/*
+ * semphr.h
+ *
+ * host stub for the tests: counting semaphores without blocking, a take that would block fails
+ */
+
+#ifndef TEST_STUBS_SEMPHR_H_
+#define TEST_STUBS_SEMPHR_H_
+
+#include "FreeRTOS.h"
+
+typedef struct fake_semaphore *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex( void );
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex( void );
+SemaphoreHandle_t xSemaphoreCreateBinary( void );
+BaseType_t xSemaphoreTake( SemaphoreHandle_t sem, TickType_t ticks );
+BaseType_t xSemaphoreGive( SemaphoreHandle_t sem );
+BaseType_t xSemaphoreTakeRecursive( SemaphoreHandle_t sem, TickType_t ticks );
+BaseType_t xSemaphoreGiveRecursive( SemaphoreHandle_t sem );
+void vSemaphoreDelete( SemaphoreHandle_t sem );
+
+#endif /* TEST_STUBS_SEMPHR_H_ */
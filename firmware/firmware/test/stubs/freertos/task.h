@@ -0,0 +1,27 @@
+/*
+ * task.h
+ *
+ * host stub for the tests. tasks are recorded, but don't run.
+ */
+
+#ifndef TEST_STUBS_TASK_H_
+#define TEST_STUBS_TASK_H_
+
+#include "FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)( void *parameter );
+
+#define tskNO_AFFINITY  0x7fffffff
+
+BaseType_t xTaskCreate( TaskFunction_t code, const char *name, uint32_t stack, void *parameter, UBaseType_t prio, TaskHandle_t *handle );
+BaseType_t xTaskCreatePinnedToCore( TaskFunction_t code, const char *name, uint32_t stack, void *parameter, UBaseType_t prio, TaskHandle_t *handle, BaseType_t core );
+void vTaskDelete( TaskHandle_t task );
+void vTaskDelay( TickType_t ticks );
+TaskHandle_t xTaskGetCurrentTaskHandle( void );
+TickType_t xTaskGetTickCount( void );
+TaskHandle_t xTaskGetHandle( const char *name );
+BaseType_t xTaskGetAffinity( TaskHandle_t task );
+void vTaskPrioritySet( TaskHandle_t task, UBaseType_t prio );
+
+#endif /* TEST_STUBS_TASK_H_ */
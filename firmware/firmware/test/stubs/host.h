@@ -0,0 +1,26 @@
+/*
+ * host.h
+ *
+ * newlib functions glibc doesn't have, included into every file of the tests
+ */
+
+#ifndef TEST_STUBS_HOST_H_
+#define TEST_STUBS_HOST_H_
+
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+char *strlwr( char *s );
+size_t strlcpy( char *dst, const char *src, size_t size );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TEST_STUBS_HOST_H_ */
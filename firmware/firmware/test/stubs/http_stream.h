@@ -0,0 +1,31 @@
+/*
+ * http_stream.h
+ *
+ * host stub for the tests: the reader is an element without callbacks
+ */
+
+#ifndef TEST_STUBS_HTTP_STREAM_H_
+#define TEST_STUBS_HTTP_STREAM_H_
+
+#include "audio_element.h"
+#include "audio_common.h"
+
+typedef struct {
+	audio_stream_type_t type;
+	int out_rb_size;
+	int task_stack;
+	int task_core;
+	int task_prio;
+} http_stream_cfg_t;
+
+#define HTTP_STREAM_CFG_DEFAULT() {   \
+	.type = AUDIO_STREAM_READER,      \
+	.out_rb_size = 20 * 1024,         \
+	.task_stack = 6 * 1024,           \
+	.task_core = 0,                   \
+	.task_prio = 4                    \
+}
+
+audio_element_handle_t http_stream_init( http_stream_cfg_t *config );
+
+#endif /* TEST_STUBS_HTTP_STREAM_H_ */
@@ -0,0 +1,33 @@
+/*
+ * i2s_stream.h
+ *
+ * host stub for the tests: the writer is an element without callbacks
+ */
+
+#ifndef TEST_STUBS_I2S_STREAM_H_
+#define TEST_STUBS_I2S_STREAM_H_
+
+#include "audio_element.h"
+#include "audio_common.h"
+
+typedef struct {
+	audio_stream_type_t type;
+	bool use_alc;
+	int  task_prio;
+	int  task_core;
+	int  out_rb_size;
+} i2s_stream_cfg_t;
+
+#define I2S_STREAM_CFG_DEFAULT() {   \
+	.type = AUDIO_STREAM_WRITER,     \
+	.use_alc = false,                \
+	.task_prio = 23,                 \
+	.task_core = 0,                  \
+	.out_rb_size = 8 * 1024          \
+}
+
+audio_element_handle_t i2s_stream_init( i2s_stream_cfg_t *config );
+esp_err_t i2s_stream_set_clk( audio_element_handle_t i2s_stream, int rate, int bits, int ch );
+esp_err_t i2s_alc_volume_set( audio_element_handle_t i2s_stream, int volume );
+
+#endif /* TEST_STUBS_I2S_STREAM_H_ */
@@ -0,0 +1,10 @@
+/*
+ * input_key_service.h
+ *
+ * host stub for the tests, adfcorrections.h only needs it for a macro
+ */
+
+#ifndef TEST_STUBS_INPUT_KEY_SERVICE_H_
+#define TEST_STUBS_INPUT_KEY_SERVICE_H_
+
+#endif /* TEST_STUBS_INPUT_KEY_SERVICE_H_ */
@@ -0,0 +1,28 @@
+/*
+ * mp3_decoder.h
+ *
+ * host stub for the tests: the decoder is an element without callbacks
+ */
+
+#ifndef TEST_STUBS_MP3_DECODER_H_
+#define TEST_STUBS_MP3_DECODER_H_
+
+#include "audio_element.h"
+
+typedef struct {
+	int out_rb_size;
+	int task_stack;
+	int task_core;
+	int task_prio;
+} mp3_decoder_cfg_t;
+
+#define DEFAULT_MP3_DECODER_CONFIG() {   \
+	.out_rb_size = 8 * 1024,          \
+	.task_stack = 4 * 1024,           \
+	.task_core = 0,                   \
+	.task_prio = 5                    \
+}
+
+audio_element_handle_t mp3_decoder_init( mp3_decoder_cfg_t *config );
+
+#endif /* TEST_STUBS_MP3_DECODER_H_ */
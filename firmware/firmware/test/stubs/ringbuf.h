@@ -0,0 +1,31 @@
+/*
+ * ringbuf.h
+ *
+ * host stub for the tests: an unbounded fifo, reads never wait
+ */
+
+#ifndef TEST_STUBS_RINGBUF_H_
+#define TEST_STUBS_RINGBUF_H_
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#define RB_OK       ( ESP_OK )
+#define RB_FAIL     ( ESP_FAIL )
+#define RB_DONE     ( -2 )
+#define RB_ABORT    ( -3 )
+#define RB_TIMEOUT  ( -4 )
+
+typedef struct ringbuf *ringbuf_handle_t;
+
+ringbuf_handle_t rb_create( int block_size, int n_blocks );
+esp_err_t rb_destroy( ringbuf_handle_t rb );
+esp_err_t rb_reset( ringbuf_handle_t rb );
+int rb_read( ringbuf_handle_t rb, char *buf, int len, TickType_t ticks_to_wait );
+int rb_write( ringbuf_handle_t rb, char *buf, int len, TickType_t ticks_to_wait );
+esp_err_t rb_done_write( ringbuf_handle_t rb );
+esp_err_t rb_abort( ringbuf_handle_t rb );
+int rb_bytes_filled( ringbuf_handle_t rb );
+int rb_get_size( ringbuf_handle_t rb );
+
+#endif /* TEST_STUBS_RINGBUF_H_ */
@@ -0,0 +1,125 @@
+/*
+ * test.h
+ *
+ * checks for the host tests, a test returns test_result() from main.
+ */
+
+#ifndef TEST_TEST_H_
+#define TEST_TEST_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+
+static int test_failures = 0;
+
+#define CHECK( cond ) do { \
+	if ( !( cond ) ) { \
+		fprintf( stderr, "%s:%d: failed: %s\n", __FILE__, __LINE__, #cond ); \
+		test_failures++; \
+	} } while ( 0 )
+
+#define CHECK_EQ( a, b ) do { \
+	long long _a = (long long) ( a ), _b = (long long) ( b ); \
+	if ( _a != _b ) { \
+		fprintf( stderr, "%s:%d: failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b ); \
+		test_failures++; \
+	} } while ( 0 )
+
+#define CHECK_NEAR( a, b, tolerance ) do { \
+	double _a = ( a ), _b = ( b ); \
+	if ( !( fabs( _a - _b ) <= ( tolerance ) ) ) { \
+		fprintf( stderr, "%s:%d: failed: %s ~ %s (%g, %g, tolerance %g)\n", __FILE__, __LINE__, #a, #b, _a, _b, (double) ( tolerance ) ); \
+		test_failures++; \
+	} } while ( 0 )
+
+// interleaved 16 bit pcm, every channel the same
+static inline std::vector<int16_t> test_sine( int frames, int channels, int rate, double frequency, double amplitude ) {
+
+	std::vector<int16_t> pcm( frames * channels );
+
+	for ( int i = 0; i < frames; i++ ) {
+		int16_t v = (int16_t) lrint( amplitude * sin( 2 * M_PI * frequency * i / rate ) );
+		for ( int c = 0; c < channels; c++ ) pcm[ i * channels + c ] = v;
+	}
+
+	return pcm;
+
+}
+
+// from the rising zero crossings, interpolated between the samples
+static inline double test_frequency( const int16_t *x, int frames, int stride, int rate ) {
+
+	double first = -1, last = -1;
+	int crossings = 0;
+
+	for ( int i = 1; i < frames; i++ ) {
+		int a = x[ ( i - 1 ) * stride ], b = x[ i * stride ];
+		if ( ( a < 0 ) && ( b >= 0 ) ) {
+			double t = i - 1 + (double) -a / ( b - a );
+			if ( first < 0 ) first = t; else crossings++;
+			last = t;
+		}
+	}
+
+	return ( crossings > 0 ) ? crossings * rate / ( last - first ) : 0;
+
+}
+
+static inline double test_rms( const int16_t *x, int frames, int stride ) {
+
+	double sum = 0;
+	for ( int i = 0; i < frames; i++ ) sum += (double) x[ i * stride ] * x[ i * stride ];
+	return ( frames > 0 ) ? sqrt( sum / frames ) : 0;
+
+}
+
+// 16 bit pcm wav, a LIST chunk behind the audio like many editors write it
+static inline bool test_write_wav( const char *path, const std::vector<int16_t> &pcm, int channels, int rate, bool list = true ) {
+
+	FILE *f = fopen( path, "wb" );
+	if ( f == NULL ) return false;
+
+	const char info[] = "INFOISFTtest";
+	uint32_t data = pcm.size() * sizeof(int16_t);
+	uint32_t riff = 4 + 24 + 8 + data + ( list ? 8 + sizeof(info) : 0 );
+	uint32_t fmt[4] = { 1u | ( (uint32_t) channels << 16 ), (uint32_t) rate, (uint32_t) rate * channels * 2, (uint32_t) channels * 2 | ( 16u << 16 ) };
+	uint32_t size = 16;
+
+	fwrite( "RIFF", 1, 4, f );
+	fwrite( &riff, 4, 1, f );
+	fwrite( "WAVEfmt ", 1, 8, f );
+	fwrite( &size, 4, 1, f );
+	fwrite( fmt, 4, 4, f );
+	fwrite( "data", 1, 4, f );
+	fwrite( &data, 4, 1, f );
+	fwrite( pcm.data(), sizeof(int16_t), pcm.size(), f );
+
+	if ( list ) {
+		size = sizeof(info);
+		fwrite( "LIST", 1, 4, f );
+		fwrite( &size, 4, 1, f );
+		fwrite( info, 1, sizeof(info), f );
+	}
+
+	fclose( f );
+	return true;
+
+}
+
+#define TEST_WAV_HEADER 44
+
+static inline int test_result( const char *name ) {
+
+	if ( test_failures > 0 ) {
+		fprintf( stderr, "%s: %d checks failed\n", name, test_failures );
+		return 1;
+	}
+
+	printf( "%s: ok\n", name );
+	return 0;
+
+}
+
+#endif /* TEST_TEST_H_ */
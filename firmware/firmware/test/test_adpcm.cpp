@@ -0,0 +1,322 @@
+/*
+ * test_adpcm.cpp
+ *
+ * bit exact decoding of IMA-ADPCM wav files and raw streams, and what it costs
+ */
+
+#include <string.h>
+#include <time.h>
+#include <audio_element.h>
+
+#include "adpcm_decoder.h"
+#include "fake_adf.h"
+#include "test.h"
+
+// decoded by python's audioop.adpcm2lin, the nibbles swapped to the wav order
+static const uint8_t raw_stream[32] = {
+	0x70, 0x77, 0x77, 0x77, 0x77, 0x90, 0x88, 0x12, 0xa0, 0xcb, 0x19, 0x81, 0xfb, 0xaa, 0x10, 0xa0,
+	0xcc, 0x19, 0x22, 0xb8, 0x9b, 0x64, 0x12, 0x89, 0x48, 0x35, 0x81, 0x89, 0x53, 0x03, 0xa9, 0x1a
+};
+
+static const int16_t raw_pcm[64] = {
+	0, 11, 41, 104, 240, 533, 1164, 2521, 5431, 11667, 12558, 10127, 9391, 8722, 11765, 13425,
+	13928, 11641, 8732, 5330, 3958, 5204, 6338, 5995, 3810, -450, -3493, -6260, -5757, -4385, -3970, -5860,
+	-8952, -12694, -14203, -12831, -10753, -8863, -9206, -11391, -13379, -14153, -12041, -8349, -5833, -4461, -5707, -6085,
+	-6428, -3617, 541, 4415, 5924, 5467, 4221, 3843, 6247, 9682, 12884, 13299, 12165, 10448, 8887, 9739
+};
+
+static const int16_t steps[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+	253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+	1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+	3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+	12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+typedef struct {
+	int predictor;
+	int index;
+} encoder_t;
+
+// reference encoder of the ima recommendation, the predictor is what a decoder reconstructs
+static uint8_t encode( encoder_t *enc, int16_t sample ) {
+
+	static const int index_step[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+	int step = steps[ enc->index ];
+	int diff = sample - enc->predictor;
+	int vpdiff = step >> 3;
+	uint8_t nibble = 0;
+
+	if ( diff < 0 ) {
+		nibble = 8;
+		diff = -diff;
+	}
+
+	for ( int bit = 4; bit > 0; bit >>= 1, step >>= 1 ) {
+		if ( diff >= step ) {
+			nibble |= bit;
+			diff -= step;
+			vpdiff += step;
+		}
+	}
+
+	enc->predictor += ( nibble & 8 ) ? -vpdiff : vpdiff;
+	if ( enc->predictor > 32767 ) enc->predictor = 32767;
+	if ( enc->predictor < -32768 ) enc->predictor = -32768;
+
+	enc->index += index_step[ nibble & 7 ];
+	if ( enc->index < 0 ) enc->index = 0;
+	if ( enc->index > 88 ) enc->index = 88;
+
+	return nibble;
+
+}
+
+static void put16( std::vector<uint8_t> &v, uint16_t x ) {
+
+	v.push_back( x & 0xff );
+	v.push_back( x >> 8 );
+
+}
+
+static void put32( std::vector<uint8_t> &v, uint32_t x ) {
+
+	put16( v, x & 0xffff );
+	put16( v, x >> 16 );
+
+}
+
+static void put_id( std::vector<uint8_t> &v, const char *id ) {
+
+	v.insert( v.end(), id, id + 4 );
+
+}
+
+// encodes interleaved pcm into wav blocks, expected gets the samples a decoder has to deliver
+static std::vector<uint8_t> encode_blocks( const std::vector<int16_t> &pcm, int channels, int block_align, std::vector<int16_t> &expected ) {
+
+	std::vector<uint8_t> data;
+	encoder_t enc[2] = {};
+	int frames = pcm.size() / channels;
+	int samples_per_block = 1 + ( block_align - 4 * channels ) * 2 / channels;
+	int pos = 0;
+
+	expected.clear();
+
+	while ( pos < frames ) {
+
+		// a short last block has complete groups of 8 samples only
+		int groups = ( ( frames - pos < samples_per_block ) ? frames - pos : samples_per_block ) / 8;
+		std::vector<int16_t> block( ( 1 + 8 * groups ) * channels );
+
+		for ( int c = 0; c < channels; c++ ) {
+			enc[c].predictor = pcm[ pos * channels + c ];
+			put16( data, enc[c].predictor );
+			data.push_back( enc[c].index );
+			data.push_back( 0 );
+			block[c] = enc[c].predictor;
+		}
+
+		for ( int g = 0; g < groups; g++ ) {
+			for ( int c = 0; c < channels; c++ ) {
+				for ( int b = 0; b < 4; b++ ) {
+					int i = 1 + 8 * g + 2 * b;
+					uint8_t lo = encode( &enc[c], pcm[ ( pos + i ) * channels + c ] );
+					block[ i * channels + c ] = enc[c].predictor;
+					uint8_t hi = encode( &enc[c], pcm[ ( pos + i + 1 ) * channels + c ] );
+					block[ ( i + 1 ) * channels + c ] = enc[c].predictor;
+					data.push_back( lo | ( hi << 4 ) );
+				}
+			}
+		}
+
+		expected.insert( expected.end(), block.begin(), block.end() );
+		pos += samples_per_block;
+
+	}
+
+	return data;
+
+}
+
+// fmt, fact, data and a trailing LIST chunk, data_size overrides the size of the data chunk
+static std::vector<uint8_t> wav_file( const std::vector<uint8_t> &data, int channels, int rate, int block_align, uint32_t data_size ) {
+
+	std::vector<uint8_t> v;
+	int samples_per_block = 1 + ( block_align - 4 * channels ) * 2 / channels;
+
+	put_id( v, "RIFF" );
+	put32( v, 0 );
+	put_id( v, "WAVE" );
+
+	put_id( v, "fmt " );
+	put32( v, 20 );
+	put16( v, 0x11 );
+	put16( v, channels );
+	put32( v, rate );
+	put32( v, rate * block_align / samples_per_block );
+	put16( v, block_align );
+	put16( v, 4 );
+	put16( v, 2 );
+	put16( v, samples_per_block );
+
+	put_id( v, "fact" );
+	put32( v, 4 );
+	put32( v, 0 );
+
+	put_id( v, "data" );
+	put32( v, data_size );
+	v.insert( v.end(), data.begin(), data.end() );
+	if ( data.size() & 1 ) v.push_back( 0 );
+
+	const char info[] = "INFOISFTtoo loud to be audio";
+	put_id( v, "LIST" );
+	put32( v, sizeof(info) );
+	v.insert( v.end(), info, info + sizeof(info) );
+
+	v[4] = ( v.size() - 8 ) & 0xff;
+	v[5] = ( v.size() - 8 ) >> 8;
+
+	return v;
+
+}
+
+static std::vector<int16_t> decode( audio_element_handle_t dec, const std::vector<uint8_t> &file, int chunk = 0 ) {
+
+	fake_element_output( dec ).clear();
+	fake_element_set_input( dec, file.data(), file.size(), chunk );
+	CHECK_EQ( fake_element_run( dec ), AEL_IO_DONE );
+
+	return fake_element_pcm( dec );
+
+}
+
+static void test_raw( audio_element_handle_t dec ) {
+
+	std::vector<uint8_t> file( raw_stream, raw_stream + sizeof(raw_stream) );
+	std::vector<int16_t> expected( raw_pcm, raw_pcm + 64 );
+
+	CHECK( decode( dec, file ) == expected );
+	CHECK( decode( dec, file, 1 ) == expected );
+
+	audio_element_info_t info;
+	audio_element_getinfo( dec, &info );
+	CHECK_EQ( info.sample_rates, ADPCM_RAW_RATE );
+	CHECK_EQ( info.channels, 1 );
+
+}
+
+static void test_wav( audio_element_handle_t dec, int channels, int rate, int block_align ) {
+
+	std::vector<int16_t> pcm = test_sine( 3000, channels, rate, 440, 12000 );
+	for ( size_t i = 0; i < pcm.size(); i += 7 ) pcm[i] += ( i % 3 ) * 2000 - 2000;
+
+	std::vector<int16_t> expected;
+	std::vector<uint8_t> data = encode_blocks( pcm, channels, block_align, expected );
+	std::vector<uint8_t> file = wav_file( data, channels, rate, block_align, data.size() );
+
+	// the LIST chunk must not be decoded
+	CHECK( decode( dec, file ) == expected );
+	CHECK( decode( dec, file, 5 ) == expected );
+
+	audio_element_info_t info;
+	audio_element_getinfo( dec, &info );
+	CHECK_EQ( info.sample_rates, rate );
+	CHECK_EQ( info.channels, channels );
+	CHECK_EQ( info.bits, 16 );
+
+}
+
+// without a size the data runs to the end of the file
+static void test_open_end( audio_element_handle_t dec ) {
+
+	std::vector<int16_t> pcm = test_sine( 1200, 1, 22050, 440, 12000 );
+	std::vector<int16_t> expected;
+	std::vector<uint8_t> data = encode_blocks( pcm, 1, 256, expected );
+
+	std::vector<int16_t> out = decode( dec, wav_file( data, 1, 22050, 256, 0 ) );
+	CHECK( out.size() > expected.size() );
+	CHECK( std::equal( expected.begin(), expected.end(), out.begin() ) );
+
+	out = decode( dec, wav_file( data, 1, 22050, 256, 0xFFFFFFFF ) );
+	CHECK( out.size() > expected.size() );
+
+	adpcm_decoder_set_open_end( dec, true );
+	out = decode( dec, wav_file( data, 1, 22050, 256, data.size() ) );
+	CHECK( out.size() > expected.size() );
+
+	// holds for one run only
+	CHECK( decode( dec, wav_file( data, 1, 22050, 256, data.size() ) ) == expected );
+
+}
+
+static void test_invalid( audio_element_handle_t dec ) {
+
+	std::vector<int16_t> expected;
+	std::vector<uint8_t> data = encode_blocks( test_sine( 600, 1, 22050, 440, 12000 ), 1, 256, expected );
+	std::vector<uint8_t> file = wav_file( data, 1, 22050, 256, data.size() );
+
+	// pcm instead of ima-adpcm
+	file[20] = 1;
+	fake_element_set_input( dec, file.data(), file.size() );
+	CHECK_EQ( fake_element_run( dec ), AEL_IO_FAIL );
+
+	// samples per block don't match the block size
+	file[20] = 0x11;
+	file[38] = 100;
+	fake_element_set_input( dec, file.data(), file.size() );
+	CHECK_EQ( fake_element_run( dec ), AEL_IO_FAIL );
+
+}
+
+// ns per decoded sample of a minute of audio. the wav and mp3 decoders are esp-adf libraries without host
+// builds: a wav is a copy of its pcm after the header, so a memcpy of the same pcm stands in for it
+static void test_cost( audio_element_handle_t dec, int channels, int rate, int block_align ) {
+
+	std::vector<int16_t> pcm = test_sine( 60 * rate, channels, rate, 440, 12000 );
+	std::vector<int16_t> expected;
+	std::vector<uint8_t> data = encode_blocks( pcm, channels, block_align, expected );
+	std::vector<uint8_t> file = wav_file( data, channels, rate, block_align, data.size() );
+
+	fake_element_output( dec ).clear();
+	fake_element_set_input( dec, file.data(), file.size() );
+	clock_t start = clock();
+	CHECK_EQ( fake_element_run( dec ), AEL_IO_DONE );
+	double seconds = (double) ( clock() - start ) / CLOCKS_PER_SEC;
+
+	size_t samples = fake_element_output( dec ).size() / sizeof(int16_t);
+	CHECK_EQ( samples, expected.size() );
+
+	std::vector<int16_t> copy( expected.size() );
+	start = clock();
+	memcpy( copy.data(), expected.data(), expected.size() * sizeof(int16_t) );
+	double copied = (double) ( clock() - start ) / CLOCKS_PER_SEC;
+	CHECK( copy == expected );
+
+	printf( "adpcm: %d Hz, %d channels, %.1f ns per sample, %.0f times real time, %u data bytes instead of %u for wav, the pcm copy takes %.2f ns per sample\n",
+			rate, channels, 1e9 * seconds / samples, samples / seconds / ( channels * rate ), (unsigned) data.size(), (unsigned) ( 2 * samples ), 1e9 * copied / samples );
+
+}
+
+int main( void ) {
+
+	adpcm_decoder_cfg_t cfg = DEFAULT_ADPCM_DECODER_CONFIG();
+	audio_element_handle_t dec = adpcm_decoder_init( &cfg );
+
+	test_raw( dec );
+	test_wav( dec, 1, 22050, 256 );
+	test_wav( dec, 1, 8000, 1024 );
+	test_wav( dec, 2, 44100, 512 );
+	test_wav( dec, 2, 32000, 2048 );
+	test_open_end( dec );
+	test_invalid( dec );
+	test_cost( dec, 1, 22050, 256 );
+	test_cost( dec, 2, 44100, 1024 );
+
+	audio_element_deinit( dec );
+
+	return test_result( "adpcm" );
+
+}
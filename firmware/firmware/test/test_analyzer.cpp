@@ -0,0 +1,175 @@
+/*
+ * test_analyzer.cpp
+ *
+ * normalization gain of the analyzer and its way through the index
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "analyzer.h"
+#include "playlist.h"
+#include "fake_adf.h"
+#include "test.h"
+
+#define RATE   22050
+#define TARGET (-16)
+
+// gain of a sine with the given peak amplitude, 1.0 = full scale
+static int sine_gain( double amplitude, int target ) {
+
+	analyzer_result_t result;
+
+	test_write_wav( "gain.wav", test_sine( RATE, 2, RATE, 440.0, 32768.0 * amplitude ), 2, RATE );
+	CHECK( analyzer_track( "gain.wav", FILETYPE_WAV, target, 0, &result ) );
+
+	// no trim without a trim level
+	CHECK_EQ( result.start, 0 );
+	CHECK_EQ( result.end, 0 );
+
+	return result.gain;
+
+}
+
+static void test_wav( void ) {
+
+	// the rms of a sine is 3dB below its peak
+	for ( double amplitude : { 0.07, 0.1, 0.2, 0.3, 0.6 } ) {
+		double rms_db = 20.0 * log10( amplitude / sqrt( 2.0 ) );
+		CHECK_EQ( sine_gain( amplitude, TARGET ), lrint( TARGET - rms_db ) );
+	}
+
+	// louder than the target
+	CHECK_EQ( sine_gain( 0.9, TARGET ), lrint( TARGET - 20.0 * log10( 0.9 / sqrt( 2.0 ) ) ) );
+
+	// 1dB headroom: peak -6dB, rms -9dB, the target would need +7dB
+	CHECK_EQ( sine_gain( 0.5, -2 ), 5 );
+
+	// limits
+	CHECK_EQ( sine_gain( 0.003, TARGET ), ANALYZER_MAX_GAIN );
+	CHECK_EQ( sine_gain( 0.9, -40 ), ANALYZER_MIN_GAIN );
+
+	// silence is nothing to measure
+	analyzer_result_t result;
+	std::vector<int16_t> silence( 2 * RATE, 0 );
+	test_write_wav( "gain.wav", silence, 2, RATE );
+	CHECK( !analyzer_track( "gain.wav", FILETYPE_WAV, TARGET, 0, &result ) );
+	CHECK_EQ( result.gain, 0 );
+
+}
+
+// TXXX frame with a latin1 description and value
+static void txxx( std::vector<uint8_t> &tag, const char *description, const char *value ) {
+
+	uint32_t n = 1 + strlen( description ) + 1 + strlen( value );
+	uint8_t hdr[10] = { 'T', 'X', 'X', 'X', (uint8_t) ( n >> 24 ), (uint8_t) ( n >> 16 ), (uint8_t) ( n >> 8 ), (uint8_t) n, 0, 0 };
+
+	tag.insert( tag.end(), hdr, hdr + 10 );
+	tag.push_back( 0 );
+	tag.insert( tag.end(), description, description + strlen( description ) + 1 );
+	tag.insert( tag.end(), value, value + strlen( value ) );
+
+}
+
+static int mp3_gain( const char *gain, const char *peak, int target, bool *found ) {
+
+	std::vector<uint8_t> frames;
+	analyzer_result_t result;
+
+	if ( gain != NULL ) txxx( frames, "replaygain_track_gain", gain );
+	if ( peak != NULL ) txxx( frames, "REPLAYGAIN_TRACK_PEAK", peak );
+	txxx( frames, "REPLAYGAIN_ALBUM_GAIN", "+20.00 dB" );
+
+	uint32_t size = frames.size();
+	uint8_t hdr[10] = { 'I', 'D', '3', 3, 0, 0, (uint8_t) ( size >> 21 ), (uint8_t) ( ( size >> 14 ) & 0x7f ), (uint8_t) ( ( size >> 7 ) & 0x7f ), (uint8_t) ( size & 0x7f ) };
+
+	FILE *f = fopen( "gain.mp3", "wb" );
+	fwrite( hdr, 1, 10, f );
+	fwrite( frames.data(), 1, size, f );
+	for ( int i = 0; i < 4000; i++ ) fputc( 0, f );
+	fclose( f );
+
+	*found = analyzer_track( "gain.mp3", FILETYPE_MP3, target, 0, &result );
+
+	return result.gain;
+
+}
+
+// replay gain refers to -18dB
+static void test_mp3( void ) {
+
+	bool found;
+
+	CHECK_EQ( mp3_gain( "-3.20 dB", "0.5", TARGET, &found ), -1 );
+	CHECK( found );
+	CHECK_EQ( mp3_gain( "+4.00 dB", NULL, TARGET, &found ), 6 );
+
+	// the peak limits it
+	CHECK_EQ( mp3_gain( "-7.6 dB", "1.0", -10, &found ), -1 );
+	CHECK_EQ( mp3_gain( "+6.00 dB", "0.5", TARGET, &found ), 5 );
+	CHECK_EQ( mp3_gain( "+30 dB", NULL, TARGET, &found ), ANALYZER_MAX_GAIN );
+
+	// the album gain alone isn't used
+	CHECK_EQ( mp3_gain( NULL, "0.5", TARGET, &found ), 0 );
+	CHECK( !found );
+
+}
+
+// analyzed gains survive saving and loading the index, unanalyzed tracks stay at 0dB
+static void test_index( void ) {
+
+	CHECK_EQ( system( "rm -rf gain && mkdir -p gain" ), 0 );
+	test_write_wav( "gain/loud.wav", test_sine( RATE, 2, RATE, 440.0, 29491.0 ), 2, RATE );
+	test_write_wav( "gain/quiet.wav", test_sine( RATE, 2, RATE, 440.0, 1638.0 ), 2, RATE );
+	test_write_wav( "gain/other.wav", test_sine( RATE, 2, RATE, 440.0, 1638.0 ), 2, RATE );
+
+	PlayList *p = new PlayList();
+	p->readFolders( "gain" );
+	p->selectFolder( 0, true );
+	CHECK_EQ( p->getTracks(), 3 );
+
+	int8_t loud = p->findName( "loud.wav" );
+	int8_t quiet = p->findName( "quiet.wav" );
+	int8_t gain[2];
+
+	for ( int i = 0; i < 2; i++ ) {
+		int8_t nr = ( i == 0 ) ? loud : quiet;
+		char path[100];
+		analyzer_result_t result;
+		p->getPath( nr, path, sizeof(path) );
+		CHECK( analyzer_track( path, p->getFiletype( nr ), TARGET, 0, &result ) );
+		p->setGain( nr, result.gain );
+		gain[i] = result.gain;
+	}
+
+	CHECK( gain[0] < 0 );
+	CHECK( gain[1] > 0 );
+
+	char index[100];
+	p->getIndexFile( index, sizeof(index) );
+	p->saveIndex( index );
+	delete p;
+
+	p = new PlayList();
+	p->readFolders( "gain" );
+	p->selectFolder( 0, false );
+	CHECK_EQ( p->getTracks(), 3 );
+	CHECK( p->isAnalyzed( p->findName( "loud.wav" ) ) );
+	CHECK_EQ( p->getGain( p->findName( "loud.wav" ) ), gain[0] );
+	CHECK_EQ( p->getGain( p->findName( "quiet.wav" ) ), gain[1] );
+	CHECK( !p->isAnalyzed( p->findName( "other.wav" ) ) );
+	CHECK_EQ( p->getGain( p->findName( "other.wav" ) ), 0 );
+	delete p;
+
+}
+
+int main( void ) {
+
+	test_wav();
+	test_mp3();
+	test_index();
+
+	return test_result( "analyzer" );
+
+}
@@ -0,0 +1,283 @@
+/*
+ * test_equalizer.cpp
+ *
+ * frequency response of the bands, the limiter and the bypass of the equalizer, and what they cost
+ */
+
+#include <time.h>
+#include <complex>
+#include <audio_element.h>
+
+#include "equalizer.h"
+#include "fake_adf.h"
+#include "test.h"
+
+#define RATE 44100
+
+static audio_element_handle_t source;
+static audio_element_handle_t eq;
+
+static void bands_off( void ) {
+
+	eq_band_t off = { EQ_OFF, 1000, 0, 1 };
+	for ( int i = 0; i < EQ_BANDS; i++ ) equalizer_set_band( i, &off );
+	equalizer_set_limiter( 0 );
+
+}
+
+// rbj cookbook in double precision, the gain in dB of one band at a frequency
+static double response( const eq_band_t *b, double frequency ) {
+
+	double A = pow( 10, b->gain / 40 );
+	double w0 = 2 * M_PI * b->frequency / RATE;
+	double cs = cos( w0 ), alpha = sin( w0 ) / ( 2 * b->q ), sq = 2 * sqrt( A ) * alpha;
+	double b0, b1, b2, a0, a1, a2;
+
+	switch ( b->type ) {
+	case EQ_PEAK:
+		b0 = 1 + alpha * A;  b1 = -2 * cs;  b2 = 1 - alpha * A;
+		a0 = 1 + alpha / A;  a1 = -2 * cs;  a2 = 1 - alpha / A;
+		break;
+	case EQ_LOW_SHELF:
+		b0 = A * ( ( A + 1 ) - ( A - 1 ) * cs + sq );
+		b1 = 2 * A * ( ( A - 1 ) - ( A + 1 ) * cs );
+		b2 = A * ( ( A + 1 ) - ( A - 1 ) * cs - sq );
+		a0 = ( A + 1 ) + ( A - 1 ) * cs + sq;
+		a1 = -2 * ( ( A - 1 ) + ( A + 1 ) * cs );
+		a2 = ( A + 1 ) + ( A - 1 ) * cs - sq;
+		break;
+	case EQ_HIGH_SHELF:
+		b0 = A * ( ( A + 1 ) + ( A - 1 ) * cs + sq );
+		b1 = -2 * A * ( ( A - 1 ) + ( A + 1 ) * cs );
+		b2 = A * ( ( A + 1 ) + ( A - 1 ) * cs - sq );
+		a0 = ( A + 1 ) - ( A - 1 ) * cs + sq;
+		a1 = 2 * ( ( A - 1 ) - ( A + 1 ) * cs );
+		a2 = ( A + 1 ) - ( A - 1 ) * cs - sq;
+		break;
+	case EQ_LOW_PASS:
+		b0 = ( 1 - cs ) / 2;  b1 = 1 - cs;  b2 = ( 1 - cs ) / 2;
+		a0 = 1 + alpha;  a1 = -2 * cs;  a2 = 1 - alpha;
+		break;
+	case EQ_HIGH_PASS:
+		b0 = ( 1 + cs ) / 2;  b1 = -( 1 + cs );  b2 = ( 1 + cs ) / 2;
+		a0 = 1 + alpha;  a1 = -2 * cs;  a2 = 1 - alpha;
+		break;
+	default:
+		return 0;
+	}
+
+	std::complex<double> z = std::polar( 1.0, -2 * M_PI * frequency / RATE );
+	std::complex<double> h = ( b0 + b1 * z + b2 * z * z ) / ( a0 + a1 * z + a2 * z * z );
+
+	return 20 * log10( std::abs( h ) );
+
+}
+
+static std::vector<int16_t> filter( const std::vector<int16_t> &in ) {
+
+	fake_element_output( eq ).clear();
+	fake_element_set_input( eq, in.data(), in.size() * sizeof(int16_t) );
+	CHECK_EQ( fake_element_run( eq ), AEL_IO_DONE );
+
+	return fake_element_pcm( eq );
+
+}
+
+// gain in dB of a sine, measured after the filter has settled
+static double gain( double frequency, int channels = 2 ) {
+
+	int frames = RATE / 4;
+	audio_element_set_music_info( source, RATE, channels, 16 );
+	std::vector<int16_t> in = test_sine( frames, channels, RATE, frequency, 4000 );
+	std::vector<int16_t> out = filter( in );
+
+	CHECK_EQ( out.size(), in.size() );
+
+	double db = 0;
+	for ( int c = 0; c < channels; c++ ) {
+		double g = 20 * log10( test_rms( &out[ frames / 2 * channels + c ], frames / 2, channels ) / test_rms( &in[ frames / 2 * channels + c ], frames / 2, channels ) );
+		if ( c > 0 ) CHECK_NEAR( g, db, 0.01 );
+		db = g;
+	}
+
+	return db;
+
+}
+
+static const double frequencies[] = { 40, 100, 250, 500, 1000, 2000, 4000, 8000, 12000, 16000 };
+
+// measured against the analytic response, as far as the sine is above the noise floor
+static void check_response( const eq_band_t *bands, int n, int channels = 2 ) {
+
+	bands_off();
+	for ( int i = 0; i < n; i++ ) equalizer_set_band( i, &bands[i] );
+
+	for ( double f : frequencies ) {
+		double expected = 0;
+		for ( int i = 0; i < n; i++ ) expected += response( &bands[i], f );
+		if ( expected < -40 ) {
+			CHECK( gain( f, channels ) < -38 );
+		} else {
+			CHECK_NEAR( gain( f, channels ), expected, ( expected > -20 ) ? 0.1 : 1.0 );
+		}
+	}
+
+}
+
+static void test_bands( void ) {
+
+	eq_band_t peak[] = { { EQ_PEAK, 1000, 6, 1.0f } };
+	check_response( peak, 1 );
+	check_response( peak, 1, 1 );
+
+	eq_band_t cut[] = { { EQ_PEAK, 3000, -9, 4.0f } };
+	check_response( cut, 1 );
+
+	eq_band_t shelves[] = { { EQ_LOW_SHELF, 200, 6, 0.707f }, { EQ_HIGH_SHELF, 5000, -6, 0.707f } };
+	check_response( shelves, 2 );
+
+	eq_band_t passes[] = { { EQ_HIGH_PASS, 80, 0, 0.707f }, { EQ_LOW_PASS, 4000, 0, 0.707f } };
+	check_response( passes, 2 );
+
+	eq_band_t all[] = { { EQ_LOW_SHELF, 100, 4, 0.707f }, { EQ_PEAK, 500, -3, 2.0f }, { EQ_PEAK, 2500, 5, 1.5f }, { EQ_HIGH_SHELF, 10000, 3, 0.707f } };
+	check_response( all, 4 );
+
+	// the corner and center frequencies
+	bands_off();
+	equalizer_set_band( 0, &peak[0] );
+	CHECK_NEAR( gain( 1000 ), 6.0, 0.1 );
+	equalizer_set_band( 0, &passes[1] );
+	CHECK_NEAR( gain( 4000 ), -3.0, 0.1 );
+
+}
+
+// the limiter holds the peaks at the threshold, in spite of a boost
+static void test_limiter( void ) {
+
+	bands_off();
+	eq_band_t band = { EQ_PEAK, 1000, 12, 1.0f };
+	equalizer_set_band( 0, &band );
+	equalizer_set_limiter( -6 );
+	audio_element_set_music_info( source, RATE, 2, 16 );
+
+	std::vector<int16_t> in = test_sine( RATE / 2, 2, RATE, 1000, 16000 );
+	std::vector<int16_t> out = filter( in );
+
+	int peak = 0;
+	for ( int16_t v : out ) peak = ( abs( v ) > peak ) ? abs( v ) : peak;
+
+	// -6dBFS
+	CHECK( peak <= 16423 );
+	CHECK( peak > 15000 );
+
+	// without the limiter the boost saturates
+	equalizer_set_limiter( 0 );
+	out = filter( in );
+	peak = 0;
+	for ( int16_t v : out ) peak = ( abs( v ) > peak ) ? abs( v ) : peak;
+	CHECK( peak >= 32767 );
+
+}
+
+// without bands the samples pass untouched, incomplete frames as well
+static void test_bypass( void ) {
+
+	bands_off();
+	audio_element_set_music_info( source, RATE, 2, 16 );
+
+	std::vector<int16_t> in = test_sine( 3001, 2, RATE, 440, 20000 );
+	CHECK( filter( in ) == in );
+
+	fake_element_output( eq ).clear();
+	fake_element_set_input( eq, in.data(), in.size() * sizeof(int16_t), 5 );
+	fake_element_run( eq );
+	CHECK( fake_element_pcm( eq ) == in );
+
+	// a band enabled splits frames the same way
+	eq_band_t band = { EQ_PEAK, 1000, 3, 1.0f };
+	equalizer_set_band( 0, &band );
+	std::vector<int16_t> a = filter( in );
+	fake_element_output( eq ).clear();
+	fake_element_set_input( eq, in.data(), in.size() * sizeof(int16_t), 5 );
+	fake_element_run( eq );
+	CHECK( fake_element_pcm( eq ) == a );
+
+}
+
+static void test_settings( void ) {
+
+	eq_band_t band = { EQ_PEAK, 5, 30, 0 };
+	CHECK( equalizer_set_band( 0, &band ) );
+
+	eq_band_t b = equalizer_get_band( 0 );
+	CHECK_EQ( b.frequency, 20 );
+	CHECK_NEAR( b.gain, EQ_MAX_GAIN, 0 );
+	CHECK_NEAR( b.q, 0.1, 1e-6 );
+
+	CHECK( !equalizer_set_band( EQ_BANDS, &band ) );
+	band.type = (eq_type_t) 6;
+	CHECK( !equalizer_set_band( 0, &band ) );
+
+	CHECK( equalizer_parse( "EQ_BAND2", "3,8000,-4.5,0.7" ) );
+	b = equalizer_get_band( 1 );
+	CHECK_EQ( b.type, EQ_HIGH_SHELF );
+	CHECK_EQ( b.frequency, 8000 );
+	CHECK_NEAR( b.gain, -4.5, 1e-6 );
+
+	CHECK( equalizer_parse( "EQ_LIMITER", "-40" ) );
+	CHECK_EQ( equalizer_get_limiter(), -24 );
+	CHECK( !equalizer_parse( "VOLUME", "10" ) );
+
+	bands_off();
+
+}
+
+// ns per sample of ten seconds of stereo, from the bypass up to all bands and the limiter
+static void test_cost( void ) {
+
+	eq_band_t all[EQ_BANDS] = { { EQ_LOW_SHELF, 100, 4, 0.707f }, { EQ_PEAK, 500, -3, 2.0f }, { EQ_PEAK, 2500, 5, 1.5f }, { EQ_HIGH_SHELF, 10000, 3, 0.707f } };
+
+	audio_element_set_music_info( source, RATE, 2, 16 );
+	std::vector<int16_t> in = test_sine( 10 * RATE, 2, RATE, 1000, 8000 );
+
+	for ( int bands = 0; bands <= EQ_BANDS + 1; bands++ ) {
+
+		bands_off();
+		for ( int i = 0; ( i < bands ) && ( i < EQ_BANDS ); i++ ) equalizer_set_band( i, &all[i] );
+		if ( bands > EQ_BANDS ) equalizer_set_limiter( -6 );
+
+		clock_t start = clock();
+		std::vector<int16_t> out = filter( in );
+		double seconds = (double) ( clock() - start ) / CLOCKS_PER_SEC;
+
+		CHECK_EQ( out.size(), in.size() );
+		printf( "equalizer: %d bands%s, %.1f ns per sample\n", ( bands > EQ_BANDS ) ? EQ_BANDS : bands, ( bands > EQ_BANDS ) ? " and the limiter" : "", 1e9 * seconds / in.size() );
+
+	}
+
+	bands_off();
+
+}
+
+int main( void ) {
+
+	audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+	source = audio_element_init( &cfg );
+	audio_element_set_music_info( source, RATE, 2, 16 );
+
+	equalizer_cfg_t eq_cfg = DEFAULT_EQUALIZER_CONFIG();
+	eq = equalizer_init( &eq_cfg );
+	equalizer_set_source( eq, source );
+
+	test_bands();
+	test_limiter();
+	test_bypass();
+	test_settings();
+	test_cost();
+
+	audio_element_deinit( eq );
+	audio_element_deinit( source );
+
+	return test_result( "equalizer" );
+
+}
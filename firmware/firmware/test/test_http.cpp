@@ -0,0 +1,352 @@
+/*
+ * test_http.cpp
+ *
+ * tracks on a media server: urls go to the http reader, sd card tracks get the sd reader back.
+ * a server on the loopback serves them, so the reader's start, throughput and range requests are real.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "pipeline.h"
+#include "fake_adf.h"
+#include "test.h"
+
+static Pipeline *player;
+static audio_pipeline_handle_t pipeline;
+
+#define SONG  ( 16 * 1024 * 1024 )		// bytes the server sends for every path
+
+static int server;
+static int port;
+static std::vector<char> song;
+static std::atomic<long long> range_from;	// of the last request, -1 = without a range
+
+static uint8_t pattern( uint32_t pos ) {
+
+	return ( pos * 7 + ( pos >> 8 ) ) & 0xFF;
+
+}
+
+// one request per connection: the whole song, or from the start of a range to its end
+static void serve( void ) {
+
+	int client;
+	while ( ( client = accept( server, NULL, NULL ) ) >= 0 ) {
+
+		std::string request;
+		char buf[1024];
+		while ( request.find( "\r\n\r\n" ) == std::string::npos ) {
+			ssize_t n = recv( client, buf, sizeof(buf), 0 );
+			if ( n <= 0 ) break;
+			request.append( buf, n );
+		}
+
+		const char range_header[] = "\r\nRange: bytes=";
+		long long from = -1;
+		size_t range = request.find( range_header );
+		if ( range != std::string::npos ) from = atoll( request.c_str() + range + strlen( range_header ) );
+		range_from = from;
+
+		std::string header;
+		if ( from < 0 ) {
+			header = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string( SONG ) + "\r\n\r\n";
+			from = 0;
+		} else {
+			header = "HTTP/1.1 206 Partial Content\r\nContent-Length: " + std::to_string( SONG - from ) +
+			         "\r\nContent-Range: bytes " + std::to_string( from ) + "-" + std::to_string( SONG - 1 ) + "/" + std::to_string( SONG ) + "\r\n\r\n";
+		}
+
+		bool sent = send( client, header.data(), header.size(), MSG_NOSIGNAL ) > 0;
+		for ( long long pos = from; sent && ( pos < SONG ); ) {
+			ssize_t n = send( client, &song[pos], std::min( SONG - pos, 16384LL ), MSG_NOSIGNAL );
+			sent = ( n > 0 );
+			pos += n;
+		}
+
+		close( client );
+
+	}
+
+}
+
+static std::thread start_server( void ) {
+
+	song.resize( SONG );
+	for ( uint32_t i = 0; i < SONG; i++ ) song[i] = pattern( i );
+
+	server = socket( AF_INET, SOCK_STREAM, 0 );
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+	CHECK_EQ( bind( server, (struct sockaddr *) &addr, sizeof(addr) ), 0 );
+	CHECK_EQ( listen( server, 4 ), 0 );
+
+	socklen_t len = sizeof(addr);
+	getsockname( server, (struct sockaddr *) &addr, &len );
+	port = ntohs( addr.sin_port );
+
+	return std::thread( serve );
+
+}
+
+static std::string song_url( const char *name ) {
+
+	return "http://127.0.0.1:" + std::to_string( port ) + "/music/" + name;
+
+}
+
+static double now( void ) {
+
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec + t.tv_nsec * 1e-9;
+
+}
+
+// reads what the http reader gets to its end, false if a byte isn't the server's at that position
+static bool receive( audio_element_handle_t http, uint32_t from, uint32_t *bytes ) {
+
+	bool ok = true;
+	int r;
+
+	*bytes = 0;
+	while ( ( r = fake_element_process( http ) ) > 0 ) {
+		std::vector<uint8_t> &out = fake_element_output( http );
+		for ( size_t i = 0; ok && ( i < out.size() ); i++ ) ok = ( out[i] == pattern( from + *bytes + i ) );
+		*bytes += out.size();
+		out.clear();
+	}
+
+	return ok && ( r == AEL_IO_DONE );
+
+}
+
+static void finish( void ) {
+
+	fake_pipeline_finish( pipeline );
+
+	audio_event_iface_msg_t msg = {};
+	msg.source_type = AUDIO_ELEMENT_TYPE_ELEMENT;
+	msg.source = fake_pipeline_element( pipeline, "i2s" );
+	msg.cmd = AEL_MSG_CMD_REPORT_STATUS;
+	player->audioMessageHandler( msg );
+
+}
+
+static fake_run_t &last( void ) {
+
+	return fake_pipeline_runs( pipeline ).back();
+
+}
+
+static void test_filetype( void ) {
+
+	CHECK_EQ( PlayList::filetypeOf( "http://server/music/song.mp3" ), FILETYPE_MP3 );
+	CHECK_EQ( PlayList::filetypeOf( "http://server/get.php/horn.WAV?id=1&x=a.ogg" ), FILETYPE_WAV );
+	CHECK_EQ( PlayList::filetypeOf( "http://server/song.ogg#t=10" ), FILETYPE_OGG );
+	CHECK_EQ( PlayList::filetypeOf( "http://server/v1.2/stream" ), FILETYPE_UNKOWN );
+	CHECK_EQ( PlayList::filetypeOf( "http://server.local" ), FILETYPE_UNKOWN );
+	CHECK_EQ( PlayList::filetypeOf( "song.mp3x" ), FILETYPE_UNKOWN );
+
+}
+
+// without HTTP_BUFFER there is no http reader
+static void test_disabled( void ) {
+
+	Pipeline *sd_only = new Pipeline();
+	sd_only->StartCodec();
+	audio_pipeline_handle_t p = fake_pipeline( 0 );
+
+	CHECK( !sd_only->playUrl( (char *) "http://server/song.mp3" ) );
+	CHECK( fake_pipeline_runs( p ).empty() );
+
+}
+
+static void test_url( void ) {
+
+	char url[] = "http://192.168.7.10:8000/music/song.mp3?token=42";
+
+	CHECK( player->playUrl( url ) );
+	CHECK( last().uri == url );
+	CHECK( last().decoder == "mp3" );
+	audio_element_handle_t http = fake_pipeline_element( pipeline, "file" );
+
+	// the sd card again
+	CHECK( player->play( player->playList.findName( "horn.mp3" ), PRIORITY_NORMAL ) );
+	CHECK( last().uri == "http/horn.mp3" );
+	CHECK( fake_pipeline_element( pipeline, "file" ) != http );
+
+	// and back, the decoder stays but the reader changes
+	CHECK( player->playUrl( url ) );
+	CHECK( fake_pipeline_element( pipeline, "file" ) == http );
+
+	// the url changes with the next one
+	char other[] = "http://192.168.7.10:8000/music/other.wav";
+	CHECK( player->playUrl( other ) );
+	CHECK( last().uri == other );
+	CHECK( last().decoder == "wav" );
+
+	player->stop();
+
+}
+
+static void test_rejected( void ) {
+
+	size_t n = fake_pipeline_runs( pipeline ).size();
+
+	CHECK( !player->playUrl( (char *) "https://server/song.mp3" ) );
+	CHECK( !player->playUrl( (char *) "ftp://server/song.mp3" ) );
+	CHECK( !player->playUrl( (char *) "http://server/playlist.m3u" ) );
+	CHECK( !player->playUrl( (char *) "horn.mp3" ) );
+	CHECK_EQ( fake_pipeline_runs( pipeline ).size(), n );
+
+}
+
+// an url plays once: it neither repeats nor resumes, and it doesn't interrupt a clip
+static void test_oneshot( void ) {
+
+	char url[] = "http://server/song.mp3";
+
+	player->setMode( MODE_REPEAT );
+	CHECK( player->playUrl( url ) );
+	size_t n = fake_pipeline_runs( pipeline ).size();
+	finish();
+	CHECK_EQ( fake_pipeline_runs( pipeline ).size(), n );
+
+	player->playUrl( url );
+	CHECK( player->play( player->playList.findName( "horn.mp3" ), 3 ) );
+	n = fake_pipeline_runs( pipeline ).size();
+	CHECK( !player->playUrl( url ) );
+	CHECK_EQ( fake_pipeline_runs( pipeline ).size(), n );
+	finish();
+	CHECK_EQ( fake_pipeline_runs( pipeline ).size(), n );
+	CHECK_EQ( player->getPriority(), PRIORITY_NORMAL );
+
+	player->setMode( MODE_SINGLE_TRACK );
+	player->stop();
+
+}
+
+// the time to the first byte and the sustained rate of a url, the song isn't asked for by range
+static void test_server( void ) {
+
+	std::string url = song_url( "song.mp3" );
+	CHECK( player->playUrl( (char *) url.c_str() ) );
+	audio_element_handle_t http = fake_pipeline_element( pipeline, "file" );
+	fake_element_output( http ).clear();
+
+	double start = now();
+	CHECK_EQ( fake_element_open( http ), ESP_OK );
+	CHECK( fake_element_process( http ) > 0 );
+	double first = now();
+
+	uint32_t head = fake_element_output( http ).size();
+	fake_element_output( http ).clear();
+	uint32_t bytes;
+	CHECK( receive( http, head, &bytes ) );
+	double end = now();
+	bytes += head;
+	fake_element_close( http );
+
+	CHECK_EQ( bytes, (uint32_t) SONG );
+	CHECK_EQ( range_from.load(), -1LL );
+
+	audio_element_info_t info;
+	audio_element_getinfo( http, &info );
+	CHECK_EQ( info.byte_pos, 0 );
+	printf( "http: %.2f ms to the first byte, %u MB in %.2f s, %.0f MB/s\n", 1e3 * ( first - start ), SONG >> 20, end - start, ( SONG >> 20 ) / ( end - start ) );
+
+	player->stop();
+
+	// nobody listening
+	CHECK( player->playUrl( (char *) "http://127.0.0.1:1/song.mp3" ) );
+	CHECK( fake_element_open( http ) != ESP_OK );
+	fake_element_close( http );
+	player->stop();
+
+}
+
+// a track of the index on the server, interrupted by a clip: it resumes by a range request where it was read
+static void test_range( void ) {
+
+	std::string url = song_url( "resume.mp3" );
+	FILE *index = fopen( "http/" INDEX_NAME, "w" );
+	fprintf( index, "INDEX_VERSION=%d\nTRACK=horn.mp3\nTRACK=%s\n", INDEX_VERSION, url.c_str() );
+	fclose( index );
+	CHECK( player->playList.selectFolder( 0, false ) );
+
+	int8_t track = player->playList.findName( url.c_str() );
+	CHECK( track >= 0 );
+	CHECK( player->play( track, PRIORITY_NORMAL ) );
+	CHECK( last().uri == url );
+	audio_element_handle_t http = fake_pipeline_element( pipeline, "file" );
+
+	// the reader's task got this far
+	CHECK_EQ( fake_element_open( http ), ESP_OK );
+	for ( int i = 0; i < 5; i++ ) CHECK( fake_element_process( http ) > 0 );
+	audio_element_info_t info;
+	audio_element_getinfo( http, &info );
+	int64_t pos = info.byte_pos;
+	CHECK( pos > 0 );
+
+	CHECK( player->play( player->playList.findName( "horn.mp3" ), 3 ) );
+	fake_element_close( http );
+	CHECK( last().uri == "http/horn.mp3" );
+
+	finish();
+	CHECK( last().uri == url );
+	CHECK_EQ( last().byte_pos, pos );
+
+	fake_element_output( http ).clear();
+	CHECK_EQ( fake_element_open( http ), ESP_OK );
+	CHECK_EQ( range_from.load(), (long long) pos );
+	audio_element_getinfo( http, &info );
+	CHECK_EQ( info.total_bytes, SONG );
+
+	uint32_t bytes;
+	CHECK( receive( http, pos, &bytes ) );
+	CHECK_EQ( bytes, SONG - pos );
+	fake_element_close( http );
+
+	player->stop();
+	remove( "http/" INDEX_NAME );
+
+}
+
+int main( void ) {
+
+	CHECK_EQ( system( "rm -rf http && mkdir -p http" ), 0 );
+	fclose( fopen( "http/horn.mp3", "w" ) );
+
+	test_filetype();
+	test_disabled();
+
+	player = new Pipeline();
+	player->playList.readFolders( "http" );
+	player->playList.selectFolder( 0, true );
+	player->setHttpBuffer( 64 * 1024 );
+	player->StartCodec();
+	pipeline = fake_pipeline( 1 );
+
+	test_url();
+	test_rejected();
+	test_oneshot();
+
+	std::thread thread = start_server();
+	test_server();
+	test_range();
+	shutdown( server, SHUT_RDWR );
+	close( server );
+	thread.join();
+
+	return test_result( "http" );
+
+}
@@ -0,0 +1,174 @@
+/*
+ * test_mixer.cpp
+ *
+ * ducking envelope of the music and the foreground mixed over it
+ */
+
+#include <audio_element.h>
+#include <ringbuf.h>
+
+#include "mixer.h"
+#include "fake_adf.h"
+#include "test.h"
+
+#define RATE     44100
+#define MUSIC    16000		// dc on both channels, so the output is the gain
+#define EFFECT   1000		// right channel of the foreground, the left one is silent
+
+static audio_element_handle_t mix;
+static ringbuf_handle_t fg;
+static int duck;			// music level while ducked
+
+static int frames_out( void ) {
+
+	return fake_element_output( mix ).size() / 4;
+
+}
+
+// processes until there are at least frames output frames, returns the last result
+static int run_until( int frames ) {
+
+	int ret = 1;
+	while ( ( frames_out() < frames ) && ( ret > 0 ) ) ret = fake_element_process( mix );
+	return ret;
+
+}
+
+static void start( int music_frames ) {
+
+	static std::vector<int16_t> music;
+	music.assign( 2 * music_frames, MUSIC );
+
+	fake_element_output( mix ).clear();
+	fake_element_set_input( mix, music.data(), music.size() * sizeof(int16_t) );
+	fake_element_open( mix );
+
+}
+
+static void effect( int frames, bool done ) {
+
+	rb_reset( fg );
+	for ( int i = 0; i < frames; i++ ) {
+		int16_t frame[2] = { 0, EFFECT };
+		rb_write( fg, (char *) frame, sizeof(frame), 0 );
+	}
+	if ( done ) rb_done_write( fg );
+
+	mixer_start_foreground( mix );
+
+}
+
+static void test_envelope( void ) {
+
+	start( 3 * RATE );
+
+	// untouched without a foreground
+	run_until( 512 );
+	std::vector<int16_t> out = fake_element_pcm( mix );
+	CHECK_EQ( out.size(), 2 * 512 );
+	for ( int16_t v : out ) CHECK_EQ( v, MUSIC );
+
+	effect( RATE, true );
+	CHECK( mixer_foreground_active( mix ) );
+	CHECK_EQ( run_until( 4 * RATE ), AEL_IO_DONE );
+	fake_element_close( mix );
+	CHECK( !mixer_foreground_active( mix ) );
+
+	out = fake_element_pcm( mix );
+	int frames = out.size() / 2;
+	CHECK_EQ( frames, 3 * RATE );
+
+	// the effect is mixed at full level
+	for ( int i = 512; i < 512 + RATE; i++ ) CHECK_EQ( out[ 2 * i + 1 ] - out[ 2 * i ], EFFECT );
+	for ( int i = 512 + RATE; i < frames; i++ ) CHECK_EQ( out[ 2 * i + 1 ], out[ 2 * i ] );
+
+	// attack: linear down to the duck level within 50ms
+	int attack_end = 512;
+	while ( ( attack_end < frames ) && ( out[ 2 * attack_end ] > duck ) ) attack_end++;
+	CHECK( attack_end - 512 <= 50 * RATE / 1000 );
+	CHECK( attack_end - 512 >= 50 * RATE / 1000 - 2 );
+	CHECK_NEAR( out[ 2 * ( 512 + 25 * RATE / 1000 ) ], ( MUSIC + duck ) / 2, 100 );
+	for ( int i = 513; i < attack_end; i++ ) CHECK( out[ 2 * i ] <= out[ 2 * ( i - 1 ) ] );
+
+	// ducked while the effect plays, the release starts with the block after its end
+	int release_start = attack_end;
+	while ( ( release_start < frames ) && ( out[ 2 * release_start ] == duck ) ) release_start++;
+	CHECK( release_start >= 512 + RATE );
+	CHECK( release_start <= 512 + RATE + MIXER_BLOCK_FRAMES );
+
+	// release: linear back to full level within 300ms
+	int release_end = release_start;
+	while ( ( release_end < frames ) && ( out[ 2 * release_end ] < MUSIC ) ) release_end++;
+	CHECK( release_end - release_start <= 300 * RATE / 1000 );
+	CHECK( release_end - release_start >= 300 * RATE / 1000 - 2 );
+	CHECK_NEAR( out[ 2 * ( release_start + 150 * RATE / 1000 ) ], ( MUSIC + duck ) / 2, 100 );
+	for ( int i = release_start + 1; i < release_end; i++ ) CHECK( out[ 2 * i ] >= out[ 2 * ( i - 1 ) ] );
+	for ( int i = release_end; i < frames; i++ ) CHECK_EQ( out[ 2 * i ], MUSIC );
+
+}
+
+// the effect plays to its end after the music
+static void test_music_ends( void ) {
+
+	start( 1000 );
+	effect( 5000, true );
+
+	CHECK_EQ( run_until( 100000 ), AEL_IO_DONE );
+	fake_element_close( mix );
+
+	std::vector<int16_t> out = fake_element_pcm( mix );
+	int effect_frames = 0;
+	for ( size_t i = 0; i < out.size(); i += 2 ) {
+		if ( i >= 2 * 1000 ) CHECK_EQ( out[i], 0 );
+		if ( out[ i + 1 ] - out[i] == EFFECT ) effect_frames++;
+	}
+
+	CHECK_EQ( effect_frames, 5000 );
+
+}
+
+// a foreground without data ends after MIXER_STARVED_MS
+static void test_starved( void ) {
+
+	start( 2 * RATE );
+	effect( 0, false );
+
+	run_until( RATE * MIXER_STARVED_MS / 1000 - MIXER_BLOCK_FRAMES );
+	CHECK( mixer_foreground_active( mix ) );
+
+	run_until( RATE * MIXER_STARVED_MS / 1000 + 2 * MIXER_BLOCK_FRAMES );
+	CHECK( !mixer_foreground_active( mix ) );
+
+	// and the music comes back
+	CHECK_EQ( run_until( 3 * RATE ), AEL_IO_DONE );
+	fake_element_close( mix );
+	std::vector<int16_t> out = fake_element_pcm( mix );
+	CHECK_EQ( out.back(), MUSIC );
+
+}
+
+int main( void ) {
+
+	mixer_cfg_t cfg = DEFAULT_MIXER_CONFIG();
+	cfg.rate = RATE;
+	cfg.duck_level = -12;
+	cfg.attack = 50;
+	cfg.release = 300;
+
+	mix = mixer_init( &cfg );
+	fg = rb_create( MIXER_FOREGROUND_SIZE, 1 );
+	mixer_set_foreground( mix, fg );
+
+	// the mixer applies its gain in Q15
+	duck = ( MUSIC * ( lrint( ( 1 << 27 ) * pow( 10, -12 / 20.0 ) ) >> 12 ) ) >> 15;
+
+	test_envelope();
+	test_music_ends();
+	test_starved();
+
+	audio_element_deinit( mix );
+	rb_destroy( fg );
+
+	return test_result( "mixer" );
+
+}
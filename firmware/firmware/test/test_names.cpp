@@ -0,0 +1,76 @@
+/*
+ * test_names.cpp
+ *
+ * finding tracks by name, by clip name and by the hash of the name
+ */
+
+#include <stdlib.h>
+#include <string>
+
+#include "playlist.h"
+#include "fake_adf.h"
+#include "test.h"
+
+static PlayList *p;
+
+static void test_name( void ) {
+
+	CHECK_EQ( p->findName( "horn.mp3" ), p->findName( "HORN.MP3" ) );
+	CHECK( p->findName( "horn.mp3" ) >= 0 );
+	CHECK_EQ( p->findName( "horn" ), -1 );
+	CHECK_EQ( p->findName( "bell.mp3" ), -1 );
+
+}
+
+// the name without its extension, in any case like the sd card
+static void test_clip( void ) {
+
+	int8_t horn = p->findName( "horn.mp3" );
+
+	CHECK_EQ( p->findClip( "horn" ), horn );
+	CHECK_EQ( p->findClip( "Horn" ), horn );
+	CHECK_EQ( p->findClip( "HORN" ), horn );
+	CHECK_EQ( p->findClip( "hor" ), -1 );
+	CHECK_EQ( p->findClip( "horn.mp3" ), -1 );
+
+}
+
+static void test_hash( void ) {
+
+	int8_t horn = p->findName( "horn.mp3" );
+
+	CHECK_EQ( p->findHash( PlayList::hashName( "horn.mp3" ) ), horn );
+	CHECK_EQ( p->findHash( PlayList::hashName( "HORN.mp3" ) ), horn );
+	CHECK_EQ( p->findHash( PlayList::hashName( "bell.mp3" ) ), -1 );
+
+	// t03695b.mp3 and t0718c8.mp3 have the same fnv-1a hash: neither plays by hash, both by name
+	uint32_t shared = PlayList::hashName( "t03695b.mp3" );
+	CHECK_EQ( shared, PlayList::hashName( "t0718c8.mp3" ) );
+	CHECK_EQ( p->findHash( shared ), -1 );
+	CHECK( p->findName( "t03695b.mp3" ) >= 0 );
+	CHECK( p->findName( "t0718c8.mp3" ) >= 0 );
+	CHECK( p->findName( "t03695b.mp3" ) != p->findName( "t0718c8.mp3" ) );
+
+}
+
+int main( void ) {
+
+	CHECK_EQ( system( "rm -rf names && mkdir -p names" ), 0 );
+	static const char *files[] = { "horn.mp3", "t03695b.mp3", "t0718c8.mp3", "siren.wav" };
+	for ( const char *name : files ) {
+		std::string path = std::string( "names/" ) + name;
+		fclose( fopen( path.c_str(), "w" ) );
+	}
+
+	p = new PlayList();
+	p->readFolders( "names" );
+	p->selectFolder( 0, true );
+	CHECK_EQ( p->getTracks(), 4 );
+
+	test_name();
+	test_clip();
+	test_hash();
+
+	return test_result( "names" );
+
+}
@@ -0,0 +1,179 @@
+/*
+ * test_ogg.cpp
+ *
+ * soak test of the decoder lifecycle: the same ogg track played hundreds of times leaves no elements or heap behind
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <string>
+
+#include "pipeline.h"
+#include "resampler.h"
+#include "fake_adf.h"
+#include "test.h"
+
+#define PLAYS 500
+
+static Pipeline *player;
+static audio_pipeline_handle_t pipe;
+static audio_pipeline_handle_t fg_pipe;
+
+static int8_t track( const char *name ) {
+
+	return player->playList.findName( name );
+
+}
+
+static void finish( audio_pipeline_handle_t p ) {
+
+	fake_pipeline_finish( p );
+
+	audio_event_iface_msg_t msg = {};
+	msg.source_type = AUDIO_ELEMENT_TYPE_ELEMENT;
+	msg.source = fake_pipeline_element( p, "i2s" );
+	msg.cmd = AEL_MSG_CMD_REPORT_STATUS;
+	player->audioMessageHandler( msg );
+
+}
+
+static size_t heap( void ) {
+
+	return mallinfo2().uordblks;
+
+}
+
+// every ogg track gets a new decoder, the one before is freed
+static void test_repeat( void ) {
+
+	int8_t song = track( "song.ogg" );
+
+	player->play( song, PRIORITY_NORMAL );
+	finish( pipe );
+
+	int alive = fake_elements_alive();
+	size_t before = heap();
+
+	for ( int i = 0; i < PLAYS; i++ ) {
+		int created = fake_elements_created();
+		fake_pipeline_runs( pipe ).clear();
+		CHECK( player->play( song, PRIORITY_NORMAL ) );
+		CHECK_EQ( fake_elements_created(), created + 1 );
+		CHECK_EQ( fake_pipeline_runs( pipe ).size(), 1 );
+		CHECK( fake_pipeline_runs( pipe ).back().decoder == "ogg" );
+		finish( pipe );
+	}
+
+	CHECK_EQ( fake_elements_alive(), alive );
+	CHECK_NEAR( (double) heap(), (double) before, 1024 );
+
+	// repeat mode plays it again from the end of the track
+	player->setMode( MODE_REPEAT );
+	player->play( song, PRIORITY_NORMAL );
+	before = heap();
+	for ( int i = 0; i < PLAYS; i++ ) {
+		int created = fake_elements_created();
+		fake_pipeline_runs( pipe ).clear();
+		finish( pipe );
+		CHECK_EQ( fake_elements_created(), created + 1 );
+		CHECK_EQ( fake_pipeline_runs( pipe ).size(), 1 );
+	}
+	player->setMode( MODE_SINGLE_TRACK );
+	player->stop();
+
+	CHECK_EQ( fake_elements_alive(), alive );
+	CHECK_NEAR( (double) heap(), (double) before, 1024 );
+
+}
+
+// switching formats replaces the decoder, an interrupting clip recreates the ogg decoder for the resume
+static void test_switch( void ) {
+
+	int alive = fake_elements_alive();
+	size_t before = heap();
+
+	for ( int i = 0; i < PLAYS; i++ ) {
+		fake_pipeline_runs( pipe ).clear();
+		player->play( track( "song.ogg" ), PRIORITY_NORMAL );
+		player->play( track( "horn.wav" ), 2 );
+		finish( pipe );
+		CHECK( fake_pipeline_runs( pipe ).back().decoder == "ogg" );
+		player->play( track( "music.mp3" ), PRIORITY_NORMAL );
+		CHECK( fake_pipeline_runs( pipe ).back().decoder == "mp3" );
+		finish( pipe );
+	}
+
+	CHECK_EQ( fake_elements_alive(), alive );
+	CHECK_NEAR( (double) heap(), (double) before, 1024 );
+
+}
+
+// ogg effects over the music get a new decoder each as well
+static void test_foreground( void ) {
+
+	player->play( track( "music.mp3" ), PRIORITY_NORMAL );
+
+	CHECK( player->playForeground( track( "bell.ogg" ) ) );
+	int alive = fake_elements_alive();
+	size_t before = heap();
+
+	for ( int i = 0; i < PLAYS; i++ ) {
+		int created = fake_elements_created();
+		fake_pipeline_runs( fg_pipe ).clear();
+		CHECK( player->playForeground( track( "bell.ogg" ) ) );
+		CHECK_EQ( fake_elements_created(), created + 1 );
+		CHECK_EQ( fake_pipeline_runs( fg_pipe ).size(), 1 );
+		CHECK( fake_pipeline_runs( fg_pipe ).back().decoder == "ogg" );
+		fake_pipeline_finish( fg_pipe );
+	}
+
+	CHECK_EQ( fake_elements_alive(), alive );
+	CHECK_NEAR( (double) heap(), (double) before, 1024 );
+
+	player->stop();
+
+}
+
+// a phrase needs one decoder for all clips, ogg can't be joined
+static void test_phrase( void ) {
+
+	int8_t clips[2] = { track( "bell.ogg" ), track( "song.ogg" ) };
+
+	size_t n = fake_pipeline_runs( pipe ).size();
+	CHECK( !player->playPhrase( clips, 2 ) );
+	CHECK_EQ( fake_pipeline_runs( pipe ).size(), n );
+
+}
+
+int main( void ) {
+
+	static const char *tracks[] = { "song.ogg", "bell.ogg", "horn.wav", "music.mp3" };
+
+	CHECK_EQ( system( "rm -rf ogg && mkdir -p ogg" ), 0 );
+	for ( const char *name : tracks ) {
+		std::string path = std::string( "ogg/" ) + name;
+		fclose( fopen( path.c_str(), "w" ) );
+	}
+
+	player = new Pipeline();
+	player->playList.readFolders( "ogg" );
+	player->playList.selectFolder( 0, true );
+	CHECK_EQ( player->playList.getTracks(), 4 );
+
+	// ducking builds the foreground pipeline
+	player->setOutputRate( 44100, RESAMPLE_QUALITY_MEDIUM );
+	player->setDucking( true, -12, 50, 300 );
+	player->StartCodec();
+	pipe = fake_pipeline( 0 );
+	fg_pipe = fake_pipeline( 1 );
+	CHECK( fg_pipe != NULL );
+
+	test_repeat();
+	test_switch();
+	test_foreground();
+	test_phrase();
+
+	return test_result( "ogg" );
+
+}
@@ -0,0 +1,448 @@
+/*
+ * test_preemption.cpp
+ *
+ * priorities of the pipeline: interrupted tracks resume where they were, waiting and queued tracks follow in order
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "pipeline.h"
+#include "fake_adf.h"
+#include "test.h"
+
+static Pipeline *player;
+static audio_pipeline_handle_t pipe;
+
+static const char *tracks[] = { "music.mp3", "song.mp3", "alarm.wav", "horn.wav", "bell.wav", "chime.wav", "siren.wav", "q1.mp3", "q2.mp3", "tune.ogg" };
+
+static int8_t track( const char *name ) {
+
+	return player->playList.findName( name );
+
+}
+
+// the track of the last run, "tone" without a reader
+static std::string playing( void ) {
+
+	fake_run_t &run = fake_pipeline_runs( pipe ).back();
+	const char *slash = strrchr( run.uri.c_str(), '/' );
+
+	if ( run.decoder == "tone" ) return "tone";
+	return ( slash != NULL ) ? slash + 1 : run.uri;
+
+}
+
+static int64_t started_at( void ) {
+
+	return fake_pipeline_runs( pipe ).back().byte_pos;
+
+}
+
+static size_t runs( void ) {
+
+	return fake_pipeline_runs( pipe ).size();
+
+}
+
+// the reader got to bytes, undecoded of them still wait in its ringbuffer
+static void progress( int64_t bytes, int undecoded ) {
+
+	audio_element_handle_t file = fake_pipeline_element( pipe, "file" );
+	std::vector<char> data( undecoded );
+
+	audio_element_set_byte_pos( file, bytes );
+	rb_write( audio_element_get_output_ringbuf( file ), data.data(), undecoded, 0 );
+
+}
+
+// the running track plays to its end and i2s reports it to the listener
+static void finish( void ) {
+
+	fake_pipeline_finish( pipe );
+
+	audio_event_iface_msg_t msg = {};
+	msg.source_type = AUDIO_ELEMENT_TYPE_ELEMENT;
+	msg.source = fake_pipeline_element( pipe, "i2s" );
+	msg.cmd = AEL_MSG_CMD_REPORT_STATUS;
+	player->audioMessageHandler( msg );
+
+}
+
+static bool idle( void ) {
+
+	return player->getState() == AEL_STATE_FINISHED;
+
+}
+
+static void reset( priority_policy_t policy ) {
+
+	player->stop();
+	player->setMode( MODE_SINGLE_TRACK );
+	player->setPriorityPolicy( policy );
+
+}
+
+// an alarm interrupts the music, which resumes at the first byte not decoded yet
+static void test_resume( void ) {
+
+	reset( PRIORITY_POLICY_QUEUE );
+
+	CHECK( player->play( track( "music.mp3" ), PRIORITY_NORMAL ) );
+	CHECK( playing() == "music.mp3" );
+	progress( 50000, 4000 );
+
+	CHECK( player->play( track( "alarm.wav" ), 3 ) );
+	CHECK( playing() == "alarm.wav" );
+	CHECK_EQ( started_at(), 0 );
+	CHECK_EQ( player->getPriority(), 3 );
+
+	finish();
+	CHECK( playing() == "music.mp3" );
+	CHECK_EQ( started_at(), 46000 );
+	CHECK_EQ( player->getPriority(), PRIORITY_NORMAL );
+
+	// nothing left to resume
+	size_t n = runs();
+	finish();
+	CHECK_EQ( runs(), n );
+	CHECK( idle() );
+
+}
+
+// interrupts nest, the latest interrupted track resumes first. all but ogg resume in the middle,
+// the sd reader puts the wav header in front (see test_sd_reader).
+static void test_nested( void ) {
+
+	reset( PRIORITY_POLICY_QUEUE );
+
+	player->play( track( "music.mp3" ), PRIORITY_NORMAL );
+	progress( 10000, 0 );
+	player->play( track( "horn.wav" ), 2 );
+	progress( 8000, 0 );
+	player->play( track( "song.mp3" ), 4 );
+	progress( 30000, 1000 );
+	player->play( track( "alarm.wav" ), 6 );
+	CHECK( playing() == "alarm.wav" );
+
+	finish();
+	CHECK( playing() == "song.mp3" );
+	CHECK_EQ( started_at(), 29000 );
+	CHECK_EQ( player->getPriority(), 4 );
+
+	finish();
+	CHECK( playing() == "horn.wav" );
+	CHECK_EQ( started_at(), 8000 );
+	CHECK_EQ( player->getPriority(), 2 );
+
+	finish();
+	CHECK( playing() == "music.mp3" );
+	CHECK_EQ( started_at(), 10000 );
+
+	finish();
+	CHECK( idle() );
+
+	// ogg starts again
+	player->play( track( "tune.ogg" ), PRIORITY_NORMAL );
+	progress( 10000, 0 );
+	player->play( track( "horn.wav" ), 2 );
+	finish();
+	CHECK( playing() == "tune.ogg" );
+	CHECK_EQ( started_at(), 0 );
+	finish();
+	CHECK( idle() );
+
+}
+
+// with the queue policy the latest lower request waits for the clip
+static void test_waiting( void ) {
+
+	reset( PRIORITY_POLICY_QUEUE );
+
+	player->play( track( "music.mp3" ), PRIORITY_NORMAL );
+	progress( 20000, 0 );
+	player->play( track( "alarm.wav" ), 5 );
+
+	size_t n = runs();
+	CHECK( !player->play( track( "horn.wav" ), 2 ) );
+	CHECK( !player->play( track( "bell.wav" ), 3 ) );
+	CHECK_EQ( runs(), n );
+	CHECK( playing() == "alarm.wav" );
+
+	// it would have interrupted the music, so it goes first
+	finish();
+	CHECK( playing() == "bell.wav" );
+	CHECK_EQ( player->getPriority(), 3 );
+
+	finish();
+	CHECK( playing() == "music.mp3" );
+	CHECK_EQ( started_at(), 20000 );
+
+	finish();
+	CHECK( idle() );
+
+	// a waiting request below the interrupted track comes after it
+	player->play( track( "horn.wav" ), 3 );
+	player->play( track( "alarm.wav" ), 5 );
+	CHECK( !player->play( track( "bell.wav" ), 1 ) );
+
+	finish();
+	CHECK( playing() == "horn.wav" );
+	finish();
+	CHECK( playing() == "bell.wav" );
+	CHECK_EQ( player->getPriority(), 1 );
+	finish();
+	CHECK( idle() );
+	CHECK_EQ( player->getPriority(), PRIORITY_NORMAL );
+
+}
+
+// with the drop policy lower requests are gone
+static void test_drop( void ) {
+
+	reset( PRIORITY_POLICY_DROP );
+
+	player->play( track( "music.mp3" ), PRIORITY_NORMAL );
+	player->play( track( "alarm.wav" ), 5 );
+	CHECK( !player->play( track( "bell.wav" ), 3 ) );
+
+	finish();
+	CHECK( playing() == "music.mp3" );
+	finish();
+	CHECK( idle() );
+
+	// equal priority replaces the running track without resuming it
+	player->play( track( "horn.wav" ), 2 );
+	CHECK( player->play( track( "bell.wav" ), 2 ) );
+	finish();
+	CHECK( idle() );
+
+}
+
+// a tone interrupts like a clip, an interrupted tone is gone
+static void test_tone( void ) {
+
+	tone_t tone = TONE_DEFAULT();
+
+	reset( PRIORITY_POLICY_QUEUE );
+
+	player->play( track( "music.mp3" ), PRIORITY_NORMAL );
+	progress( 12000, 2000 );
+	CHECK( player->playTone( &tone ) );
+	CHECK( playing() == "tone" );
+
+	CHECK( player->play( track( "siren.wav" ), 4 ) );
+	finish();
+	CHECK( playing() == "music.mp3" );
+	CHECK_EQ( started_at(), 10000 );
+
+	// a lower tone never waits
+	player->play( track( "alarm.wav" ), 3 );
+	size_t n = runs();
+	CHECK( !player->playTone( &tone ) );
+	finish();
+	CHECK( playing() == "music.mp3" );
+	CHECK_EQ( runs(), n + 1 );
+
+}
+
+// more interrupts than MAXPREEMPTED lose the oldest ones beyond the limit
+static void test_limit( void ) {
+
+	static const char *clips[] = { "horn.wav", "bell.wav", "chime.wav", "siren.wav", "alarm.wav" };
+
+	reset( PRIORITY_POLICY_QUEUE );
+
+	player->play( track( "music.mp3" ), PRIORITY_NORMAL );
+	for ( int i = 0; i < 5; i++ ) {
+		player->play( track( clips[i] ), i + 1 );
+	}
+
+	// alarm interrupted siren with 4 tracks saved already
+	for ( int i = 2; i >= 0; i-- ) {
+		finish();
+		CHECK( playing() == clips[i] );
+	}
+	finish();
+	CHECK( playing() == "music.mp3" );
+	finish();
+	CHECK( idle() );
+
+}
+
+// queued tracks follow after the interrupted ones
+static void test_queue( void ) {
+
+	reset( PRIORITY_POLICY_QUEUE );
+
+	player->play( track( "music.mp3" ), PRIORITY_NORMAL );
+	progress( 5000, 0 );
+	CHECK( player->enqueue( track( "q1.mp3" ) ) );
+	CHECK( player->enqueue( track( "q2.mp3" ) ) );
+	player->play( track( "alarm.wav" ), 2 );
+
+	finish();
+	CHECK( playing() == "music.mp3" );
+	CHECK_EQ( started_at(), 5000 );
+	finish();
+	CHECK( playing() == "q1.mp3" );
+	CHECK_EQ( started_at(), 0 );
+	finish();
+	CHECK( playing() == "q2.mp3" );
+	finish();
+	CHECK( idle() );
+
+	// nothing playing, the queue starts right away
+	size_t n = runs();
+	CHECK( player->enqueue( track( "q1.mp3" ) ) );
+	CHECK_EQ( runs(), n + 1 );
+	CHECK( playing() == "q1.mp3" );
+
+}
+
+// stop forgets interrupted, waiting and queued tracks
+static void test_stop( void ) {
+
+	reset( PRIORITY_POLICY_QUEUE );
+
+	player->play( track( "music.mp3" ), PRIORITY_NORMAL );
+	player->enqueue( track( "q1.mp3" ) );
+	player->play( track( "alarm.wav" ), 4 );
+	player->play( track( "bell.wav" ), 2 );
+
+	size_t n = runs();
+	player->stop();
+	CHECK_EQ( player->getPriority(), PRIORITY_NORMAL );
+	CHECK( !player->isPlaying() );
+
+	player->play( track( "horn.wav" ), PRIORITY_NORMAL );
+	finish();
+	CHECK_EQ( runs(), n + 1 );
+	CHECK( idle() );
+
+}
+
+static int httpd_task;		// its address is the handle
+#define HTTPD  ( (TaskHandle_t) &httpd_task )
+static TaskHandle_t main_task;
+static audio_event_iface_handle_t evt, i2s_evt;
+
+// the main loop of app_main, it handles what arrived while the rest task waits
+static void main_loop( void ) {
+
+	TaskHandle_t caller = fake_task_switch( main_task );
+	audio_event_iface_msg_t msg;
+
+	while ( audio_event_iface_listen( evt, &msg, 0 ) == ESP_OK ) {
+		player->audioMessageHandler( msg );
+	}
+
+	fake_task_switch( caller );
+
+}
+
+// i2s reported the end, the main task didn't get to it yet
+static void finish_later( void ) {
+
+	fake_pipeline_finish( pipe );
+
+	audio_event_iface_msg_t msg = {};
+	msg.source_type = AUDIO_ELEMENT_TYPE_ELEMENT;
+	msg.source = fake_pipeline_element( pipe, "i2s" );
+	msg.cmd = AEL_MSG_CMD_REPORT_STATUS;
+	audio_event_iface_sendout( i2s_evt, &msg );
+
+}
+
+// a rest request in the middle of a track change waits for it and runs on the main task
+static void test_request( void ) {
+
+	reset( PRIORITY_POLICY_QUEUE );
+
+	// like app_main
+	main_task = xTaskGetCurrentTaskHandle();
+	audio_event_iface_cfg_t evt_cfg = AUDIO_EVENT_IFACE_DEFAULT_CFG();
+	evt = audio_event_iface_init( &evt_cfg );
+	i2s_evt = audio_event_iface_init( &evt_cfg );
+	audio_event_iface_set_listener( i2s_evt, evt );
+	player->setListener( evt );
+	fake_on_block( main_loop );
+
+	player->play( track( "music.mp3" ), PRIORITY_NORMAL );
+	progress( 30000, 2000 );
+	player->play( track( "alarm.wav" ), 3 );
+	finish_later();
+
+	fake_task_switch( HTTPD );
+	CHECK( player->play( track( "bell.wav" ), 2 ) );
+	fake_task_switch( main_task );
+
+	// the music resumed first, the bell interrupted it again
+	std::vector<fake_run_t> &r = fake_pipeline_runs( pipe );
+	CHECK( r[r.size() - 2].uri == "preempt/music.mp3" );
+	CHECK_EQ( r[r.size() - 2].byte_pos, 28000 );
+	CHECK( playing() == "bell.wav" );
+	CHECK( r.back().task == main_task );
+	CHECK_EQ( player->getPriority(), 2 );
+
+	finish();
+	CHECK( playing() == "music.mp3" );
+	CHECK_EQ( started_at(), 28000 );
+	finish();
+	CHECK( idle() );
+
+	// tones, phrases and the queue go the same way
+	tone_t tone = TONE_DEFAULT();
+	int8_t clips[] = { track( "horn.wav" ), track( "bell.wav" ) };
+
+	fake_task_switch( HTTPD );
+	CHECK( player->play( track( "music.mp3" ), PRIORITY_NORMAL ) );
+	CHECK( player->enqueue( track( "q1.mp3" ) ) );
+	CHECK( player->playTone( &tone, 2 ) );
+	CHECK( playing() == "tone" );
+	CHECK( !player->playPhrase( clips, 2, 1 ) );
+	CHECK( player->playPhrase( clips, 2, 2 ) );
+	CHECK( playing() == "horn.wav" );
+	CHECK( fake_pipeline_runs( pipe ).back().task == main_task );
+	fake_task_switch( main_task );
+
+	finish();
+	CHECK( playing() == "music.mp3" );
+	finish();
+	CHECK( playing() == "q1.mp3" );
+
+	fake_task_switch( HTTPD );
+	player->stop();
+	fake_task_switch( main_task );
+	CHECK( !player->isPlaying() );
+
+}
+
+int main( void ) {
+
+	CHECK_EQ( system( "rm -rf preempt && mkdir -p preempt" ), 0 );
+	for ( const char *name : tracks ) {
+		std::string path = std::string( "preempt/" ) + name;
+		fclose( fopen( path.c_str(), "w" ) );
+	}
+
+	player = new Pipeline();
+	player->playList.readFolders( "preempt" );
+	player->playList.selectFolder( 0, true );
+	player->StartCodec();
+	pipe = fake_pipeline( 0 );
+
+	test_resume();
+	test_nested();
+	test_waiting();
+	test_drop();
+	test_tone();
+	test_limit();
+	test_queue();
+	test_stop();
+	test_request();
+
+	return test_result( "preemption" );
+
+}
@@ -0,0 +1,130 @@
+/*
+ * test_requests.cpp
+ *
+ * the rest server and the stream server run on their own tasks: what changes the playlist or the pipeline
+ * is handed to the listener task and runs there, between the audio events.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "pipeline.h"
+#include "fake_adf.h"
+#include "test.h"
+
+static Pipeline *player;
+static audio_pipeline_handle_t pipe;
+static audio_event_iface_handle_t evt;
+
+static int main_task, httpd_task;	// their addresses are the handles
+#define MAIN   ( (TaskHandle_t) &main_task )
+#define HTTPD  ( (TaskHandle_t) &httpd_task )
+
+static int loops;			// main loop passes which handled something
+static int folder_seen;		// active folder when the listener got the request
+
+// the main loop of app_main, it runs while the requesting task waits
+static void main_loop( void ) {
+
+	TaskHandle_t caller = fake_task_switch( MAIN );
+	audio_event_iface_msg_t msg;
+
+	folder_seen = player->playList.getActiveFolderNr();
+	if ( audio_event_iface_listen( evt, &msg, 0 ) == ESP_OK ) {
+		loops++;
+		player->audioMessageHandler( msg );
+	}
+
+	fake_task_switch( caller );
+
+}
+
+// another folder frees the tracks, the listener task must not be using them
+static void test_folder( void ) {
+
+	fake_task_switch( MAIN );
+	CHECK( player->play( player->playList.findName( "a1.mp3" ), PRIORITY_NORMAL ) );
+	CHECK( player->isPlaying() );
+
+	fake_task_switch( HTTPD );
+	loops = 0;
+	CHECK( player->selectFolder( 1 ) );
+	CHECK_EQ( loops, 1 );
+	CHECK_EQ( folder_seen, 0 );
+	CHECK_EQ( player->playList.getActiveFolderNr(), 1 );
+	CHECK_EQ( player->playList.getTracks(), 3 );
+	CHECK( !player->isPlaying() );
+
+	// unknown folders are refused there as well
+	CHECK( !player->selectFolder( 9 ) );
+	CHECK( !player->selectFolder( -1 ) );
+	CHECK_EQ( loops, 3 );
+	CHECK_EQ( player->playList.getActiveFolderNr(), 1 );
+
+	// the listener task itself doesn't wait for itself
+	fake_task_switch( MAIN );
+	CHECK( player->selectFolder( 0 ) );
+	CHECK_EQ( loops, 3 );
+	CHECK_EQ( player->playList.getActiveFolderNr(), 0 );
+
+}
+
+// the entries of the m3u list change the same way
+static void test_list( void ) {
+
+	fake_task_switch( HTTPD );
+	loops = 0;
+
+	int8_t show = player->playList.findList( "show.m3u" );
+	CHECK( show > 0 );
+	CHECK( player->selectList( show ) );
+	CHECK_EQ( loops, 1 );
+	CHECK_EQ( player->playList.getActiveListNr(), show );
+	CHECK_EQ( player->playList.getEntries(), 2 );
+
+	CHECK( !player->selectList( 5 ) );
+	CHECK_EQ( player->playList.getActiveListNr(), show );
+
+	// back to the folder in alphabetic order
+	CHECK( player->selectList( 0 ) );
+	CHECK_EQ( loops, 3 );
+	CHECK_EQ( player->playList.getActiveListNr(), 0 );
+
+	fake_task_switch( MAIN );
+
+}
+
+int main( void ) {
+
+	CHECK_EQ( system( "rm -rf requests && mkdir -p requests/b" ), 0 );
+	static const char *files[] = { "a1.mp3", "a2.wav", "b/b1.mp3", "b/b2.mp3", "b/b3.wav" };
+	for ( const char *name : files ) {
+		std::string path = std::string( "requests/" ) + name;
+		fclose( fopen( path.c_str(), "w" ) );
+	}
+
+	FILE *m3u = fopen( "requests/show.m3u", "w" );
+	fputs( "a2.wav\na1.mp3\n", m3u );
+	fclose( m3u );
+
+	fake_task_switch( MAIN );
+
+	player = new Pipeline();
+	player->playList.readFolders( "requests" );
+	player->playList.selectFolder( 0, true );
+	player->StartCodec();
+	pipe = fake_pipeline( 0 );
+
+	// like app_main
+	audio_event_iface_cfg_t evt_cfg = AUDIO_EVENT_IFACE_DEFAULT_CFG();
+	evt = audio_event_iface_init( &evt_cfg );
+	player->setListener( evt );
+	fake_on_block( main_loop );
+
+	test_folder();
+	test_list();
+
+	return test_result( "requests" );
+
+}
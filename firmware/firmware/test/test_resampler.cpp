@@ -0,0 +1,290 @@
+/*
+ * test_resampler.cpp
+ *
+ * output rate, distortion of a sine, the bypass and the speed of the resampler, and what it costs
+ */
+
+#include <time.h>
+#include <audio_element.h>
+
+#include "resampler.h"
+#include "fake_adf.h"
+#include "test.h"
+
+static audio_element_handle_t source_init( int rate, int channels ) {
+
+	audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
+	audio_element_handle_t el = audio_element_init( &cfg );
+	audio_element_set_music_info( el, rate, channels, 16 );
+
+	return el;
+
+}
+
+// resamples a 1kHz sine, returns the output as interleaved stereo
+static std::vector<int16_t> resample( int src_rate, int channels, int out_rate, resample_quality_t quality, int frames, int chunk = 0 ) {
+
+	resampler_cfg_t cfg = DEFAULT_RESAMPLER_CONFIG();
+	cfg.out_rate = out_rate;
+	cfg.quality = quality;
+
+	audio_element_handle_t source = source_init( src_rate, channels );
+	audio_element_handle_t rsp = resampler_init( &cfg );
+	resampler_set_source( rsp, source );
+
+	std::vector<int16_t> in = test_sine( frames, channels, src_rate, 1000, 16000 );
+	fake_element_set_input( rsp, in.data(), in.size() * sizeof(int16_t), chunk );
+	CHECK_EQ( fake_element_run( rsp ), AEL_IO_DONE );
+
+	std::vector<int16_t> out = fake_element_pcm( rsp );
+
+	audio_element_deinit( rsp );
+	audio_element_deinit( source );
+
+	return out;
+
+}
+
+// the first output frame is the first input frame, so the ideal output is the sine at the output rate
+static double snr( const std::vector<int16_t> &out, int out_rate ) {
+
+	int frames = out.size() / 2;
+	double signal = 0, noise = 0;
+
+	// leave out the filter's run in and run out
+	for ( int i = 64; i < frames - 64; i++ ) {
+		double ref = 16000 * sin( 2 * M_PI * 1000.0 * i / out_rate );
+		signal += ref * ref;
+		noise += ( out[ 2 * i ] - ref ) * ( out[ 2 * i ] - ref );
+		noise += ( out[ 2 * i + 1 ] - ref ) * ( out[ 2 * i + 1 ] - ref );
+	}
+
+	return 10 * log10( 2 * signal / noise );
+
+}
+
+static void test_rate( int src_rate, int channels, int out_rate ) {
+
+	std::vector<int16_t> out = resample( src_rate, channels, out_rate, RESAMPLE_QUALITY_MEDIUM, src_rate );
+	int frames = out.size() / 2;
+
+	// one second in is one second out, less the filter's tail
+	CHECK( frames <= out_rate );
+	CHECK( frames >= out_rate - 16 * out_rate / src_rate - 1 );
+	CHECK_NEAR( test_frequency( out.data(), frames, 2, out_rate ), 1000.0, 0.5 );
+	CHECK_NEAR( test_frequency( out.data() + 1, frames, 2, out_rate ), 1000.0, 0.5 );
+
+}
+
+static void test_snr( void ) {
+
+	CHECK( snr( resample( 22050, 1, 44100, RESAMPLE_QUALITY_LOW, 22050 ), 44100 ) > 70 );
+	CHECK( snr( resample( 22050, 1, 44100, RESAMPLE_QUALITY_MEDIUM, 22050 ), 44100 ) > 70 );
+	CHECK( snr( resample( 22050, 2, 44100, RESAMPLE_QUALITY_HIGH, 22050 ), 44100 ) > 70 );
+	CHECK( snr( resample( 48000, 2, 44100, RESAMPLE_QUALITY_MEDIUM, 48000 ), 44100 ) > 60 );
+
+	// the phases aren't interpolated, the phase error limits low source rates
+	CHECK( snr( resample( 16000, 1, 44100, RESAMPLE_QUALITY_MEDIUM, 16000 ), 44100 ) > 50 );
+
+}
+
+// frames split over reads must not change the output
+static void test_chunks( void ) {
+
+	std::vector<int16_t> a = resample( 22050, 1, 44100, RESAMPLE_QUALITY_MEDIUM, 4000 );
+	std::vector<int16_t> b = resample( 22050, 1, 44100, RESAMPLE_QUALITY_MEDIUM, 4000, 3 );
+	CHECK( a == b );
+
+	a = resample( 48000, 2, 44100, RESAMPLE_QUALITY_MEDIUM, 4000 );
+	b = resample( 48000, 2, 44100, RESAMPLE_QUALITY_MEDIUM, 4000, 7 );
+	CHECK( a == b );
+
+}
+
+static void test_bypass( void ) {
+
+	resampler_cfg_t cfg = DEFAULT_RESAMPLER_CONFIG();
+	audio_element_handle_t source = source_init( 44100, 2 );
+	audio_element_handle_t rsp = resampler_init( &cfg );
+	resampler_set_source( rsp, source );
+
+	std::vector<int16_t> in = test_sine( 5000, 2, 44100, 1000, 16000 );
+	fake_element_set_input( rsp, in.data(), in.size() * sizeof(int16_t) );
+	fake_element_run( rsp );
+
+	CHECK( fake_element_pcm( rsp ) == in );
+
+	// mono is still doubled
+	audio_element_set_music_info( source, 44100, 1, 16 );
+	fake_element_output( rsp ).clear();
+	std::vector<int16_t> mono = test_sine( 5000, 1, 44100, 1000, 16000 );
+	fake_element_set_input( rsp, mono.data(), mono.size() * sizeof(int16_t) );
+	fake_element_run( rsp );
+
+	CHECK( fake_element_pcm( rsp ) == in );
+
+	audio_element_deinit( rsp );
+	audio_element_deinit( source );
+
+}
+
+// pitch and tempo follow the speed
+static void test_speed( int src_rate, int speed ) {
+
+	resampler_cfg_t cfg = DEFAULT_RESAMPLER_CONFIG();
+	audio_element_handle_t source = source_init( src_rate, 2 );
+	audio_element_handle_t rsp = resampler_init( &cfg );
+	resampler_set_source( rsp, source );
+	resampler_set_speed( rsp, speed );
+
+	std::vector<int16_t> in = test_sine( src_rate, 2, src_rate, 1000, 16000 );
+	fake_element_set_input( rsp, in.data(), in.size() * sizeof(int16_t) );
+	fake_element_run( rsp );
+
+	std::vector<int16_t> out = fake_element_pcm( rsp );
+	int frames = out.size() / 2;
+	int expected = 44100 * RESAMPLER_SPEED_NORMAL / speed;
+
+	CHECK( frames <= expected + 1 );
+	CHECK( frames >= expected - 16 * 44100 / src_rate * RESAMPLER_SPEED_NORMAL / speed - 1 );
+	CHECK_NEAR( test_frequency( out.data(), frames, 2, 44100 ), 1000.0 * speed / RESAMPLER_SPEED_NORMAL, speed * 0.001 );
+
+	audio_element_deinit( rsp );
+	audio_element_deinit( source );
+
+}
+
+// a new speed while running: ramped within RESAMPLER_RAMP_FRAMES, without a jump, also out of the bypass
+static void test_speed_change( int src_rate ) {
+
+	resampler_cfg_t cfg = DEFAULT_RESAMPLER_CONFIG();
+	audio_element_handle_t source = source_init( src_rate, 2 );
+	audio_element_handle_t rsp = resampler_init( &cfg );
+	resampler_set_source( rsp, source );
+
+	std::vector<int16_t> in = test_sine( 2 * src_rate, 2, src_rate, 1000, 8000 );
+	fake_element_set_input( rsp, in.data(), in.size() * sizeof(int16_t) );
+	fake_element_open( rsp );
+
+	while ( fake_element_output( rsp ).size() < 4 * 20000 ) fake_element_process( rsp );
+	int change = fake_element_output( rsp ).size() / 4;
+
+	resampler_set_speed( rsp, 1500 );
+	while ( fake_element_process( rsp ) > 0 ) {}
+	fake_element_close( rsp );
+
+	std::vector<int16_t> out = fake_element_pcm( rsp );
+	int frames = out.size() / 2;
+
+	CHECK_NEAR( test_frequency( out.data() + 2 * 1000, change - 1000, 2, 44100 ), 1000, 1 );
+	CHECK_NEAR( test_frequency( out.data() + 2 * ( change + RESAMPLER_RAMP_FRAMES ), frames - change - RESAMPLER_RAMP_FRAMES - 100, 2, 44100 ), 1500, 1.5 );
+
+	// the steepest slope of a 1.5kHz sine
+	int step = 0;
+	for ( int i = change - 100; i < change + 2 * RESAMPLER_RAMP_FRAMES; i++ ) {
+		int d = abs( out[ 2 * i ] - out[ 2 * ( i - 1 ) ] );
+		if ( d > step ) step = d;
+	}
+	CHECK( step <= 2 * M_PI * 1500 / 44100 * 8000 + 20 );
+
+	audio_element_deinit( rsp );
+	audio_element_deinit( source );
+
+}
+
+static void test_speed_limits( void ) {
+
+	resampler_cfg_t cfg = DEFAULT_RESAMPLER_CONFIG();
+	audio_element_handle_t rsp = resampler_init( &cfg );
+
+	CHECK_EQ( resampler_get_speed( rsp ), RESAMPLER_SPEED_NORMAL );
+	resampler_set_speed( rsp, 100 );
+	CHECK_EQ( resampler_get_speed( rsp ), RESAMPLER_SPEED_MIN );
+	resampler_set_speed( rsp, 10000 );
+	CHECK_EQ( resampler_get_speed( rsp ), RESAMPLER_SPEED_MAX );
+
+	audio_element_deinit( rsp );
+
+}
+
+// output samples per second of cpu time, the host is faster than the esp32 but the ratios hold
+static double throughput( int src_rate, int channels, resample_quality_t quality, int speed ) {
+
+	const int frames = 10 * src_rate;
+
+	resampler_cfg_t cfg = DEFAULT_RESAMPLER_CONFIG();
+	cfg.quality = quality;
+
+	audio_element_handle_t source = source_init( src_rate, channels );
+	audio_element_handle_t rsp = resampler_init( &cfg );
+	resampler_set_source( rsp, source );
+	resampler_set_speed( rsp, speed );
+
+	std::vector<int16_t> in = test_sine( frames, channels, src_rate, 1000, 16000 );
+	fake_element_set_input( rsp, in.data(), in.size() * sizeof(int16_t) );
+
+	clock_t start = clock();
+	CHECK_EQ( fake_element_run( rsp ), AEL_IO_DONE );
+	double seconds = (double) ( clock() - start ) / CLOCKS_PER_SEC;
+
+	size_t samples = fake_element_output( rsp ).size() / sizeof(int16_t);
+	CHECK( samples >= 2 * (size_t) frames * 44100 / src_rate * RESAMPLER_SPEED_NORMAL / speed * 99 / 100 );
+
+	audio_element_deinit( rsp );
+	audio_element_deinit( source );
+
+	return samples / seconds;
+
+}
+
+static void test_throughput( void ) {
+
+	static const char *name[] = { "low", "medium", "high" };
+
+	for ( int q = RESAMPLE_QUALITY_LOW; q <= RESAMPLE_QUALITY_HIGH; q++ ) {
+		double rate = throughput( 22050, 2, (resample_quality_t) q, RESAMPLER_SPEED_NORMAL );
+		printf( "resampler: 22050 -> 44100 stereo, %s quality, %.1f M samples/s, %.0f times real time\n", name[q], rate / 1e6, rate / ( 2 * 44100 ) );
+	}
+
+}
+
+// the speed changes how much is read per output sample, not what an output sample costs
+static void test_speed_cost( void ) {
+
+	static const int speed[] = { RESAMPLER_SPEED_MIN, 500, 1000, 1500, 2000, 3000, RESAMPLER_SPEED_MAX };
+
+	for ( int s : speed ) {
+		double rate = throughput( 22050, 2, RESAMPLE_QUALITY_MEDIUM, s );
+		printf( "resampler: speed %4d, %.1f ns per output sample, %.0f times real time\n", s, 1e9 / rate, rate / ( 2 * 44100 ) );
+	}
+
+	// the bypass only copies
+	double rate = throughput( 44100, 2, RESAMPLE_QUALITY_MEDIUM, RESAMPLER_SPEED_NORMAL );
+	printf( "resampler: bypass, %.1f ns per output sample\n", 1e9 / rate );
+
+}
+
+int main( void ) {
+
+	test_rate( 22050, 1, 44100 );
+	test_rate( 22050, 2, 44100 );
+	test_rate( 48000, 2, 44100 );
+	test_rate( 8000, 1, 44100 );
+	test_rate( 44100, 2, 22050 );
+	test_snr();
+	test_chunks();
+	test_bypass();
+	test_speed( 44100, 2000 );
+	test_speed( 44100, 500 );
+	test_speed( 22050, 1250 );
+	test_speed( 48000, 3000 );
+	test_speed( 22050, RESAMPLER_SPEED_MIN );
+	test_speed_change( 44100 );
+	test_speed_change( 22050 );
+	test_speed_limits();
+	test_throughput();
+	test_speed_cost();
+
+	return test_result( "resampler" );
+
+}
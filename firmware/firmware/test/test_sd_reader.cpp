@@ -0,0 +1,391 @@
+/*
+ * test_sd_reader.cpp
+ *
+ * loops, segments and the file cache of the sd card reader, and the open latency it saves
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <audio_element.h>
+
+#include "sd_reader.h"
+#include "fake_adf.h"
+#include "test.h"
+
+#define RATE   22050
+#define FRAMES 22050
+
+static std::vector<int16_t> saw;		// a jump of 20000 from the end to the start
+
+static audio_element_handle_t reader_init( int cache_size ) {
+
+	sd_reader_cfg_t cfg = SD_READER_CFG_DEFAULT();
+	cfg.read_size = 4096;
+	cfg.cache_size = cache_size;
+
+	return sd_reader_init( &cfg );
+
+}
+
+static int bytes_out( audio_element_handle_t rdr ) {
+
+	return fake_element_output( rdr ).size();
+
+}
+
+// the audio behind the wav header as stereo frames
+static std::vector<int16_t> audio_out( audio_element_handle_t rdr ) {
+
+	std::vector<uint8_t> &out = fake_element_output( rdr );
+	std::vector<int16_t> pcm( ( out.size() - TEST_WAV_HEADER ) / sizeof(int16_t) );
+	memcpy( pcm.data(), &out[TEST_WAV_HEADER], pcm.size() * sizeof(int16_t) );
+
+	return pcm;
+
+}
+
+static int max_step( const std::vector<int16_t> &pcm ) {
+
+	int step = 0;
+	for ( size_t i = 2; i < pcm.size(); i++ ) {
+		int d = abs( pcm[i] - pcm[ i - 2 ] );
+		if ( d > step ) step = d;
+	}
+
+	return step;
+
+}
+
+// loops until passes are read, then stops the loop and reads to the end
+static int loop( audio_element_handle_t rdr, const char *path, int64_t start, int64_t end, int crossfade_ms, int passes ) {
+
+	audio_element_set_uri( rdr, path );
+	fake_element_output( rdr ).clear();
+	sd_reader_set_loop( rdr, start, end, crossfade_ms );
+
+	CHECK_EQ( fake_element_open( rdr ), ESP_OK );
+	while ( bytes_out( rdr ) < TEST_WAV_HEADER + passes * FRAMES * 4 ) {
+		if ( fake_element_process( rdr ) <= 0 ) break;
+	}
+
+	sd_reader_stop_loop( rdr );
+	int ret;
+	while ( ( ret = fake_element_process( rdr ) ) > 0 ) {}
+	fake_element_close( rdr );
+
+	return ret;
+
+}
+
+// every pass is the whole audio, the LIST chunk behind it never gets in
+static void test_whole( audio_element_handle_t rdr ) {
+
+	CHECK_EQ( loop( rdr, "loop.wav", 0, 0, 0, 3 ), AEL_IO_OK );
+
+	std::vector<int16_t> out = audio_out( rdr );
+	CHECK_EQ( out.size() % saw.size(), 0 );
+	CHECK( out.size() >= 3 * saw.size() );
+
+	for ( size_t i = 0; i < out.size(); i += saw.size() ) {
+		CHECK( std::equal( saw.begin(), saw.end(), out.begin() + i ) );
+	}
+
+	// the saw jumps at the seam
+	CHECK( max_step( out ) > 19000 );
+
+}
+
+// frames [first, last) repeat, the first pass starts at the beginning, the last one runs to the end
+static void test_range( audio_element_handle_t rdr, int first, int last ) {
+
+	CHECK_EQ( loop( rdr, "loop.wav", TEST_WAV_HEADER + 4 * first, TEST_WAV_HEADER + 4 * last, 0, 3 ), AEL_IO_OK );
+
+	std::vector<int16_t> out = audio_out( rdr );
+	int frames = out.size() / 2;
+	int passes = ( frames - last - ( FRAMES - first ) ) / ( last - first );
+
+	CHECK( passes >= 2 );
+	CHECK_EQ( frames, last + passes * ( last - first ) + FRAMES - first );
+
+	std::vector<int16_t> expected( saw.begin(), saw.begin() + 2 * last );
+	for ( int i = 0; i < passes; i++ ) expected.insert( expected.end(), saw.begin() + 2 * first, saw.begin() + 2 * last );
+	expected.insert( expected.end(), saw.begin() + 2 * first, saw.end() );
+
+	CHECK( out == expected );
+
+}
+
+// the seam is faded over, the output has no jump
+static void test_crossfade( audio_element_handle_t rdr ) {
+
+	CHECK_EQ( loop( rdr, "loop.wav", 0, 0, 10, 3 ), AEL_IO_OK );
+
+	std::vector<int16_t> out = audio_out( rdr );
+	int fade = RATE * 10 / 1000;
+
+	CHECK( out.size() > 3 * saw.size() );
+	CHECK( max_step( out ) < 100 );
+
+	// untouched up to the seam, and the following pass continues behind the faded frames
+	CHECK( std::equal( saw.begin(), saw.end() - 2 * fade, out.begin() ) );
+	CHECK( std::equal( saw.begin() + 2 * fade, saw.end() - 2 * fade, out.begin() + saw.size() ) );
+
+	// the last pass ends with the audio
+	CHECK( std::equal( saw.end() - 2 * fade, saw.end(), out.end() - 2 * fade ) );
+
+}
+
+static std::vector<uint8_t> read_file( const char *path ) {
+
+	std::vector<uint8_t> file( 200000 );
+	FILE *f = fopen( path, "rb" );
+	file.resize( ( f != NULL ) ? fread( file.data(), 1, file.size(), f ) : 0 );
+	if ( f != NULL ) fclose( f );
+
+	return file;
+
+}
+
+// reads a whole file, returns false if it could not be opened
+static bool play( audio_element_handle_t rdr, const char *path, const std::vector<uint8_t> &expected ) {
+
+	audio_element_set_uri( rdr, path );
+	fake_element_output( rdr ).clear();
+
+	if ( fake_element_run( rdr ) != AEL_IO_OK ) return false;
+
+	CHECK( fake_element_output( rdr ) == expected );
+	return true;
+
+}
+
+static int open_files( void ) {
+
+	int n = 0;
+	DIR *dir = opendir( "/proc/self/fd" );
+	while ( readdir( dir ) != NULL ) n++;
+	closedir( dir );
+
+	return n;
+
+}
+
+// no loop set: the file is read as it is, chunks behind the audio included
+static void test_no_loop( audio_element_handle_t rdr ) {
+
+	CHECK( play( rdr, "loop.wav", read_file( "loop.wav" ) ) );
+
+}
+
+// a cached file is read without opening it again, so it still plays after it was deleted
+static void test_cache( void ) {
+
+	int files = open_files();
+	audio_element_handle_t rdr = reader_init( 2 );
+	std::vector<uint8_t> content[3];
+	const char *path[3] = { "cache1.wav", "cache2.wav", "cache3.wav" };
+
+	for ( int i = 0; i < 3; i++ ) {
+		test_write_wav( path[i], test_sine( 1000 + 100 * i, 2, RATE, 440 * ( i + 1 ), 8000 ), 2, RATE );
+		content[i] = read_file( path[i] );
+	}
+
+	CHECK_EQ( sd_reader_preload( rdr, path[0] ), ESP_OK );
+	unlink( path[0] );
+	CHECK( play( rdr, path[0], content[0] ) );
+
+	// still open after playing, twice from the start
+	CHECK( play( rdr, path[0], content[0] ) );
+
+	// the least recently used file is closed for the third one
+	CHECK_EQ( sd_reader_preload( rdr, path[1] ), ESP_OK );
+	CHECK_EQ( sd_reader_preload( rdr, path[2] ), ESP_OK );
+	unlink( path[1] );
+	unlink( path[2] );
+	CHECK( !play( rdr, path[0], content[0] ) );
+	CHECK( play( rdr, path[1], content[1] ) );
+	CHECK( play( rdr, path[2], content[2] ) );
+	CHECK( play( rdr, path[1], content[1] ) );
+
+	// a missing file doesn't take a place in the cache
+	CHECK_EQ( sd_reader_preload( rdr, "missing.wav" ), ESP_FAIL );
+	CHECK( play( rdr, path[2], content[2] ) );
+
+	sd_reader_flush( rdr );
+	CHECK( !play( rdr, path[1], content[1] ) );
+	CHECK( !play( rdr, path[2], content[2] ) );
+
+	audio_element_deinit( rdr );
+	CHECK_EQ( open_files(), files );
+
+	// without a cache every play opens the file
+	rdr = reader_init( 0 );
+	test_write_wav( path[0], test_sine( 1000, 2, RATE, 440, 8000 ), 2, RATE );
+	CHECK_EQ( sd_reader_preload( rdr, path[0] ), ESP_FAIL );
+	CHECK( play( rdr, path[0], content[0] ) );
+	CHECK_EQ( open_files(), files );
+	unlink( path[0] );
+	CHECK( !play( rdr, path[0], content[0] ) );
+
+	audio_element_deinit( rdr );
+	CHECK_EQ( open_files(), files );
+
+}
+
+// us per open of the last file in folders of growing size, opened each time and from the cache.
+// fat looks names up by reading the directory, the host's file system has an index, so the growth is
+// smaller here than on the sd card
+static void test_open_latency( void ) {
+
+	const int opens = 2000;
+	std::vector<int16_t> pcm = test_sine( 100, 2, RATE, 440, 8000 );
+	char path[128];
+
+	for ( int size = 10; size <= 1000; size *= 10 ) {
+
+		snprintf( path, sizeof(path), "rm -rf open%d && mkdir open%d", size, size );
+		CHECK_EQ( system( path ), 0 );
+		for ( int i = 0; i < size; i++ ) {
+			snprintf( path, sizeof(path), "open%d/clip%04d.wav", size, i );
+			test_write_wav( path, pcm, 2, RATE );
+		}
+
+		double us[2];
+		for ( int cache = 0; cache <= 1; cache++ ) {
+			audio_element_handle_t rdr = reader_init( cache );
+			if ( cache > 0 ) CHECK_EQ( sd_reader_preload( rdr, path ), ESP_OK );
+			audio_element_set_uri( rdr, path );
+
+			int files = open_files();
+			bool ok = true;
+			clock_t start = clock();
+			for ( int i = 0; i < opens; i++ ) {
+				ok = ok && ( fake_element_open( rdr ) == ESP_OK );
+				fake_element_close( rdr );
+			}
+			us[cache] = 1e6 * ( clock() - start ) / CLOCKS_PER_SEC / opens;
+
+			CHECK( ok );
+			CHECK_EQ( open_files(), files );
+			audio_element_deinit( rdr );
+		}
+
+		printf( "sd_reader: %4d files in the folder, %.1f us per open, %.1f us from the cache\n", size, us[0], us[1] );
+
+	}
+
+}
+
+// clips joined behind the first file: headers and LIST chunks left out, at most two clips open at a time
+static void test_segments( void ) {
+
+	int files = open_files();
+	audio_element_handle_t rdr = reader_init( 0 );
+	std::vector<int16_t> clip[6];
+	char path[16];
+
+	for ( int i = 0; i < 6; i++ ) {
+		clip[i] = test_sine( 700 + 300 * i, 2, RATE, 300 + 100 * i, 8000 );
+		snprintf( path, sizeof(path), "clip%d.wav", i );
+		test_write_wav( path, clip[i], 2, RATE );
+	}
+
+	// the same clip twice in a row shares its descriptor, the first file's one as well
+	int phrase[] = { 1, 2, 2, 3, 0, 4, 5, 5, 5, 1, 0 };
+	std::vector<uint8_t> expected = read_file( "clip0.wav" );
+	expected.resize( TEST_WAV_HEADER + clip[0].size() * sizeof(int16_t) );
+
+	for ( int i : phrase ) {
+		snprintf( path, sizeof(path), "clip%d.wav", i );
+		CHECK_EQ( sd_reader_add_segment( rdr, path, 0, 0 ), ESP_OK );
+		expected.insert( expected.end(), (uint8_t *) clip[i].data(), (uint8_t *) ( clip[i].data() + clip[i].size() ) );
+	}
+
+	audio_element_set_uri( rdr, "clip0.wav" );
+	fake_element_output( rdr ).clear();
+	CHECK_EQ( fake_element_open( rdr ), ESP_OK );
+
+	int ret, most = 0;
+	while ( ( ret = fake_element_process( rdr ) ) > 0 ) {
+		if ( open_files() - files > most ) most = open_files() - files;
+	}
+	fake_element_close( rdr );
+
+	CHECK_EQ( ret, AEL_IO_OK );
+	CHECK( fake_element_output( rdr ) == expected );
+	CHECK( most <= 3 );
+	CHECK_EQ( open_files(), files );
+
+	// a missing clip is skipped
+	sd_reader_clear_segments( rdr );
+	sd_reader_add_segment( rdr, "missing.wav", 0, 0 );
+	sd_reader_add_segment( rdr, "clip1.wav", 0, 0 );
+	expected.resize( TEST_WAV_HEADER + clip[0].size() * sizeof(int16_t) );
+	expected.insert( expected.end(), (uint8_t *) clip[1].data(), (uint8_t *) ( clip[1].data() + clip[1].size() ) );
+
+	fake_element_output( rdr ).clear();
+	CHECK_EQ( fake_element_run( rdr ), AEL_IO_OK );
+	CHECK( fake_element_output( rdr ) == expected );
+
+	audio_element_deinit( rdr );
+	CHECK_EQ( open_files(), files );
+
+}
+
+// a position set before opening resumes there: the wav header first, then the frame the position is in
+static void test_resume( audio_element_handle_t rdr ) {
+
+	std::vector<uint8_t> file = read_file( "loop.wav" );
+	std::vector<uint8_t> expected( file.begin(), file.begin() + TEST_WAV_HEADER );
+	expected.insert( expected.end(), file.begin() + TEST_WAV_HEADER + 4000, file.end() );
+
+	audio_element_set_uri( rdr, "loop.wav" );
+	sd_reader_set_range( rdr, 0, 0, 0 );
+	fake_element_output( rdr ).clear();
+	audio_element_set_byte_pos( rdr, TEST_WAV_HEADER + 4003 );
+	CHECK_EQ( fake_element_run( rdr ), AEL_IO_OK );
+	CHECK( fake_element_output( rdr ) == expected );
+
+	// a file without header continues right there
+	FILE *f = fopen( "raw.mp3", "wb" );
+	fwrite( file.data() + TEST_WAV_HEADER, 1, 10000, f );
+	fclose( f );
+	audio_element_set_uri( rdr, "raw.mp3" );
+	fake_element_output( rdr ).clear();
+	audio_element_set_byte_pos( rdr, 4003 );
+	CHECK_EQ( fake_element_run( rdr ), AEL_IO_OK );
+	CHECK( fake_element_output( rdr ) == std::vector<uint8_t>( file.begin() + TEST_WAV_HEADER + 4003, file.begin() + TEST_WAV_HEADER + 10000 ) );
+
+}
+
+int main( void ) {
+
+	saw.resize( 2 * FRAMES );
+	for ( int i = 0; i < FRAMES; i++ ) {
+		saw[ 2 * i ] = -10000 + 20000 * i / FRAMES;
+		saw[ 2 * i + 1 ] = -saw[ 2 * i ];
+	}
+	test_write_wav( "loop.wav", saw, 2, RATE );
+
+	audio_element_handle_t rdr = reader_init( SD_READER_CACHE_SIZE );
+
+	test_whole( rdr );
+	test_range( rdr, 1000, 9000 );
+	test_range( rdr, 0, 5001 );
+	test_range( rdr, 7777, FRAMES );
+	test_crossfade( rdr );
+	test_no_loop( rdr );
+	test_resume( rdr );
+
+	audio_element_deinit( rdr );
+
+	test_cache();
+	test_open_latency();
+	test_segments();
+
+	return test_result( "sd_reader" );
+
+}
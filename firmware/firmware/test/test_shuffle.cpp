@@ -0,0 +1,193 @@
+/*
+ * test_shuffle.cpp
+ *
+ * shuffle order of the playlist: passes are permutations, no track twice in a row, seeds reproduce
+ */
+
+#include <stdlib.h>
+#include <vector>
+#include <set>
+
+#include "playlist.h"
+#include "fake_adf.h"
+#include "test.h"
+
+#define TRACKS 10
+
+static PlayList *folder( const char *path, int tracks ) {
+
+	char cmd[128];
+	snprintf( cmd, sizeof(cmd), "rm -rf %s && mkdir -p %s", path, path );
+	CHECK_EQ( system( cmd ), 0 );
+
+	for ( int i = 0; i < tracks; i++ ) {
+		snprintf( cmd, sizeof(cmd), "%s/track%02d.mp3", path, i );
+		fclose( fopen( cmd, "w" ) );
+	}
+
+	PlayList *p = new PlayList();
+	p->readFolders( path );
+	p->selectFolder( 0, true );
+	CHECK_EQ( p->getTracks(), tracks );
+
+	return p;
+
+}
+
+static std::vector<int> draw( PlayList *p, int n ) {
+
+	std::vector<int> order;
+
+	for ( int i = 0; i < n; i++ ) {
+		int8_t next = p->peekTrack();
+		p->nextTrack();
+		CHECK_EQ( p->getActiveTrackNr(), next );
+		order.push_back( p->getActiveTrackNr() );
+	}
+
+	return order;
+
+}
+
+// every pass plays each track once, the next pass doesn't start with the last track
+static void test_passes( PlayList *p, uint32_t seed, int passes ) {
+
+	int tracks = p->getTracks();
+
+	p->setShuffle( false );
+	p->setShuffleSeed( seed );
+	p->setShuffle( true );
+
+	std::vector<int> order = draw( p, passes * tracks );
+
+	for ( int pass = 0; pass < passes; pass++ ) {
+		std::set<int> played( order.begin() + pass * tracks, order.begin() + ( pass + 1 ) * tracks );
+		CHECK_EQ( played.size(), tracks );
+		CHECK( *played.begin() >= 0 );
+		CHECK( *played.rbegin() < tracks );
+	}
+
+	for ( size_t i = 1; i < order.size(); i++ ) {
+		if ( order[i] == order[ i - 1 ] ) {
+			CHECK( order[i] != order[ i - 1 ] );
+			break;
+		}
+	}
+
+}
+
+static void test_seed( PlayList *p ) {
+
+	p->setShuffle( true );
+
+	p->setShuffleSeed( 42 );
+	std::vector<int> a = draw( p, 3 * TRACKS );
+	p->setShuffleSeed( 42 );
+	std::vector<int> b = draw( p, 3 * TRACKS );
+	CHECK( a == b );
+
+	// the same in another playlist of the same folder
+	PlayList *q = folder( "shuffle2", TRACKS );
+	q->setShuffleSeed( 42 );
+	q->setShuffle( true );
+	CHECK( draw( q, 3 * TRACKS ) == a );
+	delete q;
+
+	// small seeds differ from each other
+	p->setShuffleSeed( 1 );
+	a = draw( p, TRACKS );
+	p->setShuffleSeed( 2 );
+	b = draw( p, TRACKS );
+	CHECK( a != b );
+
+	// seed 0 draws a random one
+	fake_random_seed( 7 );
+	p->setShuffleSeed( 0 );
+	a = draw( p, TRACKS );
+	fake_random_seed( 8 );
+	p->setShuffleSeed( 0 );
+	b = draw( p, TRACKS );
+	CHECK( a != b );
+
+}
+
+// the first track of a pass is about uniform over the seeds
+static void test_uniform( PlayList *p ) {
+
+	int count[TRACKS] = {};
+
+	p->setShuffle( true );
+	for ( uint32_t seed = 1; seed <= 2000; seed++ ) {
+		p->setShuffleSeed( seed );
+		p->nextTrack();
+		count[ p->getActiveTrackNr() ]++;
+	}
+
+	for ( int i = 0; i < TRACKS; i++ ) {
+		CHECK( count[i] > 130 );
+		CHECK( count[i] < 270 );
+	}
+
+}
+
+// back within the pass, in reverse order, and forward again the same way
+static void test_prev( PlayList *p ) {
+
+	p->setShuffle( true );
+	p->setShuffleSeed( 5 );
+	std::vector<int> order = draw( p, 6 );
+
+	for ( int i = 4; i >= 0; i-- ) {
+		p->prevTrack();
+		CHECK_EQ( p->getActiveTrackNr(), order[i] );
+	}
+
+	// not before the first track of the pass
+	p->prevTrack();
+	CHECK_EQ( p->getActiveTrackNr(), order[0] );
+
+	std::vector<int> again = draw( p, 5 );
+	CHECK( std::equal( again.begin(), again.end(), order.begin() + 1 ) );
+
+}
+
+static void test_off( PlayList *p ) {
+
+	p->setShuffle( false );
+	CHECK_EQ( p->peekTrack(), -1 );
+
+	p->setActiveTrackNr( TRACKS - 1 );
+	p->nextTrack();
+	CHECK_EQ( p->getActiveTrackNr(), 0 );
+	p->nextTrack();
+	CHECK_EQ( p->getActiveTrackNr(), 1 );
+
+}
+
+int main( void ) {
+
+	PlayList *p = folder( "shuffle", TRACKS );
+
+	for ( uint32_t seed = 1; seed <= 50; seed++ ) {
+		test_passes( p, seed, 5 );
+	}
+	test_seed( p );
+	test_uniform( p );
+	test_prev( p );
+	test_off( p );
+	delete p;
+
+	// the smallest folders
+	p = folder( "shuffle1", 1 );
+	test_passes( p, 3, 1 );
+	draw( p, 3 );
+	CHECK_EQ( p->getActiveTrackNr(), 0 );
+	delete p;
+
+	p = folder( "shuffle2", 2 );
+	test_passes( p, 3, 10 );
+	delete p;
+
+	return test_result( "shuffle" );
+
+}
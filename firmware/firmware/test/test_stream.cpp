@@ -0,0 +1,358 @@
+/*
+ * test_stream.cpp
+ *
+ * the stream reader: the sender writes into the jitter ring like the stream server does,
+ * the element reads it as its task would. the fake semaphores don't block, a wait times out at once.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "stream_reader.h"
+#include "pipeline.h"
+#include "fake_adf.h"
+#include "test.h"
+
+#define RING  ( 8 * 1024 )		// STREAM_READER_BUFFER is larger, a small ring wraps often
+
+static audio_element_handle_t reader;
+static uint32_t sent;			// bytes ever sent, the ring position of the next span
+
+// the pattern the sender sends, its position is known from the byte
+static uint8_t pattern( uint32_t pos ) {
+
+	return ( pos * 7 + ( pos >> 8 ) ) & 0xFF;
+
+}
+
+// writes up to len bytes like a socket receive would, returns the bytes the ring took
+static int send( int len, char *base = NULL ) {
+
+	int done = 0;
+
+	while ( done < len ) {
+		char *span;
+		int free = stream_reader_span( reader, &span, 0 );
+		if ( free <= 0 ) break;
+
+		// received directly into the ring, the span never crosses its end
+		if ( base != NULL ) {
+			CHECK( span == base + ( sent & ( RING - 1 ) ) );
+			CHECK( span + free <= base + RING );
+		}
+
+		int n = ( free < len - done ) ? free : len - done;
+		for ( int i = 0; i < n; i++ ) span[i] = pattern( sent + i );
+		stream_reader_commit( reader, n );
+		sent += n;
+		done += n;
+	}
+
+	return done;
+
+}
+
+// the first span of a new stream is the start of the ring
+static char *begin( int rate = 0, int channels = 0 ) {
+
+	stream_reader_begin( reader, rate, channels );
+	sent = 0;
+
+	char *base;
+	CHECK_EQ( stream_reader_span( reader, &base, 0 ), RING );
+	CHECK_EQ( fake_element_open( reader ), ESP_OK );
+	fake_element_output( reader ).clear();
+
+	return base;
+
+}
+
+static bool received( uint32_t from, uint32_t len ) {
+
+	std::vector<uint8_t> &out = fake_element_output( reader );
+	if ( out.size() != len ) return false;
+
+	for ( uint32_t i = 0; i < len; i++ ) {
+		if ( out[i] != pattern( from + i ) ) return false;
+	}
+
+	return true;
+
+}
+
+static uint32_t get32( const uint8_t *p ) {
+
+	return p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( (uint32_t) p[3] << 24 );
+
+}
+
+static void test_not_begun( void ) {
+
+	char *span;
+
+	CHECK( fake_element_open( reader ) != ESP_OK );
+	CHECK_EQ( stream_reader_span( reader, &span, 0 ), -1 );
+
+}
+
+// raw pcm gets a wav header, before the ring has been filled
+static void test_header( void ) {
+
+	begin( 22050, 2 );
+
+	CHECK_EQ( fake_element_process( reader ), 44 );
+	uint8_t *h = fake_element_output( reader ).data();
+	CHECK( memcmp( h, "RIFF", 4 ) == 0 );
+	CHECK( memcmp( h + 8, "WAVEfmt ", 8 ) == 0 );
+	CHECK_EQ( h[20] | ( h[21] << 8 ), 1 );
+	CHECK_EQ( h[22] | ( h[23] << 8 ), 2 );
+	CHECK_EQ( get32( h + 24 ), 22050u );
+	CHECK_EQ( get32( h + 28 ), 22050u * 4 );
+	CHECK_EQ( h[32] | ( h[33] << 8 ), 4 );
+	CHECK_EQ( h[34] | ( h[35] << 8 ), 16 );
+	CHECK( memcmp( h + 36, "data", 4 ) == 0 );
+	CHECK( get32( h + 40 ) > 0x7F000000u );
+	CHECK_EQ( fake_element_process( reader ), AEL_IO_TIMEOUT );
+
+	fake_element_close( reader );
+
+	// an encoded stream has its own
+	begin();
+	send( RING / 2 );
+	fake_element_process( reader );
+	CHECK( received( 0, 1024 ) );
+
+	fake_element_close( reader );
+
+}
+
+// playback starts half full, and after an underrun when it is half full again
+static void test_prefill( void ) {
+
+	begin();
+
+	CHECK_EQ( send( RING / 2 - 1 ), RING / 2 - 1 );
+	CHECK_EQ( fake_element_process( reader ), AEL_IO_TIMEOUT );
+	CHECK( fake_element_output( reader ).empty() );
+
+	send( 1 );
+	CHECK_EQ( fake_element_process( reader ), 1024 );
+
+	// the rest of it, then the ring is empty
+	int r;
+	while ( ( r = fake_element_process( reader ) ) > 0 ) { }
+	CHECK_EQ( r, AEL_IO_TIMEOUT );
+	CHECK( received( 0, RING / 2 ) );
+
+	// less than half doesn't play
+	fake_element_output( reader ).clear();
+	send( 1000 );
+	CHECK_EQ( fake_element_process( reader ), AEL_IO_TIMEOUT );
+	send( RING / 2 - 1001 );
+	CHECK_EQ( fake_element_process( reader ), AEL_IO_TIMEOUT );
+	send( 1 );
+	CHECK_EQ( fake_element_process( reader ), 1024 );
+	CHECK( received( RING / 2, 1024 ) );
+
+	fake_element_close( reader );
+
+}
+
+// a full ring takes nothing, a read makes room where it read
+static void test_full( void ) {
+
+	char *base = begin();
+	char *span;
+
+	CHECK_EQ( send( 2 * RING, base ), RING );
+	CHECK_EQ( stream_reader_span( reader, &span, 0 ), 0 );
+
+	CHECK_EQ( fake_element_process( reader ), 1024 );
+	CHECK_EQ( stream_reader_span( reader, &span, 0 ), 1024 );
+	CHECK( span == base );
+
+	fake_element_close( reader );
+
+}
+
+// the sender is done: the ring plays to its end, also less than the prefill
+static void test_finish( void ) {
+
+	begin();
+
+	send( 3000 );
+	stream_reader_finish( reader );
+
+	int r, blocks = 0;
+	while ( ( r = fake_element_process( reader ) ) > 0 ) blocks++;
+	CHECK_EQ( r, AEL_IO_DONE );
+	CHECK_EQ( blocks, 3 );
+	CHECK( received( 0, 3000 ) );
+
+	fake_element_close( reader );
+
+}
+
+// a sender without data ends the stream after STREAM_READER_TIMEOUT_MS, data in between restarts the wait
+static void test_stall( void ) {
+
+	begin();
+
+	// 30 polls without data, one with it, then the last poll of the timeout returns done
+	int timeouts = 0;
+	while ( fake_element_process( reader ) == AEL_IO_TIMEOUT ) {
+		if ( ++timeouts == 30 ) send( 10 );
+	}
+	CHECK_EQ( timeouts, 30 + 1 + STREAM_READER_TIMEOUT_MS / 100 - 1 );
+
+	fake_element_close( reader );
+
+}
+
+// a stopped stream doesn't take data, the sender gives up
+static void test_close( void ) {
+
+	char *span;
+
+	begin();
+	send( 100 );
+	fake_element_close( reader );
+
+	CHECK_EQ( stream_reader_span( reader, &span, 0 ), -1 );
+	CHECK_EQ( send( 100 ), 0 );
+	CHECK( fake_element_open( reader ) != ESP_OK );
+
+}
+
+// sender and element take turns with odd sizes: every byte arrives once and in order,
+// the spans are the ring itself
+static void test_order( void ) {
+
+	char *base = begin();
+	uint32_t read = 0;
+	bool ok = true;
+
+	srand( 7 );
+	while ( sent < 40 * RING ) {
+
+		send( 1 + rand() % 1460, base );
+
+		int blocks = rand() % 4;
+		for ( int i = 0; i < blocks; i++ ) {
+			if ( fake_element_process( reader ) <= 0 ) break;
+		}
+
+		ok = ok && received( read, fake_element_output( reader ).size() );
+		read += fake_element_output( reader ).size();
+		fake_element_output( reader ).clear();
+
+	}
+
+	stream_reader_finish( reader );
+	while ( fake_element_process( reader ) > 0 ) { }
+	ok = ok && received( read, sent - read );
+
+	CHECK( ok );
+
+	fake_element_close( reader );
+
+}
+
+// a sender with a full mss per receive, the element reads as fast as it can
+static void test_throughput( void ) {
+
+	const uint32_t total = 64 * 1024 * 1024;
+	uint32_t read = 0;
+
+	begin();
+
+	clock_t start = clock();
+	while ( sent < total ) {
+		char *span;
+		int free = stream_reader_span( reader, &span, 0 );
+		if ( free > 0 ) {
+			int n = ( free < 1460 ) ? free : 1460;
+			if ( n > (int) ( total - sent ) ) n = total - sent;
+			memset( span, 0x55, n );
+			stream_reader_commit( reader, n );
+			sent += n;
+		}
+		if ( fake_element_process( reader ) > 0 ) {
+			read += fake_element_output( reader ).size();
+			fake_element_output( reader ).clear();
+		}
+	}
+	stream_reader_finish( reader );
+	while ( fake_element_process( reader ) > 0 ) {
+		read += fake_element_output( reader ).size();
+		fake_element_output( reader ).clear();
+	}
+	double seconds = (double) ( clock() - start ) / CLOCKS_PER_SEC;
+
+	CHECK_EQ( read, total );
+	printf( "stream: %u MB through a %d byte ring in %.2f s, %.0f MB/s\n", total >> 20, RING, seconds, ( total >> 20 ) / seconds );
+
+	fake_element_close( reader );
+
+}
+
+static Pipeline *player;
+static audio_pipeline_handle_t pipe;
+
+// the stream server asks the pipeline to play: the stream reader replaces the sd reader
+static void test_pipeline( void ) {
+
+	CHECK( player->playStream( FILETYPE_WAV, 44100, 1 ) );
+	CHECK( fake_pipeline_runs( pipe ).back().decoder == "wav" );
+	CHECK( fake_pipeline_element( pipe, "file" ) == player->getStreamReader() );
+
+	char *span;
+	CHECK_EQ( stream_reader_span( player->getStreamReader(), &span, 0 ), STREAM_READER_BUFFER );
+
+	// a clip interrupts the stream, the stream doesn't interrupt the clip
+	CHECK( player->play( player->playList.findName( "horn.mp3" ), 3 ) );
+	CHECK( fake_pipeline_runs( pipe ).back().decoder == "mp3" );
+	CHECK( fake_pipeline_element( pipe, "file" ) != player->getStreamReader() );
+	CHECK( !player->playStream( FILETYPE_MP3 ) );
+
+	player->stop();
+	CHECK( player->playStream( FILETYPE_MP3 ) );
+	CHECK( fake_pipeline_element( pipe, "file" ) == player->getStreamReader() );
+
+	player->stop();
+
+}
+
+int main( void ) {
+
+	stream_reader_cfg_t cfg = STREAM_READER_CFG_DEFAULT();
+	cfg.buffer_size = RING - 100;
+	reader = stream_reader_init( &cfg );
+
+	test_not_begun();
+	test_header();
+	test_prefill();
+	test_full();
+	test_finish();
+	test_stall();
+	test_close();
+	test_order();
+	test_throughput();
+
+	CHECK_EQ( system( "rm -rf stream && mkdir -p stream" ), 0 );
+	fclose( fopen( "stream/horn.mp3", "w" ) );
+
+	player = new Pipeline();
+	player->playList.readFolders( "stream" );
+	player->playList.selectFolder( 0, true );
+	player->setStreamBuffer( STREAM_READER_BUFFER );
+	player->StartCodec();
+	pipe = fake_pipeline( 0 );
+
+	test_pipeline();
+
+	return test_result( "stream" );
+
+}
@@ -0,0 +1,474 @@
+/*
+ * test_tags.cpp
+ *
+ * title, artist and duration from ID3v1/v2 tags, RIFF INFO chunks and vorbis comments
+ */
+
+#include <string.h>
+#include <string>
+
+#include "analyzer.h"
+#include "fake_adf.h"
+#include "test.h"
+
+typedef std::vector<uint8_t> bytes_t;
+
+static void put( bytes_t &b, const void *p, size_t n ) {
+	b.insert( b.end(), (const uint8_t *) p, (const uint8_t *) p + n );
+}
+
+static void put( bytes_t &b, const char *s ) {
+	put( b, s, strlen( s ) );
+}
+
+static void put_le( bytes_t &b, uint32_t x, int n ) {
+	for ( int i = 0; i < n; i++ ) b.push_back( x >> ( 8 * i ) );
+}
+
+static void put_be( bytes_t &b, uint32_t x, int n ) {
+	for ( int i = n - 1; i >= 0; i-- ) b.push_back( x >> ( 8 * i ) );
+}
+
+static void put_syncsafe( bytes_t &b, uint32_t x ) {
+	for ( int i = 3; i >= 0; i-- ) b.push_back( ( x >> ( 7 * i ) ) & 0x7f );
+}
+
+static void write( const char *path, const bytes_t &b ) {
+	FILE *f = fopen( path, "wb" );
+	fwrite( b.data(), 1, b.size(), f );
+	fclose( f );
+}
+
+// <encoding> <text> as an id3 frame of the given version
+static void id3_frame( bytes_t &b, int version, const char *id, uint8_t encoding, const bytes_t &text, uint8_t flags = 0 ) {
+
+	uint32_t n = text.size() + 1;
+
+	put( b, id, ( version >= 3 ) ? 4 : 3 );
+	if ( version >= 4 ) {
+		put_syncsafe( b, n );
+	} else {
+		put_be( b, n, ( version >= 3 ) ? 4 : 3 );
+	}
+	if ( version >= 3 ) {
+		b.push_back( 0 );
+		b.push_back( flags );
+	}
+	b.push_back( encoding );
+	put( b, text.data(), text.size() );
+
+}
+
+static bytes_t text( const char *s ) {
+	return bytes_t( s, s + strlen( s ) );
+}
+
+static bytes_t id3v2( int version, const bytes_t &frames, int padding = 32, uint8_t flags = 0 ) {
+
+	bytes_t b;
+	put( b, "ID3" );
+	b.push_back( version );
+	b.push_back( 0 );
+	b.push_back( flags );
+	put_syncsafe( b, frames.size() + padding );
+	put( b, frames.data(), frames.size() );
+	b.insert( b.end(), padding, 0 );
+
+	return b;
+
+}
+
+// mpeg 1 layer 3, 128kbit/s, 44.1kHz, stereo
+static void mp3_audio( bytes_t &b, size_t size ) {
+
+	static const uint8_t frame[4] = { 0xff, 0xfb, 0x90, 0x00 };
+
+	put( b, frame, 4 );
+	b.insert( b.end(), size - 4, 0 );
+
+}
+
+static void id3v1( bytes_t &b, const char *title, const char *artist ) {
+
+	char tag[128];
+
+	memset( tag, ' ', sizeof(tag) );
+	memcpy( tag, "TAG", 3 );
+	memcpy( &tag[3], title, strlen( title ) );
+	memcpy( &tag[33], artist, strlen( artist ) );
+	put( b, tag, sizeof(tag) );
+
+}
+
+static bool tags_of( const char *path, const bytes_t &b, audio_filetype_t filetype, analyzer_tags_t *tags ) {
+
+	write( path, b );
+	return analyzer_tags( path, filetype, tags );
+
+}
+
+static void test_id3v2( void ) {
+
+	analyzer_tags_t tags;
+	bytes_t frames;
+	bytes_t utf16 = { 0xff, 0xfe, 'A', 0, 'r', 0, 't', 0, 0xe9, 0 };	// little endian with bom
+
+	// v2.3, latin1 title and utf-16 artist, 1s of audio
+	id3_frame( frames, 3, "TALB", 0, text( "Album" ) );
+	id3_frame( frames, 3, "TIT2", 0, text( "Caf\xe9" ) );
+	id3_frame( frames, 3, "TPE1", 1, utf16 );
+	bytes_t b = id3v2( 3, frames );
+	mp3_audio( b, 16000 );
+
+	CHECK( tags_of( "tags.mp3", b, FILETYPE_MP3, &tags ) );
+	CHECK( strcmp( tags.title, "Caf\xc3\xa9" ) == 0 );
+	CHECK( strcmp( tags.artist, "Art\xc3\xa9" ) == 0 );
+	CHECK_EQ( tags.duration, 1000 );
+
+	// v2.4 with syncsafe frame sizes, an extended header and utf-8. big endian utf-16 with a surrogate pair.
+	bytes_t big( 200, 'x' );
+	bytes_t note = { 0xd8, 0x3c, 0xdf, 0xb5, 0, '!' };
+	frames.clear();
+	id3_frame( frames, 4, "COMM", 0, big );
+	id3_frame( frames, 4, "TIT2", 3, text( "Gr\xc3\xbc\xc3\x9f" "e" ) );
+	id3_frame( frames, 4, "TPE1", 2, note );
+	bytes_t ext;
+	put_syncsafe( ext, 6 );
+	ext.push_back( 1 );
+	ext.push_back( 0 );
+	ext.insert( ext.end(), frames.begin(), frames.end() );
+	b = id3v2( 4, ext, 0, 0x40 );
+	mp3_audio( b, 8000 );
+
+	CHECK( tags_of( "tags.mp3", b, FILETYPE_MP3, &tags ) );
+	CHECK( strcmp( tags.title, "Gr\xc3\xbc\xc3\x9f" "e" ) == 0 );
+	CHECK( strcmp( tags.artist, "\xf0\x9f\x8e\xb5!" ) == 0 );
+	CHECK_EQ( tags.duration, 500 );
+
+	// v2.2 with 3 character ids
+	frames.clear();
+	id3_frame( frames, 2, "TT2", 0, text( "Old" ) );
+	id3_frame( frames, 2, "TP1", 0, text( "Timer" ) );
+	b = id3v2( 2, frames );
+	mp3_audio( b, 4000 );
+
+	CHECK( tags_of( "tags.mp3", b, FILETYPE_MP3, &tags ) );
+	CHECK( strcmp( tags.title, "Old" ) == 0 );
+	CHECK( strcmp( tags.artist, "Timer" ) == 0 );
+	CHECK_EQ( tags.duration, 250 );
+
+	// compressed frames are skipped
+	frames.clear();
+	id3_frame( frames, 3, "TIT2", 0, text( "zipped" ), 0x80 );
+	id3_frame( frames, 3, "TPE1", 0, text( "Plain" ) );
+	b = id3v2( 3, frames );
+	mp3_audio( b, 4000 );
+
+	CHECK( tags_of( "tags.mp3", b, FILETYPE_MP3, &tags ) );
+	CHECK( strcmp( tags.title, "" ) == 0 );
+	CHECK( strcmp( tags.artist, "Plain" ) == 0 );
+
+}
+
+static void test_id3v1( void ) {
+
+	analyzer_tags_t tags;
+	bytes_t frames;
+
+	// the trailing tag isn't audio
+	bytes_t b;
+	mp3_audio( b, 16000 );
+	id3v1( b, "Only V1", "Someone" );
+
+	CHECK( tags_of( "tags.mp3", b, FILETYPE_MP3, &tags ) );
+	CHECK( strcmp( tags.title, "Only V1" ) == 0 );
+	CHECK( strcmp( tags.artist, "Someone" ) == 0 );
+	CHECK_EQ( tags.duration, 1000 );
+
+	// it fills what the ID3v2 tag misses
+	id3_frame( frames, 3, "TIT2", 0, text( "V2 Title" ) );
+	b = id3v2( 3, frames );
+	mp3_audio( b, 16000 );
+	id3v1( b, "V1 Title", "V1 Artist" );
+
+	CHECK( tags_of( "tags.mp3", b, FILETYPE_MP3, &tags ) );
+	CHECK( strcmp( tags.title, "V2 Title" ) == 0 );
+	CHECK( strcmp( tags.artist, "V1 Artist" ) == 0 );
+	CHECK_EQ( tags.duration, 1000 );
+
+}
+
+static void test_xing( void ) {
+
+	analyzer_tags_t tags;
+	bytes_t b;
+
+	// 1000 frames of 1152 samples in 522449 bytes are 160kbit/s, the first frame says 128
+	mp3_audio( b, 20000 );
+	memcpy( &b[36], "Xing", 4 );
+	b[43] = 0x03;
+	bytes_t counts;
+	put_be( counts, 1000, 4 );
+	put_be( counts, 522449, 4 );
+	memcpy( &b[44], counts.data(), 8 );
+
+	CHECK( tags_of( "tags.mp3", b, FILETYPE_MP3, &tags ) );
+	CHECK_EQ( tags.duration, 1000 );
+
+}
+
+static void test_text( void ) {
+
+	analyzer_tags_t tags;
+	bytes_t frames;
+
+	// a long title is cut at a character, invalid utf-8 is latin1
+	bytes_t long_title( 100, 0xe9 );
+	id3_frame( frames, 3, "TIT2", 0, long_title );
+	id3_frame( frames, 3, "TPE1", 3, text( "caf\xe9 \x01" ) );
+	bytes_t b = id3v2( 3, frames );
+	mp3_audio( b, 4000 );
+
+	CHECK( tags_of( "tags.mp3", b, FILETYPE_MP3, &tags ) );
+	CHECK_EQ( strlen( tags.title ), ANALYZER_TEXT_MAX - 2 );
+	CHECK( strncmp( tags.title, "\xc3\xa9\xc3\xa9", 4 ) == 0 );
+	CHECK( strcmp( tags.artist, "caf\xc3\xa9" ) == 0 );
+
+	// a text ends at its first 0
+	frames.clear();
+	bytes_t two = { 'o', 'n', 'e', 0, 't', 'w', 'o' };
+	id3_frame( frames, 3, "TIT2", 0, two );
+	b = id3v2( 3, frames );
+	mp3_audio( b, 4000 );
+
+	CHECK( tags_of( "tags.mp3", b, FILETYPE_MP3, &tags ) );
+	CHECK( strcmp( tags.title, "one" ) == 0 );
+
+}
+
+static bytes_t wav_header( uint32_t rate, uint16_t channels ) {
+
+	bytes_t b;
+	put( b, "RIFF" );
+	put_le( b, 0, 4 );
+	put( b, "WAVE" );
+	put( b, "fmt " );
+	put_le( b, 16, 4 );
+	put_le( b, 1, 2 );
+	put_le( b, channels, 2 );
+	put_le( b, rate, 4 );
+	put_le( b, rate * channels * 2, 4 );
+	put_le( b, channels * 2, 2 );
+	put_le( b, 16, 2 );
+
+	return b;
+
+}
+
+static void info_item( bytes_t &b, const char *id, const char *s ) {
+
+	uint32_t n = strlen( s ) + 1;
+
+	put( b, id );
+	put_le( b, n, 4 );
+	put( b, s, n );
+	if ( n & 1 ) b.push_back( 0 );
+
+}
+
+static void test_wav( void ) {
+
+	analyzer_tags_t tags;
+
+	// 2s of audio, the INFO list behind the data
+	bytes_t b = wav_header( 22050, 2 );
+	put( b, "data" );
+	put_le( b, 2 * 22050 * 4, 4 );
+	b.insert( b.end(), 2 * 22050 * 4, 0 );
+
+	bytes_t info;
+	put( info, "INFO" );
+	info_item( info, "ISFT", "test" );
+	info_item( info, "INAM", "Odd" );
+	info_item( info, "IART", "Wav Artist" );
+	put( b, "LIST" );
+	put_le( b, info.size(), 4 );
+	put( b, info.data(), info.size() );
+
+	CHECK( tags_of( "tags.wav", b, FILETYPE_WAV, &tags ) );
+	CHECK( strcmp( tags.title, "Odd" ) == 0 );
+	CHECK( strcmp( tags.artist, "Wav Artist" ) == 0 );
+	CHECK_EQ( tags.duration, 2000 );
+
+	// an id3 chunk, the data size of a stream is larger than the file
+	bytes_t frames;
+	id3_frame( frames, 3, "TIT2", 0, text( "Chunk" ) );
+	bytes_t tag = id3v2( 3, frames, 1 );
+	b = wav_header( 8000, 1 );
+	put( b, "id3 " );
+	put_le( b, tag.size(), 4 );
+	put( b, tag.data(), tag.size() );
+	if ( tag.size() & 1 ) b.push_back( 0 );
+	put( b, "data" );
+	put_le( b, 0xffffffff, 4 );
+	b.insert( b.end(), 8000, 0 );
+
+	CHECK( tags_of( "tags.wav", b, FILETYPE_WAV, &tags ) );
+	CHECK( strcmp( tags.title, "Chunk" ) == 0 );
+	CHECK( strcmp( tags.artist, "" ) == 0 );
+	CHECK_EQ( tags.duration, 500 );
+
+	// the header of test_write_wav
+	std::vector<int16_t> pcm( 44100, 0 );
+	test_write_wav( "tags.wav", pcm, 1, 44100 );
+	CHECK( analyzer_tags( "tags.wav", FILETYPE_WAV, &tags ) );
+	CHECK( strcmp( tags.title, "" ) == 0 );
+	CHECK_EQ( tags.duration, 1000 );
+
+}
+
+static void ogg_page( bytes_t &b, uint64_t granule, const bytes_t &body ) {
+
+	put( b, "OggS" );
+	b.push_back( 0 );
+	b.push_back( 0 );
+	put_le( b, granule, 4 );
+	put_le( b, granule >> 32, 4 );
+	put_le( b, 1234, 4 );
+	put_le( b, 0, 4 );
+	put_le( b, 0, 4 );
+
+	size_t segments = body.size() / 255 + 1;
+	b.push_back( segments );
+	for ( size_t i = 0; i + 1 < segments; i++ ) b.push_back( 255 );
+	b.push_back( body.size() % 255 );
+
+	put( b, body.data(), body.size() );
+
+}
+
+static void comment( bytes_t &b, const char *s ) {
+
+	put_le( b, strlen( s ), 4 );
+	put( b, s );
+
+}
+
+static void test_ogg( void ) {
+
+	analyzer_tags_t tags;
+	bytes_t b, body;
+
+	// vorbis at 44.1kHz, 2.5s
+	put( body, "\x01vorbis" );
+	put_le( body, 0, 4 );
+	body.push_back( 2 );
+	put_le( body, 44100, 4 );
+	body.insert( body.end(), 12, 0 );
+	ogg_page( b, 0, body );
+
+	body.clear();
+	put( body, "\x03vorbis" );
+	comment( body, "test vendor" );
+	put_le( body, 3, 4 );
+	comment( body, "ALBUM=x" );
+	comment( body, "title=Vorbis" );
+	comment( body, "ARTIST=\xc3\x89" "cole" );
+	ogg_page( b, 0, body );
+
+	body.assign( 300, 0x55 );
+	ogg_page( b, 44100, body );
+	ogg_page( b, 44100 * 5 / 2, body );
+
+	CHECK( tags_of( "tags.ogg", b, FILETYPE_OGG, &tags ) );
+	CHECK( strcmp( tags.title, "Vorbis" ) == 0 );
+	CHECK( strcmp( tags.artist, "\xc3\x89" "cole" ) == 0 );
+	CHECK_EQ( tags.duration, 2500 );
+
+	// opus counts in 48kHz without the pre-skip, 3s
+	b.clear();
+	body.clear();
+	put( body, "OpusHead" );
+	body.push_back( 1 );
+	body.push_back( 2 );
+	put_le( body, 312, 2 );
+	put_le( body, 48000, 4 );
+	body.insert( body.end(), 3, 0 );
+	ogg_page( b, 0, body );
+
+	body.clear();
+	put( body, "OpusTags" );
+	comment( body, "" );
+	put_le( body, 1, 4 );
+	comment( body, "TITLE=Opus" );
+	ogg_page( b, 0, body );
+
+	body.assign( 100, 0 );
+	ogg_page( b, 48000 * 3 + 312, body );
+
+	CHECK( tags_of( "tags.opus", b, FILETYPE_OGG, &tags ) );
+	CHECK( strcmp( tags.title, "Opus" ) == 0 );
+	CHECK( strcmp( tags.artist, "" ) == 0 );
+	CHECK_EQ( tags.duration, 3000 );
+
+	// a count beyond the page stops at its end
+	b.clear();
+	body.clear();
+	put( body, "\x01vorbis" );
+	put_le( body, 0, 4 );
+	body.push_back( 1 );
+	put_le( body, 8000, 4 );
+	body.insert( body.end(), 12, 0 );
+	ogg_page( b, 0, body );
+	body.clear();
+	put( body, "\x03vorbis" );
+	comment( body, "" );
+	put_le( body, 1000, 4 );
+	comment( body, "ARTIST=Cut" );
+	put_le( body, 50, 4 );
+	put( body, "TITLE=" );
+	ogg_page( b, 8000, body );
+
+	CHECK( tags_of( "tags.ogg", b, FILETYPE_OGG, &tags ) );
+	CHECK( strcmp( tags.title, "" ) == 0 );
+	CHECK( strcmp( tags.artist, "Cut" ) == 0 );
+	CHECK_EQ( tags.duration, 1000 );
+
+}
+
+static void test_none( void ) {
+
+	analyzer_tags_t tags;
+	bytes_t b( 1000, 0 );
+
+	CHECK( !analyzer_tags( "missing.mp3", FILETYPE_MP3, &tags ) );
+	CHECK( !tags_of( "tags.mp3", b, FILETYPE_MP3, &tags ) );
+	CHECK( !tags_of( "tags.wav", b, FILETYPE_WAV, &tags ) );
+	CHECK( !tags_of( "tags.ogg", b, FILETYPE_OGG, &tags ) );
+	CHECK( strcmp( tags.title, "" ) == 0 );
+	CHECK_EQ( tags.duration, 0 );
+
+	// a tag claiming more than the file holds
+	bytes_t frames;
+	id3_frame( frames, 3, "TIT2", 0, text( "Short" ) );
+	b = id3v2( 3, frames, 5000 );
+	b.resize( 40 );
+	CHECK( tags_of( "tags.mp3", b, FILETYPE_MP3, &tags ) );
+	CHECK( strcmp( tags.title, "Short" ) == 0 );
+	CHECK_EQ( tags.duration, 0 );
+
+}
+
+int main( void ) {
+
+	test_id3v2();
+	test_id3v1();
+	test_xing();
+	test_text();
+	test_wav();
+	test_ogg();
+	test_none();
+
+	return test_result( "tags" );
+
+}
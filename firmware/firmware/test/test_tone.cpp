@@ -0,0 +1,263 @@
+/*
+ * test_tone.cpp
+ *
+ * frequency, length, envelope and waveforms of the tone generator, and what they cost
+ */
+
+#include <time.h>
+#include <audio_element.h>
+
+#include "tone_generator.h"
+#include "fake_adf.h"
+#include "test.h"
+
+static audio_element_handle_t gen;
+static int rate;
+
+static std::vector<int16_t> play( const tone_t *tone ) {
+
+	tone_generator_set( gen, tone );
+	fake_element_output( gen ).clear();
+	CHECK_EQ( fake_element_run( gen ), AEL_IO_DONE );
+
+	std::vector<int16_t> out = fake_element_pcm( gen );
+	for ( size_t i = 0; i < out.size(); i += 2 ) {
+		if ( out[i] != out[ i + 1 ] ) {
+			CHECK_EQ( out[i], out[ i + 1 ] );
+			break;
+		}
+	}
+
+	return out;
+
+}
+
+static void test_frequency( int frequency ) {
+
+	tone_t tone = TONE_DEFAULT();
+	tone.frequency = frequency;
+	tone.duration = 500;
+
+	std::vector<int16_t> out = play( &tone );
+	int frames = out.size() / 2;
+
+	CHECK_EQ( frames, rate / 2 );
+	CHECK_NEAR( test_frequency( out.data(), frames, 2, rate ), frequency, frequency * 1e-4 );
+
+	// sustain against the ideal sine, the table is interpolated
+	int gain = 50 * 32767 / 100;
+	double signal = 0, noise = 0;
+	for ( int i = rate / 100; i < frames - rate / 20; i++ ) {
+		double ref = gain * sin( 2 * M_PI * frequency * (double) i / rate );
+		signal += ref * ref;
+		noise += ( out[ 2 * i ] - ref ) * ( out[ 2 * i ] - ref );
+	}
+	CHECK( 10 * log10( signal / noise ) > 70 );
+
+}
+
+static void test_envelope( void ) {
+
+	tone_t tone = TONE_DEFAULT();
+	tone.frequency = 2000;
+	tone.duration = 300;
+	tone.attack = 20;
+	tone.decay = 30;
+	tone.sustain = 50;
+	tone.release = 100;
+	tone.level = 80;
+
+	std::vector<int16_t> out = play( &tone );
+	int frames = out.size() / 2;
+
+	CHECK_EQ( frames, 300 * rate / 1000 );
+
+	// peak of the 1ms around a point in time
+	auto level = [&]( int t ) {
+		int peak = 0;
+		int center = t * rate / 1000;
+		for ( int i = center - rate / 2000; i < center + rate / 2000; i++ ) {
+			if ( ( i >= 0 ) && ( i < frames ) && ( abs( out[ 2 * i ] ) > peak ) ) peak = abs( out[ 2 * i ] );
+		}
+		return peak / ( 0.8 * 32767 );
+	};
+
+	CHECK( level( 0 ) < 0.05 );
+	CHECK_NEAR( level( 10 ), 0.5, 0.05 );
+	CHECK_NEAR( level( 20 ), 1.0, 0.03 );
+	CHECK_NEAR( level( 35 ), 0.75, 0.05 );
+	CHECK_NEAR( level( 50 ), 0.5, 0.03 );
+	CHECK_NEAR( level( 150 ), 0.5, 0.01 );
+	CHECK_NEAR( level( 200 ), 0.5, 0.03 );
+	CHECK_NEAR( level( 250 ), 0.25, 0.05 );
+	CHECK( level( 300 ) < 0.05 );
+
+	// no click at the end
+	CHECK( abs( out[ 2 * ( frames - 1 ) ] ) < 100 );
+
+}
+
+static void test_square( void ) {
+
+	tone_t tone = TONE_DEFAULT();
+	tone.waveform = TONE_SQUARE;
+	tone.frequency = 750;
+	tone.duration = 400;
+
+	std::vector<int16_t> out = play( &tone );
+	int frames = out.size() / 2;
+	int gain = 50 * 32767 / 100;
+
+	CHECK_NEAR( test_frequency( out.data(), frames, 2, rate ), 750, 1 );
+
+	// two levels in the sustain
+	for ( int i = rate / 100; i < frames - rate / 20; i++ ) CHECK_NEAR( abs( out[ 2 * i ] ), gain, 1 );
+
+}
+
+static void test_sweep( void ) {
+
+	tone_t tone = TONE_DEFAULT();
+	tone.waveform = TONE_SWEEP;
+	tone.frequency = 500;
+	tone.frequency_end = 4500;
+	tone.duration = 1000;
+
+	std::vector<int16_t> out = play( &tone );
+	int frames = out.size() / 2;
+	int window = rate / 20;
+
+	// linear: the mean frequency of a window is the frequency of its center
+	for ( int t = 100; t <= 850; t += 250 ) {
+		int start = t * rate / 1000;
+		double center = 500 + 4000.0 * ( start + window / 2 ) / frames;
+		CHECK_NEAR( test_frequency( &out[ 2 * start ], window, 2, rate ), center, center * 0.01 );
+	}
+
+}
+
+static void test_noise( void ) {
+
+	tone_t tone = TONE_DEFAULT();
+	tone.waveform = TONE_NOISE;
+	tone.duration = 500;
+
+	std::vector<int16_t> a = play( &tone );
+	std::vector<int16_t> b = play( &tone );
+
+	// the same for each run, white and centered
+	CHECK( a == b );
+
+	double mean = 0;
+	int crossings = 0;
+	int n = a.size() / 2;
+	for ( int i = 1; i < n; i++ ) {
+		mean += a[ 2 * i ];
+		if ( ( a[ 2 * i - 2 ] < 0 ) != ( a[ 2 * i ] < 0 ) ) crossings++;
+	}
+	mean /= n;
+
+	CHECK( fabs( mean ) < 200 );
+	CHECK_NEAR( (double) crossings / n, 0.5, 0.05 );
+
+}
+
+static void test_limits( void ) {
+
+	tone_t tone = TONE_DEFAULT();
+	tone.frequency = 30000;
+	tone.duration = 20000;
+	tone.level = 200;
+
+	std::vector<int16_t> out = play( &tone );
+	CHECK_EQ( out.size() / 2, (size_t) TONE_MAX_DURATION * rate / 1000 );
+
+	// the same as the highest frequency at full level
+	tone.frequency = ( rate / 2 < TONE_MAX_FREQUENCY ) ? rate / 2 : TONE_MAX_FREQUENCY;
+	tone.duration = TONE_MAX_DURATION;
+	tone.level = 100;
+	CHECK( play( &tone ) == out );
+
+	tone.frequency = 5;
+	out = play( &tone );
+	tone.frequency = TONE_MIN_FREQUENCY;
+	CHECK( play( &tone ) == out );
+
+	tone = TONE_DEFAULT();
+	tone.duration = 0;
+	CHECK( play( &tone ).empty() );
+
+}
+
+static void test_rate( int r ) {
+
+	tone_generator_cfg_t cfg = DEFAULT_TONE_GENERATOR_CONFIG();
+	cfg.rate = rate = r;
+	gen = tone_generator_init( &cfg );
+
+	test_frequency( 100 );
+	test_frequency( 440 );
+	test_frequency( 1000 );
+	test_frequency( 3520 );
+	test_frequency( 7777 );
+	test_envelope();
+	test_square();
+	test_sweep();
+	test_noise();
+	test_limits();
+
+	audio_element_info_t info;
+	audio_element_getinfo( gen, &info );
+	CHECK_EQ( info.sample_rates, r );
+	CHECK_EQ( info.channels, 2 );
+
+	audio_element_deinit( gen );
+
+}
+
+// ns per output sample of each waveform at 44.1kHz, the longest tone repeated
+static void test_cost( void ) {
+
+	static const char *name[] = { "sine", "square", "sweep", "noise" };
+	const int repeat = 10;
+
+	tone_generator_cfg_t cfg = DEFAULT_TONE_GENERATOR_CONFIG();
+	cfg.rate = rate = 44100;
+	gen = tone_generator_init( &cfg );
+
+	for ( int w = TONE_SINE; w <= TONE_NOISE; w++ ) {
+
+		tone_t tone = TONE_DEFAULT();
+		tone.waveform = (tone_waveform_t) w;
+		tone.frequency_end = 8000;
+		tone.duration = TONE_MAX_DURATION;
+
+		size_t samples = 0;
+		clock_t start = clock();
+		for ( int i = 0; i < repeat; i++ ) {
+			tone_generator_set( gen, &tone );
+			fake_element_output( gen ).clear();
+			CHECK_EQ( fake_element_run( gen ), AEL_IO_DONE );
+			samples += fake_element_output( gen ).size() / sizeof(int16_t);
+		}
+		double seconds = (double) ( clock() - start ) / CLOCKS_PER_SEC;
+
+		CHECK_EQ( samples, (size_t) repeat * 2 * TONE_MAX_DURATION * rate / 1000 );
+		printf( "tone: %s, %.1f ns per sample, %.0f times real time\n", name[w], 1e9 * seconds / samples, samples / seconds / ( 2 * rate ) );
+
+	}
+
+	audio_element_deinit( gen );
+
+}
+
+int main( void ) {
+
+	test_rate( 44100 );
+	test_rate( 22050 );
+	test_rate( 48000 );
+	test_cost();
+
+	return test_result( "tone" );
+
+}
@@ -0,0 +1,255 @@
+/*
+ * test_trim.cpp
+ *
+ * silence trimming and .trim cue points of the analyzer, read back through the sd card reader
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "analyzer.h"
+#include "playlist.h"
+#include "sd_reader.h"
+#include "fake_adf.h"
+#include "test.h"
+
+#define RATE       22050
+#define TRIM_LEVEL (-50)
+#define NOISE      (20)			// -64dB, below the trim level
+#define SOUND      (1000)
+
+#define MARGIN_FRAMES ( RATE * ANALYZER_TRIM_MARGIN_MS / 1000 )
+
+// stereo, lead ms of noise, 300ms of sound, tail ms of noise
+static std::vector<int16_t> effect( int lead, int tail ) {
+
+	int lead_frames = RATE * lead / 1000;
+	int sound_frames = RATE * 300 / 1000;
+	std::vector<int16_t> pcm = test_sine( lead_frames + sound_frames + RATE * tail / 1000, 2, RATE, 200.0, NOISE );
+	std::vector<int16_t> sound = test_sine( sound_frames, 2, RATE, 440.0, SOUND );
+
+	std::copy( sound.begin(), sound.end(), pcm.begin() + 2 * lead_frames );
+
+	return pcm;
+
+}
+
+// frames before the first sample above the trim level
+static int latency( const std::vector<int16_t> &pcm ) {
+
+	for ( size_t i = 0; i < pcm.size(); i++ ) {
+		if ( abs( pcm[i] ) > 2 * NOISE ) return i / 2;
+	}
+
+	return pcm.size() / 2;
+
+}
+
+// plays the file like the pipeline, the header followed by the range
+static std::vector<uint8_t> play( audio_element_handle_t rdr, const char *path, const analyzer_result_t *result ) {
+
+	audio_element_set_uri( rdr, path );
+	fake_element_output( rdr ).clear();
+	sd_reader_set_range( rdr, result->head, result->start, result->end );
+	fake_element_run( rdr );
+
+	return fake_element_output( rdr );
+
+}
+
+static std::vector<int16_t> audio( const std::vector<uint8_t> &out ) {
+
+	std::vector<int16_t> pcm( ( out.size() - TEST_WAV_HEADER ) / sizeof(int16_t) );
+	memcpy( pcm.data(), &out[TEST_WAV_HEADER], pcm.size() * sizeof(int16_t) );
+
+	return pcm;
+
+}
+
+// the sample set, the latency of each file is cut to the margin in front of the sound
+static void test_latency( audio_element_handle_t rdr ) {
+
+	static const int lead[] = { 0, 5, 40, 120, 250, 600 };
+	int before = 0;
+	int after = 0;
+
+	for ( int lead_ms : lead ) {
+
+		analyzer_result_t result;
+		analyzer_result_t whole = {};
+		std::vector<int16_t> pcm = effect( lead_ms, 100 );
+
+		test_write_wav( "trim.wav", pcm, 2, RATE );
+		CHECK( analyzer_track( "trim.wav", FILETYPE_WAV, -16, TRIM_LEVEL, &result ) );
+
+		std::vector<uint8_t> untrimmed = play( rdr, "trim.wav", &whole );
+		std::vector<uint8_t> trimmed = play( rdr, "trim.wav", &result );
+
+		// the header stays in front for the decoder
+		CHECK_EQ( result.head, TEST_WAV_HEADER );
+		CHECK( std::equal( untrimmed.begin(), untrimmed.begin() + TEST_WAV_HEADER, trimmed.begin() ) );
+
+		int lead_frames = RATE * lead_ms / 1000;
+		int latency_before = latency( audio( untrimmed ) );
+		int latency_after = latency( audio( trimmed ) );
+
+		CHECK_NEAR( latency_before, lead_frames, 1 );
+		CHECK_NEAR( latency_after, std::min( lead_frames, MARGIN_FRAMES ), 1 );
+
+		// the trimmed audio is a piece of the file: sound, margin and no tail
+		std::vector<int16_t> cut = audio( trimmed );
+		int first = ( result.start - TEST_WAV_HEADER ) / 2;
+		CHECK( std::equal( cut.begin(), cut.end(), pcm.begin() + first ) );
+		CHECK_NEAR( (int) cut.size() / 2, RATE * 300 / 1000 + std::min( lead_frames, MARGIN_FRAMES ) + MARGIN_FRAMES, 2 );
+
+		before += latency_before;
+		after += latency_after;
+
+	}
+
+	printf( "trim: latency %d ms -> %d ms over %d files\n", before * 1000 / RATE, after * 1000 / RATE, (int) ( sizeof(lead) / sizeof(lead[0]) ) );
+	CHECK( after * 10 < before );
+
+}
+
+// no trim level keeps the file, all silence leaves a single frame
+static void test_levels( void ) {
+
+	analyzer_result_t result;
+
+	test_write_wav( "trim.wav", effect( 200, 200 ), 2, RATE );
+	CHECK( analyzer_track( "trim.wav", FILETYPE_WAV, -16, 0, &result ) );
+	CHECK_EQ( result.start, 0 );
+	CHECK_EQ( result.end, 0 );
+
+	// the noise is above -70dB
+	CHECK( analyzer_track( "trim.wav", FILETYPE_WAV, -16, -70, &result ) );
+	CHECK_EQ( result.start, 0 );
+	CHECK_EQ( result.end, 0 );
+
+	// sound up to the ends needs no range
+	test_write_wav( "trim.wav", effect( 0, 0 ), 2, RATE );
+	CHECK( analyzer_track( "trim.wav", FILETYPE_WAV, -16, TRIM_LEVEL, &result ) );
+	CHECK_EQ( result.start, 0 );
+	CHECK_EQ( result.end, 0 );
+
+	std::vector<int16_t> silence( 2 * RATE, 0 );
+	silence[RATE] = 1000;
+	test_write_wav( "trim.wav", silence, 2, RATE );
+	CHECK( analyzer_track( "trim.wav", FILETYPE_WAV, -16, TRIM_LEVEL, &result ) );
+	CHECK_EQ( result.start, TEST_WAV_HEADER + ( RATE / 2 - MARGIN_FRAMES ) * 4 );
+	CHECK_EQ( result.end, TEST_WAV_HEADER + ( RATE / 2 + 1 + MARGIN_FRAMES ) * 4 );
+
+}
+
+static void cue( const char *path, const char *text ) {
+
+	char name[100];
+	snprintf( name, sizeof(name), "%s.trim", path );
+
+	FILE *f = fopen( name, "w" );
+	fputs( text, f );
+	fclose( f );
+
+}
+
+// cue points replace the detection, loop points alone don't
+static void test_cue( void ) {
+
+	analyzer_result_t result;
+
+	test_write_wav( "cue.wav", effect( 200, 200 ), 2, RATE );
+
+	cue( "cue.wav", "START=100\nEND=400\n" );
+	CHECK( analyzer_track( "cue.wav", FILETYPE_WAV, -16, TRIM_LEVEL, &result ) );
+	CHECK_EQ( result.head, TEST_WAV_HEADER );
+	CHECK_EQ( result.start, TEST_WAV_HEADER + RATE / 10 * 4 );
+	CHECK_EQ( result.end, TEST_WAV_HEADER + RATE * 4 / 10 * 4 );
+
+	// beyond the end is the end
+	cue( "cue.wav", "START=150\nEND=99999\n" );
+	CHECK( analyzer_track( "cue.wav", FILETYPE_WAV, -16, TRIM_LEVEL, &result ) );
+	CHECK_EQ( result.start, TEST_WAV_HEADER + RATE * 15 / 100 * 4 );
+	CHECK_EQ( result.end, TEST_WAV_HEADER + RATE * 7 / 10 * 4 );
+
+	cue( "cue.wav", "LOOP_START=250\nLOOP_END=450\n" );
+	CHECK( analyzer_track( "cue.wav", FILETYPE_WAV, -16, TRIM_LEVEL, &result ) );
+	CHECK_NEAR( result.start, TEST_WAV_HEADER + ( RATE / 5 - MARGIN_FRAMES ) * 4, 4 );
+	CHECK_EQ( result.loop_start, TEST_WAV_HEADER + RATE / 4 * 4 );
+	CHECK_EQ( result.loop_end, TEST_WAV_HEADER + RATE * 45 / 100 * 4 );
+
+	// cbr mp3 at 128kbit/s is 16 bytes per ms from the first frame
+	FILE *f = fopen( "cue.mp3", "wb" );
+	for ( int i = 0; i < 100; i++ ) fputc( 0, f );
+	fputc( 0xff, f );
+	fputc( 0xfb, f );
+	fputc( 0x90, f );
+	for ( int i = 0; i < 16000; i++ ) fputc( 0, f );
+	fclose( f );
+
+	cue( "cue.mp3", "START=250\nEND=750\n" );
+	CHECK( analyzer_track( "cue.mp3", FILETYPE_MP3, -16, TRIM_LEVEL, &result ) );
+	CHECK_EQ( result.head, 0 );
+	CHECK_EQ( result.start, 100 + 250 * 16 );
+	CHECK_EQ( result.end, 100 + 750 * 16 );
+
+	// without cue points mp3 isn't trimmed
+	remove( "cue.mp3.trim" );
+	CHECK( !analyzer_track( "cue.mp3", FILETYPE_MP3, -16, TRIM_LEVEL, &result ) );
+	CHECK_EQ( result.start, 0 );
+
+}
+
+// trim points survive saving and loading the index
+static void test_index( void ) {
+
+	CHECK_EQ( system( "rm -rf trim && mkdir -p trim" ), 0 );
+	test_write_wav( "trim/horn.wav", effect( 300, 50 ), 2, RATE );
+
+	PlayList *p = new PlayList();
+	p->readFolders( "trim" );
+	p->selectFolder( 0, true );
+
+	int8_t nr = p->findName( "horn.wav" );
+	analyzer_result_t result;
+	char path[100];
+	uint32_t head, start, end;
+
+	p->getPath( nr, path, sizeof(path) );
+	CHECK( analyzer_track( path, FILETYPE_WAV, -16, TRIM_LEVEL, &result ) );
+	CHECK( !p->getTrim( nr, &head, &start, &end ) );
+	p->setTrim( nr, result.head, result.start, result.end );
+
+	char index[100];
+	p->getIndexFile( index, sizeof(index) );
+	p->saveIndex( index );
+	delete p;
+
+	p = new PlayList();
+	p->readFolders( "trim" );
+	p->selectFolder( 0, false );
+	nr = p->findName( "horn.wav" );
+	CHECK( p->getTrim( nr, &head, &start, &end ) );
+	CHECK_EQ( head, result.head );
+	CHECK_EQ( start, result.start );
+	CHECK_EQ( end, result.end );
+	delete p;
+
+}
+
+int main( void ) {
+
+	sd_reader_cfg_t cfg = SD_READER_CFG_DEFAULT();
+	cfg.read_size = 4096;
+	audio_element_handle_t rdr = sd_reader_init( &cfg );
+
+	test_latency( rdr );
+	test_levels();
+	test_cue();
+	test_index();
+
+	audio_element_deinit( rdr );
+
+	return test_result( "trim" );
+
+}